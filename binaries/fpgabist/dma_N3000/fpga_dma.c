@@ -158,26 +158,12 @@ static fpga_result MMIOWrite64Blk(fpga_dma_handle dma_h, uint64_t device,
 	assert(IS_ALIGNED_QWORD(bytes));
 
 	uint64_t *haddr = (uint64_t *)host;
-	uint64_t i;
 	fpga_result res = FPGA_OK;
 
-#ifndef USE_ASE
-	volatile uint64_t *dev_addr = HOST_MMIO_64_ADDR(dma_h, device);
-#endif
-
 	debug_print("copying %lld bytes from 0x%p to 0x%p\n",
 		    (long long int)bytes, haddr, (void *)device);
-	for (i = 0; i < bytes / sizeof(uint64_t); i++) {
-#ifdef USE_ASE
-		res = fpgaWriteMMIO64(dma_h->fpga_h, dma_h->mmio_num, device,
-				      *haddr);
-		ON_ERR_RETURN(res, "fpgaWriteMMIO64");
-		haddr++;
-		device += sizeof(uint64_t);
-#else
-		*dev_addr++ = *haddr++;
-#endif
-	}
+	res = fpgaCopyToMMIO(dma_h->fpga_h, dma_h->mmio_num, device, haddr, bytes);
+	ON_ERR_RETURN(res, "fpgaCopyToMMIO");
 	return res;
 }
 
@@ -240,26 +226,12 @@ static fpga_result MMIORead64Blk(fpga_dma_handle dma_h, uint64_t device,
 	assert(IS_ALIGNED_QWORD(bytes));
 
 	uint64_t *haddr = (uint64_t *)host;
-	uint64_t i;
 	fpga_result res = FPGA_OK;
 
-#ifndef USE_ASE
-	volatile uint64_t *dev_addr = HOST_MMIO_64_ADDR(dma_h, device);
-#endif
-
 	debug_print("copying %lld bytes from 0x%p to 0x%p\n",
 		    (long long int)bytes, (void *)device, haddr);
-	for (i = 0; i < bytes / sizeof(uint64_t); i++) {
-#ifdef USE_ASE
-		res = fpgaReadMMIO64(dma_h->fpga_h, dma_h->mmio_num, device,
-				     haddr);
-		ON_ERR_RETURN(res, "fpgaReadMMIO64");
-		haddr++;
-		device += sizeof(uint64_t);
-#else
-		*haddr++ = *dev_addr++;
-#endif
-	}
+	res = fpgaCopyFromMMIO(dma_h->fpga_h, dma_h->mmio_num, device, haddr, bytes);
+	ON_ERR_RETURN(res, "fpgaCopyFromMMIO");
 	return res;
 }
 
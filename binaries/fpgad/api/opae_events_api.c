@@ -42,15 +42,53 @@ log_printf("opae_events_api: " format, ##__VA_ARGS__)
 STATIC pthread_mutex_t list_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 STATIC api_client_event_registry *event_registry_list;
 
+/*
+** The registrations of each client, indexed by conn_socket. Socket
+** descriptors are small, dense integers, so a client's registrations
+** are found without walking event_registry_list.
+*/
+STATIC api_client_event_registry **client_registry;
+STATIC size_t client_registry_size;
+
+// 0 on success
+STATIC int grow_client_registry(int conn_socket)
+{
+	size_t size = client_registry_size ? client_registry_size : 64;
+	api_client_event_registry **table;
+
+	while (size <= (size_t)conn_socket)
+		size *= 2;
+
+	table = (api_client_event_registry **)
+		opae_calloc(size, sizeof(api_client_event_registry *));
+	if (!table)
+		return ENOMEM;
+
+	if (client_registry) {
+		memcpy(table, client_registry,
+		       client_registry_size * sizeof(*table));
+		opae_free(client_registry);
+	}
+
+	client_registry = table;
+	client_registry_size = size;
+
+	return 0;
+}
+
 int opae_api_register_event(int conn_socket,
 			    int fd,
 			    fpga_event_type e,
 			    uint64_t object_id)
 {
-	api_client_event_registry *r =
-		(api_client_event_registry *) opae_malloc(sizeof(*r));
+	api_client_event_registry *r;
 	int err;
+	int res = 0;
+
+	if (conn_socket < 0)
+		return EINVAL;
 
+	r = (api_client_event_registry *) opae_malloc(sizeof(*r));
 	if (!r)
 		return ENOMEM;
 
@@ -62,12 +100,26 @@ int opae_api_register_event(int conn_socket,
 
 	fpgad_mutex_lock(err, &list_lock);
 
+	if (((size_t)conn_socket >= client_registry_size) &&
+	    grow_client_registry(conn_socket)) {
+		opae_free(r);
+		res = ENOMEM;
+		goto out_unlock;
+	}
+
+	r->prev = NULL;
 	r->next = event_registry_list;
+	if (r->next)
+		r->next->prev = r;
 	event_registry_list = r;
 
+	r->client_next = client_registry[conn_socket];
+	client_registry[conn_socket] = r;
+
+out_unlock:
 	fpgad_mutex_unlock(err, &list_lock);
 
-	return 0;
+	return res;
 }
 
 STATIC void release_event_registry(api_client_event_registry *r)
@@ -76,74 +128,49 @@ STATIC void release_event_registry(api_client_event_registry *r)
 	opae_free(r);
 }
 
+// Remove r from event_registry_list.
+STATIC void unlink_event_registry(api_client_event_registry *r)
+{
+	if (r->prev)
+		r->prev->next = r->next;
+	else
+		event_registry_list = r->next;
+	if (r->next)
+		r->next->prev = r->prev;
+}
+
 int opae_api_unregister_event(int conn_socket,
 			      fpga_event_type e,
 			      uint64_t object_id)
 {
+	api_client_event_registry **link;
 	api_client_event_registry *trash;
-	api_client_event_registry *save;
 	int err;
-	int res = 0;
-
-	fpgad_mutex_lock(err, &list_lock);
-
-	trash = event_registry_list;
+	int res = 1;
 
-	if (!trash) { // empty list
-		res = 1;
-		goto out_unlock;
-	}
-
-	if ((conn_socket == trash->conn_socket) &&
-		(e == trash->event) &&
-		(object_id == trash->object_id)) {
-
-		// found at head of list
+	if ((conn_socket < 0) || ((size_t)conn_socket >= client_registry_size))
+		return 1;
 
-		event_registry_list = event_registry_list->next;
-		release_event_registry(trash);
-		goto out_unlock;
-	}
+	fpgad_mutex_lock(err, &list_lock);
 
-	save = trash;
-	trash = trash->next;
-	while (trash) {
+	for (link = &client_registry[conn_socket] ; *link ;
+	     link = &(*link)->client_next) {
+		trash = *link;
 
-		if ((conn_socket == trash->conn_socket) &&
-			(e == trash->event) &&
-			(object_id == trash->object_id))
+		if ((e == trash->event) &&
+		    (object_id == trash->object_id)) {
+			*link = trash->client_next;
+			unlink_event_registry(trash);
+			release_event_registry(trash);
+			res = 0;
 			break;
-
-		save = trash;
-		trash = trash->next;
+		}
 	}
 
-	if (!trash) { // not found
-		res = 1;
-		goto out_unlock;
-	}
-
-	// found at trash
-	save->next = trash->next;
-	release_event_registry(trash);
-
-out_unlock:
 	fpgad_mutex_unlock(err, &list_lock);
 	return res;
 }
 
-STATIC api_client_event_registry *
-find_event_for(int conn_socket)
-{
-	api_client_event_registry *r;
-
-	for (r = event_registry_list ; r ; r = r->next)
-		if (conn_socket == r->conn_socket)
-			break;
-
-	return r;
-}
-
 void opae_api_unregister_all_events_for(int conn_socket)
 {
 	api_client_event_registry *r;
@@ -151,12 +178,22 @@ void opae_api_unregister_all_events_for(int conn_socket)
 
 	fpgad_mutex_lock(err, &list_lock);
 
-	r = find_event_for(conn_socket);
+	if ((conn_socket < 0) ||
+	    ((size_t)conn_socket >= client_registry_size))
+		goto out_unlock;
+
+	r = client_registry[conn_socket];
+	client_registry[conn_socket] = NULL;
+
 	while (r) {
-		opae_api_unregister_event(conn_socket, r->event, r->object_id);
-		r = find_event_for(conn_socket);
+		api_client_event_registry *trash = r;
+
+		r = r->client_next;
+		unlink_event_registry(trash);
+		release_event_registry(trash);
 	}
 
+out_unlock:
 	fpgad_mutex_unlock(err, &list_lock);
 }
 
@@ -176,6 +213,11 @@ void opae_api_unregister_all_events(void)
 
 	event_registry_list = NULL;
 
+	if (client_registry)
+		opae_free(client_registry);
+	client_registry = NULL;
+	client_registry_size = 0;
+
 	fpgad_mutex_unlock(err, &list_lock);
 }
 
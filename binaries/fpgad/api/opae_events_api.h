@@ -57,6 +57,9 @@ typedef struct _api_client_event_registry {
 	fpga_event_type event;
 	uint64_t object_id;
 	struct _api_client_event_registry *next;
+	struct _api_client_event_registry *prev;
+	// next registration of the same conn_socket
+	struct _api_client_event_registry *client_next;
 } api_client_event_registry;
 
 // 0 on success
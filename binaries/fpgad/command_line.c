@@ -47,7 +47,7 @@
 #define LOG(format, ...) \
 log_printf("args: " format, ##__VA_ARGS__)
 
-#define OPT_STR ":hdl:p:s:n:v"
+#define OPT_STR ":hdl:p:s:n:q:v"
 
 STATIC struct option longopts[] = {
 	{ "help",           no_argument,       NULL, 'h' },
@@ -56,6 +56,7 @@ STATIC struct option longopts[] = {
 	{ "pidfile",        required_argument, NULL, 'p' },
 	{ "socket",         required_argument, NULL, 's' },
 	{ "null-bitstream", required_argument, NULL, 'n' },
+	{ "queue-policy",   required_argument, NULL, 'q' },
 	{ "version",        no_argument,       NULL, 'v' },
 
 	{ 0, 0, 0, 0 }
@@ -76,6 +77,9 @@ void cmd_show_help(FILE *fptr)
 	fprintf(fptr, "\t-s,--socket <sock>          the unix domain socket [/tmp/fpga_event_socket].\n");
 	fprintf(fptr, "\t-n,--null-bitstream <file>  NULL bitstream (for AP6 handling, may be\n"
 		      "\t                            given multiple times).\n");
+	fprintf(fptr, "\t-q,--queue-policy <policy>  action when an event queue is full:\n"
+		      "\t                            drop-newest, drop-oldest or block\n"
+		      "\t                            [drop-newest].\n");
 	fprintf(fptr, "\t-v,--version                display the version and exit.\n");
 }
 
@@ -176,6 +180,24 @@ int cmd_parse_args(struct fpgad_config *c, int argc, char *argv[])
 			}
 			break;
 
+		case 'q':
+			if (!tmp_optarg) {
+				LOG("missing queue policy parameter.\n");
+				return 1;
+			}
+			if (!strcmp(tmp_optarg, "drop-newest")) {
+				c->queue_policy = FPGAD_QUEUE_DROP_NEWEST;
+			} else if (!strcmp(tmp_optarg, "drop-oldest")) {
+				c->queue_policy = FPGAD_QUEUE_DROP_OLDEST;
+			} else if (!strcmp(tmp_optarg, "block")) {
+				c->queue_policy = FPGAD_QUEUE_BLOCK;
+			} else {
+				LOG("invalid queue policy: \"%s\"\n", tmp_optarg);
+				return 1;
+			}
+			LOG("event queue policy is %s\n", tmp_optarg);
+			break;
+
 		case 's':
 			if (tmp_optarg) {
 				c->api_socket = tmp_optarg;
@@ -36,8 +36,19 @@
 
 #define MAX_NULL_GBS 32
 
+/*
+** What happens to a response when its event dispatch queue is full.
+*/
+typedef enum _fpgad_queue_policy {
+	FPGAD_QUEUE_DROP_NEWEST = 0, /* discard the response being queued */
+	FPGAD_QUEUE_DROP_OLDEST,     /* discard the oldest queued response */
+	FPGAD_QUEUE_BLOCK            /* wait up to poll_interval_usec for space,
+					then discard the new response */
+} fpgad_queue_policy;
+
 struct fpgad_config {
 	useconds_t poll_interval_usec;
+	fpgad_queue_policy queue_policy;
 
 	bool daemon;
 	char directory[PATH_MAX];
@@ -73,6 +73,11 @@ int daemonize(void (*hndlr)(int, siginfo_t *, void *), mode_t mask, const char *
 	if (res < 0)
 		return errno;
 
+	sa.sa_flags = SA_SIGINFO;
+	res = sigaction(SIGUSR1, &sa, NULL);
+	if (res < 0)
+		return errno;
+
 	// 4) Orphan the child again - the session leading process terminates.
 	// (only session leaders can request TTY).
 	pid = fork();
@@ -29,7 +29,9 @@
 #endif // HAVE_CONFIG_H
 
 #include <semaphore.h>
+#include <signal.h>
 #include <time.h>
+#include <unistd.h>
 #include <inttypes.h>
 #include "event_dispatcher_thread.h"
 
@@ -46,39 +48,44 @@ event_dispatcher_thread_config event_dispatcher_config = {
 };
 
 #define EVENT_DISPATCH_QUEUE_DEPTH 512
+#define EVENT_DISPATCH_QUEUE_MASK  (EVENT_DISPATCH_QUEUE_DEPTH - 1)
+#define EVENT_DISPATCH_BATCH       16
+
+/*
+** Each queue is a bounded ring in the style of Vyukov's MPMC queue.
+** Every slot carries a sequence number that says whose turn the slot
+** is: producers (monitor thread, plugins) claim a slot by advancing
+** tail with a CAS, and the dispatcher (or a producer evicting under
+** drop-oldest) claims a run of slots by advancing head. Neither side
+** takes a lock and nothing is cleared on dequeue.
+**
+** The slot for position pos is free when seq == pos, holds an item
+** when seq == pos + 1, and is handed back for the next lap with
+** seq = pos + DEPTH. seq is stored minus the slot index so that a
+** zero-filled queue is empty and ready to use.
+*/
+typedef struct _evt_dispatch_slot {
+	uint64_t seq;
+	event_dispatch_queue_item item;
+} evt_dispatch_slot;
 
 typedef struct _evt_dispatch_queue {
-	event_dispatch_queue_item q[EVENT_DISPATCH_QUEUE_DEPTH];
-	unsigned head;
-	unsigned tail;
-	pthread_mutex_t lock;
+	evt_dispatch_slot q[EVENT_DISPATCH_QUEUE_DEPTH];
+	uint64_t tail __attribute__((aligned(64)));
+	uint64_t head __attribute__((aligned(64)));
+	evt_queue_stats stats;
 } evt_dispatch_queue;
 
 STATIC sem_t evt_dispatch_sem;
+STATIC int evt_dispatch_sleeping;
+STATIC volatile sig_atomic_t evt_stats_requested;
 
-STATIC evt_dispatch_queue normal_queue = {
-	{ { NULL, NULL, NULL }, },
-	0,
-	0,
-	PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP,
-};
-
-STATIC evt_dispatch_queue high_priority_queue = {
-	{ { NULL, NULL, NULL }, },
-	0,
-	0,
-	PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP,
-};
+STATIC evt_dispatch_queue normal_queue;
+STATIC evt_dispatch_queue high_priority_queue;
 
 STATIC void evt_queue_init(evt_dispatch_queue *q)
 {
-	memset(q->q, 0, sizeof(q->q));
-	q->head = q->tail = 0;
-}
-
-STATIC void evt_queue_destroy(evt_dispatch_queue *q)
-{
-	q->head = q->tail = 0;
+	memset(q, 0, sizeof(*q));
 }
 
 STATIC volatile bool dispatcher_is_ready = (bool)0;
@@ -88,71 +95,192 @@ bool evt_dispatcher_is_ready(void)
 	return dispatcher_is_ready;
 }
 
-STATIC bool evt_queue_is_full(evt_dispatch_queue *q)
+STATIC uint64_t evt_now_nsec(void)
 {
-	const size_t num = sizeof(q->q) / sizeof(q->q[0]);
-
-	if (q->tail > q->head) {
-		if ((q->head == 0) && (q->tail == (num - 1)))
-			return true;
-	} else if (q->tail < q->head) {
-		if (q->tail == (q->head - 1))
-			return true;
-	}
-	return false;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
-STATIC bool evt_queue_is_empty(evt_dispatch_queue *q)
+static inline evt_dispatch_slot *evt_slot(evt_dispatch_queue *q,
+					  uint64_t pos)
 {
-	return q->head == q->tail;
+	return &q->q[pos & EVENT_DISPATCH_QUEUE_MASK];
 }
 
-STATIC bool _evt_queue_response(evt_dispatch_queue *q,
-				fpgad_respond_event_t callback,
-				fpgad_monitored_device *device,
-				void *context)
+// Signed distance between the slot's turn and want.
+static inline int64_t evt_slot_turn(evt_dispatch_queue *q,
+				    uint64_t pos,
+				    uint64_t want)
 {
-	int res;
+	uint64_t seq = __atomic_load_n(&evt_slot(q, pos)->seq,
+				       __ATOMIC_ACQUIRE);
 
-	opae_mutex_lock(res, &q->lock);
+	return (int64_t)(seq + (pos & EVENT_DISPATCH_QUEUE_MASK) - want);
+}
 
-	if (evt_queue_is_full(q)) {
-		opae_mutex_unlock(res, &q->lock);
-		return false;
-	}
+static inline void evt_slot_release(evt_dispatch_queue *q,
+				    uint64_t pos,
+				    uint64_t turn)
+{
+	__atomic_store_n(&evt_slot(q, pos)->seq,
+			 turn - (pos & EVENT_DISPATCH_QUEUE_MASK),
+			 __ATOMIC_RELEASE);
+}
 
-	q->q[q->tail].callback = callback;
-	q->q[q->tail].device = device;
-	q->q[q->tail].context = context;
+STATIC bool evt_queue_is_full(evt_dispatch_queue *q)
+{
+	uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
 
-	q->tail = (q->tail + 1) % EVENT_DISPATCH_QUEUE_DEPTH;
+	return evt_slot_turn(q, pos, pos) < 0;
+}
 
-	opae_mutex_unlock(res, &q->lock);
+STATIC bool evt_queue_is_empty(evt_dispatch_queue *q)
+{
+	uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
 
-	sem_post(&evt_dispatch_sem);
+	return evt_slot_turn(q, pos, pos + 1) < 0;
+}
+
+STATIC bool evt_queue_try_put(evt_dispatch_queue *q,
+			      fpgad_respond_event_t callback,
+			      fpgad_monitored_device *device,
+			      void *context)
+{
+	uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	evt_dispatch_slot *s;
+	int64_t turn;
+
+	while (1) {
+		turn = evt_slot_turn(q, pos, pos);
+		if (!turn) {
+			if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1,
+							true,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (turn < 0) {
+			return false; // full
+		} else {
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	s = evt_slot(q, pos);
+	s->item.callback = callback;
+	s->item.device = device;
+	s->item.context = context;
+	s->item.stamp_nsec = evt_now_nsec();
+
+	evt_slot_release(q, pos, pos + 1);
+
+	__atomic_fetch_add(&q->stats.enqueued, 1, __ATOMIC_RELAXED);
 
 	return true;
 }
 
-STATIC bool _evt_queue_get(evt_dispatch_queue *q,
-			   event_dispatch_queue_item *item)
+STATIC unsigned evt_queue_take(evt_dispatch_queue *q,
+			       event_dispatch_queue_item *items,
+			       unsigned max)
 {
-	int res;
+	uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	int64_t turn = 0;
+	unsigned n;
+
+	while (1) {
+		// Count the run of published slots starting at head.
+		for (n = 0 ; n < max ; ++n) {
+			turn = evt_slot_turn(q, pos + n, pos + n + 1);
+			if (turn)
+				break;
+		}
+
+		if (!n) {
+			if (turn < 0)
+				return 0; // empty
+			// head moved underneath us.
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+			continue;
+		}
 
-	opae_mutex_lock(res, &q->lock);
+		if (__atomic_compare_exchange_n(&q->head, &pos, pos + n,
+						true,
+						__ATOMIC_RELAXED,
+						__ATOMIC_RELAXED))
+			break;
+	}
 
-	if (evt_queue_is_empty(q)) {
-		opae_mutex_unlock(res, &q->lock);
-		return false;
+	for (max = 0 ; max < n ; ++max) {
+		items[max] = evt_slot(q, pos + max)->item;
+		evt_slot_release(q, pos + max,
+				 pos + max + EVENT_DISPATCH_QUEUE_DEPTH);
 	}
 
-	*item = q->q[q->head];
-	memset(&q->q[q->head], 0, sizeof(q->q[0]));
-	q->head = (q->head + 1) % EVENT_DISPATCH_QUEUE_DEPTH;
+	return n;
+}
+
+// Wake the dispatcher if it is (about to be) asleep.
+STATIC void evt_dispatch_wake(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&evt_dispatch_sleeping, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&evt_dispatch_sleeping, 0, __ATOMIC_RELAXED))
+		sem_post(&evt_dispatch_sem);
+}
+
+STATIC bool _evt_queue_response(evt_dispatch_queue *q,
+				fpgad_respond_event_t callback,
+				fpgad_monitored_device *device,
+				void *context)
+{
+	struct fpgad_config *c = event_dispatcher_config.global;
+	event_dispatch_queue_item victim;
+	uint64_t deadline = 0;
+
+	while (!evt_queue_try_put(q, callback, device, context)) {
+
+		switch (c->queue_policy) {
+
+		case FPGAD_QUEUE_DROP_OLDEST:
+			if (evt_queue_take(q, &victim, 1))
+				__atomic_fetch_add(&q->stats.dropped_oldest, 1,
+						   __ATOMIC_RELAXED);
+			break;
+
+		case FPGAD_QUEUE_BLOCK:
+			if (!deadline) {
+				deadline = evt_now_nsec() +
+					(uint64_t)c->poll_interval_usec * 1000;
+				__atomic_fetch_add(&q->stats.blocked, 1,
+						   __ATOMIC_RELAXED);
+			} else if (!c->running || evt_now_nsec() > deadline) {
+				goto out_drop;
+			}
+			evt_dispatch_wake();
+			if (evt_queue_is_full(q))
+				usleep(10);
+			break;
+
+		default:
+			goto out_drop;
+		}
+
+	}
 
-	opae_mutex_unlock(res, &q->lock);
+	evt_dispatch_wake();
 
 	return true;
+
+out_drop:
+	__atomic_fetch_add(&q->stats.dropped_newest, 1, __ATOMIC_RELAXED);
+	return false;
+}
+
+STATIC bool _evt_queue_get(evt_dispatch_queue *q,
+			   event_dispatch_queue_item *item)
+{
+	return evt_queue_take(q, item, 1) == 1;
 }
 
 bool evt_queue_response(fpgad_respond_event_t callback,
@@ -185,6 +313,126 @@ bool evt_queue_get_high(event_dispatch_queue_item *item)
 	return _evt_queue_get(&high_priority_queue, item);
 }
 
+unsigned evt_queue_get_batch(event_dispatch_queue_item *items,
+			     unsigned max)
+{
+	return evt_queue_take(&normal_queue, items, max);
+}
+
+unsigned evt_queue_get_high_batch(event_dispatch_queue_item *items,
+				  unsigned max)
+{
+	return evt_queue_take(&high_priority_queue, items, max);
+}
+
+void evt_queue_get_stats(bool high, evt_queue_stats *stats)
+{
+	evt_dispatch_queue *q = high ? &high_priority_queue : &normal_queue;
+	uint64_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+	stats->depth = tail > head ? tail - head : 0;
+	stats->enqueued =
+		__atomic_load_n(&q->stats.enqueued, __ATOMIC_RELAXED);
+	stats->dispatched =
+		__atomic_load_n(&q->stats.dispatched, __ATOMIC_RELAXED);
+	stats->dropped_newest =
+		__atomic_load_n(&q->stats.dropped_newest, __ATOMIC_RELAXED);
+	stats->dropped_oldest =
+		__atomic_load_n(&q->stats.dropped_oldest, __ATOMIC_RELAXED);
+	stats->blocked =
+		__atomic_load_n(&q->stats.blocked, __ATOMIC_RELAXED);
+	stats->latency_total_nsec =
+		__atomic_load_n(&q->stats.latency_total_nsec, __ATOMIC_RELAXED);
+	stats->latency_max_nsec =
+		__atomic_load_n(&q->stats.latency_max_nsec, __ATOMIC_RELAXED);
+}
+
+void evt_dispatcher_request_stats(void)
+{
+	evt_stats_requested = 1;
+}
+
+STATIC void evt_queue_log_stats(bool high)
+{
+	evt_queue_stats stats;
+
+	evt_queue_get_stats(high, &stats);
+
+	LOG("%s queue: depth %" PRIu64 " enqueued %" PRIu64
+	    " dispatched %" PRIu64 " dropped newest %" PRIu64
+	    " oldest %" PRIu64 " blocked %" PRIu64
+	    " latency avg %" PRIu64 " max %" PRIu64 " usec\n",
+	    high ? "high" : "normal",
+	    stats.depth, stats.enqueued, stats.dispatched,
+	    stats.dropped_newest, stats.dropped_oldest, stats.blocked,
+	    stats.dispatched ?
+		stats.latency_total_nsec / stats.dispatched / 1000 : 0,
+	    stats.latency_max_nsec / 1000);
+}
+
+// Run one dequeued item and account for its queueing latency.
+STATIC void evt_dispatch(evt_dispatch_queue *q,
+			 event_dispatch_queue_item *item)
+{
+	uint64_t latency = evt_now_nsec() - item->stamp_nsec;
+
+	__atomic_fetch_add(&q->stats.dispatched, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&q->stats.latency_total_nsec, latency,
+			   __ATOMIC_RELAXED);
+	if (latency > q->stats.latency_max_nsec)
+		__atomic_store_n(&q->stats.latency_max_nsec, latency,
+				 __ATOMIC_RELAXED);
+
+	LOG("dispatching%s for object_id: 0x%" PRIx64 ".\n",
+	    q == &high_priority_queue ? " (high)" : "",
+	    item->device->object_id);
+	item->callback(item->device, item->context);
+}
+
+STATIC unsigned evt_dispatch_high(void)
+{
+	event_dispatch_queue_item items[EVENT_DISPATCH_BATCH];
+	unsigned total = 0;
+	unsigned i;
+	unsigned n;
+
+	while ((n = evt_queue_get_high_batch(items, EVENT_DISPATCH_BATCH))) {
+		for (i = 0 ; i < n ; ++i)
+			evt_dispatch(&high_priority_queue, &items[i]);
+		total += n;
+	}
+
+	return total;
+}
+
+// Sleep until a producer posts or poll_interval_usec elapses.
+STATIC void evt_dispatch_sleep(event_dispatcher_thread_config *c)
+{
+	struct timespec ts;
+
+	__atomic_store_n(&evt_dispatch_sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (!evt_queue_is_empty(&high_priority_queue) ||
+	    !evt_queue_is_empty(&normal_queue)) {
+		__atomic_store_n(&evt_dispatch_sleeping, 0, __ATOMIC_RELAXED);
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	ts.tv_nsec += c->global->poll_interval_usec * 1000;
+	if (ts.tv_nsec > 1000000000) {
+		++ts.tv_sec;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	sem_timedwait(&evt_dispatch_sem, &ts);
+
+	__atomic_store_n(&evt_dispatch_sleeping, 0, __ATOMIC_RELAXED);
+}
+
 void *event_dispatcher_thread(void *thread_context)
 {
 	event_dispatcher_thread_config *c =
@@ -192,7 +440,6 @@ void *event_dispatcher_thread(void *thread_context)
 	struct sched_param sched_param;
 	int policy = 0;
 	int res;
-	struct timespec ts;
 
 	LOG("starting\n");
 
@@ -223,40 +470,35 @@ void *event_dispatcher_thread(void *thread_context)
 	dispatcher_is_ready = true;
 
 	while (c->global->running) {
-
-		clock_gettime(CLOCK_REALTIME, &ts);
-
-		ts.tv_nsec += c->global->poll_interval_usec * 1000;
-		if (ts.tv_nsec > 1000000000) {
-			++ts.tv_sec;
-			ts.tv_nsec -= 1000000000;
+		event_dispatch_queue_item items[EVENT_DISPATCH_BATCH];
+		unsigned dispatched;
+		unsigned i;
+		unsigned n;
+
+		// High-priority items always go ahead of the next normal one.
+		dispatched = evt_dispatch_high();
+
+		n = evt_queue_get_batch(items, EVENT_DISPATCH_BATCH);
+		for (i = 0 ; i < n ; ++i) {
+			evt_dispatch(&normal_queue, &items[i]);
+			dispatched += evt_dispatch_high();
 		}
+		dispatched += n;
 
-		res = sem_timedwait(&evt_dispatch_sem, &ts);
-
-		if (!res) {
-			event_dispatch_queue_item item;
-
-			// Process all high-priority items first
-			while (evt_queue_get_high(&item)) {
-				LOG("dispatching (high) for object_id: 0x%" PRIx64 ".\n",
-					item.device->object_id);
-				item.callback(item.device, item.context);
-			}
-
-			if (evt_queue_get(&item)) {
-				LOG("dispatching for object_id: 0x%" PRIx64 ".\n",
-					item.device->object_id);
-				item.callback(item.device, item.context);
-			}
+		if (evt_stats_requested) {
+			evt_stats_requested = 0;
+			evt_queue_log_stats(true);
+			evt_queue_log_stats(false);
 		}
 
+		if (!dispatched)
+			evt_dispatch_sleep(c);
 	}
 
 	dispatcher_is_ready = false;
 
-	evt_queue_destroy(&normal_queue);
-	evt_queue_destroy(&high_priority_queue);
+	evt_queue_log_stats(true);
+	evt_queue_log_stats(false);
 
 	sem_destroy(&evt_dispatch_sem);
 
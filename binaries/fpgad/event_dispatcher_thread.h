@@ -44,6 +44,7 @@ typedef struct _event_dispatch_queue_item {
 	fpgad_respond_event_t callback;
 	fpgad_monitored_device *device;
 	void *context;
+	uint64_t stamp_nsec; // CLOCK_MONOTONIC time the item was queued
 } event_dispatch_queue_item;
 
 bool evt_dispatcher_is_ready(void);
@@ -60,4 +61,31 @@ bool evt_queue_response_high(fpgad_respond_event_t callback,
 
 bool evt_queue_get_high(event_dispatch_queue_item *item);
 
+/*
+** Dequeue up to max items from the normal/high queue in
+** one step. Returns the number of items stored to items.
+*/
+unsigned evt_queue_get_batch(event_dispatch_queue_item *items,
+			     unsigned max);
+
+unsigned evt_queue_get_high_batch(event_dispatch_queue_item *items,
+				  unsigned max);
+
+typedef struct _evt_queue_stats {
+	uint64_t depth;              // responses currently queued
+	uint64_t enqueued;           // responses accepted
+	uint64_t dispatched;         // responses handed to their callback
+	uint64_t dropped_newest;     // rejected because the queue was full
+	uint64_t dropped_oldest;     // evicted to make room (drop-oldest)
+	uint64_t blocked;            // producers that waited for space (block)
+	uint64_t latency_total_nsec; // sum of queue-to-dispatch latencies
+	uint64_t latency_max_nsec;   // worst queue-to-dispatch latency
+} evt_queue_stats;
+
+// Snapshot the counters of the normal (high == false) or high queue.
+void evt_queue_get_stats(bool high, evt_queue_stats *stats);
+
+// Ask the dispatcher to log the queue counters. Async-signal-safe.
+void evt_dispatcher_request_stats(void);
+
 #endif /* __FPGAD_EVENT_DISPATCHER_THREAD_H__ */
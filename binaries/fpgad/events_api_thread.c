@@ -37,7 +37,8 @@
 
 #include <sys/socket.h>
 #include <sys/un.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <inttypes.h>
 #include "events_api_thread.h"
 #include "api/opae_events_api.h"
@@ -55,34 +56,226 @@ events_api_thread_config events_api_config = {
 	.sched_priority = 10,
 };
 
-#define MAX_CLIENT_CONNECTIONS 1023
-#define SRV_SOCKET             0
-#define FIRST_CLIENT_SOCKET    1
+#define EVENTS_API_MAX_EVENTS  64
+#define CLIENT_TABLE_MIN_SIZE  64
+
+/*
+** Connected clients, hashed by socket fd. Descriptors are small,
+** densely allocated integers, so masking off the low bits spreads
+** them evenly. The table doubles whenever it holds more clients than
+** buckets, which keeps add_client() and remove_client() O(1)
+** amortized with no fixed ceiling on the number of clients.
+*/
+STATIC api_client **client_table;
+STATIC size_t client_table_size;
+STATIC size_t num_clients;
+
+STATIC int epoll_fd = -1;
+STATIC int server_socket = -1;
+STATIC bool server_paused;
+
+static inline api_client **client_bucket(api_client **table,
+					 size_t size,
+					 int conn_socket)
+{
+	return &table[(size_t)conn_socket & (size - 1)];
+}
+
+STATIC api_client *find_client(int conn_socket)
+{
+	api_client *cl;
+
+	if (!client_table)
+		return NULL;
+
+	cl = *client_bucket(client_table, client_table_size, conn_socket);
+	while (cl && (cl->conn_socket != conn_socket))
+		cl = cl->next;
+
+	return cl;
+}
+
+// 0 on success
+STATIC int grow_client_table(void)
+{
+	size_t size = client_table_size ?
+		client_table_size * 2 : CLIENT_TABLE_MIN_SIZE;
+	api_client **table;
+	size_t i;
+
+	table = (api_client **)opae_calloc(size, sizeof(api_client *));
+	if (!table)
+		return ENOMEM;
+
+	for (i = 0 ; i < client_table_size ; ++i) {
+		api_client *cl = client_table[i];
+
+		while (cl) {
+			api_client *next = cl->next;
+			api_client **b = client_bucket(table, size,
+						       cl->conn_socket);
+
+			cl->next = *b;
+			*b = cl;
+			cl = next;
+		}
+	}
+
+	if (client_table)
+		opae_free(client_table);
+	client_table = table;
+	client_table_size = size;
+
+	return 0;
+}
+
+// 0 on success
+STATIC int add_client(int conn_socket)
+{
+	struct epoll_event ev;
+	api_client **b;
+	api_client *cl;
+	int err;
+
+	if ((num_clients >= client_table_size) && grow_client_table()) {
+		LOG("failed to grow client table.\n");
+		return ENOMEM;
+	}
+
+	cl = (api_client *)opae_malloc(sizeof(api_client));
+	if (!cl)
+		return ENOMEM;
+
+	cl->conn_socket = conn_socket;
+
+	if (epoll_fd >= 0) {
+		ev.events = EPOLLIN | EPOLLPRI;
+		ev.data.ptr = cl;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn_socket, &ev)) {
+			err = errno;
+			LOG("failed to watch conn_socket=%d: %s\n",
+			    conn_socket, strerror(err));
+			opae_free(cl);
+			return err;
+		}
+	}
+
+	b = client_bucket(client_table, client_table_size, conn_socket);
+	cl->next = *b;
+	*b = cl;
+	++num_clients;
+
+	return 0;
+}
+
+STATIC void resume_server(void)
+{
+	struct epoll_event ev;
 
-/* array keeping track of all connection file descriptors (plus server socket) */
-STATIC struct pollfd pollfds[MAX_CLIENT_CONNECTIONS+1];
-STATIC nfds_t num_fds = 1;
+	if (!server_paused)
+		return;
+
+	ev.events = EPOLLIN | EPOLLPRI;
+	ev.data.ptr = NULL;
+	if (!epoll_ctl(epoll_fd, EPOLL_CTL_MOD, server_socket, &ev)) {
+		server_paused = false;
+		LOG("accepting connections again.\n");
+	}
+}
 
 STATIC void remove_client(int conn_socket)
 {
-	nfds_t i, j;
-	nfds_t removed = 0;
+	api_client **link;
+	api_client *cl;
 
 	opae_api_unregister_all_events_for(conn_socket);
 	LOG("closing connection conn_socket=%d.\n", conn_socket);
+
+	cl = find_client(conn_socket);
+	if (cl) {
+		link = client_bucket(client_table, client_table_size,
+				     conn_socket);
+		while (*link != cl)
+			link = &(*link)->next;
+		*link = cl->next;
+		--num_clients;
+		if (epoll_fd >= 0)
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn_socket, NULL);
+		opae_free(cl);
+	}
+
 	opae_close(conn_socket);
 
-	for (i = j = FIRST_CLIENT_SOCKET ; i < num_fds ; ++i) {
-		if (conn_socket != pollfds[i].fd) {
-			if (j != i)
-				pollfds[j] = pollfds[i];
-			++j;
-		} else {
-			++removed;
+	// A descriptor is free again; retry any deferred accept.
+	resume_server();
+}
+
+STATIC void remove_all_clients(void)
+{
+	size_t i;
+
+	for (i = 0 ; i < client_table_size ; ++i) {
+		while (client_table[i])
+			remove_client(client_table[i]->conn_socket);
+	}
+
+	if (client_table)
+		opae_free(client_table);
+	client_table = NULL;
+	client_table_size = 0;
+}
+
+STATIC void accept_clients(void)
+{
+	struct epoll_event ev;
+	int conn_socket;
+
+	while (1) {
+		conn_socket = accept4(server_socket, NULL, NULL, SOCK_CLOEXEC);
+
+		if (conn_socket < 0) {
+			if ((errno == EMFILE) || (errno == ENFILE)) {
+				// Out of descriptors: stop polling the
+				// listener until a client goes away, rather
+				// than spinning on a readable socket.
+				LOG("out of descriptors with %zu clients!\n",
+				    num_clients);
+				ev.events = 0;
+				ev.data.ptr = NULL;
+				if (!epoll_ctl(epoll_fd, EPOLL_CTL_MOD,
+					       server_socket, &ev))
+					server_paused = true;
+			} else if ((errno != EAGAIN) &&
+				   (errno != EWOULDBLOCK) &&
+				   (errno != EINTR)) {
+				LOG("failed to accept new connection!\n");
+			}
+			break;
+		}
+
+		if (add_client(conn_socket)) {
+			opae_close(conn_socket);
+			continue;
 		}
+
+		LOG("accepting connection %d.\n", conn_socket);
 	}
+}
+
+// Allow as many clients as the hard descriptor limit permits.
+STATIC void raise_fd_limit(void)
+{
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl))
+		return;
 
-	num_fds -= removed;
+	if (rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		if (setrlimit(RLIMIT_NOFILE, &rl))
+			LOG("failed to raise descriptor limit: %s\n",
+			    strerror(errno));
+	}
 }
 
 STATIC int handle_message(int conn_socket)
@@ -177,11 +370,12 @@ void *events_api_thread(void *thread_context)
 	int policy = 0;
 	int res;
 
-	nfds_t i;
 	struct sockaddr_un addr;
-	int server_socket;
-	int conn_socket;
+	struct epoll_event ev;
+	struct epoll_event events[EVENTS_API_MAX_EVENTS];
 	size_t len;
+	int n;
+	int i;
 
 	LOG("starting\n");
 
@@ -201,9 +395,11 @@ void *events_api_thread(void *thread_context)
 		}
 	}
 
+	raise_fd_limit();
+
 	unlink(c->global->api_socket);
 
-	server_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	server_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
 	if (server_socket < 0) {
 		LOG("failed to create server socket.\n");
 		goto out_exit;
@@ -222,61 +418,55 @@ void *events_api_thread(void *thread_context)
 	}
 	LOG("server socket bind success.\n");
 
-	if (listen(server_socket, 20) < 0) {
+	if (listen(server_socket, SOMAXCONN) < 0) {
 		LOG("failed to listen on socket.\n");
 		goto out_close_server;
 	}
 	LOG("listening for connections.\n");
 
-	evt_api_is_ready = true;
-
-	pollfds[SRV_SOCKET].fd = server_socket;
-	pollfds[SRV_SOCKET].events = POLLIN | POLLPRI;
-	num_fds = 1;
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		LOG("failed to create epoll set: %s\n", strerror(errno));
+		goto out_close_server;
+	}
 
-	while (c->global->running) {
+	// The listener is the only entry whose data.ptr is NULL.
+	ev.events = EPOLLIN | EPOLLPRI;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_socket, &ev)) {
+		LOG("failed to watch server socket: %s\n", strerror(errno));
+		goto out_close_epoll;
+	}
+	server_paused = false;
 
-		res = poll(pollfds, num_fds, 100);
-		if (res < 0) {
-			LOG("poll error\n");
-			continue;
-		}
+	evt_api_is_ready = true;
 
-		if (0 == res) // timeout
-			continue;
+	while (c->global->running) {
 
-		if ((nfds_t)res > num_fds) { // weird
-			LOG("something bad happened during poll!\n");
+		n = epoll_wait(epoll_fd, events, EVENTS_API_MAX_EVENTS, 100);
+		if (n < 0) {
+			if (errno != EINTR)
+				LOG("epoll error\n");
 			continue;
 		}
 
-		// handle requests on existing sockets
-		for (i = FIRST_CLIENT_SOCKET ; i < num_fds ; ++i) {
-			if (pollfds[i].revents) {
-				handle_message(pollfds[i].fd);
-			}
-		}
-
-		// handle new connection requests
-		if (pollfds[SRV_SOCKET].revents) {
+		for (i = 0 ; i < n ; ++i) {
+			api_client *cl = (api_client *)events[i].data.ptr;
+			int conn_socket;
 
-			if (num_fds == MAX_CLIENT_CONNECTIONS+1) {
-				LOG("exceeded max connections!\n");
+			if (!cl) { // new connection requests
+				accept_clients();
 				continue;
 			}
 
-			conn_socket = accept(server_socket, NULL, NULL);
-
-			if (conn_socket < 0) {
-				LOG("failed to accept new connection!\n");
-			} else {
-				LOG("accepting connection %d.\n", conn_socket);
-
-				pollfds[num_fds].fd = conn_socket;
-				pollfds[num_fds].events = POLLIN | POLLPRI;
-				++num_fds;
-			}
+			conn_socket = cl->conn_socket;
+			res = handle_message(conn_socket);
 
+			// A failed read on a socket in error would
+			// otherwise be reported on every wait.
+			if ((res < 0) &&
+			    (events[i].events & (EPOLLERR | EPOLLHUP)))
+				remove_client(conn_socket);
 		}
 
 	}
@@ -284,13 +474,17 @@ void *events_api_thread(void *thread_context)
 	opae_api_unregister_all_events();
 
 	// close any active client sockets
-	for (i = FIRST_CLIENT_SOCKET ; i < num_fds ; ++i) {
-		opae_close(pollfds[i].fd);
-	}
+	remove_all_clients();
+
+	evt_api_is_ready = false;
 
+out_close_epoll:
+	opae_close(epoll_fd);
+	epoll_fd = -1;
 out_close_server:
 	evt_api_is_ready = false;
 	opae_close(server_socket);
+	server_socket = -1;
 out_exit:
 	LOG("exiting\n");
 	return NULL;
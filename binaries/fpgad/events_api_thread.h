@@ -38,6 +38,12 @@ typedef struct _events_api_thread_config {
 
 extern events_api_thread_config events_api_config;
 
+/* A client connected to the events API socket. */
+typedef struct _api_client {
+	int conn_socket;
+	struct _api_client *next;
+} api_client;
+
 void *events_api_thread(void *);
 
 #endif /* __FPGAD_EVENTS_API_THREAD_H__ */
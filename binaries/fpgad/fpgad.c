@@ -58,6 +58,10 @@ void sig_handler(int sig, siginfo_t *info, void *unused)
 		LOG("Got SIGTERM. Exiting.\n");
 		global_config.running = false;
 		break;
+	case SIGUSR1:
+		// Log the event queue counters.
+		evt_dispatcher_request_stats();
+		break;
 	}
 }
 
@@ -118,6 +122,13 @@ int main(int argc, char *argv[])
 			LOG("failed to register SIGTERM handler.\n");
 			goto out_destroy;
 		}
+
+		sa.sa_flags = SA_SIGINFO;
+		res = sigaction(SIGUSR1, &sa, NULL);
+		if (res < 0) {
+			LOG("failed to register SIGUSR1 handler.\n");
+			goto out_destroy;
+		}
 	}
 
 	if (log_open(global_config.logfile) < 0) {
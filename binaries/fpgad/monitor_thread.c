@@ -30,6 +30,10 @@
 
 #include <dlfcn.h>
 #include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include "monitored_device.h"
 #include "monitor_thread.h"
 #include "event_dispatcher_thread.h"
@@ -50,6 +54,37 @@ monitor_thread_config monitor_config = {
 STATIC pthread_mutex_t mon_list_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 STATIC fpgad_monitored_device *monitored_device_list;
 
+#define MON_WHEEL_SLOTS     256
+#define MON_WHEEL_TICK_USEC 1000
+#define MON_MAX_EVENTS      32
+
+// One detection of a callback plugin, run every interval_ticks and
+// whenever its descriptor, if any, becomes ready.
+typedef struct _mon_schedule {
+	fpgad_monitored_device *device;
+	unsigned detection;
+	uint64_t interval_ticks;
+	uint64_t due_tick;
+	int fd;
+	struct _mon_schedule *wheel_next;
+	struct _mon_schedule *next;
+} mon_schedule;
+
+// Hashed timer wheel. Slot (due_tick % MON_WHEEL_SLOTS) holds the
+// schedules due on that tick or a whole number of turns later.
+STATIC mon_schedule *mon_wheel[MON_WHEEL_SLOTS];
+STATIC uint64_t mon_wheel_tick; // next tick to process
+STATIC mon_schedule *mon_schedules;
+
+// Ready descriptors of the schedules, plus mon_wake_fd, which is
+// signaled when schedules are added.
+STATIC int mon_epfd = -1;
+STATIC int mon_wake_fd = -1;
+
+// Set when a device could not be scheduled. The monitor then polls
+// every detection each poll interval, as without schedules.
+STATIC bool mon_sched_failed;
+
 STATIC void mon_queue_response(fpgad_detection_status status,
 			       fpgad_respond_event_t response,
 			       fpgad_monitored_device *d,
@@ -78,6 +113,33 @@ STATIC void mon_queue_response(fpgad_detection_status status,
 	}
 }
 
+STATIC void mon_detect(fpgad_monitored_device *d, unsigned i)
+{
+	fpgad_detection_status result;
+	fpgad_detect_event_t detect =
+		d->detections[i];
+	void *detect_context =
+		d->detection_contexts ?
+		d->detection_contexts[i] : NULL;
+
+	result = detect(d, detect_context);
+
+	if (result != FPGAD_STATUS_NOT_DETECTED && d->responses) {
+		fpgad_respond_event_t response =
+			d->responses[i];
+		void *response_context =
+			d->response_contexts ?
+			d->response_contexts[i] : NULL;
+
+		if (response) {
+			mon_queue_response(result,
+					   response,
+					   d,
+					   response_context);
+		}
+	}
+}
+
 STATIC void mon_monitor(fpgad_monitored_device *d)
 {
 	unsigned i;
@@ -85,30 +147,246 @@ STATIC void mon_monitor(fpgad_monitored_device *d)
 	if (!d->detections)
 		return;
 
+	for (i = 0 ; d->detections[i] ; ++i)
+		mon_detect(d, i);
+}
+
+STATIC uint64_t mon_now_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Create the epoll set and wake descriptor. 0 on success.
+STATIC int mon_sched_init(void)
+{
+	struct epoll_event ev;
+
+	if (mon_epfd >= 0)
+		return 0;
+
+	mon_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (mon_epfd < 0) {
+		LOG("epoll_create1() failed: %s\n", strerror(errno));
+		return 1;
+	}
+
+	mon_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (mon_wake_fd < 0) {
+		LOG("eventfd() failed: %s\n", strerror(errno));
+		goto out_close;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+
+	if (epoll_ctl(mon_epfd, EPOLL_CTL_ADD, mon_wake_fd, &ev)) {
+		LOG("epoll_ctl() failed: %s\n", strerror(errno));
+		goto out_close;
+	}
+
+	mon_wheel_tick = mon_now_usec() / MON_WHEEL_TICK_USEC;
+
+	return 0;
+
+out_close:
+	if (mon_wake_fd >= 0) {
+		close(mon_wake_fd);
+		mon_wake_fd = -1;
+	}
+	close(mon_epfd);
+	mon_epfd = -1;
+	return 1;
+}
+
+STATIC void mon_wheel_insert(mon_schedule *s)
+{
+	mon_schedule **slot = &mon_wheel[s->due_tick % MON_WHEEL_SLOTS];
+
+	s->wheel_next = *slot;
+	*slot = s;
+}
+
+// Schedule each detection of a callback plugin. 0 on success.
+STATIC int mon_sched_add(fpgad_monitored_device *d)
+{
+	struct epoll_event ev;
+	uint64_t one = 1;
+	uint64_t usec;
+	unsigned i;
+
+	if (!d->detections)
+		return 0;
+
+	if (mon_sched_init())
+		return 1;
+
 	for (i = 0 ; d->detections[i] ; ++i) {
-		fpgad_detection_status result;
-		fpgad_detect_event_t detect =
-			d->detections[i];
-		void *detect_context =
-			d->detection_contexts ?
-			d->detection_contexts[i] : NULL;
-
-		result = detect(d, detect_context);
-
-		if (result != FPGAD_STATUS_NOT_DETECTED && d->responses) {
-			fpgad_respond_event_t response =
-				d->responses[i];
-			void *response_context =
-				d->response_contexts ?
-				d->response_contexts[i] : NULL;
-
-			if (response) {
-				mon_queue_response(result,
-						   response,
-						   d,
-						   response_context);
+		mon_schedule *s =
+			(mon_schedule *)opae_calloc(1, sizeof(mon_schedule));
+
+		if (!s) {
+			LOG("calloc failed\n");
+			return 1;
+		}
+
+		s->device = d;
+		s->detection = i;
+
+		usec = d->detection_intervals ? d->detection_intervals[i] : 0;
+		if (!usec)
+			usec = d->config->poll_interval_usec;
+		s->interval_ticks = usec / MON_WHEEL_TICK_USEC;
+		if (!s->interval_ticks)
+			s->interval_ticks = 1;
+
+		// Run on the next pass of the wheel.
+		s->due_tick = mon_wheel_tick;
+
+		s->fd = d->detection_fds ? d->detection_fds[i] : -1;
+		if (s->fd >= 0) {
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN | EPOLLPRI | EPOLLET;
+			ev.data.ptr = s;
+
+			if (epoll_ctl(mon_epfd, EPOLL_CTL_ADD, s->fd, &ev)) {
+				LOG("detection %u: epoll_ctl(%d) failed: %s."
+				    " Polling only.\n",
+				    i, s->fd, strerror(errno));
+				s->fd = -1;
+			}
+		}
+
+		s->next = mon_schedules;
+		mon_schedules = s;
+		mon_wheel_insert(s);
+	}
+
+	if (write(mon_wake_fd, &one, sizeof(one)) < 0)
+		LOG("failed to wake monitor: %s\n", strerror(errno));
+
+	return 0;
+}
+
+/*
+ * Run the detections due by now_usec. Returns the number of
+ * milliseconds until the next one is due, at most max_usec.
+ */
+STATIC int mon_sched_run(uint64_t now_usec, uint64_t max_usec)
+{
+	uint64_t now_tick = now_usec / MON_WHEEL_TICK_USEC;
+	uint64_t tick;
+	uint64_t usec;
+	mon_schedule *s;
+	mon_schedule *next;
+
+	if (now_tick >= mon_wheel_tick) {
+		// After a stall of a whole turn, visit each slot once.
+		if (now_tick - mon_wheel_tick >= MON_WHEEL_SLOTS)
+			mon_wheel_tick = now_tick - MON_WHEEL_SLOTS + 1;
+
+		for (tick = mon_wheel_tick ; tick <= now_tick ; ++tick) {
+			s = mon_wheel[tick % MON_WHEEL_SLOTS];
+			mon_wheel[tick % MON_WHEEL_SLOTS] = NULL;
+
+			for ( ; s ; s = next) {
+				next = s->wheel_next;
+
+				if (s->due_tick <= now_tick) {
+					mon_detect(s->device, s->detection);
+					s->due_tick = now_tick + s->interval_ticks;
+				}
+
+				mon_wheel_insert(s);
 			}
 		}
+
+		mon_wheel_tick = now_tick + 1;
+	}
+
+	usec = max_usec;
+
+	// Find the first tick of this turn with a schedule due on it.
+	for (tick = mon_wheel_tick ;
+	     tick < mon_wheel_tick + MON_WHEEL_SLOTS ;
+	     ++tick) {
+		for (s = mon_wheel[tick % MON_WHEEL_SLOTS] ; s ;
+		     s = s->wheel_next) {
+			if (s->due_tick <= tick)
+				break;
+		}
+
+		if (s) {
+			if (tick * MON_WHEEL_TICK_USEC - now_usec < usec)
+				usec = tick * MON_WHEEL_TICK_USEC - now_usec;
+			break;
+		}
+	}
+
+	return (int)((usec + 999) / 1000);
+}
+
+// Wait up to timeout_ms, then run the detections whose
+// descriptors became ready.
+STATIC void mon_sched_wait(int timeout_ms)
+{
+	struct epoll_event events[MON_MAX_EVENTS];
+	uint64_t count;
+	int err;
+	int n;
+	int i;
+
+	n = epoll_wait(mon_epfd, events, MON_MAX_EVENTS, timeout_ms);
+	if (n < 0) {
+		if (errno != EINTR) {
+			LOG("epoll_wait() failed: %s\n", strerror(errno));
+			usleep(timeout_ms * 1000);
+		}
+		return;
+	}
+
+	fpgad_mutex_lock(err, &mon_list_lock);
+
+	for (i = 0 ; i < n ; ++i) {
+		mon_schedule *s = (mon_schedule *)events[i].data.ptr;
+
+		if (!s) {
+			if (read(mon_wake_fd, &count, sizeof(count)) < 0 &&
+			    errno != EAGAIN)
+				LOG("read() failed: %s\n", strerror(errno));
+			continue;
+		}
+
+		mon_detect(s->device, s->detection);
+	}
+
+	fpgad_mutex_unlock(err, &mon_list_lock);
+}
+
+STATIC void mon_sched_destroy(void)
+{
+	mon_schedule *s;
+
+	while (mon_schedules) {
+		s = mon_schedules;
+		mon_schedules = s->next;
+		opae_free(s);
+	}
+
+	memset(mon_wheel, 0, sizeof(mon_wheel));
+	mon_sched_failed = false;
+
+	if (mon_wake_fd >= 0) {
+		close(mon_wake_fd);
+		mon_wake_fd = -1;
+	}
+
+	if (mon_epfd >= 0) {
+		close(mon_epfd);
+		mon_epfd = -1;
 	}
 }
 
@@ -126,6 +404,8 @@ void *monitor_thread(void *thread_context)
 	int policy = 0;
 	int res;
 	int err;
+	int timeout;
+	bool scheduled;
 	fpgad_monitored_device *d;
 
 	LOG("starting\n");
@@ -148,7 +428,12 @@ void *monitor_thread(void *thread_context)
 
 	mon_is_ready = true;
 
-	while (c->global->running) {
+	fpgad_mutex_lock(err, &mon_list_lock);
+	scheduled = (mon_epfd >= 0) && !mon_sched_failed;
+	fpgad_mutex_unlock(err, &mon_list_lock);
+
+	// Without schedules, run every detection each poll interval.
+	while (c->global->running && !scheduled) {
 		fpgad_mutex_lock(err, &mon_list_lock);
 
 		for (d = monitored_device_list ; d ; d = d->next) {
@@ -160,6 +445,17 @@ void *monitor_thread(void *thread_context)
 		usleep(c->global->poll_interval_usec);
 	}
 
+	// The wait is bounded by the poll interval so that shutdown
+	// is noticed.
+	while (c->global->running && scheduled) {
+		fpgad_mutex_lock(err, &mon_list_lock);
+		timeout = mon_sched_run(mon_now_usec(),
+					c->global->poll_interval_usec);
+		fpgad_mutex_unlock(err, &mon_list_lock);
+
+		mon_sched_wait(timeout);
+	}
+
 	while (evt_dispatcher_is_ready()) {
 		// Wait for the event dispatcher to complete
 		// before we destroy the monitored devices.
@@ -182,6 +478,13 @@ void mon_monitor_device(fpgad_monitored_device *d)
 
 	d->next = NULL;
 
+	if (d->type == FPGAD_PLUGIN_TYPE_CALLBACK && mon_sched_add(d)) {
+		LOG("failed to schedule detections."
+		    " Polling every %u usec.\n",
+		    d->config->poll_interval_usec);
+		mon_sched_failed = true;
+	}
+
 	if (!monitored_device_list) {
 		monitored_device_list = d;
 		goto out_unlock;
@@ -244,6 +547,8 @@ void mon_destroy(struct fpgad_config *c)
 	}
 	monitored_device_list = NULL;
 
+	mon_sched_destroy();
+
 	if (c->supported_devices) {
 		for (i = 0 ; c->supported_devices[i].module_library ; ++i) {
 			fpgad_config_data *d = &c->supported_devices[i];
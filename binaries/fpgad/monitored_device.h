@@ -70,6 +70,18 @@ typedef struct _fpgad_monitored_device {
 	fpgad_respond_event_t *responses;
 	void **response_contexts;
 
+	// Optional, parallel to detections. Microseconds between
+	// runs of each detection. 0 runs it every poll_interval_usec.
+	uint64_t *detection_intervals;
+
+	// Optional, parallel to detections. A descriptor whose
+	// readiness (POLLIN or POLLPRI) runs the detection as soon as
+	// it is signaled, eg a sysfs attribute, a uevent socket or an
+	// error interrupt eventfd, or -1 for none. Readiness is edge
+	// triggered; the detection should consume it. The descriptor
+	// is owned by the plugin.
+	int *detection_fds;
+
 	// }
 
 	// for type FPGAD_PLUGIN_TYPE_THREAD {
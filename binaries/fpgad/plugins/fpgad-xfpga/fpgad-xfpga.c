@@ -28,8 +28,12 @@
 #include <config.h>
 #endif // HAVE_CONFIG_H
 
+#include <glob.h>
+#include <unistd.h>
+
 #include "fpgad/api/opae_events_api.h"
 #include "fpgad/api/device_monitoring.h"
+#include "mock/opae_std.h"
 
 #ifdef LOG
 #undef LOG
@@ -57,35 +61,80 @@ fpgad_xfpga_AP_context fpgad_xfpga_AP_contexts[] = {
 	{ "power_state", "Power state changed to", 0, 1 },
 };
 
+// The descriptor that fpgad_plugin_configure() opened for the
+// detection whose context is given, or -1.
+STATIC int fpgad_xfpga_detection_fd(fpgad_monitored_device *d,
+				    void *context)
+{
+	unsigned i;
+
+	if (!d->detection_fds || !d->detection_contexts)
+		return -1;
+
+	for (i = 0 ; d->detections[i] ; ++i) {
+		if (d->detection_contexts[i] == context)
+			return d->detection_fds[i];
+	}
+
+	return -1;
+}
+
+/*
+ * Read the 64 bit value of sysfs_file. When the detection has a
+ * descriptor, reading it also re-arms its readiness.
+ */
+STATIC fpga_result fpgad_xfpga_read64(fpgad_monitored_device *d,
+				      void *context,
+				      const char *sysfs_file,
+				      uint64_t *value)
+{
+	fpga_object obj = NULL;
+	fpga_result res;
+	char buf[32];
+	ssize_t n;
+	int fd;
+
+	fd = fpgad_xfpga_detection_fd(d, context);
+	if (fd >= 0) {
+		n = pread(fd, buf, sizeof(buf) - 1, 0);
+		if (n <= 0) {
+			LOG("failed to read error object\n");
+			return FPGA_EXCEPTION;
+		}
+		buf[n] = '\0';
+		*value = strtoull(buf, NULL, 0);
+		return FPGA_OK;
+	}
+
+	res = fpgaTokenGetObject(d->token, sysfs_file,
+				 &obj, 0);
+	if (res != FPGA_OK) {
+		LOG("failed to get error object\n");
+		return res;
+	}
+
+	res = fpgaObjectRead64(obj, value, 0);
+	if (res != FPGA_OK)
+		LOG("failed to read error object\n");
+
+	fpgaDestroyObject(&obj);
+	return res;
+}
+
 fpgad_detection_status
 fpgad_xfpga_detect_AP1_or_AP2(fpgad_monitored_device *d,
 			      void *context)
 {
 	fpgad_xfpga_AP_context *c =
 		(fpgad_xfpga_AP_context *)context;
-	fpga_object obj = NULL;
-	fpga_result res;
 	uint64_t err = 0;
 	uint64_t mask;
 	uint64_t value;
 	int i;
 	bool detected = false;
 
-	res = fpgaTokenGetObject(d->token, c->sysfs_file,
-				 &obj, 0);
-	if (res != FPGA_OK) {
-		LOG("failed to get error object\n");
-		return FPGAD_STATUS_NOT_DETECTED;
-	}
-
-	res = fpgaObjectRead64(obj, &err, 0);
-	if (res != FPGA_OK) {
-		LOG("failed to read error object\n");
-		fpgaDestroyObject(&obj);
+	if (fpgad_xfpga_read64(d, context, c->sysfs_file, &err))
 		return FPGAD_STATUS_NOT_DETECTED;
-	}
-
-	fpgaDestroyObject(&obj);
 
 	mask = 0;
 	for (i = c->low_bit ; i <= c->high_bit ; ++i)
@@ -122,29 +171,14 @@ fpgad_xfpga_detect_PowerStateChange(fpgad_monitored_device *d,
 {
 	fpgad_xfpga_AP_context *c =
 		(fpgad_xfpga_AP_context *)context;
-	fpga_object obj = NULL;
-	fpga_result res;
 	uint64_t err = 0;
 	uint64_t mask;
 	uint64_t value;
 	int i;
 	bool detected = false;
 
-	res = fpgaTokenGetObject(d->token, c->sysfs_file,
-				 &obj, 0);
-	if (res != FPGA_OK) {
-		LOG("failed to get error object\n");
+	if (fpgad_xfpga_read64(d, context, c->sysfs_file, &err))
 		return FPGAD_STATUS_NOT_DETECTED;
-	}
-
-	res = fpgaObjectRead64(obj, &err, 0);
-	if (res != FPGA_OK) {
-		LOG("failed to read error object\n");
-		fpgaDestroyObject(&obj);
-		return FPGAD_STATUS_NOT_DETECTED;
-	}
-
-	fpgaDestroyObject(&obj);
 
 	mask = 0;
 	for (i = c->low_bit ; i <= c->high_bit ; ++i)
@@ -307,29 +341,14 @@ fpgad_xfpga_detect_Error(fpgad_monitored_device *d,
 {
 	fpgad_xfpga_Error_context *c =
 		(fpgad_xfpga_Error_context *)context;
-	fpga_object obj = NULL;
-	fpga_result res;
 	uint64_t err = 0;
 	uint64_t mask;
 	uint64_t value;
 	int i;
 	bool detected = false;
 
-	res = fpgaTokenGetObject(d->token, c->sysfs_file,
-				 &obj, 0);
-	if (res != FPGA_OK) {
-		LOG("failed to get error object\n");
-		return FPGAD_STATUS_NOT_DETECTED;
-	}
-
-	res = fpgaObjectRead64(obj, &err, 0);
-	if (res != FPGA_OK) {
-		LOG("failed to read error object\n");
-		fpgaDestroyObject(&obj);
+	if (fpgad_xfpga_read64(d, context, c->sysfs_file, &err))
 		return FPGAD_STATUS_NOT_DETECTED;
-	}
-
-	fpgaDestroyObject(&obj);
 
 	mask = 0;
 	for (i = c->low_bit ; i <= c->high_bit ; ++i)
@@ -951,9 +970,164 @@ STATIC void *fpgad_xfpga_fme_response_contexts[] = {
 	NULL
 };
 
+// Errors that are only logged are read this often, instead of
+// every poll interval.
+#define FPGAD_XFPGA_ERROR_INTERVAL_USEC 1000000
+
+STATIC const char *fpgad_xfpga_port_patterns[] = {
+	"/sys/bus/pci/devices/%s/fpga_region/region*/dfl-port.*",
+	"/sys/bus/pci/devices/%s/fpga/intel-fpga-dev.*/intel-fpga-port.*",
+	NULL
+};
+
+STATIC const char *fpgad_xfpga_fme_patterns[] = {
+	"/sys/bus/pci/devices/%s/fpga_region/region*/dfl-fme.*",
+	"/sys/bus/pci/devices/%s/fpga/intel-fpga-dev.*/intel-fpga-fme.*",
+	NULL
+};
+
+// Find the sysfs directory of d's Port or FME. 0 on success.
+STATIC int fpgad_xfpga_sysfs_dir(fpgad_monitored_device *d,
+				 char *dir, size_t len)
+{
+	const char **patterns;
+	char pattern[PATH_MAX];
+	char sbdf[16];
+	fpga_properties props = NULL;
+	uint16_t seg = 0;
+	uint8_t bus = 0;
+	uint8_t dev = 0;
+	uint8_t fn = 0;
+	glob_t glob_data;
+	int res = 1;
+	size_t i;
+
+	if (fpgaGetProperties(d->token, &props) != FPGA_OK)
+		return 1;
+
+	if ((fpgaPropertiesGetSegment(props, &seg) != FPGA_OK) ||
+	    (fpgaPropertiesGetBus(props, &bus) != FPGA_OK) ||
+	    (fpgaPropertiesGetDevice(props, &dev) != FPGA_OK) ||
+	    (fpgaPropertiesGetFunction(props, &fn) != FPGA_OK)) {
+		fpgaDestroyProperties(&props);
+		return 1;
+	}
+
+	fpgaDestroyProperties(&props);
+
+	snprintf(sbdf, sizeof(sbdf), "%04x:%02x:%02x.%d",
+		 (int)seg, (int)bus, (int)dev, (int)fn);
+
+	patterns = (d->object_type == FPGA_ACCELERATOR) ?
+		fpgad_xfpga_port_patterns : fpgad_xfpga_fme_patterns;
+
+	for (i = 0 ; patterns[i] ; ++i) {
+		snprintf(pattern, sizeof(pattern), patterns[i], sbdf);
+
+		if (opae_glob(pattern, 0, NULL, &glob_data)) {
+			if (glob_data.gl_pathv)
+				opae_globfree(&glob_data);
+			continue;
+		}
+
+		// With several matches, which one is d's is unknown.
+		if (glob_data.gl_pathc == 1 &&
+		    strlen(glob_data.gl_pathv[0]) < len) {
+			strcpy(dir, glob_data.gl_pathv[0]);
+			res = 0;
+		}
+
+		opae_globfree(&glob_data);
+		break;
+	}
+
+	return res;
+}
+
+/*
+ * The AP and AP6 detections read their attribute each poll interval,
+ * and also as soon as its descriptor signals a change. The other
+ * errors are logged, and are read every FPGAD_XFPGA_ERROR_INTERVAL_USEC.
+ * dir is the sysfs directory of the device, or NULL to poll only.
+ * 0 on success.
+ */
+STATIC int fpgad_xfpga_schedule(fpgad_monitored_device *d,
+				const char *dir)
+{
+	char path[PATH_MAX];
+	const char *sysfs_file;
+	unsigned num;
+	unsigned i;
+
+	for (num = 0 ; d->detections[num] ; ++num)
+		/* count the detections */ ;
+
+	d->detection_intervals = opae_calloc(num, sizeof(uint64_t));
+	d->detection_fds = opae_malloc(num * sizeof(int));
+	if (!d->detection_intervals || !d->detection_fds) {
+		LOG("calloc failed\n");
+		goto out_free;
+	}
+
+	for (i = 0 ; i < num ; ++i) {
+		d->detection_fds[i] = -1;
+
+		if (d->detections[i] == fpgad_xfpga_detect_Error &&
+		    d->responses[i] != fpgad_xfpga_respond_AP6) {
+			d->detection_intervals[i] =
+				FPGAD_XFPGA_ERROR_INTERVAL_USEC;
+			continue;
+		}
+
+		if (!dir)
+			continue;
+
+		// Both context types begin with the sysfs file name.
+		sysfs_file =
+			((fpgad_xfpga_AP_context *)
+			 d->detection_contexts[i])->sysfs_file;
+
+		if (snprintf(path, sizeof(path), "%s/%s",
+			     dir, sysfs_file) >= (int)sizeof(path))
+			continue;
+
+		d->detection_fds[i] = opae_open(path, O_RDONLY);
+		if (d->detection_fds[i] < 0)
+			LOG("failed to open %s. Polling only.\n", path);
+	}
+
+	return 0;
+
+out_free:
+	opae_free(d->detection_intervals);
+	opae_free(d->detection_fds);
+	d->detection_intervals = NULL;
+	d->detection_fds = NULL;
+	return 1;
+}
+
+STATIC void fpgad_xfpga_unschedule(fpgad_monitored_device *d)
+{
+	unsigned i;
+
+	if (d->detection_fds) {
+		for (i = 0 ; d->detections[i] ; ++i) {
+			if (d->detection_fds[i] >= 0)
+				opae_close(d->detection_fds[i]);
+		}
+		opae_free(d->detection_fds);
+		d->detection_fds = NULL;
+	}
+
+	opae_free(d->detection_intervals);
+	d->detection_intervals = NULL;
+}
+
 int fpgad_plugin_configure(fpgad_monitored_device *d,
 			   const char *cfg)
 {
+	char dir[PATH_MAX];
+
 	UNUSED_PARAM(cfg);
 
 	LOG("monitoring vid=0x%04x did=0x%04x objid=0x%x (%s)\n",
@@ -977,6 +1151,13 @@ int fpgad_plugin_configure(fpgad_monitored_device *d,
 		d->response_contexts = fpgad_xfpga_fme_response_contexts;
 	}
 
+	if (fpgad_xfpga_sysfs_dir(d, dir, sizeof(dir))) {
+		LOG("sysfs directory not found. Polling only.\n");
+		fpgad_xfpga_schedule(d, NULL);
+	} else {
+		fpgad_xfpga_schedule(d, dir);
+	}
+
 	return 0;
 }
 
@@ -988,4 +1169,6 @@ void fpgad_plugin_destroy(fpgad_monitored_device *d)
 			d->object_id,
 			d->object_type == FPGA_ACCELERATOR ?
 			"accelerator" : "device");
+
+	fpgad_xfpga_unschedule(d);
 }
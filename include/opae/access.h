@@ -64,6 +64,29 @@ extern "C" {
  *                          of a parent resource that is already open in the
  *                          same process. When set, the value of *handle on
  *                          entry is the parent handle.
+ *                        * FPGA_OPEN_LOCKLESS_MMIO requests that the MMIO
+ *                          read/write functions validate the handle without
+ *                          acquiring its lock, so that MMIO from many threads
+ *                          can proceed concurrently. fpgaClose() waits for
+ *                          in-flight MMIO accesses to drain before releasing
+ *                          the mapping. Honored by the vfio plugin; MMIO
+ *                          through the xfpga plugin is always lock-free, and
+ *                          other plugins accept and ignore the flag.
+ *                        * FPGA_OPEN_BUFFER_POOL keeps buffers released with
+ *                          fpgaReleaseBuffer() pinned and IOMMU-mapped, and
+ *                          hands them out again to fpgaPrepareBuffer() calls
+ *                          of the same size class, so that repeat
+ *                          allocations don't enter the kernel. Recycled
+ *                          buffers are not cleared. The pool holds at most
+ *                          LIBOPAE_BUFFER_POOL_MAX bytes (default 1 GiB).
+ *                          Honored by the vfio plugin; other plugins accept
+ *                          and ignore the flag.
+ *                        * FPGA_OPEN_DEFERRED_RELEASE makes fpgaReleaseBuffer()
+ *                          queue the unmapping and freeing of buffers that
+ *                          were allocated by fpgaPrepareBuffer() to a
+ *                          background thread, and return. See
+ *                          fpgaDrainBufferReleases(). Honored by the vfio
+ *                          and xfpga plugins.
  * @returns             FPGA_OK on success. FPGA_NOT_FOUND if the resource for
  *                      'token' could not be found. FPGA_INVALID_PARAM if
  *                      'token' does not refer to a resource that can be
@@ -84,11 +84,40 @@ extern "C" {
  *                        pointed at in '*buf_addr' is already allocated an
  *                        mapped into virtual memory. FPGA_BUF_READ_ONLY
  *                        pins pages with only read access from the FPGA.
+ *                        FPGA_BUF_SLAB carves the buffer from a pinned
+ *                        hugepage region shared with other FPGA_BUF_SLAB
+ *                        buffers on the handle (see below).
+ *                        FPGA_BUF_NUMA_LOCAL allocates the buffer's pages
+ *                        on the NUMA node of the PCIe device (see
+ *                        fpgaPrepareBufferEx()). FPGA_BUF_PREFAULT
+ *                        populates a new buffer's pages in parallel
+ *                        before they are pinned (see below).
  * @returns FPGA_OK on success. FPGA_NO_MEMORY if the requested memory could
  * not be allocated. FPGA_INVALID_PARAM if invalid parameters were provided, or
  * if the parameter combination is not valid. FPGA_EXCEPTION if an internal
  * exception occurred while trying to access the handle.
  *
+ * Without FPGA_BUF_SLAB, a buffer larger than 4 KiB is backed by its own
+ * 2 MiB or 1 GiB hugepages, so small buffers pin far more memory than
+ * they use. With FPGA_BUF_SLAB, buffers of up to 1 MiB share 2 MiB
+ * regions and buffers of up to 256 MiB share 1 GiB regions. Each slab
+ * buffer still has its own wsid and IO address. A region is unpinned once
+ * all of its buffers have been released, except for the last region of
+ * each size, which is kept until the handle is closed. Larger requests
+ * ignore FPGA_BUF_SLAB. Slab regions are mapped for device reads and
+ * writes, so FPGA_BUF_READ_ONLY has no effect on slab buffers.
+ * FPGA_BUF_SLAB cannot be combined with FPGA_BUF_PREALLOCATED.
+ *
+ * Pinning faults in the pages of a new buffer one at a time, which can
+ * take seconds for a buffer of several GiB. With FPGA_BUF_PREFAULT, the
+ * pages are first populated by worker threads running on the CPUs of the
+ * buffer's NUMA node (or on the CPUs allowed for the calling thread, when
+ * the buffer has no NUMA placement). A buffer with no NUMA placement
+ * that fits in a single page is populated by mmap() with MAP_POPULATE
+ * instead. FPGA_BUF_PREFAULT is
+ * ignored for pre-allocated, slab and pooled buffers. The time spent
+ * preparing buffers is reported by fpgaGetBufferPrepareStats().
+ *
  * @note As a special case, when FPGA_BUF_PREALLOCATED is present in flags,
  * if len == 0 and buf_addr == NULL, then the function returns FPGA_OK if
  * pre-allocated buffers are supported. In this case, a return value other
@@ -98,6 +127,93 @@ fpga_result fpgaPrepareBuffer(fpga_handle handle,
 			      uint64_t len,
 			      void **buf_addr, uint64_t *wsid, int flags);
 
+/** No NUMA placement for fpgaPrepareBufferEx(), other than that implied
+ * by FPGA_BUF_NUMA_LOCAL. */
+#define FPGA_NUMA_NODE_ANY (-1)
+
+/**
+ * Prepare a shared memory buffer on a given NUMA node
+ *
+ * Like fpgaPrepareBuffer(), but the pages of an allocated buffer are
+ * bound to NUMA node `numa_node`. DMA between a device and memory on a
+ * remote socket crosses the socket interconnect, which reduces the
+ * bandwidth available to the device.
+ *
+ * When `numa_node` is FPGA_NUMA_NODE_ANY, FPGA_BUF_NUMA_LOCAL in `flags`
+ * selects the node that the PCIe device is attached to. If the device's
+ * node is not known, the buffer is allocated without a NUMA policy.
+ * Without either, this call is equivalent to fpgaPrepareBuffer().
+ *
+ * The pages are bound strictly: if the node has no free pages of the
+ * required (huge) page size, the call fails with FPGA_NO_MEMORY rather
+ * than placing the buffer elsewhere. FPGA_BUF_PREALLOCATED buffers are
+ * never rebound. A NUMA placement request takes precedence over
+ * FPGA_BUF_SLAB, whose shared regions have no placement of their own.
+ *
+ * @param[in]  handle     Handle to previously opened accelerator resource
+ * @param[in]  len        Length of the buffer to allocate/prepare in bytes
+ * @param[inout] buf_addr Virtual address of buffer (see fpgaPrepareBuffer())
+ * @param[out] wsid       Handle to the allocated/prepared buffer to be used
+ *                        with other functions
+ * @param[in]  flags      Flags, as for fpgaPrepareBuffer()
+ * @param[in]  numa_node  NUMA node for the buffer, or FPGA_NUMA_NODE_ANY
+ * @returns As for fpgaPrepareBuffer(). FPGA_INVALID_PARAM if `numa_node`
+ * is neither FPGA_NUMA_NODE_ANY nor a possible node of the system.
+ * FPGA_NOT_SUPPORTED if the plugin serving `handle` cannot place buffers
+ * on a NUMA node.
+ */
+fpga_result fpgaPrepareBufferEx(fpga_handle handle,
+				uint64_t len,
+				void **buf_addr, uint64_t *wsid, int flags,
+				int numa_node);
+
+/**
+ * Pin an application buffer for scatter-gather DMA
+ *
+ * Prepares the application-owned range [buf_addr, buf_addr + len) for
+ * access by the accelerator, without copying it. Unlike
+ * fpgaPrepareBuffer() with FPGA_BUF_PREALLOCATED, the memory need not be
+ * physically contiguous or backed by hugepages, and buf_addr and len need
+ * not be page-aligned: the pages overlapping the range are pinned.
+ *
+ * The range is mapped in as few IOVA-contiguous segments as the platform
+ * allows, and those segments are returned in `sg`, in address order. The
+ * first segment starts at the IO address of buf_addr, and the segment
+ * lengths add up to len. Behind an IOMMU this is usually a single
+ * segment. Without one, each segment is a physically contiguous run of
+ * pages.
+ *
+ * Release the buffer with fpgaReleaseBuffer(), which unpins the memory
+ * but does not free it. fpgaGetIOAddress() returns the IO address of the
+ * first segment.
+ *
+ * Buffers may share pages. A shared page stays pinned until the last
+ * buffer using it is released, and buffers sharing a page must agree on
+ * FPGA_BUF_READ_ONLY.
+ *
+ * @param[in]  handle     Handle to previously opened accelerator resource
+ * @param[in]  buf_addr   Start of the application buffer
+ * @param[in]  len        Length of the buffer in bytes
+ * @param[out] wsid       Handle to the prepared buffer to be used
+ *                        with other functions
+ * @param[out] sg         Array receiving the segment list
+ * @param[inout] num_sg   On input, the number of entries in `sg`. On
+ *                        output, the number of entries used.
+ * @param[in]  flags      FPGA_BUF_READ_ONLY and FPGA_BUF_QUIET, as for
+ *                        fpgaPrepareBuffer()
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if invalid parameters
+ * were provided, or if a shared page was pinned with other flags.
+ * FPGA_NO_MEMORY if the range could not be pinned, or needs more than
+ * *num_sg segments; nothing remains pinned in that case.
+ * FPGA_NOT_SUPPORTED if the plugin serving `handle` cannot pin
+ * application memory, or if `handle` has child AFU ports.
+ */
+fpga_result fpgaPrepareBufferSG(fpga_handle handle,
+				void *buf_addr, uint64_t len,
+				uint64_t *wsid,
+				fpga_sg_entry *sg, uint32_t *num_sg,
+				int flags);
+
 /**
  * Release a shared memory buffer
  *
@@ -106,6 +222,15 @@ fpga_result fpgaPrepareBuffer(fpga_handle handle,
  * will deallocate/free that memory. Otherwise, it will only be returned to
  * it's previous state (pinned/unpinned, cached/non-cached).
  *
+ * For a handle opened with FPGA_OPEN_DEFERRED_RELEASE, a buffer allocated
+ * by fpgaPrepareBuffer() is unmapped and freed by a background thread
+ * after the call returns. `wsid` and the buffer's address are invalid as
+ * soon as the call returns, but the buffer's pages and IO address range
+ * are only reusable once fpgaDrainBufferReleases() returns. The vfio
+ * plugin combines the IOMMU unmapping of released buffers with adjacent
+ * IO address ranges. Pre-allocated, slab and scatter-gather buffers are
+ * always released synchronously.
+ *
  * @param[in]  handle   Handle to previously opened accelerator resource
  * @param[in]  wsid     Handle to the allocated/prepared buffer
  * @returns FPGA_OK on success. FPGA_INVALID_PARAM if invalid parameters were
@@ -114,6 +239,21 @@ fpga_result fpgaPrepareBuffer(fpga_handle handle,
  */
 fpga_result fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid);
 
+/**
+ * Wait for deferred buffer releases to complete
+ *
+ * Returns once every buffer released with fpgaReleaseBuffer() on a handle
+ * opened with FPGA_OPEN_DEFERRED_RELEASE has been unmapped from the device
+ * and freed. fpgaClose() drains the handle's releases before returning, and
+ * fpgaPrepareBuffer() drains them before failing for lack of memory. For
+ * other handles, there is nothing to wait for.
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if handle is invalid.
+ * FPGA_NOT_SUPPORTED if the plugin does not defer releases.
+ */
+fpga_result fpgaDrainBufferReleases(fpga_handle handle);
+
 /**
  * Retrieve base IO address for buffer
  *
@@ -147,6 +287,37 @@ fpga_result fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
  */
 fpga_result fpgaBindSVA(fpga_handle handle, uint32_t *pasid);
 
+/**
+ * Retrieve buffer pool statistics
+ *
+ * Reports the activity of the buffer pool of a handle that was opened
+ * with FPGA_OPEN_BUFFER_POOL. See fpgaOpen().
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[out] stats    Receives the pool statistics
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if stats is NULL.
+ * FPGA_NOT_SUPPORTED if the handle has no buffer pool.
+ */
+fpga_result fpgaGetBufferPoolStats(fpga_handle handle,
+				   fpga_buffer_pool_stats *stats);
+
+/**
+ * Retrieve buffer preparation statistics
+ *
+ * Reports the number of DMA mappings created for a handle by
+ * fpgaPrepareBuffer() and related calls, and the time spent allocating,
+ * populating and pinning their pages. The counters accumulate from
+ * fpgaOpen() and are not reset. Comparing the time per byte with and
+ * without FPGA_BUF_PREFAULT shows the effect of the flag.
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[out] stats    Receives the preparation statistics
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if stats is NULL.
+ * FPGA_NOT_SUPPORTED if the plugin does not keep the statistics.
+ */
+fpga_result fpgaGetBufferPrepareStats(fpga_handle handle,
+				      fpga_buffer_prepare_stats *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -102,6 +102,24 @@ fpga_result fpgaEnumerate(const fpga_properties *filters,
 			  uint32_t num_filters, fpga_token *tokens,
 			  uint32_t max_tokens, uint32_t *num_matches);
 
+/**
+ * Invalidate the enumeration cache
+ *
+ * When the environment variable LIBOPAE_ENUM_CACHE is set to 1,
+ * fpgaEnumerate() caches the resources discovered by each plugin and
+ * evaluates subsequent filters in memory. Filters that name a parent token,
+ * an error count, or an accelerator state always trigger a fresh scan.
+ *
+ * The cache is invalidated automatically by kernel hotplug uevents for
+ * PCI and FPGA devices. This call forces the next fpgaEnumerate() to
+ * rescan, for example after a driver has been rebound in a way that does
+ * not generate uevents visible to the calling process. Tokens that were
+ * already returned remain valid.
+ *
+ * @returns FPGA_OK on success.
+ */
+fpga_result fpgaInvalidateEnumerationCache(void);
+
 /**
  * Clone a fpga_token object
  *
@@ -153,6 +153,117 @@ fpga_result fpgaUnregisterEvent(fpga_handle handle,
 					     fpga_event_type event_type,
 					     fpga_event_handle event_handle);
 
+/**
+ * Wait for any of a set of FPGA events
+ *
+ * Blocks until at least one of the given event handles is signaled, or
+ * the timeout expires. The handles may have been registered on any
+ * number of FPGA resources and plugins.
+ *
+ * The OS objects of the handles are kept in an epoll set that belongs
+ * to the calling thread and is reused across calls, so the cost of a
+ * wakeup depends on the number of signaled handles, not on the number
+ * being waited for. An event handle should be waited on by one thread
+ * at a time.
+ *
+ * As with poll(), a signaled handle stays signaled until its event is
+ * consumed, e.g. by reading the eventfd obtained from
+ * fpgaGetOSObjectFromEventHandle(). Distinct handles that share an OS
+ * object, such as the event handles of one uio device, are reported
+ * together when it is signaled.
+ *
+ * @param[in]  event_handles Array of event handles, each previously
+ *                           passed to fpgaRegisterEvent(). A handle
+ *                           may appear only once.
+ * @param[in]  num_handles   Number of entries in `event_handles`.
+ * @param[in]  timeout       Time to wait in milliseconds. 0 returns
+ *                           immediately; -1 waits indefinitely.
+ * @param[out] ready         Receives the indices into `event_handles`
+ *                           of the signaled handles. Must have room for
+ *                           `num_handles` entries.
+ * @param[out] num_ready     Number of entries written to `ready`. 0 when
+ *                           the timeout expired or the wait was
+ *                           interrupted by a signal.
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any pointer is NULL,
+ * `num_handles` is 0, or an event handle is invalid, unregistered or
+ * repeated. FPGA_NOT_SUPPORTED if the plugin of a handle provides no OS
+ * object. FPGA_NO_MEMORY or FPGA_EXCEPTION if the wait set could not be
+ * created or updated.
+ */
+fpga_result fpgaWaitForEvents(fpga_event_handle *event_handles,
+			      uint32_t num_handles,
+			      int timeout,
+			      uint32_t *ready,
+			      uint32_t *num_ready);
+
+/**
+ * Wait for an accelerator to signal completion in host memory
+ *
+ * Waits until `(*addr & mask) == value`, typically for a status word in
+ * a DSM buffer that the accelerator writes when a job is done. The word
+ * is polled for a spin budget, after which the caller blocks on
+ * `event_handle` and checks the word each time the event is signaled.
+ * The event must already be registered with fpgaRegisterEvent(), and
+ * the accelerator must raise it when it writes the word.
+ *
+ * The spin budget starts at the measured cost of the blocking path and
+ * adapts to the completion times seen on `event_handle`: short jobs are
+ * caught by spinning, while long ones soon go straight to blocking. The
+ * environment variable LIBOPAE_SPIN_NS sets the initial budget and its
+ * ceiling; 0 disables spinning.
+ *
+ * @param[in]  event_handle Registered event handle raised on completion.
+ * @param[in]  addr         Completion word.
+ * @param[in]  mask         Bits of the word to compare.
+ * @param[in]  value        Value of the masked bits on completion.
+ * @param[in]  timeout      Time to wait in milliseconds. -1 waits
+ *                          indefinitely.
+ * @param[out] stats        Optional. Receives how the wait was resolved
+ *                          and the time spent spinning and blocked.
+ *
+ * @returns FPGA_OK on completion. FPGA_BUSY if the timeout expired
+ * first. FPGA_INVALID_PARAM if `event_handle` or `addr` is NULL or the
+ * event handle has not been registered. FPGA_EXCEPTION if waiting on
+ * the event failed.
+ */
+fpga_result fpgaWaitForCompletion(fpga_event_handle event_handle,
+				  volatile uint64_t *addr,
+				  uint64_t mask,
+				  uint64_t value,
+				  int timeout,
+				  fpga_wait_stats *stats);
+
+/**
+ * Wait for an accelerator to signal completion in a CSR
+ *
+ * As fpgaWaitForCompletion(), with the completion word read by
+ * fpgaReadMMIO64() from the given MMIO region and offset of `handle`.
+ *
+ * @param[in]  handle       Handle to an opened accelerator.
+ * @param[in]  mmio_num     MMIO region of the CSR.
+ * @param[in]  offset       Byte offset of the CSR within the region.
+ * @param[in]  mask         Bits of the CSR to compare.
+ * @param[in]  value        Value of the masked bits on completion.
+ * @param[in]  event_handle Registered event handle raised on completion.
+ * @param[in]  timeout      Time to wait in milliseconds. -1 waits
+ *                          indefinitely.
+ * @param[out] stats        Optional. Receives how the wait was resolved
+ *                          and the time spent spinning and blocked.
+ *
+ * @returns FPGA_OK on completion. FPGA_BUSY if the timeout expired
+ * first. FPGA_INVALID_PARAM if `handle` or `event_handle` is invalid.
+ * Any error returned by fpgaReadMMIO64().
+ */
+fpga_result fpgaWaitForCompletionCSR(fpga_handle handle,
+				     uint32_t mmio_num,
+				     uint64_t offset,
+				     uint64_t mask,
+				     uint64_t value,
+				     fpga_event_handle event_handle,
+				     int timeout,
+				     fpga_wait_stats *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -54,9 +54,19 @@ extern "C" {
  * in situations where the key space is guaranteed to produce unique values,
  * for example a memory allocator. When the key space is guaranteed to be
  * unique, opae_hash_map_add() can implement a small performance improvement.
+ *
+ * OPAE_HASH_MAP_OPEN_ADDRESSING stores keys and values inline in a single
+ * slot array, probed linearly, instead of in per-bucket lists. No memory
+ * is allocated per item, and the array doubles in size as it fills, so
+ * num_buckets is only the initial capacity (rounded up to a power of 2).
+ * The key_hash function is called with the current capacity as its
+ * num_buckets parameter. When key_hash is opae_u64_key_hash, the map
+ * applies its own multiplicative hash instead, so that aligned addresses
+ * don't share their low bits.
  */
 typedef enum _opae_hash_map_flags {
-	OPAE_HASH_MAP_UNIQUE_KEYSPACE = (1u << 0)
+	OPAE_HASH_MAP_UNIQUE_KEYSPACE = (1u << 0),
+	OPAE_HASH_MAP_OPEN_ADDRESSING = (1u << 1)
 } opae_hash_map_flags;
 
 /**
@@ -73,6 +83,18 @@ typedef struct _opae_hash_map_item {
 	struct _opae_hash_map_item *next;
 } opae_hash_map_item;
 
+/**
+ * Open addressing slot.
+ *
+ * Used in place of opae_hash_map_item when the map is initialized
+ * with OPAE_HASH_MAP_OPEN_ADDRESSING.
+ */
+typedef struct _opae_hash_map_slot {
+	void *key;
+	void *value;
+	uint32_t state; ///< empty, in use, or deleted
+} opae_hash_map_slot;
+
 /**
  * Hash map object.
  *
@@ -93,6 +115,10 @@ typedef struct _opae_hash_map {
 	int (*key_compare)(void *keya, void *keyb);	   ///< (required)
 	void (*key_cleanup)(void *key, void *context);	   ///< (optional)
 	void (*value_cleanup)(void *value, void *context); ///< (optional)
+	/* Appended to keep the layout of the fields above. */
+	opae_hash_map_slot *slots;         ///< OPAE_HASH_MAP_OPEN_ADDRESSING storage
+	uint32_t num_items;                ///< slots in use
+	uint32_t num_deleted;              ///< slots vacated by remove
 } opae_hash_map;
 
 /**
@@ -127,6 +153,9 @@ typedef struct _opae_hash_map {
  *                           any resources allocated when the value was created.
  * @returns FPGA_OK on success, FPGA_INVALID_PARAM if any of the required parameters are
  *          NULL, or FPGA_NO_MEMORY if the bucket array could not be allocated.
+ *
+ * @note With OPAE_HASH_MAP_OPEN_ADDRESSING, num_buckets is the initial
+ *       number of slots. The slot array grows as items are added.
  */
 fpga_result opae_hash_map_init(opae_hash_map *hm,
 			       uint32_t num_buckets,
@@ -150,8 +179,10 @@ fpga_result opae_hash_map_init(opae_hash_map *hm,
  * @param[in]      key   The hash map key.
  * @param[in]      value The hash map value.
  * @returns FPGA_OK on success, FPGA_INVALID_PARAM if hm is NULL, FPGA_NO_MEMORY
- *          if malloc() fails when allocating the list item, or FPGA_INVALID_PARAM
- *          if the key hash produced by key_hash is out of bounds.
+ *          if malloc() fails when allocating the list item (or, for
+ *          OPAE_HASH_MAP_OPEN_ADDRESSING, the grown slot array), or
+ *          FPGA_INVALID_PARAM if the key hash produced by key_hash is out of
+ *          bounds.
  */
 fpga_result opae_hash_map_add(opae_hash_map *hm,
 			      void *key,
@@ -36,20 +36,37 @@
 * ie released back to the available pool of logical address space for future
 * allocations. The memory backing the allocator's internal data structures
 * is managed by malloc()/free().
+*
+* Free and allocated ranges are kept on address-ordered lists. Each list is
+* indexed by an AVL tree keyed on address, and free ranges are additionally
+* grouped into power-of-two size bins, so that allocation, release and
+* coalescing are O(log n) in the number of tracked ranges.
 */
 
 #include <stdint.h>
 
+/** Number of power-of-two free size bins. */
+#define MEM_ALLOC_BINS 64
+
 struct mem_link {
 	uint64_t address;
 	uint64_t size;
 	struct mem_link *prev;
 	struct mem_link *next;
+	struct mem_link *left;		/**< Address tree, lower addresses. */
+	struct mem_link *right;		/**< Address tree, higher addresses. */
+	struct mem_link *bin_prev;	/**< Free size bin links. */
+	struct mem_link *bin_next;
+	int height;			/**< AVL height of this subtree. */
 };
 
 struct mem_alloc {
 	struct mem_link free;
 	struct mem_link allocated;
+	struct mem_link *free_root;	/**< Address tree of free ranges. */
+	struct mem_link *allocated_root;/**< Address tree of allocations. */
+	uint64_t bins_mask;		/**< Bit n set: free_bins[n] non-empty. */
+	struct mem_link *free_bins[MEM_ALLOC_BINS];
 };
 
 #ifdef __cplusplus
@@ -105,7 +122,12 @@ int mem_alloc_add_free(struct mem_alloc *m,
 /** Allocate memory
  *
  * Retrieve an available memory address for a free block
- * that is at least size bytes.
+ * that is at least size bytes. The returned address is
+ * aligned to size when size is a power of two.
+ *
+ * The smallest free range that satisfies the request is
+ * preferred, so that large ranges are kept intact for
+ * large requests.
  *
  * @param[in, out] m       The memory allocator object.
  * @param[out]     address The retrieved address for the allocation.
@@ -0,0 +1,82 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __OPAE_MEM_BIND_H__
+#define __OPAE_MEM_BIND_H__
+
+/**
+* Provides an API for binding the pages of a newly mapped DMA buffer to a
+* NUMA node before they are first touched, without a libnuma dependency.
+*/
+
+#include <stdint.h>
+
+/** Upper bound on the NUMA node count, and the size of the mbind() mask. */
+#define MEM_BIND_MAX_NODES 1024
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Return the number of possible NUMA nodes
+ *
+ * One more than the highest node listed in
+ * /sys/devices/system/node/possible, capped at MEM_BIND_MAX_NODES, or 1
+ * when the list can't be read.
+ *
+ * @returns The node count, at least 1.
+ */
+int mem_bind_num_nodes(void);
+
+/**
+ * Check a NUMA node number
+ *
+ * @param[in] numa_node The node.
+ * @returns Non-zero when 0 <= numa_node < mem_bind_num_nodes().
+ */
+int mem_bind_node_valid(int numa_node);
+
+/**
+ * Bind the pages of a range to a NUMA node
+ *
+ * Applies a strict MPOL_BIND policy for numa_node to [addr, addr + len),
+ * so the range must not have been touched yet. The range must be page
+ * aligned and, for hugepage mappings, cover whole hugepages.
+ *
+ * @param[in] addr      The start of the range.
+ * @param[in] len       The length of the range.
+ * @param[in] numa_node The node, which must pass mem_bind_node_valid().
+ * @returns Non-zero on error, with errno set (EINVAL for an invalid node).
+ * Zero on success.
+ */
+int mem_bind(void *addr, uint64_t len, int numa_node);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __OPAE_MEM_BIND_H__
@@ -0,0 +1,89 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef __OPAE_MEM_PREFAULT_H__
+#define __OPAE_MEM_PREFAULT_H__
+
+/**
+* Provides an API for populating the pages of a large, newly mapped DMA
+* buffer before it is pinned. Pinning (VFIO_IOMMU_MAP_DMA, DFL port DMA
+* map) otherwise faults the pages in one at a time in the calling thread,
+* and for hugepages most of that time is spent zeroing memory. Spreading
+* the first touch across worker threads divides that cost.
+*/
+
+#include <stdint.h>
+
+/** Upper bound on the number of worker threads used by mem_prefault(). */
+#define MEM_PREFAULT_MAX_THREADS 16
+/** Each worker thread populates at least this many bytes. */
+#define MEM_PREFAULT_MIN_CHUNK   (32UL * 1024 * 1024)
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Return the number of threads mem_prefault() would use.
+ *
+ * @param[in] len       The length of the range in bytes.
+ * @param[in] page_size The size of the pages backing the range.
+ * @param[in] numa_node The node whose CPUs run the workers, or -1.
+ * @returns The thread count, at least 1.
+ */
+uint32_t mem_prefault_threads(uint64_t len, uint64_t page_size,
+			      int numa_node);
+
+/**
+ * Populate the pages of a range
+ *
+ * Writes the first byte of each page in [addr, addr + len), so the range
+ * must be newly mapped anonymous memory whose contents are still zero.
+ * Any NUMA memory policy for the range must be set beforehand.
+ *
+ * The pages are divided among up to MEM_PREFAULT_MAX_THREADS worker
+ * threads. When numa_node is not -1, the workers run on the CPUs of
+ * that node, so that the pages are zeroed by CPUs local to them.
+ * Otherwise, or when the node's CPUs can't be determined, they run on
+ * the CPUs allowed for the calling thread. A
+ * range with too few pages to divide is populated by the caller.
+ *
+ * @param[in] addr      The page-aligned start of the range.
+ * @param[in] len       The length of the range, a multiple of page_size.
+ * @param[in] page_size The size of the pages backing the range.
+ * @param[in] numa_node The node whose CPUs run the workers, or -1.
+ * @returns Non-zero on error. Zero on success.
+ */
+int mem_prefault(void *addr, uint64_t len, uint64_t page_size,
+		 int numa_node);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __OPAE_MEM_PREFAULT_H__
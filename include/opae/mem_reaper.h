@@ -0,0 +1,145 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifndef __OPAE_MEM_REAPER_H__
+#define __OPAE_MEM_REAPER_H__
+
+/**
+* Provides an API for releasing DMA buffers on a background thread.
+* Unmapping a buffer from the device and unmapping its pages from the
+* process are both system calls whose cost falls on the caller of a
+* release function. A reaper instead queues the buffer and returns. Its
+* thread hands the queued buffers, sorted by IO address, to a callback
+* in batches, which lets the callback combine the unmapping of buffers
+* with adjacent IO address ranges.
+*
+* The reaper's thread is started by the first mem_reaper_put().
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct mem_reaper_entry {
+	void *vaddr;
+	uint64_t iova;
+	uint64_t size;
+	void *data;			/**< Opaque to the reaper. */
+	struct mem_reaper_entry *next;
+};
+
+/**
+ * Release the buffers of a batch
+ *
+ * The batch is a list of entries in ascending order of iova. The reaper
+ * frees the entries after the callback returns. The callback runs on the
+ * reaper's thread, without the reaper's lock held.
+ */
+typedef void (*mem_reaper_fn)(void *context,
+			      struct mem_reaper_entry *batch);
+
+struct mem_reaper {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;		/**< Queued work, or stop. */
+	pthread_cond_t idle;		/**< Queue emptied. */
+	pthread_t thread;
+	bool running;			/**< thread was started. */
+	bool stop;
+	uint32_t busy;			/**< Entries in the current batch. */
+	uint32_t queued;
+	struct mem_reaper_entry *queue;
+	mem_reaper_fn reap;
+	void *context;			/**< Passed to reap. */
+	uint64_t batches;		/**< Calls to reap. */
+	uint64_t entries;		/**< Entries passed to reap. */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Initialize a reaper object
+ *
+ * @param[out] r       The reaper to initialize.
+ * @param[in]  reap    Callback that releases a batch of buffers.
+ * @param[in]  context Opaque value passed to reap.
+ * @returns Non-zero on error. Zero on success.
+ */
+int mem_reaper_init(struct mem_reaper *r,
+		    mem_reaper_fn reap,
+		    void *context);
+
+/**
+ * Destroy a reaper object
+ *
+ * Releases any queued buffers, then stops the reaper's thread.
+ *
+ * @param[in] r The reaper to destroy.
+ */
+void mem_reaper_destroy(struct mem_reaper *r);
+
+/**
+ * Queue a buffer for release
+ *
+ * @param[in, out] r     The reaper object.
+ * @param[in]      vaddr The virtual address of the buffer.
+ * @param[in]      iova  The IO address of the buffer.
+ * @param[in]      size  The size of the buffer.
+ * @param[in]      data  Opaque value handed to the callback.
+ * @returns Non-zero when the buffer could not be queued, in which
+ * case the caller must release it. Zero on success.
+ */
+int mem_reaper_put(struct mem_reaper *r,
+		   void *vaddr,
+		   uint64_t iova,
+		   uint64_t size,
+		   void *data);
+
+/**
+ * Wait for all queued buffers to be released
+ *
+ * Must not be called from the reap callback.
+ *
+ * @param[in, out] r The reaper object.
+ * @returns Non-zero on error. Zero on success.
+ */
+int mem_reaper_drain(struct mem_reaper *r);
+
+/**
+ * Return the number of buffers queued or being released.
+ *
+ * @param[in] r The reaper object.
+ */
+uint32_t mem_reaper_pending(struct mem_reaper *r);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __OPAE_MEM_REAPER_H__
@@ -0,0 +1,161 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef __OPAE_MEM_SLAB_H__
+#define __OPAE_MEM_SLAB_H__
+
+/**
+* Provides an API for sub-allocating small DMA buffers from large pinned
+* regions. Regions are obtained from and returned to the caller through
+* a pair of callbacks, so the slab is independent of the mechanism used
+* to pin memory and map it for device access (VFIO, DFL port ioctl, etc).
+* Each region's space is managed by a mem_alloc allocator, keyed on the
+* region's virtual addresses. A sub-allocation's IO address is the region's
+* IO address plus the sub-allocation's offset into the region.
+*
+* The slab performs no locking. Callers serialize access.
+*/
+
+#include <stdint.h>
+#include <opae/mem_alloc.h>
+
+/** Region size used for sub-allocations up to MEM_SLAB_SMALL_MAX bytes. */
+#define MEM_SLAB_SMALL_REGION (2UL * 1024 * 1024)
+#define MEM_SLAB_SMALL_MAX    (1UL * 1024 * 1024)
+/** Region size used for sub-allocations up to MEM_SLAB_LARGE_MAX bytes. */
+#define MEM_SLAB_LARGE_REGION (1UL * 1024 * 1024 * 1024)
+#define MEM_SLAB_LARGE_MAX    (256UL * 1024 * 1024)
+
+/** Sub-allocations are rounded up to a multiple of this size. */
+#define MEM_SLAB_GRANULE 4096
+
+/**
+ * Pin and map a new region of size bytes.
+ *
+ * @returns Non-zero on error. Zero on success.
+ */
+typedef int (*mem_slab_map_fn)(void *context, uint64_t size,
+			       void **vaddr, uint64_t *iova);
+
+/**
+ * Unmap and unpin a region returned by a mem_slab_map_fn.
+ */
+typedef void (*mem_slab_unmap_fn)(void *context, void *vaddr,
+				  uint64_t iova, uint64_t size);
+
+struct mem_slab_region {
+	uint8_t *vaddr;
+	uint64_t iova;
+	uint64_t size;
+	uint32_t allocs;		/**< Live sub-allocations. */
+	struct mem_alloc alloc;
+	struct mem_slab_region *next;
+};
+
+struct mem_slab {
+	struct mem_slab_region *regions;
+	mem_slab_map_fn map;
+	mem_slab_unmap_fn unmap;
+	void *context;			/**< Passed to map and unmap. */
+	uint64_t pinned;		/**< Sum of the region sizes. */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/**
+ * Initialize a slab object
+ *
+ * After the call, the slab holds no regions. Regions are mapped on
+ * demand by mem_slab_get().
+ *
+ * @param[out] s       The slab to initialize.
+ * @param[in]  map     Callback that pins and maps a new region.
+ * @param[in]  unmap   Callback that releases a region.
+ * @param[in]  context Opaque value passed to map and unmap.
+ */
+void mem_slab_init(struct mem_slab *s,
+		   mem_slab_map_fn map,
+		   mem_slab_unmap_fn unmap,
+		   void *context);
+
+/**
+ * Destroy a slab object
+ *
+ * Releases every region, whether or not it still holds live
+ * sub-allocations.
+ *
+ * @param[in] s The slab to destroy.
+ */
+void mem_slab_destroy(struct mem_slab *s);
+
+/**
+ * Return the region size that mem_slab_get() uses for a request.
+ *
+ * @param[in] size The request size in bytes.
+ * @returns The region size, or 0 when size is too large to be
+ * sub-allocated.
+ */
+uint64_t mem_slab_region_size(uint64_t size);
+
+/**
+ * Sub-allocate a buffer
+ *
+ * The request is rounded up to a multiple of MEM_SLAB_GRANULE and carved
+ * from an existing region of the appropriate size, mapping a new region
+ * when none has room.
+ *
+ * @param[in, out] s     The slab object.
+ * @param[in]      size  The request size in bytes.
+ * @param[out]     vaddr The virtual address of the buffer.
+ * @param[out]     iova  The IO address of the buffer.
+ * @returns Non-zero on error. Zero on success.
+ */
+int mem_slab_get(struct mem_slab *s,
+		 uint64_t size,
+		 void **vaddr,
+		 uint64_t *iova);
+
+/**
+ * Release a sub-allocated buffer
+ *
+ * When the buffer was the last one in its region, the region is
+ * released, unless it is the only region of its size. Keeping one
+ * empty region avoids remapping for alternating get/put sequences.
+ *
+ * @param[in, out] s     The slab object.
+ * @param[in]      vaddr The address returned by mem_slab_get().
+ * @returns Non-zero on error. Zero on success.
+ */
+int mem_slab_put(struct mem_slab *s, void *vaddr);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // __OPAE_MEM_SLAB_H__
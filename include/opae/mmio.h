@@ -121,7 +121,13 @@ fpga_result fpgaReadMMIO32(fpga_handle handle,
 /**
  * Write 512 bit value to MMIO space
  *
- * 512 bit MMIO writes may not be supported on all platforms.
+ * 512 bit MMIO writes may not be supported on all platforms. On x86-64
+ * hosts the write uses the widest vector store the CPU provides: a single
+ * AVX-512 store, a pair of AVX stores, or four SSE non-temporal stores.
+ * Only the AVX-512 path issues the line as one 64 byte store. The AVX and
+ * SSE2 fallbacks split it into 2 or 4 stores, which the device may see as
+ * separate, smaller writes: the 512 bit write is then not atomic with
+ * respect to the device.
  *
  * This function will write to MMIO space of the target object at a specified
  * offset.
@@ -138,6 +144,124 @@ fpga_result fpgaWriteMMIO512(fpga_handle handle,
 			    uint32_t mmio_num, uint64_t offset,
 			    const void *value);
 
+/**
+ * Read 512 bit value from MMIO space
+ *
+ * 512 bit MMIO reads may not be supported on all platforms. On x86-64
+ * hosts the read uses the widest vector load the CPU provides.
+ *
+ * This function will read from MMIO space of the target object at a
+ * specified offset and write the 64 bytes read to `value`.
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[in]  mmio_num Number of MMIO space to access
+ * @param[in]  offset   Byte offset into MMIO space (64 byte aligned)
+ * @param[out] value    Pointer to memory where the value read (512 bits)
+ *                      is returned
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid. FPGA_NOT_SUPPORTED if the platform does not
+ * support 512 bit MMIO. FPGA_EXCEPTION if an internal exception occurred
+ * while trying to access the handle.
+ */
+fpga_result fpgaReadMMIO512(fpga_handle handle,
+			   uint32_t mmio_num, uint64_t offset,
+			   void *value);
+
+/**
+ * Read a batch of values from MMIO space
+ *
+ * This function performs each read described by `ops`, in array order,
+ * validating the handle and acquiring any plugin-internal lock only once
+ * for the whole batch. The value of each read is returned in the `value`
+ * field of its operation.
+ *
+ * Processing stops at the first operation that fails. Operations preceding
+ * the failing one have been performed and their `value` fields are valid.
+ *
+ * @param[in]    handle  Handle to previously opened accelerator resource
+ * @param[inout] ops     Array of operations to perform
+ * @param[in]    num_ops Number of entries in `ops`
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid, including an operation whose width is not 4 or 8.
+ * FPGA_EXCEPTION if an internal exception occurred while trying to access
+ * the handle.
+ */
+fpga_result fpgaReadMMIOBatch(fpga_handle handle,
+			      fpga_mmio_op *ops,
+			      uint32_t num_ops);
+
+/**
+ * Write a batch of values to MMIO space
+ *
+ * This function performs each write described by `ops`, in array order,
+ * validating the handle and acquiring any plugin-internal lock only once
+ * for the whole batch.
+ *
+ * Processing stops at the first operation that fails. Operations preceding
+ * the failing one have been performed.
+ *
+ * @param[in]  handle  Handle to previously opened accelerator resource
+ * @param[in]  ops     Array of operations to perform
+ * @param[in]  num_ops Number of entries in `ops`
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid, including an operation whose width is not 4 or 8.
+ * FPGA_EXCEPTION if an internal exception occurred while trying to access
+ * the handle.
+ */
+fpga_result fpgaWriteMMIOBatch(fpga_handle handle,
+			       const fpga_mmio_op *ops,
+			       uint32_t num_ops);
+
+/**
+ * Copy a block of memory to MMIO space
+ *
+ * This function copies `len` bytes from `src` to MMIO space of the target
+ * object, starting at the specified offset. It is intended for loading
+ * register windows of many registers, such as descriptor or lookup tables.
+ *
+ * The 64 byte aligned part of the range is written with the widest vector
+ * stores supported by the host CPU (see fpgaWriteMMIO512()); the remainder
+ * is written 64 bits at a time. All writes have been issued and are
+ * globally visible, in particular on write-combining mappings, before the
+ * function returns. No ordering between the individual writes is
+ * guaranteed.
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[in]  mmio_num Number of MMIO space to access
+ * @param[in]  offset   Byte offset into MMIO space (multiple of 8)
+ * @param[in]  src      Pointer to memory holding the data to write
+ * @param[in]  len      Number of bytes to write (multiple of 8)
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid, including an offset or length that is not a
+ * multiple of 8 or a range that exceeds the MMIO space. FPGA_EXCEPTION if
+ * an internal exception occurred while trying to access the handle.
+ */
+fpga_result fpgaCopyToMMIO(fpga_handle handle,
+			   uint32_t mmio_num, uint64_t offset,
+			   const void *src, uint64_t len);
+
+/**
+ * Copy a block of MMIO space to memory
+ *
+ * This function copies `len` bytes from MMIO space of the target object,
+ * starting at the specified offset, to `dst`. The 64 byte aligned part of
+ * the range is read with the widest vector loads supported by the host
+ * CPU; the remainder is read 64 bits at a time.
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[in]  mmio_num Number of MMIO space to access
+ * @param[in]  offset   Byte offset into MMIO space (multiple of 8)
+ * @param[out] dst      Pointer to memory where the data read is returned
+ * @param[in]  len      Number of bytes to read (multiple of 8)
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if any of the supplied
+ * parameters is invalid, including an offset or length that is not a
+ * multiple of 8 or a range that exceeds the MMIO space. FPGA_EXCEPTION if
+ * an internal exception occurred while trying to access the handle.
+ */
+fpga_result fpgaCopyFromMMIO(fpga_handle handle,
+			     uint32_t mmio_num, uint64_t offset,
+			     void *dst, uint64_t len);
+
 /**
  * Map MMIO space
  *
@@ -0,0 +1,222 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @file opae/mmio_inline.h
+ * @brief Inline accessors for a mapped MMIO space
+ *
+ * fpgaReadMMIO64() and friends validate the handle, dispatch through the
+ * plugin layer and serialize on the handle lock for every access. For
+ * register-heavy code paths that cost dominates the PCIe round trip.
+ *
+ * The accessors in this file operate on an fpga_mmio_region obtained once
+ * from fpgaMMIORegionInit(), which maps the MMIO space with fpgaMapMMIO().
+ * Each read or write then compiles to a single volatile load or store. No
+ * locking is performed: the caller is responsible for any ordering between
+ * threads that share registers.
+ *
+ * Define OPAE_MMIO_INLINE_CHECKED before including this file to assert()
+ * that each access is aligned, within the region size given to
+ * fpgaMMIORegionInit(), and of a width listed in the region's caps.
+ *
+ * The region is valid until fpgaUnmapMMIO() or fpgaClose() is called on
+ * the handle it was created from.
+ */
+
+#ifndef __FPGA_MMIO_INLINE_H__
+#define __FPGA_MMIO_INLINE_H__
+
+#include <opae/types.h>
+#include <opae/mmio.h>
+
+#ifdef OPAE_MMIO_INLINE_CHECKED
+#include <assert.h>
+#endif // OPAE_MMIO_INLINE_CHECKED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Region supports 32 bit accesses */
+#define FPGA_MMIO_CAP_32  (1u << 0)
+/** Region supports 64 bit accesses */
+#define FPGA_MMIO_CAP_64  (1u << 1)
+/** Region supports 512 bit writes (host CPU has AVX512) */
+#define FPGA_MMIO_CAP_512 (1u << 2)
+
+/** Mapped MMIO region descriptor
+ *
+ * Filled by fpgaMMIORegionInit(). May also be filled directly by callers
+ * that obtained a mapping by other means.
+ */
+typedef struct fpga_mmio_region {
+	volatile uint8_t *base; // Mapped base address of the MMIO space
+	uint64_t size;          // Size in bytes, or 0 if unknown (no bounds check)
+	uint32_t caps;          // FPGA_MMIO_CAP_* access widths
+} fpga_mmio_region;
+
+#ifdef OPAE_MMIO_INLINE_CHECKED
+#define __FPGA_MMIO_CHECK(__r, __offset, __width, __cap)           \
+	do {                                                       \
+		assert((__r)->base);                               \
+		assert((__r)->caps & (__cap));                     \
+		assert(!((__offset) % (__width)));                 \
+		assert(!(__r)->size ||                             \
+		       (((__r)->size >= (__width)) &&              \
+			((__offset) <= (__r)->size - (__width)))); \
+	} while (0)
+#else
+#define __FPGA_MMIO_CHECK(__r, __offset, __width, __cap) \
+	do {                                             \
+	} while (0)
+#endif // OPAE_MMIO_INLINE_CHECKED
+
+/**
+ * Map an MMIO space and describe it for the inline accessors
+ *
+ * @param[in]  handle   Handle to previously opened accelerator resource
+ * @param[in]  mmio_num Number of MMIO space to map
+ * @param[in]  size     Size of the MMIO space in bytes, used only for
+ *                      OPAE_MMIO_INLINE_CHECKED builds. May be 0.
+ * @param[out] region   Descriptor to fill
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if region is NULL.
+ * FPGA_NOT_SUPPORTED if the platform does not return a mapped address.
+ * Otherwise, the result of fpgaMapMMIO().
+ */
+static inline fpga_result fpgaMMIORegionInit(fpga_handle handle,
+					     uint32_t mmio_num,
+					     uint64_t size,
+					     fpga_mmio_region *region)
+{
+	uint64_t *ptr = NULL;
+	fpga_result res;
+
+	if (!region)
+		return FPGA_INVALID_PARAM;
+
+	res = fpgaMapMMIO(handle, mmio_num, &ptr);
+	if (res != FPGA_OK)
+		return res;
+
+	if (!ptr)
+		return FPGA_NOT_SUPPORTED;
+
+	region->base = (volatile uint8_t *)ptr;
+	region->size = size;
+	region->caps = FPGA_MMIO_CAP_32 | FPGA_MMIO_CAP_64;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		region->caps |= FPGA_MMIO_CAP_512;
+#endif // x86_64
+
+	return FPGA_OK;
+}
+
+/**
+ * Read 32 bit value from a mapped MMIO region
+ *
+ * @param[in] region Region descriptor from fpgaMMIORegionInit()
+ * @param[in] offset Byte offset into the region
+ * @returns The value read.
+ */
+static inline uint32_t fpgaMMIORegionRead32(const fpga_mmio_region *region,
+					    uint64_t offset)
+{
+	__FPGA_MMIO_CHECK(region, offset, 4, FPGA_MMIO_CAP_32);
+	return *(volatile uint32_t *)(region->base + offset);
+}
+
+/**
+ * Write 32 bit value to a mapped MMIO region
+ *
+ * @param[in] region Region descriptor from fpgaMMIORegionInit()
+ * @param[in] offset Byte offset into the region
+ * @param[in] value  Value to write
+ */
+static inline void fpgaMMIORegionWrite32(const fpga_mmio_region *region,
+					 uint64_t offset, uint32_t value)
+{
+	__FPGA_MMIO_CHECK(region, offset, 4, FPGA_MMIO_CAP_32);
+	*(volatile uint32_t *)(region->base + offset) = value;
+}
+
+/**
+ * Read 64 bit value from a mapped MMIO region
+ *
+ * @param[in] region Region descriptor from fpgaMMIORegionInit()
+ * @param[in] offset Byte offset into the region
+ * @returns The value read.
+ */
+static inline uint64_t fpgaMMIORegionRead64(const fpga_mmio_region *region,
+					    uint64_t offset)
+{
+	__FPGA_MMIO_CHECK(region, offset, 8, FPGA_MMIO_CAP_64);
+	return *(volatile uint64_t *)(region->base + offset);
+}
+
+/**
+ * Write 64 bit value to a mapped MMIO region
+ *
+ * @param[in] region Region descriptor from fpgaMMIORegionInit()
+ * @param[in] offset Byte offset into the region
+ * @param[in] value  Value to write
+ */
+static inline void fpgaMMIORegionWrite64(const fpga_mmio_region *region,
+					 uint64_t offset, uint64_t value)
+{
+	__FPGA_MMIO_CHECK(region, offset, 8, FPGA_MMIO_CAP_64);
+	*(volatile uint64_t *)(region->base + offset) = value;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/**
+ * Write 512 bit value to a mapped MMIO region
+ *
+ * Only valid when region->caps includes FPGA_MMIO_CAP_512.
+ *
+ * @param[in] region Region descriptor from fpgaMMIORegionInit()
+ * @param[in] offset Byte offset into the region (64 byte aligned)
+ * @param[in] value  Pointer to memory holding value to write (512 bits)
+ */
+static inline void fpgaMMIORegionWrite512(const fpga_mmio_region *region,
+					  uint64_t offset, const void *value)
+{
+	__FPGA_MMIO_CHECK(region, offset, 64, FPGA_MMIO_CAP_512);
+	__asm__ volatile("vmovdqu64 (%0), %%zmm0;"
+			 "vmovdqu64 %%zmm0, (%1);"
+			 :
+			 : "r"(value), "r"(region->base + offset)
+			 : "xmm0", "memory");
+}
+#endif // x86_64
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __FPGA_MMIO_INLINE_H__
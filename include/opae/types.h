@@ -252,6 +252,75 @@ typedef struct metric_threshold {
 	threshold hysteresis;                          // Hysteresis
 } metric_threshold;
 
+/** MMIO batch operation
+ *
+ * Describes a single register access within a call to fpgaReadMMIOBatch()
+ * or fpgaWriteMMIOBatch(). `width` is the access size in bytes and must be
+ * either 4 or 8. For reads, `value` receives the register contents (32 bit
+ * reads are zero-extended). For writes, the low `width` bytes of `value`
+ * are written.
+ */
+typedef struct fpga_mmio_op {
+	uint32_t mmio_num;   // Number of MMIO space to access
+	uint32_t width;      // Access width in bytes (4 or 8)
+	uint64_t offset;     // Byte offset into MMIO space
+	uint64_t value;      // Value to write, or value read
+} fpga_mmio_op;
+
+/** Buffer pool statistics
+ *
+ * Reported by fpgaGetBufferPoolStats() for a handle opened with
+ * FPGA_OPEN_BUFFER_POOL. Byte counts are of the pinned (page-rounded)
+ * buffer sizes.
+ */
+typedef struct fpga_buffer_pool_stats {
+	uint64_t hits;            // fpgaPrepareBuffer() calls served by the pool
+	uint64_t misses;          // fpgaPrepareBuffer() calls that pinned memory
+	uint64_t recycled;        // fpgaReleaseBuffer() calls kept by the pool
+	uint64_t evicted;         // fpgaReleaseBuffer() calls over the high-water mark
+	uint64_t pooled_buffers;  // Buffers currently held by the pool
+	uint64_t pooled_bytes;    // Bytes currently held by the pool
+	uint64_t high_water;      // Maximum number of bytes the pool holds
+} fpga_buffer_pool_stats;
+
+/** Buffer preparation statistics
+ *
+ * Reported by fpgaGetBufferPrepareStats(). Byte counts are of the pinned
+ * (page-rounded) buffer sizes. Times are in nanoseconds.
+ */
+typedef struct fpga_buffer_prepare_stats {
+	uint64_t buffers;         // DMA mappings created
+	uint64_t bytes;           // Bytes in those mappings
+	uint64_t prefaulted;      // Buffers populated for FPGA_BUF_PREFAULT
+	uint64_t alloc_ns;        // Time allocating and binding new pages
+	uint64_t prefault_ns;     // Time populating pages before pinning
+	uint64_t map_ns;          // Time pinning and mapping pages for DMA
+} fpga_buffer_prepare_stats;
+
+/** Scatter-gather list entry
+ *
+ * One IOVA-contiguous segment of a buffer prepared by
+ * fpgaPrepareBufferSG().
+ */
+typedef struct fpga_sg_entry {
+	uint64_t iova;            // IO address of the segment
+	uint64_t len;             // Segment length in bytes
+} fpga_sg_entry;
+
+/** Completion wait statistics
+ *
+ * Reported for a single call by fpgaWaitForCompletion() and
+ * fpgaWaitForCompletionCSR(). Times are in nanoseconds.
+ */
+typedef struct fpga_wait_stats {
+	fpga_wait_path path;      // How the wait was resolved
+	uint64_t polls;           // Reads of the completion word
+	uint64_t wakeups;         // Times the event handle was signaled
+	uint64_t budget_ns;       // Spin budget of this call
+	uint64_t spin_ns;         // Time spent spinning
+	uint64_t block_ns;        // Time spent blocked on the event handle
+} fpga_wait_stats;
+
 /** Internal token type header
  *
  * Each plugin (dfl: libxfpga.so, vfio: libopae-v.so) implements its own
@@ -89,6 +89,17 @@ typedef enum {
  *	FPGA_EVENT_CHANGE
  */
 
+/**
+ * How a completion wait was resolved
+ *
+ * Reported in fpga_wait_stats by fpgaWaitForCompletion().
+ */
+typedef enum {
+	FPGA_WAIT_SPIN = 0,  /**< Completion seen while spinning */
+	FPGA_WAIT_EVENT,     /**< Completion seen after blocking on the event */
+	FPGA_WAIT_TIMEOUT    /**< The timeout expired first */
+} fpga_wait_path;
+
 /** accelerator state */
 typedef enum {
 	/** accelerator is opened exclusively by another process */
@@ -145,7 +156,10 @@ typedef enum {
 enum fpga_buffer_flags {
 	FPGA_BUF_PREALLOCATED = (1u << 0), /**< Use existing buffer */
 	FPGA_BUF_QUIET = (1u << 1),        /**< Suppress error messages */
-	FPGA_BUF_READ_ONLY = (1u << 2)     /**< Buffer is read-only */
+	FPGA_BUF_READ_ONLY = (1u << 2),    /**< Buffer is read-only */
+	FPGA_BUF_SLAB = (1u << 3),         /**< Share a pinned hugepage */
+	FPGA_BUF_NUMA_LOCAL = (1u << 4),   /**< Allocate on the device's node */
+	FPGA_BUF_PREFAULT = (1u << 5)      /**< Populate pages before pinning */
 };
 
 /**
@@ -157,7 +171,13 @@ enum fpga_open_flags {
 	/** Open FPGA resource for shared access */
 	FPGA_OPEN_SHARED = (1u << 0),
 	/** FPGA resource being opened has a parent in the same address space */
-	FPGA_OPEN_HAS_PARENT_AFU = (1u << 1)
+	FPGA_OPEN_HAS_PARENT_AFU = (1u << 1),
+	/** MMIO accessors on the handle do not take the handle lock */
+	FPGA_OPEN_LOCKLESS_MMIO = (1u << 2),
+	/** Released buffers are kept pinned for reuse by the handle */
+	FPGA_OPEN_BUFFER_POOL = (1u << 3),
+	/** Released buffers are unpinned by a background thread */
+	FPGA_OPEN_DEFERRED_RELEASE = (1u << 4)
 };
 
 /**
@@ -48,6 +48,7 @@
 #include <linux/vfio.h>
 #include <opae/mem_alloc.h>
 #include <opae/hash_map.h>
+#include <opae/mem_reaper.h>
 
 /**
  * IO Virtual Address Range
@@ -139,6 +140,21 @@ struct opae_vfio_buffer {
 	int flags;			/**< See opae_vfio_buffer_flags. */
 };
 
+/**
+ * DMA buffer preparation statistics
+ *
+ * Accumulated over the buffers mapped by the opae_vfio_buffer_allocate
+ * family since the device was opened. Times are in nanoseconds.
+ */
+struct opae_vfio_buffer_stats {
+	uint64_t buffers;		/**< Buffers mapped. */
+	uint64_t bytes;			/**< Sum of the mapped sizes. */
+	uint64_t prefaulted;		/**< Buffers given OPAE_VFIO_BUF_PREFAULT. */
+	uint64_t alloc_ns;		/**< Time in mmap() and mbind(). */
+	uint64_t prefault_ns;		/**< Time populating pages. */
+	uint64_t map_ns;		/**< Time in VFIO_IOMMU_MAP_DMA. */
+};
+
 /**
  * OPAE VFIO device abstraction
  *
@@ -156,6 +172,8 @@ struct opae_vfio {
 	struct opae_vfio_group group;			/**< The VFIO device group. */
 	struct opae_vfio_device device;			/**< The VFIO device. */
 	opae_hash_map cont_buffers;		/**< Map of allocated DMA buffers. */
+	struct opae_vfio_buffer_stats buffer_stats; /**< Preparation timing. */
+	struct mem_reaper reaper;		/**< Deferred buffer releases. */
 };
 
 #ifdef __cplusplus
@@ -307,11 +325,13 @@ int opae_vfio_region_get(struct opae_vfio *v,
  * is not explicitly freed by opae_vfio_buffer_free, it will be
  * freed during opae_vfio_close.
  *
- * mmap is used for the allocation. If the size is greater than 2MB,
- * then the allocation request is fulfilled by a 1GB huge page. Else,
+ * mmap is used for the allocation. If the size is a multiple of 1GB,
+ * then the allocation request is fulfilled by 1GB huge pages. Else,
  * if the size is greater than 4096, then the request is fulfilled by
- * a 2MB huge page. Else, the request is fulfilled by the non-huge
- * page pool.
+ * as many 2MB huge pages as needed, which the IOMMU maps at one
+ * contiguous IOVA range. When huge pages of the preferred size are
+ * not available, the other huge page size is tried. Else, the request
+ * is fulfilled by the non-huge page pool.
  *
  * @note Allocations from the huge page pool require that huge pages
  * be configured on the system. Huge pages may be configured on the
@@ -329,8 +349,8 @@ int opae_vfio_region_get(struct opae_vfio *v,
  *
  * @param[in, out] v    The open OPAE VFIO device.
  * @param[in, out] size A pointer to the requested size. The size
- *                      may be rounded to the next page size prior
- *                      to return from the function.
+ *                      is rounded to the next page size (4KB, 2MB
+ *                      or 1GB) prior to return from the function.
  * @param[out]     buf  Optional pointer to receive the virtual address
  *                      for the buffer. Pass NULL to ignore.
  * @param[out]     iova Optional pointer to receive the IOVA address
@@ -377,6 +397,7 @@ int opae_vfio_buffer_allocate(struct opae_vfio *v,
  */
 enum opae_vfio_buffer_flags {
 	OPAE_VFIO_BUF_PREALLOCATED = 1, /**< Use existing buffer */
+	OPAE_VFIO_BUF_PREFAULT = (1 << 5), /**< Populate pages before mapping */
 };
 
 /**
@@ -389,15 +410,24 @@ enum opae_vfio_buffer_flags {
  * is used in which case the buffer is not freed by this library.
  *
  * When not using OPAE_VFIO_BUF_PREALLOCATED, mmap is used for the
- * allocation. If the size is greater than 2MB, then the allocation
- * request is fulfilled by a 1GB huge page. Else, if the size is
- * greater than 4096, then the request is fulfilled by a 2MB huge
- * page. Else, the request is fulfilled by the non-huge page pool.
+ * allocation. If the size is a multiple of 1GB, then the allocation
+ * request is fulfilled by 1GB huge pages. Else, if the size is
+ * greater than 4096, then the request is fulfilled by as many 2MB
+ * huge pages as needed, which the IOMMU maps at one contiguous IOVA
+ * range. When huge pages of the preferred size are not available,
+ * the other huge page size is tried. Else, the request is fulfilled
+ * by the non-huge page pool.
+ *
+ * VFIO_IOMMU_MAP_DMA faults in unpopulated pages one at a time. With
+ * OPAE_VFIO_BUF_PREFAULT, the pages of a buffer allocated by this
+ * library are populated beforehand by mem_prefault(), in parallel. A
+ * single-page buffer with no NUMA placement is populated by mmap()
+ * with MAP_POPULATE. The flag is ignored with OPAE_VFIO_BUF_PREALLOCATED.
  *
  * @param[in, out] v    The open OPAE VFIO device.
  * @param[in, out] size A pointer to the requested size. The size
- *                      may be rounded to the next page size prior
- *                      to return from the function.
+ *                      is rounded to the next page size (4KB, 2MB
+ *                      or 1GB) prior to return from the function.
  * @param[out]     buf  Optional pointer to receive the virtual address
  *                      for the buffer/input buffer pointer when
  *                      using OPAE_VFIO_BUF_PREALLOCATED. Pass NULL
@@ -436,6 +466,40 @@ int opae_vfio_buffer_allocate_ex(struct opae_vfio *v,
 				 uint64_t *iova,
 				 int flags);
 
+/**
+ * Allocate and map system buffer on a NUMA node
+ *
+ * Like opae_vfio_buffer_allocate_ex, but when the buffer is allocated
+ * by this library (OPAE_VFIO_BUF_PREALLOCATED is not given), its pages
+ * are bound to NUMA node numa_node with MPOL_BIND before they are
+ * pinned. The allocation fails when the node can't supply the pages.
+ *
+ * @param[in, out] v         The open OPAE VFIO device.
+ * @param[in, out] size      As for opae_vfio_buffer_allocate_ex.
+ * @param[in, out] buf       As for opae_vfio_buffer_allocate_ex.
+ * @param[out]     iova      As for opae_vfio_buffer_allocate_ex.
+ * @param[in]      flags     As for opae_vfio_buffer_allocate_ex.
+ * @param[in]      numa_node The NUMA node, or -1 for no NUMA policy. Any
+ *                           other node must pass mem_bind_node_valid().
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_allocate_node(struct opae_vfio *v,
+				   size_t *size,
+				   uint8_t **buf,
+				   uint64_t *iova,
+				   int flags,
+				   int numa_node);
+
+/**
+ * Retrieve DMA buffer preparation statistics
+ *
+ * @param[in]  v     The open OPAE VFIO device.
+ * @param[out] stats Receives a copy of v->buffer_stats.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_get_stats(struct opae_vfio *v,
+			       struct opae_vfio_buffer_stats *stats);
+
 /**
  * Extract the internal data structure pointer for the given vaddr
  *
@@ -486,6 +550,38 @@ struct opae_vfio_buffer *opae_vfio_buffer_info(struct opae_vfio *v,
 int opae_vfio_buffer_free(struct opae_vfio *v,
 			  uint8_t *buf);
 
+/**
+ * Free and unmap system buffer on a background thread
+ *
+ * Like opae_vfio_buffer_free, but only removes the buffer from
+ * v->cont_buffers before returning. The IOMMU unmap, the munmap() of
+ * buffers allocated by this library, and the release of the IOVA range
+ * are done by the device's reaper thread (see opae/mem_reaper.h), which
+ * unmaps buffers with adjacent IOVA ranges with a single
+ * VFIO_IOMMU_UNMAP_DMA. Buffers given OPAE_VFIO_BUF_PREALLOCATED are
+ * freed synchronously, so that their memory can be reused by the caller
+ * as soon as the call returns.
+ *
+ * @param[in, out] v   The open OPAE VFIO device.
+ * @param[in]      buf The virtual address corresponding to
+ *                     the buffer to be freed.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_free_deferred(struct opae_vfio *v,
+				   uint8_t *buf);
+
+/**
+ * Wait for deferred buffer frees to complete
+ *
+ * On return, every buffer passed to opae_vfio_buffer_free_deferred
+ * has been unmapped and its IOVA range can be allocated again.
+ * opae_vfio_close drains the device's deferred frees.
+ *
+ * @param[in, out] v The open OPAE VFIO device.
+ * @returns Non-zero on error. Zero on success.
+ */
+int opae_vfio_buffer_drain(struct opae_vfio *v);
+
 /**
  * Map an existing buffer for DMA at iova.
  *
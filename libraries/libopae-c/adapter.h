@@ -71,6 +71,24 @@ typedef struct _opae_api_adapter_table {
 	fpga_result (*fpgaWriteMMIO512)(fpga_handle handle, uint32_t mmio_num,
 				       uint64_t offset, const void *value);
 
+	fpga_result (*fpgaReadMMIO512)(fpga_handle handle, uint32_t mmio_num,
+				      uint64_t offset, void *value);
+
+	fpga_result (*fpgaReadMMIOBatch)(fpga_handle handle,
+					 fpga_mmio_op *ops, uint32_t num_ops);
+
+	fpga_result (*fpgaWriteMMIOBatch)(fpga_handle handle,
+					  const fpga_mmio_op *ops,
+					  uint32_t num_ops);
+
+	fpga_result (*fpgaCopyToMMIO)(fpga_handle handle, uint32_t mmio_num,
+				      uint64_t offset, const void *src,
+				      uint64_t len);
+
+	fpga_result (*fpgaCopyFromMMIO)(fpga_handle handle, uint32_t mmio_num,
+					uint64_t offset, void *dst,
+					uint64_t len);
+
 	fpga_result (*fpgaMapMMIO)(fpga_handle handle, uint32_t mmio_num,
 				   uint64_t **mmio_ptr);
 
@@ -98,13 +116,30 @@ typedef struct _opae_api_adapter_table {
 					 void **buf_addr, uint64_t *wsid,
 					 int flags);
 
+	fpga_result (*fpgaPrepareBufferEx)(fpga_handle handle, uint64_t len,
+					   void **buf_addr, uint64_t *wsid,
+					   int flags, int numa_node);
+	fpga_result (*fpgaPrepareBufferSG)(fpga_handle handle,
+					   void *buf_addr, uint64_t len,
+					   uint64_t *wsid,
+					   fpga_sg_entry *sg, uint32_t *num_sg,
+					   int flags);
+
 	fpga_result (*fpgaReleaseBuffer)(fpga_handle handle, uint64_t wsid);
 
+	fpga_result (*fpgaDrainBufferReleases)(fpga_handle handle);
+
 	fpga_result (*fpgaGetIOAddress)(fpga_handle handle, uint64_t wsid,
 					uint64_t *ioaddr);
 
 	fpga_result (*fpgaBindSVA)(fpga_handle handle, uint32_t *pasid);
 
+	fpga_result (*fpgaGetBufferPoolStats)(fpga_handle handle,
+					      fpga_buffer_pool_stats *stats);
+
+	fpga_result (*fpgaGetBufferPrepareStats)(fpga_handle handle,
+					fpga_buffer_prepare_stats *stats);
+
 	// Internal methods between shell and plugin to pin/unpin an existing
 	// buffer at a specific ioaddr. Used when managing the same address
 	// space on parent and child AFU ports, all opened by the same process.
@@ -233,6 +268,14 @@ typedef struct _opae_api_adapter_table {
 	int (*initialize)(void);
 	int (*finalize)(void);
 
+	// Set while the plugin is registered but not yet loaded. The
+	// plugin manager loads, configures and initializes it with
+	// deferred_config, its own copy of the platform config, on first use.
+	bool deferred;
+	char *deferred_config;
+	// Set when a deferred load failed, so that it is not retried.
+	bool load_failed;
+
 } opae_api_adapter_table;
 
 int opae_plugin_mgr_register_plugin(const char *name, const char *cfg);
@@ -33,14 +33,19 @@
 #endif // _GNU_SOURCE
 
 #include <stdio.h>
+#include <string.h>
 
 #include <opae/properties.h>
 #include <opae/types_enum.h>
+#include <opae/buffer.h>
 
 #include "pluginmgr.h"
 #include "opae_int.h"
 #include "props.h"
 #include "multi-port-afu.h"
+#include "enum-cache.h"
+#include "event-wait.h"
+#include "completion-wait.h"
 #include "mock/opae_std.h"
 
 const char *
@@ -74,27 +79,58 @@ __OPAE_API__ fpgaErrStr(fpga_result e)
 	}
 }
 
-STATIC pthread_mutex_t token_list_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-STATIC opae_wrapped_token token_list_head = {
-	.prev = &token_list_head,
-	.next = &token_list_head,
+/*
+ * Live wrapped tokens are kept on a sharded list so that
+ * opae_get_parent_token() can search them. Reference counts are atomic;
+ * a shard lock is taken only when a token is created or destroyed.
+ */
+#define OPAE_TOKEN_LIST_SHARDS 16
+
+typedef struct _opae_token_list_shard {
+	pthread_mutex_t lock;
+	opae_wrapped_token *head;
+} opae_token_list_shard;
+
+STATIC opae_token_list_shard token_list[OPAE_TOKEN_LIST_SHARDS] = {
+	[0 ... OPAE_TOKEN_LIST_SHARDS - 1] = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.head = NULL,
+	},
 };
 
+static inline opae_token_list_shard *
+opae_token_shard(opae_wrapped_token *wt)
+{
+	return &token_list[((uintptr_t)wt >> 6) % OPAE_TOKEN_LIST_SHARDS];
+}
+
 opae_wrapped_token *
 opae_allocate_wrapped_token(fpga_token token,
 			    const opae_api_adapter_table *adapter)
 {
 	opae_wrapped_token *wtok =
 		(opae_wrapped_token *)opae_malloc(sizeof(opae_wrapped_token));
+	opae_token_list_shard *shard;
+	int res;
 
 	if (wtok) {
 		wtok->magic = OPAE_WRAPPED_TOKEN_MAGIC;
 		wtok->opae_token = token;
-		wtok->ref_count = 0;
-		wtok->prev = wtok->next = NULL;
+		wtok->ref_count = 1;
+		wtok->prev = NULL;
 		wtok->adapter_table = (opae_api_adapter_table *)adapter;
 
-		opae_upref_wrapped_token(wtok);
+		OPAE_DBG("token ref count begin %p", wtok);
+
+		shard = opae_token_shard(wtok);
+		opae_mutex_lock(res, &shard->lock);
+
+		wtok->next = shard->head;
+		if (shard->head)
+			shard->head->prev = wtok;
+		shard->head = wtok;
+
+		opae_mutex_unlock(res, &shard->lock);
 	}
 
 	return wtok;
@@ -102,63 +138,69 @@ opae_allocate_wrapped_token(fpga_token token,
 
 void opae_upref_wrapped_token(opae_wrapped_token *wt)
 {
-	int res;
-
-	opae_mutex_lock(res, &token_list_lock);
-
-	++wt->ref_count;
-	if (wt->ref_count == 1) {
-		OPAE_DBG("token ref count begin %p", wt);
-		wt->prev = &token_list_head;
-		wt->next = token_list_head.next;
-		token_list_head.next->prev = wt;
-		token_list_head.next = wt;
-	}
 #ifdef LIBOPAE_DEBUG
-	else {
-		OPAE_DBG("token ref count up %p, %u", wt, wt->ref_count);
-	}
+	uint32_t count = __atomic_add_fetch(&wt->ref_count, 1, __ATOMIC_RELAXED);
+	OPAE_DBG("token ref count up %p, %u", wt, count);
+#else
+	__atomic_add_fetch(&wt->ref_count, 1, __ATOMIC_RELAXED);
 #endif // LIBOPAE_DEBUG
+}
+
+/*
+ * Take a reference to wt only if it is still live. Used when wt was found
+ * by searching the token list, where it may be racing with its final
+ * opae_downref_wrapped_token().
+ */
+STATIC bool opae_upref_wrapped_token_live(opae_wrapped_token *wt)
+{
+	uint32_t count = __atomic_load_n(&wt->ref_count, __ATOMIC_RELAXED);
 
-	opae_mutex_unlock(res, &token_list_lock);
+	do {
+		if (!count)
+			return false;
+	} while (!__atomic_compare_exchange_n(&wt->ref_count, &count, count + 1,
+					      true, __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+
+	return true;
 }
 
 fpga_result opae_downref_wrapped_token(opae_wrapped_token *wt)
 {
 	int res;
 	fpga_result fres = FPGA_OK;
+	opae_token_list_shard *shard;
+	uint32_t count;
+
+	count = __atomic_sub_fetch(&wt->ref_count, 1, __ATOMIC_ACQ_REL);
+	if (count) {
+		OPAE_DBG("token ref count down %p, %u", wt, count);
+		return FPGA_OK;
+	}
+
+	OPAE_DBG("token ref count end %p", wt);
 
-	opae_mutex_lock(res, &token_list_lock);
+	shard = opae_token_shard(wt);
+	opae_mutex_lock(res, &shard->lock);
 
-	--wt->ref_count;
-	if (wt->ref_count == 0) {
-		OPAE_DBG("token ref count end %p", wt);
+	if (wt->prev)
 		wt->prev->next = wt->next;
+	else
+		shard->head = wt->next;
+	if (wt->next)
 		wt->next->prev = wt->prev;
-		wt->magic = 0;
 
-		if (wt->adapter_table->fpgaDestroyToken)
-			fres = wt->adapter_table->fpgaDestroyToken(
-					&wt->opae_token);
-		else
-			fres = FPGA_NOT_SUPPORTED;
+	opae_mutex_unlock(res, &shard->lock);
 
-		opae_free(wt);
+	wt->magic = 0;
 
-#ifdef LIBOPAE_DEBUG
-		if ((token_list_head.prev == &token_list_head) &&
-		    (token_list_head.next == &token_list_head)) {
-			OPAE_DBG("token ref count CLEAN HERE");
-		}
-#endif // LIBOPAE_DEBUG
-	}
-#ifdef LIBOPAE_DEBUG
-	else {
-		OPAE_DBG("token ref count down %p, %u", wt, wt->ref_count);
-	}
-#endif // LIBOPAE_DEBUG
+	if (wt->adapter_table->fpgaDestroyToken)
+		fres = wt->adapter_table->fpgaDestroyToken(&wt->opae_token);
+	else
+		fres = FPGA_NOT_SUPPORTED;
+
+	opae_free(wt);
 
-	opae_mutex_unlock(res, &token_list_lock);
 	return fres;
 }
 
@@ -168,18 +210,23 @@ uint32_t opae_wrapped_tokens_in_use(void)
 	int res;
 	uint32_t count = 0;
 	opae_wrapped_token *wt;
+	size_t i;
 
-	opae_mutex_lock(res, &token_list_lock);
+	for (i = 0 ; i < OPAE_TOKEN_LIST_SHARDS ; ++i) {
+		opae_mutex_lock(res, &token_list[i].lock);
 
-	for (wt = token_list_head.next ;
-		wt != &token_list_head ;
-		    wt = wt->next) {
-		++count;
-		OPAE_DBG("token ref count %p, %u LEAKED",
-			 wt, wt->ref_count);
+		for (wt = token_list[i].head ; wt ; wt = wt->next) {
+			++count;
+			OPAE_DBG("token ref count %p, %u LEAKED",
+				 wt, wt->ref_count);
+		}
+
+		opae_mutex_unlock(res, &token_list[i].lock);
 	}
 
-	opae_mutex_unlock(res, &token_list_lock);
+	if (!count)
+		OPAE_DBG("token ref count CLEAN HERE");
+
 	return count;
 }
 #endif // LIBOPAE_DEBUG
@@ -234,6 +281,9 @@ opae_allocate_wrapped_event_handle(fpga_event_handle opae_event_handle,
 		wevent->flags = 0;
 		wevent->opae_event_handle = opae_event_handle;
 		wevent->adapter_table = adapter;
+		wevent->wait_fd = -1;
+		wevent->wait_id = 0;
+		wevent->spin_ns = 0;
 	}
 
 	return wevent;
@@ -269,6 +319,8 @@ fpga_result __OPAE_API__ fpgaInitialize(const char *config_file)
 
 fpga_result __OPAE_API__ fpgaFinalize(void)
 {
+	// Cached tokens belong to the plugins, so drop them first.
+	opae_enum_cache_release();
 	return opae_plugin_mgr_finalize_all() ? FPGA_EXCEPTION
 					      : FPGA_OK;
 }
@@ -407,26 +459,27 @@ opae_get_parent_token(opae_wrapped_token *child)
 	opae_wrapped_token *parent = NULL;
 	fpga_token_header *child_hdr;
 	fpga_token_header *parent_hdr;
+	size_t i;
 
 	child_hdr = (fpga_token_header *)child->opae_token;
 
-	if (opae_mutex_lock(mres, &token_list_lock))
-		return NULL;
+	for (i = 0 ; !parent && (i < OPAE_TOKEN_LIST_SHARDS) ; ++i) {
+		if (opae_mutex_lock(mres, &token_list[i].lock))
+			return NULL;
 
-	for (p = token_list_head.next ;
-		p != &token_list_head ;
-		    p = p->next) {
+		for (p = token_list[i].head ; p ; p = p->next) {
 
-		parent_hdr = (fpga_token_header *)p->opae_token;
+			parent_hdr = (fpga_token_header *)p->opae_token;
 
-		if (fpga_is_parent_child(parent_hdr, child_hdr)) {
-			parent = p;
-			opae_upref_wrapped_token(parent);
-			break;
+			if (fpga_is_parent_child(parent_hdr, child_hdr) &&
+			    opae_upref_wrapped_token_live(p)) {
+				parent = p;
+				break;
+			}
 		}
-	}
 
-	opae_mutex_unlock(mres, &token_list_lock);
+		opae_mutex_unlock(mres, &token_list[i].lock);
+	}
 
 	return parent;
 }
@@ -636,6 +689,226 @@ fpga_result __OPAE_API__ fpgaWriteMMIO512(fpga_handle handle,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
+fpga_result __OPAE_API__ fpgaReadMMIO512(fpga_handle handle,
+	uint32_t mmio_num, uint64_t offset, void *value)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReadMMIO512,
+			       FPGA_NOT_SUPPORTED);
+
+	return wrapped_handle->adapter_table->fpgaReadMMIO512(
+		wrapped_handle->opae_handle, mmio_num, offset, value);
+}
+
+/*
+ * Generic batch implementation for plugins that do not provide their
+ * own. The handle has already been validated, so each operation costs
+ * only the plugin call.
+ */
+STATIC fpga_result opae_read_mmio_batch(opae_wrapped_handle *wrapped_handle,
+					fpga_mmio_op *ops, uint32_t num_ops)
+{
+	const opae_api_adapter_table *adapter = wrapped_handle->adapter_table;
+	fpga_result res = FPGA_OK;
+	uint32_t value32;
+	uint32_t i;
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		switch (ops[i].width) {
+		case sizeof(uint32_t):
+			ASSERT_NOT_NULL_RESULT(adapter->fpgaReadMMIO32,
+					       FPGA_NOT_SUPPORTED);
+			res = adapter->fpgaReadMMIO32(
+				wrapped_handle->opae_handle, ops[i].mmio_num,
+				ops[i].offset, &value32);
+			ops[i].value = value32;
+			break;
+		case sizeof(uint64_t):
+			ASSERT_NOT_NULL_RESULT(adapter->fpgaReadMMIO64,
+					       FPGA_NOT_SUPPORTED);
+			res = adapter->fpgaReadMMIO64(
+				wrapped_handle->opae_handle, ops[i].mmio_num,
+				ops[i].offset, &ops[i].value);
+			break;
+		default:
+			OPAE_ERR("invalid MMIO width %u", ops[i].width);
+			res = FPGA_INVALID_PARAM;
+			break;
+		}
+
+		if (res != FPGA_OK)
+			break;
+	}
+
+	return res;
+}
+
+STATIC fpga_result opae_write_mmio_batch(opae_wrapped_handle *wrapped_handle,
+					 const fpga_mmio_op *ops,
+					 uint32_t num_ops)
+{
+	const opae_api_adapter_table *adapter = wrapped_handle->adapter_table;
+	fpga_result res = FPGA_OK;
+	uint32_t i;
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		switch (ops[i].width) {
+		case sizeof(uint32_t):
+			ASSERT_NOT_NULL_RESULT(adapter->fpgaWriteMMIO32,
+					       FPGA_NOT_SUPPORTED);
+			res = adapter->fpgaWriteMMIO32(
+				wrapped_handle->opae_handle, ops[i].mmio_num,
+				ops[i].offset, (uint32_t)ops[i].value);
+			break;
+		case sizeof(uint64_t):
+			ASSERT_NOT_NULL_RESULT(adapter->fpgaWriteMMIO64,
+					       FPGA_NOT_SUPPORTED);
+			res = adapter->fpgaWriteMMIO64(
+				wrapped_handle->opae_handle, ops[i].mmio_num,
+				ops[i].offset, ops[i].value);
+			break;
+		default:
+			OPAE_ERR("invalid MMIO width %u", ops[i].width);
+			res = FPGA_INVALID_PARAM;
+			break;
+		}
+
+		if (res != FPGA_OK)
+			break;
+	}
+
+	return res;
+}
+
+fpga_result __OPAE_API__ fpgaReadMMIOBatch(fpga_handle handle,
+	fpga_mmio_op *ops, uint32_t num_ops)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(ops);
+
+	if (!wrapped_handle->adapter_table->fpgaReadMMIOBatch)
+		return opae_read_mmio_batch(wrapped_handle, ops, num_ops);
+
+	return wrapped_handle->adapter_table->fpgaReadMMIOBatch(
+		wrapped_handle->opae_handle, ops, num_ops);
+}
+
+fpga_result __OPAE_API__ fpgaWriteMMIOBatch(fpga_handle handle,
+	const fpga_mmio_op *ops, uint32_t num_ops)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(ops);
+
+	if (!wrapped_handle->adapter_table->fpgaWriteMMIOBatch)
+		return opae_write_mmio_batch(wrapped_handle, ops, num_ops);
+
+	return wrapped_handle->adapter_table->fpgaWriteMMIOBatch(
+		wrapped_handle->opae_handle, ops, num_ops);
+}
+
+/*
+ * Generic block copies for plugins that do not provide their own: one
+ * 64 bit plugin access per word.
+ */
+STATIC fpga_result opae_copy_to_mmio(opae_wrapped_handle *wrapped_handle,
+				     uint32_t mmio_num, uint64_t offset,
+				     const void *src, uint64_t len)
+{
+	const opae_api_adapter_table *adapter = wrapped_handle->adapter_table;
+	const uint8_t *p = (const uint8_t *)src;
+	fpga_result res = FPGA_OK;
+	uint64_t value;
+	uint64_t i;
+
+	ASSERT_NOT_NULL_RESULT(adapter->fpgaWriteMMIO64, FPGA_NOT_SUPPORTED);
+
+	for (i = 0 ; i < len ; i += sizeof(uint64_t)) {
+		memcpy(&value, p + i, sizeof(value));
+		res = adapter->fpgaWriteMMIO64(wrapped_handle->opae_handle,
+					       mmio_num, offset + i, value);
+		if (res != FPGA_OK)
+			break;
+	}
+
+	return res;
+}
+
+STATIC fpga_result opae_copy_from_mmio(opae_wrapped_handle *wrapped_handle,
+				       uint32_t mmio_num, uint64_t offset,
+				       void *dst, uint64_t len)
+{
+	const opae_api_adapter_table *adapter = wrapped_handle->adapter_table;
+	uint8_t *p = (uint8_t *)dst;
+	fpga_result res = FPGA_OK;
+	uint64_t value;
+	uint64_t i;
+
+	ASSERT_NOT_NULL_RESULT(adapter->fpgaReadMMIO64, FPGA_NOT_SUPPORTED);
+
+	for (i = 0 ; i < len ; i += sizeof(uint64_t)) {
+		res = adapter->fpgaReadMMIO64(wrapped_handle->opae_handle,
+					      mmio_num, offset + i, &value);
+		if (res != FPGA_OK)
+			break;
+		memcpy(p + i, &value, sizeof(value));
+	}
+
+	return res;
+}
+
+fpga_result __OPAE_API__ fpgaCopyToMMIO(fpga_handle handle,
+	uint32_t mmio_num, uint64_t offset, const void *src, uint64_t len)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(src);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!wrapped_handle->adapter_table->fpgaCopyToMMIO)
+		return opae_copy_to_mmio(wrapped_handle, mmio_num,
+					 offset, src, len);
+
+	return wrapped_handle->adapter_table->fpgaCopyToMMIO(
+		wrapped_handle->opae_handle, mmio_num, offset, src, len);
+}
+
+fpga_result __OPAE_API__ fpgaCopyFromMMIO(fpga_handle handle,
+	uint32_t mmio_num, uint64_t offset, void *dst, uint64_t len)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(dst);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!wrapped_handle->adapter_table->fpgaCopyFromMMIO)
+		return opae_copy_from_mmio(wrapped_handle, mmio_num,
+					   offset, dst, len);
+
+	return wrapped_handle->adapter_table->fpgaCopyFromMMIO(
+		wrapped_handle->opae_handle, mmio_num, offset, dst, len);
+}
+
 fpga_result __OPAE_API__ fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
 			uint64_t **mmio_ptr)
 {
@@ -663,6 +936,14 @@ fpga_result __OPAE_API__ fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num)
 		wrapped_handle->opae_handle, mmio_num);
 }
 
+// Result of one adapter's fpgaEnumerate(), merged in adapter order.
+typedef struct _opae_adapter_enumeration {
+	const opae_api_adapter_table *adapter;
+	fpga_result res;
+	fpga_token *adapter_tokens;
+	uint32_t num_matches;
+} opae_adapter_enumeration;
+
 typedef struct _opae_enumeration_context {
 	// <verbatim from fpgaEnumerate>
 	const fpga_properties *filters;
@@ -672,76 +953,98 @@ typedef struct _opae_enumeration_context {
 	uint32_t *num_matches;
 	// </verbatim from fpgaEnumerate>
 
-	fpga_token *adapter_tokens;
+	opae_adapter_enumeration *results;
 	uint32_t num_wrapped_tokens;
 	uint32_t errors;
 } opae_enumeration_context;
 
-static int opae_enumerate(const opae_api_adapter_table *adapter, void *context)
+// Runs concurrently for each adapter; touches only results[index].
+static void opae_enumerate(const opae_api_adapter_table *adapter,
+			   uint32_t index, void *context)
 {
 	opae_enumeration_context *ctx = (opae_enumeration_context *)context;
-	fpga_result res;
-	uint32_t num_matches = 0;
-	uint32_t i;
-	uint32_t space_remaining;
+	opae_adapter_enumeration *r = &ctx->results[index];
 
-	space_remaining = ctx->max_wrapped_tokens - ctx->num_wrapped_tokens;
-
-	if (ctx->wrapped_tokens && !space_remaining)
-		return OPAE_ENUM_STOP;
+	r->adapter = adapter;
+	r->res = FPGA_OK;
+	r->adapter_tokens = NULL;
+	r->num_matches = 0;
 
 	if (!adapter->fpgaEnumerate) {
 		OPAE_MSG("NULL fpgaEnumerate in adapter \"%s\"",
 			 adapter->plugin.path);
-		return OPAE_ENUM_CONTINUE;
+		r->res = FPGA_NOT_FOUND;
+		return;
+	}
+
+	if (ctx->wrapped_tokens && ctx->max_wrapped_tokens) {
+		r->adapter_tokens = (fpga_token *)opae_calloc(
+			ctx->max_wrapped_tokens, sizeof(fpga_token));
+		if (!r->adapter_tokens) {
+			OPAE_ERR("out of memory");
+			r->res = FPGA_NO_MEMORY;
+			return;
+		}
 	}
 
-	res = adapter->fpgaEnumerate(ctx->filters, ctx->num_filters,
-				     ctx->adapter_tokens, space_remaining,
-				     &num_matches);
+	r->res = adapter->fpgaEnumerate(ctx->filters, ctx->num_filters,
+					r->adapter_tokens,
+					ctx->max_wrapped_tokens,
+					&r->num_matches);
+}
 
-	if (res != FPGA_OK) {
+// Wrap one adapter's tokens into the caller's array, in adapter order.
+// Tokens that don't fit are returned to the adapter.
+static void opae_enumerate_merge(opae_enumeration_context *ctx,
+				 opae_adapter_enumeration *r)
+{
+	const opae_api_adapter_table *adapter = r->adapter;
+	uint32_t num_tokens;
+	uint32_t i;
+
+	if (r->res != FPGA_OK) {
 		OPAE_DBG("fpgaEnumerate() failed for \"%s\": %s",
-			 adapter->plugin.path, fpgaErrStr(res));
-		switch (res) {
+			 adapter->plugin.path, fpgaErrStr(r->res));
+		switch (r->res) {
 		case FPGA_NO_DRIVER: // Fall through
 		case FPGA_NOT_FOUND:
-			return OPAE_ENUM_CONTINUE;
+			break;
 		default:
+			++ctx->errors;
 			break;
 		}
-		++ctx->errors;
-		return OPAE_ENUM_CONTINUE;
+		goto out_free;
 	}
 
-	*ctx->num_matches += num_matches;
+	*ctx->num_matches += r->num_matches;
 
-	if (!ctx->adapter_tokens) {
+	if (!r->adapter_tokens) {
 		// requesting token count, only.
-		return OPAE_ENUM_CONTINUE;
+		return;
 	}
 
-	if (space_remaining > num_matches)
-		space_remaining = num_matches;
+	num_tokens = r->num_matches < ctx->max_wrapped_tokens ?
+		r->num_matches : ctx->max_wrapped_tokens;
 
-	for (i = 0; i < space_remaining; ++i) {
-		opae_wrapped_token *wt = opae_allocate_wrapped_token(
-			ctx->adapter_tokens[i], adapter);
-		if (!wt) {
-			++ctx->errors;
-			return OPAE_ENUM_STOP;
-		}
+	for (i = 0; i < num_tokens; ++i) {
+		opae_wrapped_token *wt = NULL;
 
-		if (ctx->wrapped_tokens) {
-			ctx->wrapped_tokens[ctx->num_wrapped_tokens++] = wt;
-		} else {
-			opae_destroy_wrapped_token(wt);
+		if (ctx->num_wrapped_tokens < ctx->max_wrapped_tokens) {
+			wt = opae_allocate_wrapped_token(r->adapter_tokens[i],
+							 adapter);
+			if (wt)
+				ctx->wrapped_tokens[ctx->num_wrapped_tokens++] = wt;
+			else
+				++ctx->errors;
 		}
+
+		if (!wt && adapter->fpgaDestroyToken)
+			adapter->fpgaDestroyToken(&r->adapter_tokens[i]);
 	}
 
-	return ctx->num_wrapped_tokens == ctx->max_wrapped_tokens
-		       ? OPAE_ENUM_STOP
-		       : OPAE_ENUM_CONTINUE;
+out_free:
+	if (r->adapter_tokens)
+		opae_free(r->adapter_tokens);
 }
 
 fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
@@ -749,7 +1052,8 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 	uint32_t *num_matches)
 {
 	fpga_result res = FPGA_EXCEPTION;
-	fpga_token *adapter_tokens = NULL;
+	opae_adapter_enumeration *results = NULL;
+	uint32_t num_adapters;
 
 	opae_enumeration_context enum_context;
 
@@ -781,22 +1085,29 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 
 	*num_matches = 0;
 
+	if (opae_enum_cache_enabled() &&
+	    opae_enum_cache_can_filter(filters, num_filters))
+		return opae_enum_cache_enumerate(filters, num_filters,
+						 tokens, max_tokens,
+						 num_matches);
+
 	enum_context.filters = filters;
 	enum_context.num_filters = num_filters;
 	enum_context.wrapped_tokens = tokens;
 	enum_context.max_wrapped_tokens = max_tokens;
 	enum_context.num_matches = num_matches;
 
-	if (tokens) {
-		adapter_tokens =
-			(fpga_token *)opae_calloc(max_tokens, sizeof(fpga_token));
-		if (!adapter_tokens) {
+	num_adapters = opae_plugin_mgr_num_adapters();
+	if (num_adapters) {
+		results = (opae_adapter_enumeration *)opae_calloc(
+			num_adapters, sizeof(opae_adapter_enumeration));
+		if (!results) {
 			OPAE_ERR("out of memory");
 			return FPGA_NO_MEMORY;
 		}
 	}
 
-	enum_context.adapter_tokens = adapter_tokens;
+	enum_context.results = results;
 	enum_context.num_wrapped_tokens = 0;
 	enum_context.errors = 0;
 
@@ -854,14 +1165,18 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 		opae_mutex_unlock(err, &p->lock);
 	}
 
-	// perform the enumeration.
-	opae_plugin_mgr_for_each_adapter(opae_enumerate, &enum_context);
+	// perform the enumeration, each adapter on its own thread.
+	num_adapters = opae_plugin_mgr_for_each_adapter_parallel(
+		opae_enumerate, &enum_context, num_adapters);
+
+	for (i = 0; i < num_adapters; ++i)
+		opae_enumerate_merge(&enum_context, &results[i]);
 
 	res = (enum_context.errors > 0) ? FPGA_EXCEPTION : FPGA_OK;
 
 out_free_tokens:
-	if (adapter_tokens)
-		opae_free(adapter_tokens);
+	if (results)
+		opae_free(results);
 
 	// Re-establish any wrapped parent tokens.
 	while (ptf_list) {
@@ -882,6 +1197,12 @@ out_free_tokens:
 	return res;
 }
 
+fpga_result __OPAE_API__ fpgaInvalidateEnumerationCache(void)
+{
+	opae_enum_cache_invalidate();
+	return FPGA_OK;
+}
+
 fpga_result __OPAE_API__ fpgaCloneToken(fpga_token src, fpga_token *dst)
 {
 	fpga_result res;
@@ -965,6 +1286,14 @@ fpga_result __OPAE_API__ fpgaGetUmsgPtr(fpga_handle handle, uint64_t **umsg_ptr)
 
 fpga_result __OPAE_API__ fpgaPrepareBuffer(fpga_handle handle,
 	uint64_t len, void **buf_addr, uint64_t *wsid, int flags)
+{
+	return fpgaPrepareBufferEx(handle, len, buf_addr, wsid, flags,
+				   FPGA_NUMA_NODE_ANY);
+}
+
+fpga_result __OPAE_API__ fpgaPrepareBufferEx(fpga_handle handle,
+	uint64_t len, void **buf_addr, uint64_t *wsid, int flags,
+	int numa_node)
 {
 	fpga_result res;
 	opae_wrapped_handle *wrapped_handle =
@@ -988,8 +1317,17 @@ fpga_result __OPAE_API__ fpgaPrepareBuffer(fpga_handle handle,
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_handle->adapter_table->fpgaPrepareBuffer(
-		wrapped_handle->opae_handle, len, buf_addr, wsid, flags);
+	if (wrapped_handle->adapter_table->fpgaPrepareBufferEx) {
+		res = wrapped_handle->adapter_table->fpgaPrepareBufferEx(
+			wrapped_handle->opae_handle, len, buf_addr, wsid,
+			flags, numa_node);
+	} else if (numa_node == FPGA_NUMA_NODE_ANY) {
+		res = wrapped_handle->adapter_table->fpgaPrepareBuffer(
+			wrapped_handle->opae_handle, len, buf_addr, wsid,
+			flags);
+	} else {
+		return FPGA_NOT_SUPPORTED;
+	}
 	if ((res != FPGA_OK) || !buf_addr)
 		return res;
 
@@ -1006,6 +1344,37 @@ fpga_result __OPAE_API__ fpgaPrepareBuffer(fpga_handle handle,
 	return res;
 }
 
+fpga_result __OPAE_API__ fpgaPrepareBufferSG(fpga_handle handle,
+	void *buf_addr, uint64_t len, uint64_t *wsid,
+	fpga_sg_entry *sg, uint32_t *num_sg, int flags)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(buf_addr);
+	ASSERT_NOT_NULL(wsid);
+	ASSERT_NOT_NULL(sg);
+	ASSERT_NOT_NULL(num_sg);
+	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaPrepareBufferSG,
+			       FPGA_NOT_SUPPORTED);
+
+	if (wrapped_handle->parent) {
+		OPAE_ERR("Call fpgaPrepareBufferSG() from the parent handle");
+		return FPGA_NOT_SUPPORTED;
+	}
+
+	// Child ports pin a single range at the parent's IO address.
+	if (wrapped_handle->child_next) {
+		OPAE_ERR("fpgaPrepareBufferSG() with child AFU ports");
+		return FPGA_NOT_SUPPORTED;
+	}
+
+	return wrapped_handle->adapter_table->fpgaPrepareBufferSG(
+		wrapped_handle->opae_handle, buf_addr, len, wsid,
+		sg, num_sg, flags);
+}
+
 fpga_result __OPAE_API__ fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 {
 	fpga_result ret_res;
@@ -1026,6 +1395,20 @@ fpga_result __OPAE_API__ fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 	return ret_res;
 }
 
+fpga_result __OPAE_API__ fpgaDrainBufferReleases(fpga_handle handle)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL_RESULT(
+		wrapped_handle->adapter_table->fpgaDrainBufferReleases,
+		FPGA_NOT_SUPPORTED);
+
+	return wrapped_handle->adapter_table->fpgaDrainBufferReleases(
+		wrapped_handle->opae_handle);
+}
+
 fpga_result __OPAE_API__ fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
 					  uint64_t *ioaddr)
 {
@@ -1073,6 +1456,39 @@ fpga_result __OPAE_API__ fpgaBindSVA(fpga_handle handle, uint32_t *pasid)
 	return FPGA_OK;
 }
 
+fpga_result __OPAE_API__ fpgaGetBufferPoolStats(fpga_handle handle,
+						fpga_buffer_pool_stats *stats)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(stats);
+	ASSERT_NOT_NULL_RESULT(
+		wrapped_handle->adapter_table->fpgaGetBufferPoolStats,
+		FPGA_NOT_SUPPORTED);
+
+	return wrapped_handle->adapter_table->fpgaGetBufferPoolStats(
+		wrapped_handle->opae_handle, stats);
+}
+
+fpga_result __OPAE_API__
+fpgaGetBufferPrepareStats(fpga_handle handle,
+			  fpga_buffer_prepare_stats *stats)
+{
+	opae_wrapped_handle *wrapped_handle =
+		opae_validate_wrapped_handle(handle);
+
+	ASSERT_NOT_NULL(wrapped_handle);
+	ASSERT_NOT_NULL(stats);
+	ASSERT_NOT_NULL_RESULT(
+		wrapped_handle->adapter_table->fpgaGetBufferPrepareStats,
+		FPGA_NOT_SUPPORTED);
+
+	return wrapped_handle->adapter_table->fpgaGetBufferPrepareStats(
+		wrapped_handle->opae_handle, stats);
+}
+
 fpga_result __OPAE_API__ fpgaGetOPAECVersion(fpga_version *version)
 {
 	ASSERT_NOT_NULL(version);
@@ -1209,6 +1625,8 @@ fpga_result __OPAE_API__ fpgaDestroyEventHandle(fpga_event_handle *event_handle)
 			return FPGA_INVALID_PARAM;
 		}
 
+		opae_event_wait_forget(wrapped_event_handle);
+
 		res = wrapped_event_handle->adapter_table
 			      ->fpgaDestroyEventHandle(
 				      &wrapped_event_handle->opae_event_handle);
@@ -1377,6 +1795,92 @@ fpga_result __OPAE_API__ fpgaUnregisterEvent(fpga_handle handle,
 	return res;
 }
 
+fpga_result __OPAE_API__ fpgaWaitForEvents(fpga_event_handle *event_handles,
+	uint32_t num_handles, int timeout, uint32_t *ready,
+	uint32_t *num_ready)
+{
+	ASSERT_NOT_NULL(event_handles);
+	ASSERT_NOT_NULL(ready);
+	ASSERT_NOT_NULL(num_ready);
+
+	if (!num_handles) {
+		OPAE_ERR("no event handles given");
+		return FPGA_INVALID_PARAM;
+	}
+
+	return opae_event_wait(event_handles, num_handles, timeout,
+			       ready, num_ready);
+}
+
+typedef struct _opae_completion_dsm {
+	volatile uint64_t *addr;
+	uint64_t mask;
+	uint64_t value;
+} opae_completion_dsm;
+
+STATIC fpga_result opae_completion_poll_dsm(void *context, bool *done)
+{
+	opae_completion_dsm *c = (opae_completion_dsm *)context;
+
+	*done = ((*c->addr & c->mask) == c->value);
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaWaitForCompletion(fpga_event_handle event_handle,
+	volatile uint64_t *addr, uint64_t mask, uint64_t value,
+	int timeout, fpga_wait_stats *stats)
+{
+	opae_completion_dsm c;
+
+	ASSERT_NOT_NULL(event_handle);
+	ASSERT_NOT_NULL(addr);
+
+	c.addr = addr;
+	c.mask = mask;
+	c.value = value;
+
+	return opae_completion_wait(event_handle, opae_completion_poll_dsm,
+				    &c, timeout, stats);
+}
+
+typedef struct _opae_completion_csr {
+	fpga_handle handle;
+	uint32_t mmio_num;
+	uint64_t offset;
+	uint64_t mask;
+	uint64_t value;
+} opae_completion_csr;
+
+STATIC fpga_result opae_completion_poll_csr(void *context, bool *done)
+{
+	opae_completion_csr *c = (opae_completion_csr *)context;
+	fpga_result res;
+	uint64_t csr = 0;
+
+	res = fpgaReadMMIO64(c->handle, c->mmio_num, c->offset, &csr);
+	*done = (res == FPGA_OK) && ((csr & c->mask) == c->value);
+	return res;
+}
+
+fpga_result __OPAE_API__ fpgaWaitForCompletionCSR(fpga_handle handle,
+	uint32_t mmio_num, uint64_t offset, uint64_t mask, uint64_t value,
+	fpga_event_handle event_handle, int timeout, fpga_wait_stats *stats)
+{
+	opae_completion_csr c;
+
+	ASSERT_NOT_NULL(opae_validate_wrapped_handle(handle));
+	ASSERT_NOT_NULL(event_handle);
+
+	c.handle = handle;
+	c.mmio_num = mmio_num;
+	c.offset = offset;
+	c.mask = mask;
+	c.value = value;
+
+	return opae_completion_wait(event_handle, opae_completion_poll_csr,
+				    &c, timeout, stats);
+}
+
 fpga_result __OPAE_API__ fpgaAssignPortToInterface(fpga_handle fpga,
 	uint32_t interface_num, uint32_t slot_num, int flags)
 {
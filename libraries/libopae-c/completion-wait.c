@@ -0,0 +1,271 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "opae_int.h"
+#include "event-wait.h"
+#include "completion-wait.h"
+#include "mock/opae_std.h"
+
+// Bounds on the calibrated blocking cost.
+#define OPAE_COMPLETION_BLOCK_MIN_NS 2000
+#define OPAE_COMPLETION_BLOCK_MAX_NS 200000
+
+#define OPAE_COMPLETION_CALIBRATE_ROUNDS 16
+
+STATIC pthread_once_t completion_once = PTHREAD_ONCE_INIT;
+STATIC uint64_t completion_block_ns;
+
+STATIC uint64_t opae_completion_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void opae_completion_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+/*
+ * Time the system calls of the blocking path, an eventfd signal seen
+ * by poll() and consumed by read(), on the calling thread. A blocked
+ * waiter additionally pays for being scheduled back in, which is not
+ * measured here, so the result is scaled by 4.
+ *
+ * LIBOPAE_SPIN_NS in the environment replaces the calibration. A value
+ * of 0 disables spinning.
+ */
+STATIC void opae_completion_calibrate(void)
+{
+	const char *s = getenv("LIBOPAE_SPIN_NS");
+	struct pollfd pfd;
+	uint64_t best = UINT64_MAX;
+	uint64_t one = 1;
+	uint64_t count;
+	uint64_t t;
+	int i;
+
+	if (s && *s) {
+		completion_block_ns = strtoull(s, NULL, 0);
+		return;
+	}
+
+	pfd.fd = eventfd(0, EFD_CLOEXEC);
+	if (pfd.fd < 0) {
+		OPAE_ERR("eventfd() failed: %s", strerror(errno));
+		completion_block_ns = OPAE_COMPLETION_BLOCK_MIN_NS;
+		return;
+	}
+	pfd.events = POLLIN;
+
+	for (i = 0 ; i < OPAE_COMPLETION_CALIBRATE_ROUNDS ; ++i) {
+		t = opae_completion_now_ns();
+
+		if ((write(pfd.fd, &one, sizeof(one)) != sizeof(one)) ||
+		    (poll(&pfd, 1, 0) != 1) ||
+		    (opae_read(pfd.fd, &count, sizeof(count)) != sizeof(count)))
+			break;
+
+		t = opae_completion_now_ns() - t;
+		if (t < best)
+			best = t;
+	}
+
+	opae_close(pfd.fd);
+
+	if (best == UINT64_MAX)
+		best = OPAE_COMPLETION_BLOCK_MIN_NS;
+	else
+		best *= 4;
+
+	if (best < OPAE_COMPLETION_BLOCK_MIN_NS)
+		best = OPAE_COMPLETION_BLOCK_MIN_NS;
+	else if (best > OPAE_COMPLETION_BLOCK_MAX_NS)
+		best = OPAE_COMPLETION_BLOCK_MAX_NS;
+
+	completion_block_ns = best;
+}
+
+uint64_t opae_completion_block_ns(void)
+{
+	pthread_once(&completion_once, opae_completion_calibrate);
+	return completion_block_ns;
+}
+
+/*
+ * Move the spin budget a quarter of the way toward the ideal budget for
+ * a completion that took elapsed ns: enough to catch it, when it came
+ * sooner than blocking costs, and a token amount otherwise.
+ */
+STATIC uint64_t opae_completion_adapt(uint64_t budget, uint64_t elapsed)
+{
+	uint64_t block_ns = opae_completion_block_ns();
+	uint64_t target;
+
+	if (elapsed <= block_ns / 2)
+		target = 2 * elapsed;
+	else if (elapsed <= block_ns)
+		target = block_ns;
+	else
+		target = block_ns / 16;
+
+	return budget - budget / 4 + target / 4;
+}
+
+// Consume the signal on an event object: eventfds are read 8 bytes at
+// a time, UIO devices 4.
+STATIC void opae_completion_consume(int fd)
+{
+	uint64_t count = 0;
+
+	if ((opae_read(fd, &count, sizeof(uint64_t)) < 0) &&
+	    (errno == EINVAL) &&
+	    (opae_read(fd, &count, sizeof(uint32_t)) < 0))
+		OPAE_MSG("read() of event fd %d failed: %s",
+			 fd, strerror(errno));
+}
+
+fpga_result opae_completion_wait(fpga_event_handle event_handle,
+				 opae_completion_poll poll_fn,
+				 void *context,
+				 int timeout,
+				 fpga_wait_stats *stats)
+{
+	opae_wrapped_event_handle *we =
+		opae_validate_wrapped_event_handle(event_handle);
+	fpga_wait_stats s;
+	struct pollfd pfd;
+	fpga_result res;
+	uint64_t id;
+	uint64_t start;
+	uint64_t now;
+	uint64_t deadline = UINT64_MAX;
+	uint64_t spin_end;
+	uint64_t budget;
+	bool done = false;
+	int fd = -1;
+	int ms;
+	int r;
+
+	ASSERT_NOT_NULL(we);
+
+	res = opae_event_wait_fd(event_handle, &fd, &id);
+	if (res != FPGA_OK)
+		return res;
+
+	memset(&s, 0, sizeof(s));
+
+	budget = __atomic_load_n(&we->spin_ns, __ATOMIC_RELAXED);
+	if (!budget)
+		budget = opae_completion_block_ns();
+	s.budget_ns = budget;
+
+	start = now = opae_completion_now_ns();
+	if (timeout >= 0)
+		deadline = start + (uint64_t)timeout * 1000000ULL;
+	spin_end = (deadline - start > budget) ? start + budget : deadline;
+
+	do {
+		res = poll_fn(context, &done);
+		++s.polls;
+		if ((res != FPGA_OK) || done)
+			break;
+		opae_completion_relax();
+		now = opae_completion_now_ns();
+	} while (now < spin_end);
+
+	s.spin_ns = now - start;
+	s.path = FPGA_WAIT_SPIN;
+
+	while ((res == FPGA_OK) && !done) {
+		if (now >= deadline) {
+			s.path = FPGA_WAIT_TIMEOUT;
+			res = FPGA_BUSY;
+			break;
+		}
+
+		s.path = FPGA_WAIT_EVENT;
+
+		ms = -1;
+		if (deadline != UINT64_MAX)
+			ms = (int)((deadline - now + 999999) / 1000000);
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		r = poll(&pfd, 1, ms);
+		if (r < 0) {
+			if (errno != EINTR) {
+				OPAE_ERR("poll() failed: %s", strerror(errno));
+				res = FPGA_EXCEPTION;
+				break;
+			}
+		} else if (r > 0) {
+			// A signal may be left from a completion that was
+			// seen while spinning, so the word is checked again.
+			opae_completion_consume(fd);
+			++s.wakeups;
+		}
+
+		now = opae_completion_now_ns();
+
+		res = poll_fn(context, &done);
+		++s.polls;
+	}
+
+	s.block_ns = now - start - s.spin_ns;
+
+	if (done)
+		__atomic_store_n(&we->spin_ns,
+				 opae_completion_adapt(budget, now - start),
+				 __ATOMIC_RELAXED);
+
+	if (stats)
+		*stats = s;
+
+	return res;
+}
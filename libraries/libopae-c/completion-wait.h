@@ -0,0 +1,58 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+//
+// Spin-then-block completion waits behind fpgaWaitForCompletion().
+//
+// A wait polls the completion word for a spin budget, then blocks on
+// the event handle until it is signaled and the word shows completion.
+// The budget starts at the calibrated cost of the blocking path and
+// adapts, per event handle, to the completion times seen so far.
+//
+
+#ifndef __OPAE_COMPLETION_WAIT_H__
+#define __OPAE_COMPLETION_WAIT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <opae/types.h>
+
+// Reads the completion word. Sets *done when it shows completion.
+typedef fpga_result (*opae_completion_poll)(void *context, bool *done);
+
+// Same contract as fpgaWaitForCompletion(), with the completion word
+// read by poll(context).
+fpga_result opae_completion_wait(fpga_event_handle event_handle,
+				 opae_completion_poll poll,
+				 void *context,
+				 int timeout,
+				 fpga_wait_stats *stats);
+
+// Cost of the blocking path in nanoseconds, calibrated on first use.
+uint64_t opae_completion_block_ns(void);
+
+#endif // __OPAE_COMPLETION_WAIT_H__
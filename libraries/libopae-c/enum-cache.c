@@ -0,0 +1,551 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include <opae/properties.h>
+#include <opae/enum.h>
+
+#include "pluginmgr.h"
+#include "opae_int.h"
+#include "props.h"
+#include "enum-cache.h"
+#include "mock/opae_std.h"
+
+#define OPAE_ENUM_CACHE_UEVENT_BUF 4096
+
+typedef struct _opae_enum_cache_entry {
+	const opae_api_adapter_table *adapter;
+	fpga_token token;              // owned by the cache
+	struct _fpga_properties *props; // as returned by the plugin
+} opae_enum_cache_entry;
+
+typedef struct _opae_enum_cache {
+	pthread_mutex_t lock;
+	opae_enum_cache_entry *entries;
+	uint32_t num_entries;
+	uint32_t capacity;
+	bool valid;
+	uint64_t generation; // value of enum_cache_generation when built
+	int uevent_fd;
+} opae_enum_cache;
+
+STATIC opae_enum_cache enum_cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.entries = NULL,
+	.num_entries = 0,
+	.capacity = 0,
+	.valid = false,
+	.generation = 0,
+	.uevent_fd = -1,
+};
+
+// Bumped by opae_enum_cache_invalidate(). Read without the cache lock.
+STATIC uint64_t enum_cache_generation;
+
+// -1: not yet read from the environment.
+STATIC int enum_cache_state = -1;
+
+bool opae_enum_cache_enabled(void)
+{
+	int state = __atomic_load_n(&enum_cache_state, __ATOMIC_RELAXED);
+
+	if (state < 0) {
+		const char *s = getenv("LIBOPAE_ENUM_CACHE");
+
+		state = (s && *s && strcmp(s, "0")) ? 1 : 0;
+		__atomic_store_n(&enum_cache_state, state, __ATOMIC_RELAXED);
+	}
+
+	return state > 0;
+}
+
+bool opae_enum_cache_can_filter(const fpga_properties *filters,
+				uint32_t num_filters)
+{
+	uint32_t i;
+	bool can_filter = true;
+
+	for (i = 0 ; can_filter && (i < num_filters) ; ++i) {
+		int err;
+		struct _fpga_properties *p =
+			opae_validate_and_lock_properties(filters[i]);
+
+		if (!p)
+			return false;
+
+		if (FIELD_VALID(p, FPGA_PROPERTY_PARENT) ||
+		    FIELD_VALID(p, FPGA_PROPERTY_NUM_ERRORS))
+			can_filter = false;
+		else if (FIELD_VALID(p, FPGA_PROPERTY_OBJTYPE) &&
+			 (p->objtype == FPGA_ACCELERATOR) &&
+			 FIELD_VALID(p, FPGA_PROPERTY_ACCELERATOR_STATE))
+			can_filter = false;
+
+		opae_mutex_unlock(err, &p->lock);
+	}
+
+	return can_filter;
+}
+
+#define OPAE_ENUM_CACHE_FIELD_MATCH(__filter, __p, __f, __field) \
+	do {                                                     \
+		if (FIELD_VALID(__filter, __f) &&                \
+		    ((__filter)->__field != (__p)->__field))     \
+			return false;                            \
+	} while (0)
+
+// Both objects must be locked or otherwise stable.
+STATIC bool opae_enum_cache_matches(const struct _fpga_properties *filter,
+				    const struct _fpga_properties *p)
+{
+	// Every field named by the filter must be known for the resource.
+	if (filter->valid_fields & ~p->valid_fields)
+		return false;
+
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_OBJTYPE, objtype);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_SEGMENT, segment);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_BUS, bus);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_DEVICE, device);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_FUNCTION, function);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_SOCKETID, socket_id);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_VENDORID, vendor_id);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_DEVICEID, device_id);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_OBJECTID, object_id);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_NUM_ERRORS, num_errors);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_INTERFACE, interface);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_SUB_VENDORID,
+				    subsystem_vendor_id);
+	OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_SUB_DEVICEID,
+				    subsystem_device_id);
+
+	if (FIELD_VALID(filter, FPGA_PROPERTY_GUID) &&
+	    memcmp(filter->guid, p->guid, sizeof(fpga_guid)))
+		return false;
+
+	// Object-specific fields can only be set once the object type is
+	// known, and the object type has already been compared above.
+	if (!FIELD_VALID(filter, FPGA_PROPERTY_OBJTYPE))
+		return true;
+
+	if (filter->objtype == FPGA_DEVICE) {
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_NUM_SLOTS,
+					    u.fpga.num_slots);
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_BBSID,
+					    u.fpga.bbs_id);
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_BBSVERSION,
+					    u.fpga.bbs_version.major);
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_BBSVERSION,
+					    u.fpga.bbs_version.minor);
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_BBSVERSION,
+					    u.fpga.bbs_version.patch);
+	} else if (filter->objtype == FPGA_ACCELERATOR) {
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p,
+					    FPGA_PROPERTY_ACCELERATOR_STATE,
+					    u.accelerator.state);
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p, FPGA_PROPERTY_NUM_MMIO,
+					    u.accelerator.num_mmio);
+		OPAE_ENUM_CACHE_FIELD_MATCH(filter, p,
+					    FPGA_PROPERTY_NUM_INTERRUPTS,
+					    u.accelerator.num_interrupts);
+	}
+
+	return true;
+}
+
+STATIC bool opae_enum_cache_matches_filters(const fpga_properties *filters,
+					    uint32_t num_filters,
+					    const struct _fpga_properties *p)
+{
+	uint32_t i;
+
+	if (!num_filters)
+		return true;
+
+	for (i = 0 ; i < num_filters ; ++i) {
+		int err;
+		bool match;
+		struct _fpga_properties *f =
+			opae_validate_and_lock_properties(filters[i]);
+
+		if (!f)
+			continue;
+
+		match = opae_enum_cache_matches(f, p);
+
+		opae_mutex_unlock(err, &f->lock);
+
+		if (match)
+			return true;
+	}
+
+	return false;
+}
+
+// Returns true if the kernel uevent in msg may add, remove, or rebind an
+// FPGA resource. msg is "ACTION@DEVPATH\0KEY=VALUE\0...".
+STATIC bool opae_enum_cache_uevent_is_hotplug(const char *msg, size_t len)
+{
+	static const char *const actions[] = {
+		"add@", "remove@", "bind@", "unbind@", "move@"
+	};
+	static const char *const subsystems[] = {
+		"pci", "vfio", "uio", "fpga", "fpga_region", "dfl", "intel-fpga"
+	};
+	const char *end = msg + len;
+	bool action = false;
+	size_t i;
+
+	for (i = 0 ; i < sizeof(actions) / sizeof(actions[0]) ; ++i) {
+		if (!strncmp(msg, actions[i], strlen(actions[i]))) {
+			action = true;
+			break;
+		}
+	}
+
+	if (!action)
+		return false;
+
+	while (msg < end) {
+		size_t n = strnlen(msg, end - msg);
+
+		if ((n > 10) && !strncmp(msg, "SUBSYSTEM=", 10)) {
+			for (i = 0 ;
+			     i < sizeof(subsystems) / sizeof(subsystems[0]) ;
+			     ++i) {
+				if (!strcmp(msg + 10, subsystems[i]))
+					return true;
+			}
+			return false;
+		}
+
+		msg += n + 1;
+	}
+
+	// No subsystem given; assume the worst.
+	return true;
+}
+
+STATIC void opae_enum_cache_open_uevents(opae_enum_cache *cache)
+{
+	struct sockaddr_nl addr;
+	int fd;
+
+	if (cache->uevent_fd >= 0)
+		return;
+
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		    NETLINK_KOBJECT_UEVENT);
+	if (fd < 0) {
+		OPAE_DBG("uevent socket failed: %s", strerror(errno));
+		return;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1; // kernel events
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		OPAE_DBG("uevent bind failed: %s", strerror(errno));
+		opae_close(fd);
+		return;
+	}
+
+	cache->uevent_fd = fd;
+}
+
+// Drain pending uevents, invalidating the cache on any hotplug event.
+STATIC void opae_enum_cache_poll_uevents(opae_enum_cache *cache)
+{
+	char buf[OPAE_ENUM_CACHE_UEVENT_BUF];
+	ssize_t n;
+
+	if (cache->uevent_fd < 0)
+		return;
+
+	while (1) {
+		n = recv(cache->uevent_fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+		if (n < 0) {
+			if (errno == ENOBUFS) {
+				// Events were dropped.
+				opae_enum_cache_invalidate();
+				continue;
+			}
+			break;
+		}
+
+		buf[n] = '\0';
+		if (opae_enum_cache_uevent_is_hotplug(buf, (size_t)n))
+			opae_enum_cache_invalidate();
+	}
+}
+
+STATIC void opae_enum_cache_clear(opae_enum_cache *cache)
+{
+	uint32_t i;
+
+	for (i = 0 ; i < cache->num_entries ; ++i) {
+		opae_enum_cache_entry *e = &cache->entries[i];
+
+		fpgaDestroyProperties((fpga_properties *)&e->props);
+		if (e->adapter->fpgaDestroyToken)
+			e->adapter->fpgaDestroyToken(&e->token);
+	}
+
+	cache->num_entries = 0;
+	cache->valid = false;
+}
+
+STATIC int opae_enum_cache_append(opae_enum_cache *cache,
+				  const opae_api_adapter_table *adapter,
+				  fpga_token token,
+				  fpga_properties props)
+{
+	opae_enum_cache_entry *e;
+
+	if (cache->num_entries == cache->capacity) {
+		uint32_t capacity = cache->capacity ? 2 * cache->capacity : 16;
+		opae_enum_cache_entry *entries = (opae_enum_cache_entry *)
+			opae_calloc(capacity, sizeof(opae_enum_cache_entry));
+
+		if (!entries) {
+			OPAE_ERR("out of memory");
+			return 1;
+		}
+
+		if (cache->entries) {
+			memcpy(entries, cache->entries,
+			       cache->num_entries * sizeof(opae_enum_cache_entry));
+			opae_free(cache->entries);
+		}
+
+		cache->entries = entries;
+		cache->capacity = capacity;
+	}
+
+	e = &cache->entries[cache->num_entries++];
+	e->adapter = adapter;
+	e->token = token;
+	e->props = (struct _fpga_properties *)props;
+
+	return 0;
+}
+
+typedef struct _opae_enum_cache_fill_context {
+	opae_enum_cache *cache;
+	uint32_t errors;
+} opae_enum_cache_fill_context;
+
+static int opae_enum_cache_fill(const opae_api_adapter_table *adapter,
+				void *context)
+{
+	opae_enum_cache_fill_context *ctx =
+		(opae_enum_cache_fill_context *)context;
+	fpga_token *tokens = NULL;
+	uint32_t num_tokens = 0;
+	uint32_t i;
+	fpga_result res;
+
+	if (!adapter->fpgaEnumerate || !adapter->fpgaGetProperties ||
+	    !adapter->fpgaDestroyToken) {
+		OPAE_MSG("adapter \"%s\" cannot be cached",
+			 adapter->plugin.path);
+		++ctx->errors;
+		return OPAE_ENUM_CONTINUE;
+	}
+
+	res = adapter->fpgaEnumerate(NULL, 0, NULL, 0, &num_tokens);
+	if ((res != FPGA_OK) || !num_tokens)
+		goto out_check;
+
+	tokens = (fpga_token *)opae_calloc(num_tokens, sizeof(fpga_token));
+	if (!tokens) {
+		OPAE_ERR("out of memory");
+		++ctx->errors;
+		return OPAE_ENUM_STOP;
+	}
+
+	res = adapter->fpgaEnumerate(NULL, 0, tokens, num_tokens, &num_tokens);
+	if (res != FPGA_OK)
+		goto out_free;
+
+	for (i = 0 ; i < num_tokens ; ++i) {
+		fpga_properties props = NULL;
+
+		if (!tokens[i])
+			continue;
+
+		if (adapter->fpgaGetProperties(tokens[i], &props) != FPGA_OK ||
+		    opae_enum_cache_append(ctx->cache, adapter,
+					   tokens[i], props)) {
+			if (props)
+				fpgaDestroyProperties(&props);
+			adapter->fpgaDestroyToken(&tokens[i]);
+			++ctx->errors;
+		}
+	}
+
+out_free:
+	opae_free(tokens);
+out_check:
+	if (res != FPGA_OK) {
+		OPAE_DBG("fpgaEnumerate() failed for \"%s\": %s",
+			 adapter->plugin.path, fpgaErrStr(res));
+		if ((res != FPGA_NO_DRIVER) && (res != FPGA_NOT_FOUND))
+			++ctx->errors;
+	}
+	return OPAE_ENUM_CONTINUE;
+}
+
+// Called with the cache lock held. Non-zero if any plugin failed, in which
+// case the partial contents are served but not kept.
+STATIC uint32_t opae_enum_cache_refresh(opae_enum_cache *cache)
+{
+	opae_enum_cache_fill_context ctx;
+	uint64_t generation;
+
+	// Open the uevent socket before scanning so that no hotplug event
+	// between the scan and the first poll is missed.
+	opae_enum_cache_open_uevents(cache);
+	opae_enum_cache_poll_uevents(cache);
+
+	generation = __atomic_load_n(&enum_cache_generation, __ATOMIC_ACQUIRE);
+
+	if (cache->valid && (cache->generation == generation))
+		return 0;
+
+	opae_enum_cache_clear(cache);
+
+	ctx.cache = cache;
+	ctx.errors = 0;
+
+	opae_plugin_mgr_for_each_adapter(opae_enum_cache_fill, &ctx);
+
+	cache->generation = generation;
+	cache->valid = !ctx.errors;
+
+	return ctx.errors;
+}
+
+fpga_result opae_enum_cache_enumerate(const fpga_properties *filters,
+				      uint32_t num_filters,
+				      fpga_token *tokens,
+				      uint32_t max_tokens,
+				      uint32_t *num_matches)
+{
+	opae_enum_cache *cache = &enum_cache;
+	uint32_t errors;
+	uint32_t num_tokens = 0;
+	uint32_t i;
+	int err;
+
+	*num_matches = 0;
+
+	if (opae_mutex_lock(err, &cache->lock))
+		return FPGA_EXCEPTION;
+
+	errors = opae_enum_cache_refresh(cache);
+
+	for (i = 0 ; i < cache->num_entries ; ++i) {
+		opae_enum_cache_entry *e = &cache->entries[i];
+		fpga_token clone = NULL;
+		opae_wrapped_token *wt;
+
+		if (!opae_enum_cache_matches_filters(filters, num_filters,
+						     e->props))
+			continue;
+
+		++*num_matches;
+
+		if (!tokens || (num_tokens == max_tokens))
+			continue;
+
+		if (!e->adapter->fpgaCloneToken ||
+		    e->adapter->fpgaCloneToken(e->token, &clone) != FPGA_OK) {
+			++errors;
+			continue;
+		}
+
+		wt = opae_allocate_wrapped_token(clone, e->adapter);
+		if (!wt) {
+			e->adapter->fpgaDestroyToken(&clone);
+			++errors;
+			continue;
+		}
+
+		tokens[num_tokens++] = wt;
+	}
+
+	// Entries from a failed refresh are not kept.
+	if (!cache->valid)
+		opae_enum_cache_clear(cache);
+
+	opae_mutex_unlock(err, &cache->lock);
+
+	return errors ? FPGA_EXCEPTION : FPGA_OK;
+}
+
+void opae_enum_cache_invalidate(void)
+{
+	__atomic_add_fetch(&enum_cache_generation, 1, __ATOMIC_RELEASE);
+}
+
+void opae_enum_cache_release(void)
+{
+	opae_enum_cache *cache = &enum_cache;
+	int err;
+
+	opae_mutex_lock(err, &cache->lock);
+
+	opae_enum_cache_clear(cache);
+
+	if (cache->entries) {
+		opae_free(cache->entries);
+		cache->entries = NULL;
+	}
+	cache->capacity = 0;
+
+	if (cache->uevent_fd >= 0) {
+		opae_close(cache->uevent_fd);
+		cache->uevent_fd = -1;
+	}
+
+	// Re-read LIBOPAE_ENUM_CACHE on the next initialization.
+	__atomic_store_n(&enum_cache_state, -1, __ATOMIC_RELAXED);
+
+	opae_mutex_unlock(err, &cache->lock);
+}
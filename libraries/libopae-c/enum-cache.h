@@ -0,0 +1,68 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+//
+// Process-wide cache of the tokens and properties discovered by each
+// plugin's fpgaEnumerate(). When enabled (LIBOPAE_ENUM_CACHE=1 in the
+// environment), fpgaEnumerate() evaluates its filters in memory against
+// the cache instead of asking each plugin to rescan sysfs.
+//
+// The cache is rebuilt on the next enumeration after it is invalidated,
+// either explicitly by fpgaInvalidateEnumerationCache() or by a kernel
+// hotplug uevent.
+//
+
+#ifndef __OPAE_ENUM_CACHE_H__
+#define __OPAE_ENUM_CACHE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <opae/types.h>
+
+// true when LIBOPAE_ENUM_CACHE requests the cache.
+bool opae_enum_cache_enabled(void);
+
+// Whether the given filters can be evaluated against the cache. Filters
+// that name a parent token or a field that changes at runtime (error
+// count, accelerator state) must go to the plugins.
+bool opae_enum_cache_can_filter(const fpga_properties *filters,
+				uint32_t num_filters);
+
+// Same contract as fpgaEnumerate(), with filters already validated.
+fpga_result opae_enum_cache_enumerate(const fpga_properties *filters,
+				      uint32_t num_filters,
+				      fpga_token *tokens,
+				      uint32_t max_tokens,
+				      uint32_t *num_matches);
+
+// Mark the cache stale. The next enumeration rebuilds it.
+void opae_enum_cache_invalidate(void);
+
+// Release all cached tokens. Must run before the plugins are finalized.
+void opae_enum_cache_release(void);
+
+#endif // __OPAE_ENUM_CACHE_H__
@@ -0,0 +1,402 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+#include "adapter.h"
+#include "opae_int.h"
+#include "event-wait.h"
+#include "mock/opae_std.h"
+
+// Several event handles may share a descriptor (eg uio handles of one
+// device), so a slot records the handles of the current call that use
+// it as a list of array positions, linked through the set's next[].
+#define OPAE_EVENT_WAIT_END UINT32_MAX
+
+// Largest slot table: one entry per possible descriptor.
+#define OPAE_EVENT_WAIT_MAX_SLOTS (1u << 30)
+
+typedef struct _opae_event_wait_slot {
+	uint64_t id;    // wait_id of the handle that added the descriptor
+	uint64_t stamp; // wait call that last asked for the descriptor
+	uint32_t index; // last position in that call's array using it
+} opae_event_wait_slot;
+
+typedef struct _opae_event_wait_set {
+	int epfd;
+	uint64_t stamp;
+	opae_event_wait_slot *slots; // indexed by descriptor
+	uint32_t num_slots;
+	struct epoll_event *events;
+	uint64_t *ids;   // wait_id of each handle of the current call
+	uint32_t *next;  // previous position using the same descriptor
+	uint32_t num_events;
+} opae_event_wait_set;
+
+STATIC pthread_key_t event_wait_key;
+STATIC pthread_once_t event_wait_once = PTHREAD_ONCE_INIT;
+STATIC int event_wait_key_err;
+
+// Source of opae_wrapped_event_handle::wait_id. 0 is never issued.
+STATIC uint64_t event_wait_next_id;
+
+STATIC void opae_event_wait_set_free(void *arg)
+{
+	opae_event_wait_set *set = (opae_event_wait_set *)arg;
+
+	if (set->epfd >= 0)
+		opae_close(set->epfd);
+	if (set->slots)
+		opae_free(set->slots);
+	if (set->events)
+		opae_free(set->events);
+	if (set->ids)
+		opae_free(set->ids);
+	if (set->next)
+		opae_free(set->next);
+	opae_free(set);
+}
+
+STATIC void opae_event_wait_key_create(void)
+{
+	event_wait_key_err = pthread_key_create(&event_wait_key,
+						opae_event_wait_set_free);
+}
+
+STATIC opae_event_wait_set *opae_event_wait_get_set(bool create)
+{
+	opae_event_wait_set *set;
+
+	if (pthread_once(&event_wait_once, opae_event_wait_key_create) ||
+	    event_wait_key_err) {
+		OPAE_ERR("failed to create the event wait key");
+		return NULL;
+	}
+
+	set = (opae_event_wait_set *)pthread_getspecific(event_wait_key);
+	if (set || !create)
+		return set;
+
+	set = (opae_event_wait_set *)opae_calloc(1, sizeof(*set));
+	if (!set) {
+		OPAE_ERR("out of memory");
+		return NULL;
+	}
+
+	set->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->epfd < 0) {
+		OPAE_ERR("epoll_create1() failed: %s", strerror(errno));
+		goto out_free;
+	}
+
+	if (pthread_setspecific(event_wait_key, set)) {
+		OPAE_ERR("pthread_setspecific() failed");
+		goto out_free;
+	}
+
+	return set;
+
+out_free:
+	opae_event_wait_set_free(set);
+	return NULL;
+}
+
+STATIC opae_event_wait_slot *
+opae_event_wait_get_slot(opae_event_wait_set *set, int fd)
+{
+	if ((fd < 0) || ((uint32_t)fd >= OPAE_EVENT_WAIT_MAX_SLOTS)) {
+		OPAE_ERR("invalid event descriptor %d", fd);
+		return NULL;
+	}
+
+	if ((uint32_t)fd >= set->num_slots) {
+		uint32_t num_slots = set->num_slots ? set->num_slots : 64;
+		opae_event_wait_slot *slots;
+
+		while (num_slots <= (uint32_t)fd)
+			num_slots *= 2;
+
+		slots = (opae_event_wait_slot *)
+			opae_calloc(num_slots, sizeof(opae_event_wait_slot));
+		if (!slots) {
+			OPAE_ERR("out of memory");
+			return NULL;
+		}
+
+		if (set->slots) {
+			memcpy(slots, set->slots,
+			       set->num_slots * sizeof(opae_event_wait_slot));
+			opae_free(set->slots);
+		}
+
+		set->slots = slots;
+		set->num_slots = num_slots;
+	}
+
+	return &set->slots[fd];
+}
+
+fpga_result opae_event_wait_fd(fpga_event_handle event_handle,
+			       int *fd,
+			       uint64_t *id)
+{
+	fpga_result res = FPGA_OK;
+	opae_wrapped_event_handle *we =
+		opae_validate_wrapped_event_handle(event_handle);
+	int err;
+
+	ASSERT_NOT_NULL(we);
+
+	opae_mutex_lock(err, &we->lock);
+
+	if (we->wait_fd < 0) {
+		if (!(we->flags & OPAE_WRAPPED_EVENT_HANDLE_CREATED) ||
+		    !we->opae_event_handle) {
+			OPAE_ERR("event handle has not been registered");
+			res = FPGA_INVALID_PARAM;
+			goto out_unlock;
+		}
+
+		if (!we->adapter_table->fpgaGetOSObjectFromEventHandle) {
+			OPAE_ERR("NULL fpgaGetOSObjectFromEventHandle in adapter.");
+			res = FPGA_NOT_SUPPORTED;
+			goto out_unlock;
+		}
+
+		res = we->adapter_table->fpgaGetOSObjectFromEventHandle(
+			we->opae_event_handle, &we->wait_fd);
+		if (res != FPGA_OK) {
+			we->wait_fd = -1;
+			goto out_unlock;
+		}
+
+		if (we->wait_fd < 0) {
+			OPAE_ERR("invalid OS object %d for event handle",
+				 we->wait_fd);
+			we->wait_fd = -1;
+			res = FPGA_INVALID_PARAM;
+			goto out_unlock;
+		}
+
+		we->wait_id = __atomic_add_fetch(&event_wait_next_id, 1,
+						 __ATOMIC_RELAXED);
+	}
+
+	*fd = we->wait_fd;
+	*id = we->wait_id;
+
+out_unlock:
+	opae_mutex_unlock(err, &we->lock);
+	return res;
+}
+
+STATIC int64_t opae_event_wait_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+fpga_result opae_event_wait(const fpga_event_handle *event_handles,
+			    uint32_t num_handles,
+			    int timeout,
+			    uint32_t *ready,
+			    uint32_t *num_ready)
+{
+	opae_event_wait_set *set;
+	opae_event_wait_slot *slot;
+	struct epoll_event ev;
+	fpga_result res;
+	uint64_t stamp;
+	uint64_t id = 0;
+	int64_t deadline = 0;
+	uint32_t i;
+	uint32_t j;
+	int count;
+	int fd = -1;
+
+	*num_ready = 0;
+
+	set = opae_event_wait_get_set(true);
+	if (!set)
+		return FPGA_EXCEPTION;
+
+	if (num_handles > set->num_events) {
+		struct epoll_event *events = (struct epoll_event *)
+			opae_calloc(num_handles, sizeof(struct epoll_event));
+		uint64_t *ids = (uint64_t *)
+			opae_calloc(num_handles, sizeof(uint64_t));
+		uint32_t *next = (uint32_t *)
+			opae_calloc(num_handles, sizeof(uint32_t));
+
+		if (!events || !ids || !next) {
+			OPAE_ERR("out of memory");
+			if (events)
+				opae_free(events);
+			if (ids)
+				opae_free(ids);
+			if (next)
+				opae_free(next);
+			return FPGA_NO_MEMORY;
+		}
+
+		if (set->events)
+			opae_free(set->events);
+		if (set->ids)
+			opae_free(set->ids);
+		if (set->next)
+			opae_free(set->next);
+		set->events = events;
+		set->ids = ids;
+		set->next = next;
+		set->num_events = num_handles;
+	}
+
+	stamp = ++set->stamp;
+
+	for (i = 0 ; i < num_handles ; ++i) {
+		res = opae_event_wait_fd(event_handles[i], &fd, &id);
+		if (res != FPGA_OK)
+			return res;
+
+		slot = opae_event_wait_get_slot(set, fd);
+		if (!slot)
+			return FPGA_EXCEPTION;
+
+		set->ids[i] = id;
+
+		if (slot->stamp == stamp) {
+			// Another handle of this call uses the descriptor.
+			for (j = slot->index ; j != OPAE_EVENT_WAIT_END ;
+			     j = set->next[j]) {
+				if (set->ids[j] == id) {
+					OPAE_ERR("event handle %u appears "
+						 "more than once", i);
+					return FPGA_INVALID_PARAM;
+				}
+			}
+
+			set->next[i] = slot->index;
+			slot->index = i;
+			continue;
+		}
+
+		if (slot->id != id) {
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.fd = fd;
+
+			if (epoll_ctl(set->epfd, EPOLL_CTL_ADD, fd, &ev) &&
+			    ((errno != EEXIST) ||
+			     epoll_ctl(set->epfd, EPOLL_CTL_MOD, fd, &ev))) {
+				OPAE_ERR("epoll_ctl(%d) failed: %s",
+					 fd, strerror(errno));
+				return FPGA_EXCEPTION;
+			}
+
+			slot->id = id;
+		}
+
+		slot->stamp = stamp;
+		slot->index = i;
+		set->next[i] = OPAE_EVENT_WAIT_END;
+	}
+
+	if (timeout > 0)
+		deadline = opae_event_wait_now_ms() + timeout;
+
+	do {
+		count = epoll_wait(set->epfd, set->events,
+				   (int)num_handles, timeout);
+		if (count < 0) {
+			if (errno == EINTR)
+				return FPGA_OK;
+			OPAE_ERR("epoll_wait() failed: %s", strerror(errno));
+			return FPGA_EXCEPTION;
+		}
+
+		for (i = 0 ; i < (uint32_t)count ; ++i) {
+			slot = &set->slots[set->events[i].data.fd];
+
+			if (slot->stamp == stamp) {
+				for (j = slot->index ;
+				     j != OPAE_EVENT_WAIT_END ;
+				     j = set->next[j])
+					ready[(*num_ready)++] = j;
+				continue;
+			}
+
+			// Ready, but not asked for by this call.
+			epoll_ctl(set->epfd, EPOLL_CTL_DEL,
+				  set->events[i].data.fd, NULL);
+			slot->id = 0;
+		}
+
+		// Only stale descriptors were ready: wait out the rest of
+		// the timeout for the ones that were asked for.
+		if (!*num_ready && count && (timeout > 0)) {
+			int64_t left = deadline - opae_event_wait_now_ms();
+
+			timeout = (left > 0) ? (int)left : 0;
+		}
+	} while (!*num_ready && count && timeout);
+
+	return FPGA_OK;
+}
+
+void opae_event_wait_forget(opae_wrapped_event_handle *we)
+{
+	opae_event_wait_set *set;
+	opae_event_wait_slot *slot;
+
+	if (we->wait_fd < 0)
+		return;
+
+	set = opae_event_wait_get_set(false);
+	if (set && ((uint32_t)we->wait_fd < set->num_slots)) {
+		slot = &set->slots[we->wait_fd];
+		if (slot->id == we->wait_id) {
+			epoll_ctl(set->epfd, EPOLL_CTL_DEL, we->wait_fd, NULL);
+			slot->id = 0;
+		}
+	}
+
+	we->wait_fd = -1;
+}
@@ -0,0 +1,65 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+//
+// Per-thread epoll sets behind fpgaWaitForEvents().
+//
+// The OS object of each event handle is added to the calling thread's
+// set the first time the handle is waited on, and stays there across
+// calls, so a wait costs one epoll_wait() regardless of the number of
+// handles. A descriptor that is ready but was not asked for by the
+// current call is dropped from the set, and re-added when a later call
+// asks for it again. Handles that share a descriptor are all reported
+// when it is ready.
+//
+
+#ifndef __OPAE_EVENT_WAIT_H__
+#define __OPAE_EVENT_WAIT_H__
+
+#include <stdint.h>
+#include <opae/types.h>
+
+#include "opae_int.h"
+
+// Same contract as fpgaWaitForEvents(), with the pointers validated.
+fpga_result opae_event_wait(const fpga_event_handle *event_handles,
+			    uint32_t num_handles,
+			    int timeout,
+			    uint32_t *ready,
+			    uint32_t *num_ready);
+
+// Fetch the OS object of a registered event handle, caching it in the
+// wrapper, along with the id under which it is kept in the wait sets.
+fpga_result opae_event_wait_fd(fpga_event_handle event_handle,
+			       int *fd,
+			       uint64_t *id);
+
+// Remove the event handle from the calling thread's set, ahead of
+// its OS object being closed. Called with we->lock held.
+void opae_event_wait_forget(opae_wrapped_event_handle *we);
+
+#endif // __OPAE_EVENT_WAIT_H__
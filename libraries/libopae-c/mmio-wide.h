@@ -0,0 +1,399 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+//
+// 512 bit MMIO copy kernels shared by the plugins' fpgaWriteMMIO512(),
+// fpgaReadMMIO512(), fpgaCopyToMMIO() and fpgaCopyFromMMIO().
+// opae_mmio_wide_select() picks the widest kernel the host CPU supports:
+//
+//   avx512 - one 64 byte vmovdqu64 per line
+//   avx    - a pair of 32 byte vmovdqu per line
+//   sse2   - four 16 byte accesses per line; writes use non-temporal movntdq
+//
+// SSE2 is part of the x86-64 baseline, so wide MMIO is available on every
+// x86-64 host. Other architectures get no kernel (NULL).
+//
+// Only avx512 writes a line with a single store. The avx and sse2 kernels
+// split it into 2 or 4 stores, and nothing guarantees that they reach the
+// device as one transaction, so their write512 is not atomic with respect
+// to the device.
+//
+// The MMIO side of each kernel must be 64 byte aligned. The memory side
+// may have any alignment. write512 fences its line. copy_to leaves its
+// lines unfenced: opae_mmio_copy_to() fences once, after the last store of
+// the range, so that on a write-combining mapping the whole block is posted
+// before any later store (e.g. a doorbell) that the caller issues.
+//
+
+#ifndef __OPAE_MMIO_WIDE_H__
+#define __OPAE_MMIO_WIDE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct _opae_mmio_wide {
+	const char *name;
+	// Copy a single 64 byte line.
+	void (*write512)(volatile void *mmio, const void *src);
+	void (*read512)(void *dst, const volatile void *mmio);
+	// Copy lines consecutive 64 byte lines. copy_to does not fence.
+	void (*copy_to)(volatile void *mmio, const void *src, size_t lines);
+	void (*copy_from)(void *dst, const volatile void *mmio, size_t lines);
+} opae_mmio_wide;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+static inline void opae_mmio_sfence(void)
+{
+	__asm__ volatile("sfence" : : : "memory");
+}
+
+static inline void opae_mmio_vzeroupper(void)
+{
+	__asm__ volatile("vzeroupper" : : : "memory");
+}
+
+static inline void opae_mmio_store512_avx512(volatile void *mmio,
+					     const void *src)
+{
+	__asm__ volatile("vmovdqu64 (%0), %%zmm0;"
+			 "vmovdqu64 %%zmm0, (%1);"
+			 :
+			 : "r"(src), "r"(mmio)
+			 : "xmm0", "memory");
+}
+
+static inline void opae_mmio_load512_avx512(void *dst,
+					    const volatile void *mmio)
+{
+	__asm__ volatile("vmovdqu64 (%0), %%zmm0;"
+			 "vmovdqu64 %%zmm0, (%1);"
+			 :
+			 : "r"(mmio), "r"(dst)
+			 : "xmm0", "memory");
+}
+
+static inline void opae_mmio_store512_avx(volatile void *mmio,
+					  const void *src)
+{
+	__asm__ volatile("vmovdqu (%0), %%ymm0;"
+			 "vmovdqu 32(%0), %%ymm1;"
+			 "vmovdqu %%ymm0, (%1);"
+			 "vmovdqu %%ymm1, 32(%1);"
+			 :
+			 : "r"(src), "r"(mmio)
+			 : "xmm0", "xmm1", "memory");
+}
+
+static inline void opae_mmio_load512_avx(void *dst,
+					 const volatile void *mmio)
+{
+	__asm__ volatile("vmovdqu (%0), %%ymm0;"
+			 "vmovdqu 32(%0), %%ymm1;"
+			 "vmovdqu %%ymm0, (%1);"
+			 "vmovdqu %%ymm1, 32(%1);"
+			 :
+			 : "r"(mmio), "r"(dst)
+			 : "xmm0", "xmm1", "memory");
+}
+
+// movntdq bypasses the cache and, on a write-combining mapping, lets the
+// four stores leave the core as a single 64 byte burst. That merge is
+// not guaranteed: the device may still see four 16 byte writes.
+static inline void opae_mmio_store512_sse2(volatile void *mmio,
+					   const void *src)
+{
+	__asm__ volatile("movdqu (%0), %%xmm0;"
+			 "movdqu 16(%0), %%xmm1;"
+			 "movdqu 32(%0), %%xmm2;"
+			 "movdqu 48(%0), %%xmm3;"
+			 "movntdq %%xmm0, (%1);"
+			 "movntdq %%xmm1, 16(%1);"
+			 "movntdq %%xmm2, 32(%1);"
+			 "movntdq %%xmm3, 48(%1);"
+			 :
+			 : "r"(src), "r"(mmio)
+			 : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+}
+
+static inline void opae_mmio_load512_sse2(void *dst,
+					  const volatile void *mmio)
+{
+	__asm__ volatile("movdqa (%0), %%xmm0;"
+			 "movdqa 16(%0), %%xmm1;"
+			 "movdqa 32(%0), %%xmm2;"
+			 "movdqa 48(%0), %%xmm3;"
+			 "movdqu %%xmm0, (%1);"
+			 "movdqu %%xmm1, 16(%1);"
+			 "movdqu %%xmm2, 32(%1);"
+			 "movdqu %%xmm3, 48(%1);"
+			 :
+			 : "r"(mmio), "r"(dst)
+			 : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+}
+
+static inline void opae_mmio_write512_avx512(volatile void *mmio,
+					     const void *src)
+{
+	opae_mmio_store512_avx512(mmio, src);
+}
+
+static inline void opae_mmio_write512_avx(volatile void *mmio,
+					  const void *src)
+{
+	opae_mmio_store512_avx(mmio, src);
+	opae_mmio_vzeroupper();
+}
+
+// The sfence makes the non-temporal write visible before the call
+// returns, as the other kernels' writes are.
+static inline void opae_mmio_write512_sse2(volatile void *mmio,
+					   const void *src)
+{
+	opae_mmio_store512_sse2(mmio, src);
+	opae_mmio_sfence();
+}
+
+static inline void opae_mmio_read512_avx512(void *dst,
+					    const volatile void *mmio)
+{
+	opae_mmio_load512_avx512(dst, mmio);
+}
+
+static inline void opae_mmio_read512_avx(void *dst,
+					 const volatile void *mmio)
+{
+	opae_mmio_load512_avx(dst, mmio);
+	opae_mmio_vzeroupper();
+}
+
+static inline void opae_mmio_read512_sse2(void *dst,
+					  const volatile void *mmio)
+{
+	opae_mmio_load512_sse2(dst, mmio);
+}
+
+static inline void opae_mmio_copy_to_avx512(volatile void *mmio,
+					    const void *src, size_t lines)
+{
+	volatile uint8_t *d = (volatile uint8_t *)mmio;
+	const uint8_t *s = (const uint8_t *)src;
+
+	while (lines--) {
+		opae_mmio_store512_avx512(d, s);
+		d += 64;
+		s += 64;
+	}
+}
+
+static inline void opae_mmio_copy_to_avx(volatile void *mmio,
+					 const void *src, size_t lines)
+{
+	volatile uint8_t *d = (volatile uint8_t *)mmio;
+	const uint8_t *s = (const uint8_t *)src;
+
+	while (lines--) {
+		opae_mmio_store512_avx(d, s);
+		d += 64;
+		s += 64;
+	}
+	opae_mmio_vzeroupper();
+}
+
+static inline void opae_mmio_copy_to_sse2(volatile void *mmio,
+					  const void *src, size_t lines)
+{
+	volatile uint8_t *d = (volatile uint8_t *)mmio;
+	const uint8_t *s = (const uint8_t *)src;
+
+	while (lines--) {
+		opae_mmio_store512_sse2(d, s);
+		d += 64;
+		s += 64;
+	}
+}
+
+static inline void opae_mmio_copy_from_avx512(void *dst,
+					      const volatile void *mmio,
+					      size_t lines)
+{
+	const volatile uint8_t *s = (const volatile uint8_t *)mmio;
+	uint8_t *d = (uint8_t *)dst;
+
+	while (lines--) {
+		opae_mmio_load512_avx512(d, s);
+		d += 64;
+		s += 64;
+	}
+}
+
+static inline void opae_mmio_copy_from_avx(void *dst,
+					   const volatile void *mmio,
+					   size_t lines)
+{
+	const volatile uint8_t *s = (const volatile uint8_t *)mmio;
+	uint8_t *d = (uint8_t *)dst;
+
+	while (lines--) {
+		opae_mmio_load512_avx(d, s);
+		d += 64;
+		s += 64;
+	}
+	opae_mmio_vzeroupper();
+}
+
+static inline void opae_mmio_copy_from_sse2(void *dst,
+					    const volatile void *mmio,
+					    size_t lines)
+{
+	const volatile uint8_t *s = (const volatile uint8_t *)mmio;
+	uint8_t *d = (uint8_t *)dst;
+
+	while (lines--) {
+		opae_mmio_load512_sse2(d, s);
+		d += 64;
+		s += 64;
+	}
+}
+
+static const opae_mmio_wide opae_mmio_wide_avx512 = {
+	"avx512",
+	opae_mmio_write512_avx512, opae_mmio_read512_avx512,
+	opae_mmio_copy_to_avx512, opae_mmio_copy_from_avx512
+};
+
+static const opae_mmio_wide opae_mmio_wide_avx = {
+	"avx",
+	opae_mmio_write512_avx, opae_mmio_read512_avx,
+	opae_mmio_copy_to_avx, opae_mmio_copy_from_avx
+};
+
+static const opae_mmio_wide opae_mmio_wide_sse2 = {
+	"sse2",
+	opae_mmio_write512_sse2, opae_mmio_read512_sse2,
+	opae_mmio_copy_to_sse2, opae_mmio_copy_from_sse2
+};
+
+static inline const opae_mmio_wide *opae_mmio_wide_select(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return &opae_mmio_wide_avx512;
+	if (__builtin_cpu_supports("avx"))
+		return &opae_mmio_wide_avx;
+	return &opae_mmio_wide_sse2;
+}
+
+#else
+
+static inline void opae_mmio_sfence(void)
+{
+}
+
+static inline const opae_mmio_wide *opae_mmio_wide_select(void)
+{
+	return NULL;
+}
+
+#endif // x86_64
+
+//
+// Copy len bytes between memory and MMIO. mmio and len must be multiples
+// of 8. The unaligned head and tail of the range are copied 64 bits at a
+// time and the 64 byte aligned body with wide's kernel. When wide is NULL
+// the whole range is copied 64 bits at a time. Writes are fenced after the
+// tail, so that no store of the range is left in a write-combining buffer.
+//
+static inline void opae_mmio_copy_to(const opae_mmio_wide *wide,
+				     volatile uint8_t *mmio,
+				     const uint8_t *src,
+				     size_t len)
+{
+	uint64_t qword;
+	size_t lines;
+
+	while (len && ((uintptr_t)mmio % 64)) {
+		memcpy(&qword, src, sizeof(qword));
+		*((volatile uint64_t *)mmio) = qword;
+		mmio += sizeof(qword);
+		src += sizeof(qword);
+		len -= sizeof(qword);
+	}
+
+	if (wide && (len >= 64)) {
+		lines = len / 64;
+		wide->copy_to(mmio, src, lines);
+		mmio += lines * 64;
+		src += lines * 64;
+		len -= lines * 64;
+	}
+
+	while (len) {
+		memcpy(&qword, src, sizeof(qword));
+		*((volatile uint64_t *)mmio) = qword;
+		mmio += sizeof(qword);
+		src += sizeof(qword);
+		len -= sizeof(qword);
+	}
+
+	opae_mmio_sfence();
+}
+
+static inline void opae_mmio_copy_from(const opae_mmio_wide *wide,
+				       uint8_t *dst,
+				       const volatile uint8_t *mmio,
+				       size_t len)
+{
+	uint64_t qword;
+	size_t lines;
+
+	while (len && ((uintptr_t)mmio % 64)) {
+		qword = *((const volatile uint64_t *)mmio);
+		memcpy(dst, &qword, sizeof(qword));
+		mmio += sizeof(qword);
+		dst += sizeof(qword);
+		len -= sizeof(qword);
+	}
+
+	if (wide && (len >= 64)) {
+		lines = len / 64;
+		wide->copy_from(dst, mmio, lines);
+		mmio += lines * 64;
+		dst += lines * 64;
+		len -= lines * 64;
+	}
+
+	while (len) {
+		qword = *((const volatile uint64_t *)mmio);
+		memcpy(dst, &qword, sizeof(qword));
+		mmio += sizeof(qword);
+		dst += sizeof(qword);
+		len -= sizeof(qword);
+	}
+}
+
+#endif // __OPAE_MMIO_WIDE_H__
@@ -187,6 +187,9 @@ typedef struct _opae_wrapped_event_handle {
 	uint32_t flags;
 	fpga_event_handle opae_event_handle;
 	opae_api_adapter_table *adapter_table;
+	int wait_fd;      // OS object, cached by fpgaWaitForEvents()
+	uint64_t wait_id; // identifies wait_fd in the event wait sets
+	uint64_t spin_ns; // adaptive spin budget of fpgaWaitForCompletion()
 } opae_wrapped_event_handle;
 
 opae_wrapped_event_handle *
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <dlfcn.h>
 #include <sys/types.h>
 #include <dirent.h>
@@ -44,6 +45,7 @@
 #include "opae_int.h"
 #include "mock/opae_std.h"
 #include "cfg-file.h"
+#include "enum-cache.h"
 
 #define OPAE_PLUGIN_CONFIGURE "opae_plugin_configure"
 typedef int (*opae_plugin_configure_t)(opae_api_adapter_table *, const char *);
@@ -114,18 +116,59 @@ STATIC opae_api_adapter_table *opae_plugin_mgr_alloc_adapter(const char *lib_pat
 	return adapter;
 }
 
+// Allocate an adapter for a plugin that is loaded on first use, by
+// opae_plugin_mgr_load_adapter().
+STATIC opae_api_adapter_table *
+opae_plugin_mgr_alloc_deferred_adapter(const char *lib_path,
+				       const char *config)
+{
+	opae_api_adapter_table *adapter;
+
+	adapter = (opae_api_adapter_table *)opae_calloc(
+		1, sizeof(opae_api_adapter_table));
+
+	if (!adapter) {
+		OPAE_ERR("out of memory");
+		return NULL;
+	}
+
+	adapter->plugin.path = opae_strdup(lib_path);
+	if (!adapter->plugin.path) {
+		opae_free(adapter);
+		OPAE_ERR("out of memory");
+		return NULL;
+	}
+
+	if (config) {
+		adapter->deferred_config = opae_strdup(config);
+		if (!adapter->deferred_config) {
+			opae_free(adapter->plugin.path);
+			opae_free(adapter);
+			OPAE_ERR("out of memory");
+			return NULL;
+		}
+	}
+
+	adapter->deferred = true;
+
+	return adapter;
+}
+
 STATIC int opae_plugin_mgr_free_adapter(opae_api_adapter_table *adapter)
 {
-	int res;
+	int res = 0;
 	char *err;
 
-	res = dlclose(adapter->plugin.dl_handle);
+	if (adapter->plugin.dl_handle)
+		res = dlclose(adapter->plugin.dl_handle);
 
 	if (res) {
 		err = dlerror();
 		OPAE_ERR("dlclose failed with %d %s", res, err ? err : "");
 	}
 
+	if (adapter->deferred_config)
+		opae_free(adapter->deferred_config);
 	opae_free(adapter->plugin.path);
 	opae_free(adapter);
 
@@ -149,6 +192,51 @@ STATIC int opae_plugin_mgr_configure_plugin(opae_api_adapter_table *adapter,
 	return cfg(adapter, config);
 }
 
+// Load, configure and initialize a deferred adapter. Called with the
+// adapter list lock held. Returns non-zero if the adapter can't be used.
+STATIC int opae_plugin_mgr_load_adapter(opae_api_adapter_table *adapter)
+{
+	if (adapter->load_failed)
+		return 1;
+
+	if (!adapter->deferred)
+		return 0;
+
+	adapter->plugin.dl_handle =
+		opae_plugin_mgr_find_plugin(adapter->plugin.path);
+
+	if (!adapter->plugin.dl_handle) {
+		char *err = dlerror();
+		OPAE_ERR("failed to load \"%s\" %s",
+			 adapter->plugin.path, err ? err : "");
+		goto out_failed;
+	}
+
+	if (opae_plugin_mgr_configure_plugin(adapter,
+					     adapter->deferred_config)) {
+		OPAE_ERR("failed to configure plugin \"%s\"",
+			 adapter->plugin.path);
+		goto out_close;
+	}
+
+	adapter->deferred = false;
+	opae_free(adapter->deferred_config);
+	adapter->deferred_config = NULL;
+
+	if (adapter->initialize && adapter->initialize())
+		OPAE_MSG("\"%s\" initialize() routine failed",
+			 adapter->plugin.path);
+
+	return 0;
+
+out_close:
+	dlclose(adapter->plugin.dl_handle);
+	adapter->plugin.dl_handle = NULL;
+out_failed:
+	adapter->load_failed = true;
+	return 1;
+}
+
 STATIC int opae_plugin_mgr_initialize_all(void)
 {
 	int res;
@@ -157,6 +245,10 @@ STATIC int opae_plugin_mgr_initialize_all(void)
 
 	for (aptr = adapter_list; aptr; aptr = aptr->next) {
 
+		// Deferred adapters are initialized when loaded.
+		if (aptr->deferred || aptr->load_failed)
+			continue;
+
 		if (aptr->initialize) {
 			res = aptr->initialize();
 			if (res) {
@@ -189,7 +281,7 @@ int opae_plugin_mgr_finalize_all(void)
 	for (aptr = adapter_list; aptr;) {
 		opae_api_adapter_table *trash;
 
-		if (aptr->finalize) {
+		if (aptr->finalize && !aptr->deferred && !aptr->load_failed) {
 			res = aptr->finalize();
 			if (res) {
 				OPAE_MSG("\"%s\" finalize() routine failed",
@@ -229,6 +321,9 @@ STATIC int opae_plugin_mgr_register_adapter(opae_api_adapter_table *adapter)
 
 	adapter->next = NULL;
 
+	// A new adapter may add resources to the enumeration.
+	opae_enum_cache_invalidate();
+
 	if (!adapter_list) {
 		adapter_list = adapter;
 		return 0;
@@ -287,12 +382,245 @@ STATIC void opae_plugin_mgr_detect_platform(opae_pci_device *dev)
 	}
 }
 
+// Read one hex-valued sysfs attribute of the PCI device in base_dir/name.
+STATIC int opae_plugin_mgr_read_pci_attr(const char *base_dir,
+					 const char *name,
+					 const char *attr,
+					 unsigned *value)
+{
+	char file_path[PATH_MAX];
+	FILE *fp;
+
+	if (snprintf(file_path, sizeof(file_path),
+		     "%s/%s/%s", base_dir, name, attr) < 0) {
+		OPAE_ERR("snprintf buffer overflow");
+		return 1;
+	}
+
+	fp = opae_fopen(file_path, "r");
+	if (!fp) {
+		OPAE_ERR("Failed to open %s. Aborting platform detection.", file_path);
+		return 1;
+	}
+
+	if (EOF == fscanf(fp, "%x", value)) {
+		OPAE_ERR("Failed to read %s. Aborting platform detection.", file_path);
+		opae_fclose(fp);
+		return 1;
+	}
+
+	opae_fclose(fp);
+	return 0;
+}
+
+/*
+ * Platform detection reads four sysfs files for every PCI device in the
+ * system. The IDs that were read are memoized in a small file, keyed by
+ * the boot ID and the name and inode of each entry in /sys/bus/pci/devices.
+ * A device that is removed and re-added gets a new sysfs inode, so a
+ * hotplug or rescan changes the key. The config file is applied to the
+ * IDs afresh on each initialization, so it is not part of the key.
+ *
+ * The file is LIBOPAE_PLATFORM_CACHE if set (an empty value or "0"
+ * disables the cache), else $XDG_CACHE_HOME/opae_platforms.cache, else
+ * $HOME/.cache/opae_platforms.cache.
+ */
+#define OPAE_PLATFORM_CACHE_MAGIC "opae-platforms"
+#define OPAE_PLATFORM_CACHE_VERSION 1
+
+typedef struct _opae_platform_cache {
+	uint64_t key;
+	opae_pci_device *devices;
+	uint32_t num_devices;
+	uint32_t capacity;
+} opae_platform_cache;
+
+STATIC uint64_t opae_plugin_mgr_hash(uint64_t h, const void *buf, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	size_t i;
+
+	// FNV-1a
+	for (i = 0 ; i < len ; ++i) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+STATIC int opae_plugin_mgr_platform_cache_path(char *path, size_t len)
+{
+	const char *s = getenv("LIBOPAE_PLATFORM_CACHE");
+	int res;
+
+	if (s) {
+		if (!*s || !strcmp(s, "0"))
+			return 1;
+		res = snprintf(path, len, "%s", s);
+	} else if ((s = getenv("XDG_CACHE_HOME")) && *s) {
+		res = snprintf(path, len, "%s/opae_platforms.cache", s);
+	} else if ((s = getenv("HOME")) && *s) {
+		res = snprintf(path, len, "%s/.cache/opae_platforms.cache", s);
+	} else {
+		return 1;
+	}
+
+	return (res < 0) || ((size_t)res >= len);
+}
+
+STATIC int opae_plugin_mgr_platform_cache_add(opae_platform_cache *cache,
+					      const opae_pci_device *dev)
+{
+	if (cache->num_devices == cache->capacity) {
+		uint32_t capacity = cache->capacity ? 2 * cache->capacity : 64;
+		opae_pci_device *devices = (opae_pci_device *)
+			opae_calloc(capacity, sizeof(opae_pci_device));
+
+		if (!devices)
+			return 1;
+
+		if (cache->devices) {
+			memcpy(devices, cache->devices,
+			       cache->num_devices * sizeof(opae_pci_device));
+			opae_free(cache->devices);
+		}
+
+		cache->devices = devices;
+		cache->capacity = capacity;
+	}
+
+	cache->devices[cache->num_devices] = *dev;
+	cache->devices[cache->num_devices].name = NULL;
+	++cache->num_devices;
+
+	return 0;
+}
+
+// Returns 0 if the file at path holds the IDs for cache->key.
+STATIC int opae_plugin_mgr_platform_cache_load(opae_platform_cache *cache,
+					       const char *path)
+{
+	char magic[32];
+	unsigned version = 0;
+	uint64_t key = 0;
+	unsigned ids[4];
+	FILE *fp;
+	int n;
+	int res = 1;
+
+	fp = opae_fopen(path, "r");
+	if (!fp)
+		return 1;
+
+	if ((fscanf(fp, "%31s %u %" SCNx64, magic, &version, &key) != 3) ||
+	    strcmp(magic, OPAE_PLATFORM_CACHE_MAGIC) ||
+	    (version != OPAE_PLATFORM_CACHE_VERSION) ||
+	    (key != cache->key))
+		goto out_close;
+
+	while ((n = fscanf(fp, "%x %x %x %x",
+			   &ids[0], &ids[1], &ids[2], &ids[3])) == 4) {
+		opae_pci_device dev = {
+			.name = NULL,
+			.vendor_id = (uint16_t)ids[0],
+			.device_id = (uint16_t)ids[1],
+			.subsystem_vendor_id = (uint16_t)ids[2],
+			.subsystem_device_id = (uint16_t)ids[3]
+		};
+
+		if (opae_plugin_mgr_platform_cache_add(cache, &dev))
+			goto out_close;
+	}
+
+	// A partial last line means the file was truncated.
+	res = (n == EOF) ? 0 : 1;
+
+out_close:
+	opae_fclose(fp);
+	return res;
+}
+
+STATIC void opae_plugin_mgr_platform_cache_save(const opae_platform_cache *cache,
+						const char *path)
+{
+	char tmp_path[PATH_MAX];
+	FILE *fp;
+	uint32_t i;
+	int res;
+
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d",
+		     path, (int)getpid()) >= (int)sizeof(tmp_path))
+		return;
+
+	fp = opae_fopen(tmp_path, "w");
+	if (!fp) {
+		OPAE_DBG("can't write platform cache %s", tmp_path);
+		return;
+	}
+
+	res = fprintf(fp, "%s %u %" PRIx64 "\n", OPAE_PLATFORM_CACHE_MAGIC,
+		      OPAE_PLATFORM_CACHE_VERSION, cache->key) < 0;
+
+	for (i = 0 ; !res && (i < cache->num_devices) ; ++i) {
+		const opae_pci_device *dev = &cache->devices[i];
+
+		res = fprintf(fp, "%04x %04x %04x %04x\n",
+			      dev->vendor_id, dev->device_id,
+			      dev->subsystem_vendor_id,
+			      dev->subsystem_device_id) < 0;
+	}
+
+	if (opae_fclose(fp))
+		res = 1;
+
+	// Readers only ever see a complete file.
+	if (res || rename(tmp_path, path))
+		unlink(tmp_path);
+}
+
+STATIC uint64_t opae_plugin_mgr_platform_cache_key(DIR *dir)
+{
+	struct dirent *dirent;
+	char boot_id[64] = { 0, };
+	uint64_t h = 0xcbf29ce484222325ULL;
+	FILE *fp;
+
+	fp = opae_fopen("/proc/sys/kernel/random/boot_id", "r");
+	if (fp) {
+		if (!fgets(boot_id, sizeof(boot_id), fp))
+			boot_id[0] = '\0';
+		opae_fclose(fp);
+	}
+
+	h = opae_plugin_mgr_hash(h, boot_id, strlen(boot_id));
+
+	while ((dirent = readdir(dir)) != NULL) {
+		uint64_t ino = (uint64_t)dirent->d_ino;
+
+		if (!strcmp(dirent->d_name, ".") ||
+		    !strcmp(dirent->d_name, ".."))
+			continue;
+
+		h = opae_plugin_mgr_hash(h, dirent->d_name,
+					 strlen(dirent->d_name) + 1);
+		h = opae_plugin_mgr_hash(h, &ino, sizeof(ino));
+	}
+
+	rewinddir(dir);
+
+	return h;
+}
+
 STATIC int opae_plugin_mgr_detect_platforms(bool with_ase)
 {
 	DIR *dir;
 	char base_dir[PATH_MAX];
-	char file_path[PATH_MAX];
+	char cache_path[PATH_MAX];
+	bool use_cache;
+	opae_platform_cache cache = { 0, NULL, 0, 0 };
 	struct dirent *dirent;
+	uint32_t i;
 	int errors = 0;
 
 	if (with_ase) {
@@ -329,8 +657,20 @@ STATIC int opae_plugin_mgr_detect_platforms(bool with_ase)
 		return 1;
 	}
 
+	use_cache = !opae_plugin_mgr_platform_cache_path(cache_path,
+							 sizeof(cache_path));
+	if (use_cache) {
+		cache.key = opae_plugin_mgr_platform_cache_key(dir);
+
+		if (!opae_plugin_mgr_platform_cache_load(&cache, cache_path)) {
+			OPAE_DBG("using platform cache %s", cache_path);
+			goto out_detect;
+		}
+
+		cache.num_devices = 0;
+	}
+
 	while ((dirent = readdir(dir)) != NULL) {
-		FILE *fp;
 		opae_pci_device dev = { NULL, 0, 0, 0, 0 };
 		unsigned vendor_id = 0;
 		unsigned device_id = 0;
@@ -341,110 +681,20 @@ STATIC int opae_plugin_mgr_detect_platforms(bool with_ase)
 		    !strcmp(dirent->d_name, ".."))
 			continue;
 
-		// Read the 'vendor' file.
-		if (snprintf(file_path, sizeof(file_path),
-			     "%s/%s/vendor",
-			     base_dir,
-			     dirent->d_name) < 0) {
-			OPAE_ERR("snprintf buffer overflow");
-			++errors;
-			goto out_close;
-		}
-
-		fp = opae_fopen(file_path, "r");
-		if (!fp) {
-			OPAE_ERR("Failed to open %s. Aborting platform detection.", file_path);
-			++errors;
-			goto out_close;
-		}
-
-		if (EOF == fscanf(fp, "%x", &vendor_id)) {
-			OPAE_ERR("Failed to read %s. Aborting platform detection.", file_path);
-			opae_fclose(fp);
-			++errors;
-			goto out_close;
-		}
-
-		opae_fclose(fp);
-
-		// Read the 'device' file.
-		if (snprintf(file_path, sizeof(file_path),
-			     "%s/%s/device",
-			     base_dir,
-			     dirent->d_name) < 0) {
-			OPAE_ERR("snprintf buffer overflow");
-			++errors;
-			goto out_close;
-		}
-
-		fp = opae_fopen(file_path, "r");
-		if (!fp) {
-			OPAE_ERR("Failed to open %s. Aborting platform detection.", file_path);
-			++errors;
-			goto out_close;
-		}
-
-		if (EOF == fscanf(fp, "%x", &device_id)) {
-			OPAE_ERR("Failed to read %s. Aborting platform detection.", file_path);
-			opae_fclose(fp);
+		if (opae_plugin_mgr_read_pci_attr(base_dir, dirent->d_name,
+						  "vendor", &vendor_id) ||
+		    opae_plugin_mgr_read_pci_attr(base_dir, dirent->d_name,
+						  "device", &device_id) ||
+		    opae_plugin_mgr_read_pci_attr(base_dir, dirent->d_name,
+						  "subsystem_vendor",
+						  &subsystem_vendor_id) ||
+		    opae_plugin_mgr_read_pci_attr(base_dir, dirent->d_name,
+						  "subsystem_device",
+						  &subsystem_device_id)) {
 			++errors;
 			goto out_close;
 		}
 
-		opae_fclose(fp);
-
-		// Read the 'subsystem_vendor' file.
-		if (snprintf(file_path, sizeof(file_path),
-			     "%s/%s/subsystem_vendor",
-			     base_dir,
-			     dirent->d_name) < 0) {
-			OPAE_ERR("snprintf buffer overflow");
-			++errors;
-			goto out_close;
-		}
-
-		fp = opae_fopen(file_path, "r");
-		if (!fp) {
-			OPAE_ERR("Failed to open %s. Aborting platform detection.", file_path);
-			++errors;
-			goto out_close;
-		}
-
-		if (EOF == fscanf(fp, "%x", &subsystem_vendor_id)) {
-			OPAE_ERR("Failed to read %s. Aborting platform detection.", file_path);
-			opae_fclose(fp);
-			++errors;
-			goto out_close;
-		}
-
-		opae_fclose(fp);
-
-		// Read the 'subsystem_device' file.
-		if (snprintf(file_path, sizeof(file_path),
-			     "%s/%s/subsystem_device",
-			     base_dir,
-			     dirent->d_name) < 0) {
-			OPAE_ERR("snprintf buffer overflow");
-			++errors;
-			goto out_close;
-		}
-
-		fp = opae_fopen(file_path, "r");
-		if (!fp) {
-			OPAE_ERR("Failed to open %s. Aborting platform detection.", file_path);
-			++errors;
-			goto out_close;
-		}
-
-		if (EOF == fscanf(fp, "%x", &subsystem_device_id)) {
-			OPAE_ERR("Failed to read %s. Aborting platform detection.", file_path);
-			opae_fclose(fp);
-			++errors;
-			goto out_close;
-		}
-
-		opae_fclose(fp);
-
 		// Detect platform for this opae_pci_device.
 		dev.vendor_id = (uint16_t)vendor_id;
 		dev.device_id = (uint16_t)device_id;
@@ -452,9 +702,23 @@ STATIC int opae_plugin_mgr_detect_platforms(bool with_ase)
 		dev.subsystem_device_id = (uint16_t)subsystem_device_id;
 
 		opae_plugin_mgr_detect_platform(&dev);
+
+		if (use_cache && opae_plugin_mgr_platform_cache_add(&cache, &dev))
+			use_cache = false;
 	}
 
+	if (use_cache)
+		opae_plugin_mgr_platform_cache_save(&cache, cache_path);
+
+	goto out_close;
+
+out_detect:
+	for (i = 0 ; i < cache.num_devices ; ++i)
+		opae_plugin_mgr_detect_platform(&cache.devices[i]);
+
 out_close:
+	if (cache.devices)
+		opae_free(cache.devices);
 	opae_closedir(dir);
 	return errors;
 }
@@ -500,22 +764,15 @@ STATIC int opae_plugin_mgr_load_plugins(int *platforms_detected)
 		if (already_loaded)
 			continue;
 
-		adapter = opae_plugin_mgr_alloc_adapter(plugin);
+		// The plugin is loaded and configured on first use.
+		adapter = opae_plugin_mgr_alloc_deferred_adapter(plugin,
+			platform_data_table[i].config_json);
 
 		if (!adapter) {
 			OPAE_ERR("calloc failed");
 			return ++errors;
 		}
 
-		res = opae_plugin_mgr_configure_plugin(adapter,
-			platform_data_table[i].config_json);
-		if (res) {
-			opae_plugin_mgr_free_adapter(adapter);
-			OPAE_ERR("failed to configure plugin \"%s\"", plugin);
-			++errors;
-			continue; // Keep going.
-		}
-
 		res = opae_plugin_mgr_register_adapter(adapter);
 		if (res) {
 			// Duplicate adapter detected. Free it and continue.
@@ -607,6 +864,8 @@ int opae_plugin_mgr_for_each_adapter
 	opae_mutex_lock(res, &adapter_list_lock);
 
 	for (aptr = adapter_list; aptr; aptr = aptr->next) {
+		if (opae_plugin_mgr_load_adapter(aptr))
+			continue;
 		cb_res = callback(aptr, context);
 		switch (cb_res) {
 		case FPGA_OK:        // Fall through
@@ -624,6 +883,132 @@ out_unlock:
 	return cb_res;
 }
 
+uint32_t opae_plugin_mgr_num_adapters(void)
+{
+	int res;
+	uint32_t count = 0;
+	opae_api_adapter_table *aptr;
+
+	opae_mutex_lock(res, &adapter_list_lock);
+
+	for (aptr = adapter_list; aptr; aptr = aptr->next)
+		++count;
+
+	opae_mutex_unlock(res, &adapter_list_lock);
+
+	return count;
+}
+
+typedef struct _opae_plugin_mgr_worker {
+	pthread_t thread;
+	uint32_t first;  // first adapter index handled by this worker
+	uint32_t stride; // worker count
+	uint32_t count;  // total adapters
+	opae_api_adapter_table **adapters;
+	void (*callback)(const opae_api_adapter_table *, uint32_t, void *);
+	void *context;
+} opae_plugin_mgr_worker;
+
+STATIC void *opae_plugin_mgr_worker_run(void *arg)
+{
+	opae_plugin_mgr_worker *w = (opae_plugin_mgr_worker *)arg;
+	uint32_t i;
+
+	for (i = w->first ; i < w->count ; i += w->stride)
+		w->callback(w->adapters[i], i, w->context);
+
+	return NULL;
+}
+
+uint32_t opae_plugin_mgr_for_each_adapter_parallel(
+	void (*callback)(const opae_api_adapter_table *, uint32_t, void *),
+	void *context, uint32_t max_adapters)
+{
+	int res;
+	uint32_t count = 0;
+	uint32_t num_workers;
+	uint32_t i;
+	opae_api_adapter_table *aptr;
+	opae_api_adapter_table **adapters = NULL;
+	opae_plugin_mgr_worker workers[OPAE_PLUGIN_MGR_MAX_THREADS];
+	bool started[OPAE_PLUGIN_MGR_MAX_THREADS] = { false, };
+
+	if (!callback) {
+		OPAE_ERR("NULL callback passed to %s()", __func__);
+		return 0;
+	}
+
+	// The list stays locked until every worker has finished, so that
+	// no adapter can be finalized out from under a callback.
+	opae_mutex_lock(res, &adapter_list_lock);
+
+	for (aptr = adapter_list; aptr; aptr = aptr->next)
+		++count;
+
+	if (!count)
+		goto out_unlock;
+
+	adapters = (opae_api_adapter_table **)
+		opae_calloc(count, sizeof(opae_api_adapter_table *));
+	if (!adapters) {
+		OPAE_ERR("out of memory");
+		count = 0;
+		goto out_unlock;
+	}
+
+	// Deferred plugins are loaded here, one at a time, since dlopen()
+	// serializes anyway. Adapters that fail to load are skipped.
+	count = 0;
+	for (aptr = adapter_list; aptr && count < max_adapters;
+	     aptr = aptr->next) {
+		if (!opae_plugin_mgr_load_adapter(aptr))
+			adapters[count++] = aptr;
+	}
+
+	if (count <= 1) {
+		if (count)
+			callback(adapters[0], 0, context);
+		goto out_free;
+	}
+
+	num_workers = count < OPAE_PLUGIN_MGR_MAX_THREADS ?
+		count : OPAE_PLUGIN_MGR_MAX_THREADS;
+
+	for (i = 0 ; i < num_workers ; ++i) {
+		workers[i].first = i;
+		workers[i].stride = num_workers;
+		workers[i].count = count;
+		workers[i].adapters = adapters;
+		workers[i].callback = callback;
+		workers[i].context = context;
+	}
+
+	// Worker 0 runs on the calling thread. If a thread can't be
+	// created, its share of the work is done here as well.
+	for (i = 1 ; i < num_workers ; ++i) {
+		if (!pthread_create(&workers[i].thread, NULL,
+				    opae_plugin_mgr_worker_run, &workers[i]))
+			started[i] = true;
+	}
+
+	opae_plugin_mgr_worker_run(&workers[0]);
+
+	for (i = 1 ; i < num_workers ; ++i) {
+		if (started[i])
+			pthread_join(workers[i].thread, NULL);
+		else
+			opae_plugin_mgr_worker_run(&workers[i]);
+	}
+
+out_free:
+	opae_free(adapters);
+
+out_unlock:
+	opae_mutex_unlock(res, &adapter_list_lock);
+
+	return count;
+}
+
 int opae_plugin_mgr_register_plugin(const char *name, const char *cfg)
 {
 	int res;
@@ -36,9 +36,23 @@ int opae_plugin_mgr_initialize(const char *cfg_file);
 int opae_plugin_mgr_finalize_all(void);
 
 // iteration stops if callback returns non-zero.
+// Plugins whose loading was deferred by opae_plugin_mgr_initialize() are
+// loaded before their callback runs; those that fail to load are skipped.
 #define OPAE_ENUM_STOP 1
 #define OPAE_ENUM_CONTINUE 0
 int opae_plugin_mgr_for_each_adapter(
 	int (*callback)(const opae_api_adapter_table *, void *), void *context);
 
+// number of registered adapters.
+uint32_t opae_plugin_mgr_num_adapters(void);
+
+// Calls callback for each of the first max_adapters usable adapters,
+// concurrently on up to OPAE_PLUGIN_MGR_MAX_THREADS threads. index counts
+// the visited adapters in list order, so that results can be merged in
+// that order. Returns the number of adapters visited.
+#define OPAE_PLUGIN_MGR_MAX_THREADS 8
+uint32_t opae_plugin_mgr_for_each_adapter_parallel(
+	void (*callback)(const opae_api_adapter_table *, uint32_t, void *),
+	void *context, uint32_t max_adapters);
+
 #endif /* __OPAE_PLUGINMGR_H__ */
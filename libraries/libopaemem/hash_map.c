@@ -52,6 +52,184 @@
 fprintf(stderr, "%s:%u:%s() **ERROR** [%s] : " format, \
 	__SHORT_FILE__, __LINE__, __func__, strerror(errno), ##__VA_ARGS__)
 
+#define OPAE_HASH_MAP_SLOT_EMPTY   0
+#define OPAE_HASH_MAP_SLOT_IN_USE  1
+#define OPAE_HASH_MAP_SLOT_DELETED 2
+
+#define OPAE_HASH_MAP_MIN_SLOTS    8
+
+/*
+ * Home slot for key in an open addressing map of num_slots entries.
+ * num_slots is a power of 2.
+ */
+static inline uint32_t opae_hash_map_home(opae_hash_map *hm,
+					  uint32_t num_slots,
+					  void *key)
+{
+	if (hm->key_hash == opae_u64_key_hash) {
+		// Fibonacci hashing: take the high bits of the product,
+		// so that page-aligned keys spread across the table.
+		uint64_t h = (uint64_t)key * 0x9e3779b97f4a7c15ULL;
+		return (uint32_t)(h >> (64 - __builtin_ctz(num_slots)));
+	}
+
+	return hm->key_hash(num_slots, hm->hash_seed, key);
+}
+
+static inline int opae_hash_map_compare(opae_hash_map *hm,
+					void *keya,
+					void *keyb)
+{
+	if (hm->key_compare == opae_u64_key_compare)
+		return opae_u64_key_compare(keya, keyb);
+	return hm->key_compare(keya, keyb);
+}
+
+/*
+ * Move every item into a new array of num_slots entries,
+ * dropping the deleted markers.
+ */
+STATIC fpga_result opae_hash_map_resize(opae_hash_map *hm, uint32_t num_slots)
+{
+	opae_hash_map_slot *slots;
+	uint32_t i;
+
+	slots = (opae_hash_map_slot *)
+		opae_calloc(num_slots, sizeof(opae_hash_map_slot));
+	if (!slots) {
+		ERR("calloc() failed");
+		return FPGA_NO_MEMORY;
+	}
+
+	for (i = 0 ; i < hm->num_buckets ; ++i) {
+		opae_hash_map_slot *from = &hm->slots[i];
+		uint32_t j;
+
+		if (from->state != OPAE_HASH_MAP_SLOT_IN_USE)
+			continue;
+
+		j = opae_hash_map_home(hm, num_slots, from->key);
+		if (j >= num_slots) {
+			ERR("key hash returned %u which is "
+			    "greater or equal num_buckets(%u)\n",
+			    j, num_slots);
+			opae_free(slots);
+			return FPGA_INVALID_PARAM;
+		}
+
+		while (slots[j].state == OPAE_HASH_MAP_SLOT_IN_USE)
+			j = (j + 1) & (num_slots - 1);
+
+		slots[j] = *from;
+	}
+
+	opae_free(hm->slots);
+	hm->slots = slots;
+	hm->num_buckets = num_slots;
+	hm->num_deleted = 0;
+
+	return FPGA_OK;
+}
+
+/*
+ * Find the slot holding key. Returns FPGA_NOT_FOUND and,
+ * if insert is non-NULL, the slot where key should be added.
+ */
+STATIC fpga_result opae_hash_map_probe(opae_hash_map *hm,
+				       void *key,
+				       bool unique,
+				       opae_hash_map_slot **found,
+				       opae_hash_map_slot **insert)
+{
+	const uint32_t mask = hm->num_buckets - 1;
+	opae_hash_map_slot *vacant = NULL;
+	uint32_t i;
+
+	i = opae_hash_map_home(hm, hm->num_buckets, key);
+	if (i >= hm->num_buckets) {
+		ERR("key hash returned %u which is "
+		    "greater or equal num_buckets(%u)\n",
+		    i, hm->num_buckets);
+		return FPGA_INVALID_PARAM;
+	}
+
+	// The load factor is kept below 1, so an empty slot ends the probe.
+	while (1) {
+		opae_hash_map_slot *slot = &hm->slots[i];
+
+		if (slot->state == OPAE_HASH_MAP_SLOT_EMPTY) {
+			if (insert)
+				*insert = vacant ? vacant : slot;
+			return FPGA_NOT_FOUND;
+		}
+
+		if (slot->state == OPAE_HASH_MAP_SLOT_DELETED) {
+			if (!vacant) {
+				vacant = slot;
+				if (unique && insert) {
+					*insert = vacant;
+					return FPGA_NOT_FOUND;
+				}
+			}
+		} else if (!unique &&
+			   !opae_hash_map_compare(hm, key, slot->key)) {
+			*found = slot;
+			return FPGA_OK;
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
+STATIC fpga_result opae_hash_map_oa_add(opae_hash_map *hm,
+					void *key,
+					void *value)
+{
+	opae_hash_map_slot *slot = NULL;
+	opae_hash_map_slot *insert = NULL;
+	fpga_result res;
+
+	// Keep the table at most 3/4 full, counting deleted slots.
+	if ((uint64_t)(hm->num_items + hm->num_deleted + 1) * 4 >
+	    (uint64_t)hm->num_buckets * 3) {
+		uint32_t num_slots = hm->num_buckets;
+
+		if ((uint64_t)(hm->num_items + 1) * 2 > num_slots) {
+			if (num_slots & (1u << 31)) {
+				ERR("hash map is full");
+				return FPGA_NO_MEMORY;
+			}
+			num_slots <<= 1;
+		}
+
+		res = opae_hash_map_resize(hm, num_slots);
+		if (res)
+			return res;
+	}
+
+	res = opae_hash_map_probe(hm, key,
+				  hm->flags & OPAE_HASH_MAP_UNIQUE_KEYSPACE,
+				  &slot, &insert);
+	if (res == FPGA_OK) {
+		// Key collision.
+		if (hm->value_cleanup)
+			hm->value_cleanup(slot->value, hm->cleanup_context);
+		slot->value = value; // Replace value only.
+		return FPGA_OK;
+	} else if (res != FPGA_NOT_FOUND)
+		return res;
+
+	if (insert->state == OPAE_HASH_MAP_SLOT_DELETED)
+		--hm->num_deleted;
+
+	insert->key = key;
+	insert->value = value;
+	insert->state = OPAE_HASH_MAP_SLOT_IN_USE;
+	++hm->num_items;
+
+	return FPGA_OK;
+}
+
 fpga_result opae_hash_map_init(opae_hash_map *hm,
 			       uint32_t num_buckets,
 			       uint32_t hash_seed,
@@ -70,6 +248,22 @@ fpga_result opae_hash_map_init(opae_hash_map *hm,
 
 	memset(hm, 0, sizeof(*hm));
 
+	if (flags & OPAE_HASH_MAP_OPEN_ADDRESSING) {
+		uint32_t num_slots = OPAE_HASH_MAP_MIN_SLOTS;
+
+		while ((num_slots < num_buckets) && !(num_slots & (1u << 31)))
+			num_slots <<= 1;
+
+		hm->slots = (opae_hash_map_slot *)
+			opae_calloc(num_slots, sizeof(opae_hash_map_slot));
+		if (!hm->slots) {
+			ERR("calloc() failed");
+			return FPGA_NO_MEMORY;
+		}
+		num_buckets = num_slots;
+		goto out_init;
+	}
+
 	hm->buckets = (opae_hash_map_item **)
 			opae_calloc(num_buckets,
 				    sizeof(opae_hash_map_item *));
@@ -78,6 +272,7 @@ fpga_result opae_hash_map_init(opae_hash_map *hm,
 		return FPGA_NO_MEMORY;
 	}
 
+out_init:
 	hm->num_buckets = num_buckets;
 	hm->hash_seed = hash_seed;
 	hm->flags = flags;
@@ -117,6 +312,9 @@ fpga_result opae_hash_map_add(opae_hash_map *hm,
 		return FPGA_INVALID_PARAM;
 	}
 
+	if (hm->slots)
+		return opae_hash_map_oa_add(hm, key, value);
+
 	key_hash = hm->key_hash(hm->num_buckets,
 				hm->hash_seed,
 				key);
@@ -191,6 +389,16 @@ fpga_result opae_hash_map_find(opae_hash_map *hm,
 		return FPGA_INVALID_PARAM;
 	}
 
+	if (hm->slots) {
+		opae_hash_map_slot *slot = NULL;
+		fpga_result res;
+
+		res = opae_hash_map_probe(hm, key, false, &slot, NULL);
+		if (!res && value)
+			*value = slot->value;
+		return res;
+	}
+
 	key_hash = hm->key_hash(hm->num_buckets,
 				hm->hash_seed,
 				key);
@@ -235,6 +443,26 @@ fpga_result opae_hash_map_remove(opae_hash_map *hm,
 		return FPGA_INVALID_PARAM;
 	}
 
+	if (hm->slots) {
+		opae_hash_map_slot *slot = NULL;
+		fpga_result res;
+
+		res = opae_hash_map_probe(hm, key, false, &slot, NULL);
+		if (res)
+			return res;
+
+		slot->state = OPAE_HASH_MAP_SLOT_DELETED;
+		--hm->num_items;
+		++hm->num_deleted;
+
+		if (hm->key_cleanup)
+			hm->key_cleanup(slot->key, hm->cleanup_context);
+		if (hm->value_cleanup)
+			hm->value_cleanup(slot->value, hm->cleanup_context);
+
+		return FPGA_OK;
+	}
+
 	key_hash = hm->key_hash(hm->num_buckets,
 				hm->hash_seed,
 				key);
@@ -292,6 +520,24 @@ fpga_result opae_hash_map_destroy(opae_hash_map *hm)
 		return FPGA_INVALID_PARAM;
 	}
 
+	if (hm->slots) {
+		for (i = 0 ; i < hm->num_buckets ; ++i) {
+			opae_hash_map_slot *slot = &hm->slots[i];
+
+			if (slot->state != OPAE_HASH_MAP_SLOT_IN_USE)
+				continue;
+			if (hm->key_cleanup)
+				hm->key_cleanup(slot->key, hm->cleanup_context);
+			if (hm->value_cleanup)
+				hm->value_cleanup(slot->value, hm->cleanup_context);
+		}
+
+		opae_free(hm->slots);
+		memset(hm, 0, sizeof(*hm));
+
+		return FPGA_OK;
+	}
+
 	for (i = 0 ; i < hm->num_buckets ; ++i) {
 		opae_hash_map_item *item;
 		item = hm->buckets[i];
@@ -317,6 +563,9 @@ bool opae_hash_map_is_empty(opae_hash_map *hm)
 {
 	uint32_t i;
 
+	if (hm->slots)
+		return !hm->num_items;
+
 	for (i = 0 ; i < hm->num_buckets ; ++i) {
 		if (hm->buckets[i])
 			return false;
@@ -55,14 +55,15 @@ fprintf(stderr, "%s:%u:%s() **ERROR** [%s] : " format, \
 
 #define ALIGNED(__addr, __size) ((__addr + __size - 1) & ~(__size - 1))
 
+// The number of ranges examined in a size bin whose ranges may be too
+// small once the allocation is aligned, before moving on to a larger bin.
+#define MEM_ALLOC_BIN_SCAN 32
+
 void mem_alloc_init(struct mem_alloc *m)
 {
-	m->free.address = 0;
-	m->free.size = 0;
+	memset(m, 0, sizeof(*m));
 	m->free.prev = &m->free;
 	m->free.next = &m->free;
-	m->allocated.address = 0;
-	m->allocated.size = 0;
 	m->allocated.prev = &m->allocated;
 	m->allocated.next = &m->allocated;
 }
@@ -96,6 +97,11 @@ STATIC struct mem_link *mem_link_alloc(uint64_t address, uint64_t size)
 		m->size = size;
 		m->prev = m;
 		m->next = m;
+		m->left = NULL;
+		m->right = NULL;
+		m->bin_prev = NULL;
+		m->bin_next = NULL;
+		m->height = 1;
 	}
 	return m;
 }
@@ -122,39 +128,281 @@ static inline void link_unlink(struct mem_link *x)
 	x->prev->next = x->next;
 }
 
-STATIC void mem_alloc_coalesce(struct mem_link *head,
+// Address-keyed AVL tree. Keys are unique within a tree. A node's address
+// may be changed in place, provided that its order relative to the other
+// nodes in the tree is unchanged.
+
+static inline int tree_height(const struct mem_link *n)
+{
+	return n ? n->height : 0;
+}
+
+static inline void tree_update(struct mem_link *n)
+{
+	int l = tree_height(n->left);
+	int r = tree_height(n->right);
+
+	n->height = 1 + (l > r ? l : r);
+}
+
+static struct mem_link *tree_rotate_right(struct mem_link *n)
+{
+	struct mem_link *l = n->left;
+
+	n->left = l->right;
+	l->right = n;
+	tree_update(n);
+	tree_update(l);
+
+	return l;
+}
+
+static struct mem_link *tree_rotate_left(struct mem_link *n)
+{
+	struct mem_link *r = n->right;
+
+	n->right = r->left;
+	r->left = n;
+	tree_update(n);
+	tree_update(r);
+
+	return r;
+}
+
+static struct mem_link *tree_balance(struct mem_link *n)
+{
+	int balance;
+
+	tree_update(n);
+	balance = tree_height(n->left) - tree_height(n->right);
+
+	if (balance > 1) {
+		if (tree_height(n->left->left) < tree_height(n->left->right))
+			n->left = tree_rotate_left(n->left);
+		return tree_rotate_right(n);
+	}
+
+	if (balance < -1) {
+		if (tree_height(n->right->right) < tree_height(n->right->left))
+			n->right = tree_rotate_right(n->right);
+		return tree_rotate_left(n);
+	}
+
+	return n;
+}
+
+STATIC struct mem_link *mem_tree_insert(struct mem_link *root,
+					struct mem_link *node)
+{
+	if (!root) {
+		node->left = NULL;
+		node->right = NULL;
+		node->height = 1;
+		return node;
+	}
+
+	if (node->address < root->address)
+		root->left = mem_tree_insert(root->left, node);
+	else
+		root->right = mem_tree_insert(root->right, node);
+
+	return tree_balance(root);
+}
+
+static struct mem_link *tree_remove_min(struct mem_link *n,
+					struct mem_link **min)
+{
+	if (!n->left) {
+		*min = n;
+		return n->right;
+	}
+
+	n->left = tree_remove_min(n->left, min);
+	return tree_balance(n);
+}
+
+STATIC struct mem_link *mem_tree_remove(struct mem_link *root,
+					struct mem_link *node)
+{
+	struct mem_link *min = NULL;
+	struct mem_link *right;
+
+	if (!root)
+		return NULL;
+
+	if (node->address < root->address) {
+		root->left = mem_tree_remove(root->left, node);
+	} else if (node->address > root->address) {
+		root->right = mem_tree_remove(root->right, node);
+	} else {
+		if (!root->right)
+			return root->left;
+
+		right = tree_remove_min(root->right, &min);
+		min->left = root->left;
+		min->right = right;
+		return tree_balance(min);
+	}
+
+	return tree_balance(root);
+}
+
+STATIC struct mem_link *mem_tree_find(struct mem_link *root,
+				      uint64_t address)
+{
+	while (root) {
+		if (address == root->address)
+			return root;
+		root = (address < root->address) ? root->left : root->right;
+	}
+	return NULL;
+}
+
+// Find the node with the greatest address that is <= address.
+STATIC struct mem_link *mem_tree_floor(struct mem_link *root,
+				       uint64_t address)
+{
+	struct mem_link *floor = NULL;
+
+	while (root) {
+		if (address == root->address)
+			return root;
+		if (address < root->address) {
+			root = root->left;
+		} else {
+			floor = root;
+			root = root->right;
+		}
+	}
+	return floor;
+}
+
+// Free ranges are binned by floor(log2(size)).
+
+static inline unsigned bin_index(uint64_t size)
+{
+	return size ? 63 - __builtin_clzll(size) : 0;
+}
+
+static void bin_insert(struct mem_alloc *m, struct mem_link *node)
+{
+	unsigned bin = bin_index(node->size);
+
+	node->bin_prev = NULL;
+	node->bin_next = m->free_bins[bin];
+	if (node->bin_next)
+		node->bin_next->bin_prev = node;
+	m->free_bins[bin] = node;
+	m->bins_mask |= UINT64_C(1) << bin;
+}
+
+static void bin_remove(struct mem_alloc *m, struct mem_link *node)
+{
+	unsigned bin = bin_index(node->size);
+
+	if (node->bin_prev)
+		node->bin_prev->bin_next = node->bin_next;
+	else
+		m->free_bins[bin] = node->bin_next;
+
+	if (node->bin_next)
+		node->bin_next->bin_prev = node->bin_prev;
+
+	if (!m->free_bins[bin])
+		m->bins_mask &= ~(UINT64_C(1) << bin);
+
+	node->bin_prev = NULL;
+	node->bin_next = NULL;
+}
+
+static void free_insert_after(struct mem_alloc *m,
+			      struct mem_link *node,
+			      struct mem_link *pos)
+{
+	link_after(node, pos);
+	m->free_root = mem_tree_insert(m->free_root, node);
+	bin_insert(m, node);
+}
+
+static void free_remove(struct mem_alloc *m, struct mem_link *node)
+{
+	bin_remove(m, node);
+	m->free_root = mem_tree_remove(m->free_root, node);
+	link_unlink(node);
+}
+
+// Move/resize a free range without changing its address order.
+static void free_resize(struct mem_alloc *m,
+			struct mem_link *node,
+			uint64_t address,
+			uint64_t size)
+{
+	bin_remove(m, node);
+	node->address = address;
+	node->size = size;
+	bin_insert(m, node);
+}
+
+static void allocated_insert(struct mem_alloc *m, struct mem_link *node)
+{
+	link_before(node, &m->allocated);
+	m->allocated_root = mem_tree_insert(m->allocated_root, node);
+}
+
+static void allocated_remove(struct mem_alloc *m, struct mem_link *node)
+{
+	m->allocated_root = mem_tree_remove(m->allocated_root, node);
+	link_unlink(node);
+}
+
+// Merge the free range l with its address-order neighbors.
+STATIC void mem_alloc_coalesce(struct mem_alloc *m,
 			       struct mem_link *l)
 {
 	struct mem_link *prev = l->prev;
 	struct mem_link *next = l->next;
 
-	if (prev == head && next == head)
-		return;
-
-	if (prev != head) {
+	if (prev != &m->free) {
 		if (prev->address + prev->size == l->address) {
-			l->address = prev->address;
-			l->size += prev->size;
-			link_unlink(prev);
-			opae_free(prev);
+			free_remove(m, l);
+			free_resize(m, prev, prev->address, prev->size + l->size);
+			opae_free(l);
+			l = prev;
 		}
 	}
 
-	next = l->next;
-	if (next != head) {
+	if (next != &m->free) {
 		if (l->address + l->size == next->address) {
-			next->address = l->address;
-			next->size += l->size;
-			link_unlink(l);
-			opae_free(l);
+			free_remove(m, next);
+			free_resize(m, l, l->address, l->size + next->size);
+			opae_free(next);
 		}
 	}
 }
 
+// Insert node into the free ranges, taking ownership of node.
+STATIC int mem_alloc_insert_free(struct mem_alloc *m,
+				 struct mem_link *node)
+{
+	struct mem_link *prev;
+
+	prev = mem_tree_floor(m->free_root, node->address);
+	if (prev && (prev->address == node->address)) {
+		// double free
+		ERR("double free detected 0x%lx\n", node->address);
+		opae_free(node);
+		return 2;
+	}
+
+	free_insert_after(m, node, prev ? prev : &m->free);
+	mem_alloc_coalesce(m, node);
+
+	return 0;
+}
+
 int mem_alloc_add_free(struct mem_alloc *m, uint64_t address, uint64_t size)
 {
 	struct mem_link *node;
-	struct mem_link *p;
 
 	node = mem_link_alloc(address, size);
 	if (!node) {
@@ -162,31 +410,7 @@ int mem_alloc_add_free(struct mem_alloc *m, uint64_t address, uint64_t size)
 		return 1;
 	}
 
-	for (p = m->free.next ; p != &m->free ; p = p->next) {
-		if (address < p->address) {
-			link_before(node, p);
-			mem_alloc_coalesce(&m->free, node);
-			return 0;
-		} else if (address == p->address) {
-			// double free
-			opae_free(node);
-			ERR("double free detected 0x%lx\n", address);
-			return 2;
-		} else {
-			// address > p->address
-			break;
-		}
-
-	}
-
-	while ((address > p->address) && (p != &m->free)) {
-		p = p->next;
-	}
-
-	link_before(node, p);
-	mem_alloc_coalesce(&m->free, node);
-
-	return 0;
+	return mem_alloc_insert_free(m, node);
 }
 
 STATIC int mem_alloc_allocate_node(struct mem_alloc *m,
@@ -198,8 +422,8 @@ STATIC int mem_alloc_allocate_node(struct mem_alloc *m,
 
 	if (node->size == size) {
 		// If we have an exact fit, recycle the node struct.
-		link_unlink(node);
-		link_before(node, &m->allocated);
+		free_remove(m, node);
+		allocated_insert(m, node);
 		*address = node->address;
 		return 0;
 	}
@@ -212,10 +436,9 @@ STATIC int mem_alloc_allocate_node(struct mem_alloc *m,
 		return 1;
 	}
 
-	node->address += size;
-	node->size -= size;
+	free_resize(m, node, node->address + size, node->size - size);
 
-	link_before(p, &m->allocated);
+	allocated_insert(m, p);
 	*address = p->address;
 
 	return 0;
@@ -241,10 +464,10 @@ STATIC int mem_alloc_allocate_split_node(struct mem_alloc *m,
 			return 1;
 		}
 
-		link_before(p, &m->allocated);
+		allocated_insert(m, p);
 		*address = p->address;
 
-		node->size -= size;
+		free_resize(m, node, node->address, node->size - size);
 
 		return 0;
 	}
@@ -273,66 +496,127 @@ STATIC int mem_alloc_allocate_split_node(struct mem_alloc *m,
 		return 3;
 	}
 
-	node->size = first_size;
+	free_resize(m, node, node->address, first_size);
 
-	link_before(p, &m->allocated);
+	allocated_insert(m, p);
 	*address = p->address;
 
-	link_after(p2, node);
+	free_insert_after(m, p2, node);
 
 	return 0;
 }
 
-int mem_alloc_get(struct mem_alloc *m, uint64_t *address, uint64_t size)
+// Return the smallest range in bin that can hold an aligned block of size
+// bytes, examining at most limit ranges (0 for no limit).
+static struct mem_link *mem_alloc_scan_bin(struct mem_alloc *m,
+					   unsigned bin,
+					   uint64_t size,
+					   uint32_t limit)
 {
 	struct mem_link *p;
+	struct mem_link *best = NULL;
+	uint32_t n = 0;
 
-	for (p = m->free.next ; p != &m->free ; p = p->next) {
+	for (p = m->free_bins[bin] ;
+	     p && (!limit || (n < limit)) ;
+	     p = p->bin_next, ++n) {
 		uint64_t aligned_addr = ALIGNED(p->address, size);
-		if ((aligned_addr + size) <= (p->address + p->size)) { // First fit.
-			if (aligned_addr == p->address)
-				return mem_alloc_allocate_node(m,
-							       p,
-							       address,
-							       size);
-			else
-				return mem_alloc_allocate_split_node(m,
-								     p,
-								     aligned_addr,
-								     address,
-								     size);
+
+		if ((aligned_addr + size) > (p->address + p->size))
+			continue;
+
+		if (!best || (p->size < best->size)) {
+			best = p;
+			if (p->size == size)
+				break; // Can't do better.
 		}
 	}
 
-	ERR("no free block of sufficient size found\n");
-	return 1; // Out of memory.
+	return best;
 }
 
-STATIC int mem_alloc_free_node(struct mem_alloc *m,
-			       struct mem_link *node)
+STATIC struct mem_link *mem_alloc_find_fit(struct mem_alloc *m,
+					   uint64_t size)
 {
-	uint64_t address;
-	uint64_t size;
+	unsigned lo = bin_index(size);
+	unsigned hi = lo + ((size & (size - 1)) ? 1 : 0);
+	unsigned bin;
+	uint64_t mask = 0;
+	struct mem_link *p;
 
-	address = node->address;
-	size = node->size;
+	if (hi >= MEM_ALLOC_BINS)
+		hi = MEM_ALLOC_BINS - 1;
 
-	link_unlink(node);
-	opae_free(node);
+	// Ranges in bins lo..hi are shorter than 2 * size, so they may not
+	// hold an aligned block. Prefer the smallest one that does.
+	for (bin = lo ; bin <= hi ; ++bin) {
+		p = mem_alloc_scan_bin(m, bin, size, MEM_ALLOC_BIN_SCAN);
+		if (p)
+			return p;
+	}
+
+	// Any range in a higher bin fits: take one from the lowest such bin.
+	if (hi + 1 < MEM_ALLOC_BINS)
+		mask = m->bins_mask & (~UINT64_C(0) << (hi + 1));
+	if (mask)
+		return m->free_bins[__builtin_ctzll(mask)];
+
+	// Only short ranges remain. Examine all of them.
+	for (bin = lo ; bin <= hi ; ++bin) {
+		p = mem_alloc_scan_bin(m, bin, size, 0);
+		if (p)
+			return p;
+	}
 
-	return mem_alloc_add_free(m, address, size);
+	return NULL;
 }
 
-int mem_alloc_put(struct mem_alloc *m, uint64_t address)
+int mem_alloc_get(struct mem_alloc *m, uint64_t *address, uint64_t size)
 {
 	struct mem_link *p;
+	uint64_t aligned_addr;
 
-	for (p = m->allocated.next ; p != &m->allocated ; p = p->next) {
-		if (address == p->address) {
-			return mem_alloc_free_node(m, p);
-		}
+	if (!size) {
+		ERR("zero-sized allocation\n");
+		return 1;
 	}
 
+	p = mem_alloc_find_fit(m, size);
+	if (!p) {
+		ERR("no free block of sufficient size found\n");
+		return 1; // Out of memory.
+	}
+
+	aligned_addr = ALIGNED(p->address, size);
+	if (aligned_addr == p->address)
+		return mem_alloc_allocate_node(m,
+					       p,
+					       address,
+					       size);
+
+	return mem_alloc_allocate_split_node(m,
+					     p,
+					     aligned_addr,
+					     address,
+					     size);
+}
+
+STATIC int mem_alloc_free_node(struct mem_alloc *m,
+			       struct mem_link *node)
+{
+	// Recycle the allocated node as the new free range.
+	allocated_remove(m, node);
+	return mem_alloc_insert_free(m, node);
+}
+
+int mem_alloc_put(struct mem_alloc *m, uint64_t address)
+{
+	struct mem_link *p;
+
+	p = mem_tree_find(m->allocated_root, address);
+	if (p)
+		return mem_alloc_free_node(m, p);
+
 	ERR("attempt to free non-allocated 0x%lx\n", address);
 	return 1; // Address not found.
 }
@@ -345,25 +629,29 @@ STATIC int mem_alloc_drop_free_region(struct mem_alloc *m,
 	struct mem_link *p;
 	struct mem_link *p_next;
 
-	p_next = &m->free;
-	for (p = m->free.next ; p != &m->free ; p = p_next) {
+	// Start from the last range that begins at or before addr_start.
+	p = mem_tree_floor(m->free_root, addr_start);
+	if (!p)
+		p = m->free.next;
+
+	for ( ; (p != &m->free) && (p->address < addr_end) ; p = p_next) {
 		uint64_t p_end = p->address + p->size;
 		p_next = p->next;
 		if ((addr_start < p_end) && (addr_end > p->address)) {
 			printf("Conflict with 0x%lx - 0x%lx\n", p->address, p_end);
 			if ((addr_start <= p->address) && (addr_end >= p_end)) {
 				// Drop the whole range of p
-				link_unlink(p);
+				free_remove(m, p);
 				opae_free(p);
 			} else if (addr_start <= p->address) {
 				// Reduce free range so it starts at addr_end
 				// (the end of the range being removed).
-				p->address = addr_end;
-				p->size = p_end - addr_end;
+				free_resize(m, p, addr_end, p_end - addr_end);
 			} else if (addr_end >= p_end) {
 				// Reduce free range so it ends at addr_start
 				// (the start of the range being removed).
-				p->size = addr_start - p->address;
+				free_resize(m, p, p->address,
+					    addr_start - p->address);
 			} else {
 				// The remaining case: the range to drop is
 				// inside p, after the start of p and before
@@ -374,8 +662,9 @@ STATIC int mem_alloc_drop_free_region(struct mem_alloc *m,
 					return 1;
 				}
 
-				p->size = addr_start - p->address;
-				link_after(p_next, p);
+				free_resize(m, p, p->address,
+					    addr_start - p->address);
+				free_insert_after(m, p_next, p);
 			}
 		}
 	}
@@ -0,0 +1,114 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <opae/mem_bind.h>
+#include "mock/opae_std.h"
+
+#define NODE_POSSIBLE "/sys/devices/system/node/possible"
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_MF_STRICT
+#define MPOL_MF_STRICT (1 << 0)
+#endif
+
+#define MEM_BIND_BITS (8 * sizeof(unsigned long))
+
+/*
+ * The node list (eg "0-3") is in ascending order, so its last number is
+ * the highest node.
+ */
+int mem_bind_num_nodes(void)
+{
+	char buf[256];
+	char *p;
+	char *endptr;
+	FILE *fp;
+	unsigned long highest = 0;
+	bool found = false;
+
+	fp = opae_fopen(NODE_POSSIBLE, "r");
+	if (!fp)
+		return 1;
+
+	p = fgets(buf, sizeof(buf), fp);
+	opae_fclose(fp);
+	if (!p)
+		return 1;
+
+	while (*p && (*p != '\n')) {
+		highest = strtoul(p, &endptr, 10);
+		if (endptr == p)
+			return 1;
+		found = true;
+		p = endptr;
+		if ((*p == '-') || (*p == ','))
+			++p;
+	}
+
+	if (!found)
+		return 1;
+
+	if (highest >= MEM_BIND_MAX_NODES)
+		return MEM_BIND_MAX_NODES;
+
+	return (int)highest + 1;
+}
+
+int mem_bind_node_valid(int numa_node)
+{
+	return (numa_node >= 0) && (numa_node < mem_bind_num_nodes());
+}
+
+int mem_bind(void *addr, uint64_t len, int numa_node)
+{
+	unsigned long mask[MEM_BIND_MAX_NODES / MEM_BIND_BITS];
+
+	if (!mem_bind_node_valid(numa_node)) {
+		errno = EINVAL;
+		return 1;
+	}
+
+	memset(mask, 0, sizeof(mask));
+	mask[numa_node / MEM_BIND_BITS] |= 1UL << (numa_node % MEM_BIND_BITS);
+
+	// maxnode counts one past the highest node bit examined.
+	return syscall(__NR_mbind, addr, len, MPOL_BIND, mask,
+		       MEM_BIND_MAX_NODES + 1, MPOL_MF_STRICT) ? 1 : 0;
+}
@@ -0,0 +1,247 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif // _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <opae/mem_prefault.h>
+#include "mock/opae_std.h"
+
+#define __SHORT_FILE__                                    \
+({                                                        \
+	const char *file = __FILE__;                      \
+	const char *p = file;                             \
+	while (*p)                                        \
+		++p;                                      \
+	while ((p > file) && ('/' != *p) && ('\\' != *p)) \
+		--p;                                      \
+	if (p > file)                                     \
+		++p;                                      \
+	p;                                                \
+})
+
+#define ERR(format, ...)                               \
+fprintf(stderr, "%s:%u:%s() **ERROR** [%s] : " format, \
+	__SHORT_FILE__, __LINE__, __func__, strerror(errno), ##__VA_ARGS__)
+
+#define NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+
+struct mem_prefault_range {
+	volatile uint8_t *addr;
+	uint64_t pages;
+	uint64_t page_size;
+};
+
+/*
+ * Parse a node's cpulist (eg "0-3,8-11") into *cpus.
+ */
+STATIC int mem_prefault_node_cpus(int numa_node, cpu_set_t *cpus)
+{
+	char path[64];
+	char buf[1024];
+	char *p;
+	char *endptr;
+	FILE *fp;
+	unsigned long first;
+	unsigned long last;
+
+	snprintf(path, sizeof(path), NODE_CPULIST, numa_node);
+
+	fp = opae_fopen(path, "r");
+	if (!fp)
+		return 1;
+
+	p = fgets(buf, sizeof(buf), fp);
+	opae_fclose(fp);
+	if (!p)
+		return 2;
+
+	CPU_ZERO(cpus);
+
+	while (*p && (*p != '\n')) {
+		first = strtoul(p, &endptr, 10);
+		if (endptr == p)
+			return 3;
+		last = first;
+		p = endptr;
+
+		if (*p == '-') {
+			++p;
+			last = strtoul(p, &endptr, 10);
+			if ((endptr == p) || (last < first))
+				return 3;
+			p = endptr;
+		}
+
+		for ( ; (first <= last) && (first < CPU_SETSIZE) ; ++first)
+			CPU_SET(first, cpus);
+
+		if (*p == ',')
+			++p;
+	}
+
+	return CPU_COUNT(cpus) ? 0 : 4;
+}
+
+/*
+ * The CPUs that run the workers: those of numa_node, or those allowed
+ * for the calling thread when there is no node or its CPUs are unknown.
+ */
+STATIC int mem_prefault_cpus(int numa_node, cpu_set_t *cpus)
+{
+	if ((numa_node >= 0) && !mem_prefault_node_cpus(numa_node, cpus))
+		return 0;
+
+	CPU_ZERO(cpus);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(*cpus), cpus))
+		return 1;
+
+	return CPU_COUNT(cpus) ? 0 : 2;
+}
+
+STATIC uint32_t mem_prefault_count(uint64_t len, uint64_t page_size,
+				   const cpu_set_t *cpus)
+{
+	uint64_t n = len / page_size;
+	uint64_t max_chunks = len / MEM_PREFAULT_MIN_CHUNK;
+
+	if (n > max_chunks)
+		n = max_chunks;
+	if (n > MEM_PREFAULT_MAX_THREADS)
+		n = MEM_PREFAULT_MAX_THREADS;
+	if (cpus && (n > (uint64_t)CPU_COUNT(cpus)))
+		n = CPU_COUNT(cpus);
+
+	return n ? (uint32_t)n : 1;
+}
+
+uint32_t mem_prefault_threads(uint64_t len, uint64_t page_size,
+			      int numa_node)
+{
+	cpu_set_t cpus;
+
+	if (!page_size)
+		return 1;
+
+	if (mem_prefault_cpus(numa_node, &cpus))
+		return mem_prefault_count(len, page_size, NULL);
+
+	return mem_prefault_count(len, page_size, &cpus);
+}
+
+STATIC void *mem_prefault_worker(void *arg)
+{
+	struct mem_prefault_range *r = (struct mem_prefault_range *)arg;
+	volatile uint8_t *p = r->addr;
+	uint64_t i;
+
+	for (i = 0 ; i < r->pages ; ++i) {
+		*p = 0;
+		p += r->page_size;
+	}
+
+	return NULL;
+}
+
+int mem_prefault(void *addr, uint64_t len, uint64_t page_size,
+		 int numa_node)
+{
+	struct mem_prefault_range ranges[MEM_PREFAULT_MAX_THREADS];
+	pthread_t threads[MEM_PREFAULT_MAX_THREADS];
+	int started[MEM_PREFAULT_MAX_THREADS];
+	pthread_attr_t attr;
+	cpu_set_t cpus;
+	int have_cpus;
+	uint64_t pages;
+	uint64_t first;
+	uint32_t n;
+	uint32_t i;
+
+	if (!addr || !page_size || (len % page_size)) {
+		ERR("invalid param\n");
+		return 1;
+	}
+
+	pages = len / page_size;
+	have_cpus = !mem_prefault_cpus(numa_node, &cpus);
+	n = mem_prefault_count(len, page_size, have_cpus ? &cpus : NULL);
+
+	for (i = 0, first = 0 ; i < n ; ++i) {
+		ranges[i].addr = (uint8_t *)addr + first * page_size;
+		ranges[i].pages = pages / n + ((i < pages % n) ? 1 : 0);
+		ranges[i].page_size = page_size;
+		first += ranges[i].pages;
+	}
+
+	if (n == 1) {
+		mem_prefault_worker(&ranges[0]);
+		return 0;
+	}
+
+	if (pthread_attr_init(&attr)) {
+		ERR("pthread_attr_init() failed\n");
+		return 2;
+	}
+
+	// The workers may run on any CPU of the set. Pinning to
+	// the node's CPUs keeps page zeroing local to the memory.
+	if (have_cpus &&
+	    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus))
+		ERR("pthread_attr_setaffinity_np() failed\n");
+
+	for (i = 0 ; i < n ; ++i)
+		started[i] = !pthread_create(&threads[i], &attr,
+					     mem_prefault_worker, &ranges[i]);
+
+	pthread_attr_destroy(&attr);
+
+	// Populate the ranges of any workers that failed to start.
+	for (i = 0 ; i < n ; ++i) {
+		if (!started[i])
+			mem_prefault_worker(&ranges[i]);
+	}
+
+	for (i = 0 ; i < n ; ++i) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+	}
+
+	return 0;
+}
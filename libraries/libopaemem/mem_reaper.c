@@ -0,0 +1,290 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <opae/mem_reaper.h>
+#include "mock/opae_std.h"
+
+#define __SHORT_FILE__                                    \
+({                                                        \
+	const char *file = __FILE__;                      \
+	const char *p = file;                             \
+	while (*p)                                        \
+		++p;                                      \
+	while ((p > file) && ('/' != *p) && ('\\' != *p)) \
+		--p;                                      \
+	if (p > file)                                     \
+		++p;                                      \
+	p;                                                \
+})
+
+#define ERR(format, ...)                               \
+fprintf(stderr, "%s:%u:%s() **ERROR** [%s] : " format, \
+	__SHORT_FILE__, __LINE__, __func__, strerror(errno), ##__VA_ARGS__)
+
+int mem_reaper_init(struct mem_reaper *r,
+		    mem_reaper_fn reap,
+		    void *context)
+{
+	if (!r || !reap) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	memset(r, 0, sizeof(*r));
+
+	if (pthread_mutex_init(&r->lock, NULL)) {
+		ERR("pthread_mutex_init() failed\n");
+		return 2;
+	}
+
+	if (pthread_cond_init(&r->wake, NULL)) {
+		ERR("pthread_cond_init() failed\n");
+		goto out_destroy_lock;
+	}
+
+	if (pthread_cond_init(&r->idle, NULL)) {
+		ERR("pthread_cond_init() failed\n");
+		goto out_destroy_wake;
+	}
+
+	r->reap = reap;
+	r->context = context;
+
+	return 0;
+
+out_destroy_wake:
+	pthread_cond_destroy(&r->wake);
+out_destroy_lock:
+	pthread_mutex_destroy(&r->lock);
+	return 3;
+}
+
+/*
+ * Merge sort a list of entries by ascending iova.
+ */
+STATIC struct mem_reaper_entry *
+mem_reaper_sort(struct mem_reaper_entry *list)
+{
+	struct mem_reaper_entry *slow;
+	struct mem_reaper_entry *fast;
+	struct mem_reaper_entry *right;
+	struct mem_reaper_entry head;
+	struct mem_reaper_entry *tail = &head;
+
+	if (!list || !list->next)
+		return list;
+
+	slow = list;
+	fast = list->next;
+	while (fast && fast->next) {
+		slow = slow->next;
+		fast = fast->next->next;
+	}
+
+	right = slow->next;
+	slow->next = NULL;
+
+	list = mem_reaper_sort(list);
+	right = mem_reaper_sort(right);
+
+	while (list && right) {
+		if (list->iova <= right->iova) {
+			tail->next = list;
+			list = list->next;
+		} else {
+			tail->next = right;
+			right = right->next;
+		}
+		tail = tail->next;
+	}
+
+	tail->next = list ? list : right;
+
+	return head.next;
+}
+
+STATIC void *mem_reaper_thread(void *arg)
+{
+	struct mem_reaper *r = (struct mem_reaper *)arg;
+	struct mem_reaper_entry *batch;
+	struct mem_reaper_entry *next;
+
+	pthread_mutex_lock(&r->lock);
+
+	while (1) {
+		while (!r->queue && !r->stop)
+			pthread_cond_wait(&r->wake, &r->lock);
+
+		// Queued buffers are released before stopping.
+		if (!r->queue)
+			break;
+
+		batch = r->queue;
+		r->queue = NULL;
+		r->busy = r->queued;
+		r->queued = 0;
+
+		++r->batches;
+		r->entries += r->busy;
+
+		pthread_mutex_unlock(&r->lock);
+
+		batch = mem_reaper_sort(batch);
+		r->reap(r->context, batch);
+
+		while (batch) {
+			next = batch->next;
+			opae_free(batch);
+			batch = next;
+		}
+
+		pthread_mutex_lock(&r->lock);
+
+		r->busy = 0;
+		if (!r->queue)
+			pthread_cond_broadcast(&r->idle);
+	}
+
+	pthread_mutex_unlock(&r->lock);
+
+	return NULL;
+}
+
+void mem_reaper_destroy(struct mem_reaper *r)
+{
+	bool running;
+
+	if (!r) {
+		ERR("NULL param\n");
+		return;
+	}
+
+	pthread_mutex_lock(&r->lock);
+	r->stop = true;
+	running = r->running;
+	pthread_cond_signal(&r->wake);
+	pthread_mutex_unlock(&r->lock);
+
+	if (running && pthread_join(r->thread, NULL))
+		ERR("pthread_join() failed\n");
+
+	pthread_cond_destroy(&r->idle);
+	pthread_cond_destroy(&r->wake);
+	pthread_mutex_destroy(&r->lock);
+}
+
+int mem_reaper_put(struct mem_reaper *r,
+		   void *vaddr,
+		   uint64_t iova,
+		   uint64_t size,
+		   void *data)
+{
+	struct mem_reaper_entry *e;
+
+	if (!r) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	e = opae_malloc(sizeof(*e));
+	if (!e) {
+		ERR("malloc failed\n");
+		return 2;
+	}
+
+	e->vaddr = vaddr;
+	e->iova = iova;
+	e->size = size;
+	e->data = data;
+
+	pthread_mutex_lock(&r->lock);
+
+	if (r->stop) {
+		ERR("reaper is stopping\n");
+		goto out_free;
+	}
+
+	if (!r->running) {
+		if (pthread_create(&r->thread, NULL, mem_reaper_thread, r)) {
+			ERR("pthread_create() failed\n");
+			goto out_free;
+		}
+		r->running = true;
+	}
+
+	e->next = r->queue;
+	r->queue = e;
+	++r->queued;
+
+	pthread_cond_signal(&r->wake);
+	pthread_mutex_unlock(&r->lock);
+
+	return 0;
+
+out_free:
+	pthread_mutex_unlock(&r->lock);
+	opae_free(e);
+	return 3;
+}
+
+int mem_reaper_drain(struct mem_reaper *r)
+{
+	if (!r) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	pthread_mutex_lock(&r->lock);
+
+	while (r->queue || r->busy)
+		pthread_cond_wait(&r->idle, &r->lock);
+
+	pthread_mutex_unlock(&r->lock);
+
+	return 0;
+}
+
+uint32_t mem_reaper_pending(struct mem_reaper *r)
+{
+	uint32_t pending;
+
+	pthread_mutex_lock(&r->lock);
+	pending = r->queued + r->busy;
+	pthread_mutex_unlock(&r->lock);
+
+	return pending;
+}
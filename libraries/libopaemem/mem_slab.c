@@ -0,0 +1,211 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <opae/mem_slab.h>
+#include "mock/opae_std.h"
+
+#define __SHORT_FILE__                                    \
+({                                                        \
+	const char *file = __FILE__;                      \
+	const char *p = file;                             \
+	while (*p)                                        \
+		++p;                                      \
+	while ((p > file) && ('/' != *p) && ('\\' != *p)) \
+		--p;                                      \
+	if (p > file)                                     \
+		++p;                                      \
+	p;                                                \
+})
+
+#define ERR(format, ...)                               \
+fprintf(stderr, "%s:%u:%s() **ERROR** [%s] : " format, \
+	__SHORT_FILE__, __LINE__, __func__, strerror(errno), ##__VA_ARGS__)
+
+void mem_slab_init(struct mem_slab *s,
+		   mem_slab_map_fn map,
+		   mem_slab_unmap_fn unmap,
+		   void *context)
+{
+	memset(s, 0, sizeof(*s));
+	s->map = map;
+	s->unmap = unmap;
+	s->context = context;
+}
+
+STATIC void mem_slab_region_free(struct mem_slab *s,
+				 struct mem_slab_region *r)
+{
+	s->unmap(s->context, r->vaddr, r->iova, r->size);
+	s->pinned -= r->size;
+	mem_alloc_destroy(&r->alloc);
+	opae_free(r);
+}
+
+void mem_slab_destroy(struct mem_slab *s)
+{
+	struct mem_slab_region *r;
+	struct mem_slab_region *trash;
+
+	for (r = s->regions ; r ; ) {
+		trash = r;
+		r = r->next;
+		mem_slab_region_free(s, trash);
+	}
+
+	s->regions = NULL;
+}
+
+uint64_t mem_slab_region_size(uint64_t size)
+{
+	if (!size)
+		return 0;
+	if (size <= MEM_SLAB_SMALL_MAX)
+		return MEM_SLAB_SMALL_REGION;
+	if (size <= MEM_SLAB_LARGE_MAX)
+		return MEM_SLAB_LARGE_REGION;
+	return 0;
+}
+
+STATIC struct mem_slab_region *mem_slab_region_add(struct mem_slab *s,
+						   uint64_t size)
+{
+	struct mem_slab_region *r;
+	void *vaddr = NULL;
+	uint64_t iova = 0;
+
+	r = opae_calloc(1, sizeof(struct mem_slab_region));
+	if (!r) {
+		ERR("calloc() failed\n");
+		return NULL;
+	}
+
+	if (s->map(s->context, size, &vaddr, &iova)) {
+		opae_free(r);
+		return NULL;
+	}
+
+	r->vaddr = (uint8_t *)vaddr;
+	r->iova = iova;
+	r->size = size;
+	mem_alloc_init(&r->alloc);
+
+	if (mem_alloc_add_free(&r->alloc, (uint64_t)r->vaddr, size)) {
+		ERR("mem_alloc_add_free() failed\n");
+		s->unmap(s->context, vaddr, iova, size);
+		opae_free(r);
+		return NULL;
+	}
+
+	r->next = s->regions;
+	s->regions = r;
+	s->pinned += size;
+
+	return r;
+}
+
+int mem_slab_get(struct mem_slab *s,
+		 uint64_t size,
+		 void **vaddr,
+		 uint64_t *iova)
+{
+	struct mem_slab_region *r;
+	uint64_t region_size;
+	uint64_t addr = 0;
+
+	region_size = mem_slab_region_size(size);
+	if (!region_size) {
+		ERR("invalid slab request size 0x%lx\n", size);
+		return 1;
+	}
+
+	size = (size + MEM_SLAB_GRANULE - 1) & ~((uint64_t)MEM_SLAB_GRANULE - 1);
+
+	for (r = s->regions ; r ; r = r->next) {
+		if ((r->size == region_size) &&
+		    !mem_alloc_get(&r->alloc, &addr, size))
+			goto out_found;
+	}
+
+	r = mem_slab_region_add(s, region_size);
+	if (!r)
+		return 2;
+
+	if (mem_alloc_get(&r->alloc, &addr, size)) {
+		ERR("mem_alloc_get() failed on an empty region\n");
+		return 3;
+	}
+
+out_found:
+	++r->allocs;
+	*vaddr = (void *)addr;
+	*iova = r->iova + (addr - (uint64_t)r->vaddr);
+	return 0;
+}
+
+int mem_slab_put(struct mem_slab *s, void *vaddr)
+{
+	struct mem_slab_region *r;
+	struct mem_slab_region **prev;
+	struct mem_slab_region *peer;
+	uint8_t *p = (uint8_t *)vaddr;
+
+	for (prev = &s->regions ; *prev ; prev = &(*prev)->next) {
+		r = *prev;
+		if ((p >= r->vaddr) && (p < r->vaddr + r->size))
+			break;
+	}
+
+	r = *prev;
+	if (!r || mem_alloc_put(&r->alloc, (uint64_t)p)) {
+		ERR("%p is not a slab allocation\n", vaddr);
+		return 1;
+	}
+
+	if (--r->allocs)
+		return 0;
+
+	// Release the now-empty region only if another region of the
+	// same size remains to serve the next request.
+	for (peer = s->regions ; peer ; peer = peer->next) {
+		if ((peer != r) && (peer->size == r->size)) {
+			*prev = r->next;
+			mem_slab_region_free(s, r);
+			break;
+		}
+	}
+
+	return 0;
+}
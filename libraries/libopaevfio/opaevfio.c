@@ -38,9 +38,13 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <regex.h>
+#include <stdbool.h>
+#include <time.h>
 #include <linux/pci_regs.h>
 
 #include <opae/vfio.h>
+#include <opae/mem_prefault.h>
+#include <opae/mem_bind.h>
 #include "mock/opae_std.h"
 
 #define __SHORT_FILE__                                    \
@@ -482,6 +486,10 @@ opae_vfio_destroy_buffer(struct opae_vfio *, struct opae_vfio_buffer *);
 
 STATIC void opae_vfio_destroy(struct opae_vfio *v)
 {
+	// The reaper was drained by opae_vfio_close(), so stopping
+	// its thread does not wait on v->lock, which is held here.
+	mem_reaper_destroy(&v->reaper);
+
 	// destroy buffers before we close any FDs
 	opae_hash_map_destroy(&v->cont_buffers);
 
@@ -615,6 +623,12 @@ STATIC int opae_vfio_iova_reserve(struct opae_vfio *v,
 			     *size);
 }
 
+/*
+ * Set on a buffer whose release is handed to v->reaper when it is
+ * removed from v->cont_buffers. Not a caller-visible flag.
+ */
+#define OPAE_VFIO_BUF_DEFERRED (1 << 24)
+
 STATIC struct opae_vfio_buffer *
 opae_vfio_create_buffer(uint8_t *vaddr,
 			size_t size,
@@ -659,6 +673,74 @@ opae_vfio_destroy_buffer(struct opae_vfio *v,
 	opae_free(b);
 }
 
+/*
+ * Release a batch of buffers given to opae_vfio_buffer_free_deferred(),
+ * in ascending IOVA order. Runs on the reaper thread.
+ *
+ * Each run of adjacent IOVA ranges is unmapped with one
+ * VFIO_IOMMU_UNMAP_DMA, which removes every mapping that lies wholly
+ * within the given range. Should the kernel refuse a combined unmap,
+ * the buffers of the run are unmapped one at a time.
+ */
+STATIC void opae_vfio_reap(void *context, struct mem_reaper_entry *batch)
+{
+	struct opae_vfio *v = (struct opae_vfio *)context;
+	struct vfio_iommu_type1_dma_unmap dma_unmap;
+	struct mem_reaper_entry *run;
+	struct mem_reaper_entry *e;
+	struct opae_vfio_buffer *b;
+
+	for (run = batch ; run ; run = e) {
+		memset(&dma_unmap, 0, sizeof(dma_unmap));
+		dma_unmap.argsz = sizeof(dma_unmap);
+		dma_unmap.iova = run->iova;
+		dma_unmap.size = run->size;
+
+		for (e = run->next ;
+		     e && (e->iova == dma_unmap.iova + dma_unmap.size) ;
+		     e = e->next)
+			dma_unmap.size += e->size;
+
+		if (opae_ioctl(v->cont_fd, VFIO_IOMMU_UNMAP_DMA,
+			       &dma_unmap) >= 0)
+			continue;
+
+		for ( ; run != e ; run = run->next) {
+			memset(&dma_unmap, 0, sizeof(dma_unmap));
+			dma_unmap.argsz = sizeof(dma_unmap);
+			dma_unmap.iova = run->iova;
+			dma_unmap.size = run->size;
+
+			if (opae_ioctl(v->cont_fd, VFIO_IOMMU_UNMAP_DMA,
+				       &dma_unmap) < 0)
+				ERR("ioctl(%d, VFIO_IOMMU_UNMAP_DMA, &dma_unmap)\n",
+				    v->cont_fd);
+		}
+	}
+
+	// Deferred buffers were allocated by this library.
+	for (e = batch ; e ; e = e->next) {
+		if (munmap(e->vaddr, e->size) < 0)
+			ERR("munmap(%p, %lu) failed\n", e->vaddr, e->size);
+	}
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return;
+	}
+
+	for (e = batch ; e ; e = e->next) {
+		b = (struct opae_vfio_buffer *)e->data;
+		if (mem_alloc_put(&v->iova_alloc, b->buffer_iova))
+			ERR("mem_alloc_put(..., 0x%lx) failed\n",
+			    b->buffer_iova);
+		opae_free(b);
+	}
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+}
+
 #ifndef MAP_HUGETLB
 #define MAP_HUGETLB 0x40000
 #endif
@@ -679,12 +761,88 @@ opae_vfio_destroy_buffer(struct opae_vfio *v,
 #define FLAGS_1G (FLAGS_4K|MAP_1G_HUGEPAGE|MAP_HUGETLB)
 #endif
 
+#define SIZE_2M (2UL * 1024 * 1024)
+#define SIZE_1G (1024UL * 1024 * 1024)
+#define ROUND_UP(__n, __m) (((__n) + (__m) - 1) & ~((__m) - 1))
+
+STATIC uint8_t *opae_vfio_mmap_pages(size_t len, int map_flags)
+{
+	void *vaddr = mmap(ADDR, len, PROT_READ|PROT_WRITE, map_flags, 0, 0);
+	return (vaddr == MAP_FAILED) ? NULL : (uint8_t *)vaddr;
+}
+
+/*
+ * Allocate backing pages for a buffer of *size bytes, updating *size
+ * to the mapped length.
+ *
+ * Buffers over 4 KiB are backed by hugepages. 1 GiB pages are preferred
+ * only when the size is a whole number of them. Other buffers over 2 MiB
+ * are built from several 2 MiB pages, which need not be physically
+ * contiguous: VFIO_IOMMU_MAP_DMA pins each page and the IOMMU presents
+ * the range at one contiguous IOVA. When the preferred page size is
+ * exhausted, the other one is tried. The size of the backing pages is
+ * returned in *page_size.
+ *
+ * When populate is set, a mapping of a single page is populated by
+ * mmap() (MAP_POPULATE).
+ */
+STATIC uint8_t *opae_vfio_buffer_pages(size_t *size, size_t *page_size,
+				       bool populate)
+{
+	size_t len_2m = ROUND_UP(*size, SIZE_2M);
+	size_t len_1g = ROUND_UP(*size, SIZE_1G);
+	int pop_2m = (populate && (len_2m == SIZE_2M)) ? MAP_POPULATE : 0;
+	int pop_1g = (populate && (len_1g == SIZE_1G)) ? MAP_POPULATE : 0;
+	uint8_t *vaddr;
+
+	if (*size <= 4096) {
+		*page_size = 4096;
+		return opae_vfio_mmap_pages(*size,
+			FLAGS_4K | (populate ? MAP_POPULATE : 0));
+	}
+
+	if ((*size > SIZE_2M) && (len_1g == *size)) {
+		vaddr = opae_vfio_mmap_pages(len_1g, FLAGS_1G | pop_1g);
+		if (vaddr)
+			goto out_1g;
+	}
+
+	vaddr = opae_vfio_mmap_pages(len_2m, FLAGS_2M | pop_2m);
+	if (vaddr) {
+		*size = len_2m;
+		*page_size = SIZE_2M;
+		return vaddr;
+	}
+
+	if ((*size > SIZE_2M) && (len_1g != *size)) {
+		vaddr = opae_vfio_mmap_pages(len_1g, FLAGS_1G | pop_1g);
+		if (vaddr)
+			goto out_1g;
+	}
+
+	return NULL;
+
+out_1g:
+	*size = len_1g;
+	*page_size = SIZE_1G;
+	return vaddr;
+}
+
+STATIC uint64_t opae_vfio_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
 STATIC int
 opae_vfio_buffer_mmap(struct opae_vfio *v,
 		      size_t *size,
 		      uint8_t **buf,
 		      uint64_t *iova,
 		      int flags,
+		      int numa_node,
 		      struct opae_vfio_buffer **node)
 {
 	uint8_t *vaddr = NULL;
@@ -692,37 +850,61 @@ opae_vfio_buffer_mmap(struct opae_vfio *v,
 	int res;
 	struct vfio_iommu_type1_dma_map dma_map;
 	struct vfio_iommu_type1_dma_unmap dma_unmap;
-
-	if (opae_vfio_iova_reserve(v, size, &ioaddr)) {
-		return 1;
-	}
+	bool prefault = false;
+	uint64_t t_start = opae_vfio_now_ns();
+	uint64_t t_alloc = t_start;
+	uint64_t t_prefault = t_start;
+	uint64_t t_map;
 
 	if (!(flags & OPAE_VFIO_BUF_PREALLOCATED)) {
+		size_t page_size = 4096;
+
+		// Populating the pages at mmap() time would place them
+		// before the NUMA policy is set.
+		prefault = (flags & OPAE_VFIO_BUF_PREFAULT) != 0;
 
-		if (*size > (2 * 1024 * 1024))
-			vaddr = mmap(ADDR, *size, PROT_READ|PROT_WRITE,
-				     FLAGS_1G, 0, 0);
-		else if (*size > 4096)
-			vaddr = mmap(ADDR, *size, PROT_READ|PROT_WRITE,
-				     FLAGS_2M, 0, 0);
-		else
-			vaddr = mmap(ADDR, *size, PROT_READ|PROT_WRITE,
-				     FLAGS_4K, 0, 0);
-
-		if (vaddr == MAP_FAILED) {
+		// Size the IOVA range to the hugepage-rounded length, so that
+		// it is aligned for IOMMU superpage mappings.
+		vaddr = opae_vfio_buffer_pages(size, &page_size,
+					       prefault && (numa_node < 0));
+		if (!vaddr) {
 			ERR("mmap() failed\n");
-			mem_alloc_put(&v->iova_alloc, ioaddr);
 			return 2;
 		}
 
+		// The pages are faulted in by mem_prefault() or by
+		// VFIO_IOMMU_MAP_DMA below, so they are placed according
+		// to this policy.
+		if ((numa_node >= 0) &&
+		    mem_bind(vaddr, *size, numa_node)) {
+			ERR("mbind(%p, %lu, node %d) failed\n",
+			    vaddr, *size, numa_node);
+			munmap(vaddr, *size);
+			return 6;
+		}
+
+		t_alloc = t_prefault = opae_vfio_now_ns();
+
+		if (prefault &&
+		    ((numa_node >= 0) || (*size > page_size))) {
+			// On failure, VFIO_IOMMU_MAP_DMA faults the pages.
+			if (mem_prefault(vaddr, *size, page_size, numa_node))
+				ERR("mem_prefault() failed\n");
+			t_prefault = opae_vfio_now_ns();
+		}
+
 	} else if (!buf || !*buf) {
 		ERR("got OPAE_VFIO_BUF_PREALLOCATED, but buf is NULL.\n");
-		mem_alloc_put(&v->iova_alloc, ioaddr);
 		return 3;
 	} else {
 		vaddr = *buf;
 	}
 
+	if (opae_vfio_iova_reserve(v, size, &ioaddr)) {
+		res = 1;
+		goto out_munmap;
+	}
+
 	memset(&dma_map, 0, sizeof(dma_map));
 
 	dma_map.argsz = sizeof(dma_map);
@@ -738,6 +920,8 @@ opae_vfio_buffer_mmap(struct opae_vfio *v,
 		goto out_munmap;
 	}
 
+	t_map = opae_vfio_now_ns();
+
 	*node = opae_vfio_create_buffer(vaddr, *size, ioaddr, flags);
 	if (!*node) {
 		ERR("malloc failed\n");
@@ -751,6 +935,14 @@ opae_vfio_buffer_mmap(struct opae_vfio *v,
 	if (iova)
 		*iova = ioaddr;
 
+	++v->buffer_stats.buffers;
+	v->buffer_stats.bytes += *size;
+	if (prefault)
+		++v->buffer_stats.prefaulted;
+	v->buffer_stats.alloc_ns += t_alloc - t_start;
+	v->buffer_stats.prefault_ns += t_prefault - t_alloc;
+	v->buffer_stats.map_ns += t_map - t_prefault;
+
 	return 0;
 
 out_unmap_ioctl:
@@ -770,6 +962,16 @@ int opae_vfio_buffer_allocate_ex(struct opae_vfio *v,
 				 uint8_t **buf,
 				 uint64_t *iova,
 				 int flags)
+{
+	return opae_vfio_buffer_allocate_node(v, size, buf, iova, flags, -1);
+}
+
+int opae_vfio_buffer_allocate_node(struct opae_vfio *v,
+				   size_t *size,
+				   uint8_t **buf,
+				   uint64_t *iova,
+				   int flags,
+				   int numa_node)
 {
 	struct opae_vfio_buffer *node = NULL;
 	int res = 0;
@@ -784,17 +986,37 @@ int opae_vfio_buffer_allocate_ex(struct opae_vfio *v,
 		return 2;
 	}
 
+	if ((numa_node != -1) && !mem_bind_node_valid(numa_node)) {
+		ERR("invalid NUMA node %d\n", numa_node);
+		return 1;
+	}
+
 	if (pthread_mutex_lock(&v->lock)) {
 		ERR("pthread_mutex_lock() failed\n");
 		return 3;
 	}
 
-	if (opae_vfio_buffer_mmap(v,
-				  size,
-				  buf,
-				  iova,
-				  flags,
-				  &node)) {
+	res = opae_vfio_buffer_mmap(v, size, buf, iova, flags,
+				    numa_node, &node);
+
+	// Buffers awaiting a deferred free may hold the hugepages or
+	// the IOVA space that the allocation needs.
+	if (res && mem_reaper_pending(&v->reaper)) {
+		if (pthread_mutex_unlock(&v->lock))
+			ERR("pthread_mutex_unlock() failed\n");
+
+		mem_reaper_drain(&v->reaper);
+
+		if (pthread_mutex_lock(&v->lock)) {
+			ERR("pthread_mutex_lock() failed\n");
+			return 3;
+		}
+
+		res = opae_vfio_buffer_mmap(v, size, buf, iova, flags,
+					    numa_node, &node);
+	}
+
+	if (res) {
 		if (pthread_mutex_unlock(&v->lock))
 			ERR("pthread_mutex_unlock() failed\n");
 		return 4;
@@ -811,6 +1033,27 @@ int opae_vfio_buffer_allocate_ex(struct opae_vfio *v,
 	return res;
 }
 
+int opae_vfio_buffer_get_stats(struct opae_vfio *v,
+			       struct opae_vfio_buffer_stats *stats)
+{
+	if (!v || !stats) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	*stats = v->buffer_stats;
+
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return 0;
+}
+
 struct opae_vfio_buffer *opae_vfio_buffer_info(struct opae_vfio *v,
 					       uint8_t *vaddr)
 {
@@ -875,6 +1118,60 @@ int opae_vfio_buffer_free(struct opae_vfio *v,
 	return res;
 }
 
+int opae_vfio_buffer_free_deferred(struct opae_vfio *v,
+				   uint8_t *buf)
+{
+	struct opae_vfio_buffer *b = NULL;
+	int res = 0;
+
+	if (!v) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	if (pthread_mutex_lock(&v->lock)) {
+		ERR("pthread_mutex_lock() failed\n");
+		return 2;
+	}
+
+	if (opae_hash_map_find(&v->cont_buffers, buf, (void **)&b)) {
+		ERR("hash key %p not found\n", buf);
+		res = 3;
+		goto out_unlock;
+	}
+
+	// The caller owns the memory of a preallocated buffer, and may
+	// reuse it once the buffer is unmapped.
+	if (!(b->flags & OPAE_VFIO_BUF_PREALLOCATED))
+		b->flags |= OPAE_VFIO_BUF_DEFERRED;
+
+	if (opae_hash_map_remove(&v->cont_buffers, buf)) {
+		ERR("hash key %p not found\n", buf);
+		res = 3;
+	}
+
+out_unlock:
+	if (pthread_mutex_unlock(&v->lock))
+		ERR("pthread_mutex_unlock() failed\n");
+
+	return res;
+}
+
+int opae_vfio_buffer_drain(struct opae_vfio *v)
+{
+	if (!v) {
+		ERR("NULL param\n");
+		return 1;
+	}
+
+	if (mem_reaper_drain(&v->reaper)) {
+		ERR("mem_reaper_drain() failed\n");
+		return 2;
+	}
+
+	return 0;
+}
+
 int opae_vfio_buffer_map(struct opae_vfio *v,
 			 size_t size,
 			 uint8_t *buf,
@@ -1156,6 +1453,12 @@ void opae_vfio_value_cleanup(void *value, void *context)
 	struct opae_vfio *v =
 		(struct opae_vfio *)context;
 
+	// When the buffer can't be queued, it is released here.
+	if ((b->flags & OPAE_VFIO_BUF_DEFERRED) &&
+	    !mem_reaper_put(&v->reaper, b->buffer_ptr, b->buffer_iova,
+			    b->buffer_size, b))
+		return;
+
 	opae_vfio_destroy_buffer(v, b);
 }
 
@@ -1176,9 +1479,10 @@ STATIC int opae_vfio_init(struct opae_vfio *v,
 	mem_alloc_init(&v->iova_alloc);
 
 	result = opae_hash_map_init(&v->cont_buffers,
-				    19441, // num_buckets
+				    1024,  // initial slots (grows as needed)
 				    0,     // hash_seed
-				    OPAE_HASH_MAP_UNIQUE_KEYSPACE,
+				    OPAE_HASH_MAP_UNIQUE_KEYSPACE |
+				    OPAE_HASH_MAP_OPEN_ADDRESSING,
 				    opae_u64_key_hash,
 				    opae_u64_key_compare,
 				    NULL,  // key_cleanup
@@ -1206,6 +1510,12 @@ STATIC int opae_vfio_init(struct opae_vfio *v,
 		goto out_destroy_attr;
 	}
 
+	if (mem_reaper_init(&v->reaper, opae_vfio_reap, v)) {
+		ERR("mem_reaper_init()\n");
+		res = 12;
+		goto out_destroy_lock;
+	}
+
 	v->cont_device = opae_strdup("/dev/vfio/vfio");
 	v->cont_pciaddr = opae_strdup(pciaddr);
 	v->cont_fd = opae_open(v->cont_device, O_RDWR);
@@ -1266,6 +1576,10 @@ STATIC int opae_vfio_init(struct opae_vfio *v,
 out_destroy_container:
 	pthread_mutex_lock(&v->lock);
 	opae_vfio_destroy(v);
+	goto out_destroy_attr;
+
+out_destroy_lock:
+	pthread_mutex_destroy(&v->lock);
 
 out_destroy_attr:
 	if (pthread_mutexattr_destroy(&mattr)) {
@@ -1390,6 +1704,9 @@ void opae_vfio_close(struct opae_vfio *v)
 		return;
 	}
 
+	// The reaper thread takes v->lock.
+	mem_reaper_drain(&v->reaper);
+
 	if (pthread_mutex_lock(&v->lock)) {
 		ERR("pthread_mutex_lock() failed\n");
 		return;
@@ -680,14 +680,7 @@ fpga_result __UIO_API__ uio_fpgaOpen(fpga_token token, fpga_handle *handle, int
 	_handle->mmio_size = size;
 
 	_handle->flags = 0;
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__)
-#if GCC_VERSION >= 40900
-	__builtin_cpu_init();
-	if (__builtin_cpu_supports("avx512f")) {
-		_handle->flags |= OPAE_FLAG_HAS_AVX512;
-	}
-#endif // GCC_VERSION
-#endif // x86
+	_handle->mmio_wide = opae_mmio_wide_select();
 
 	*handle = _handle;
 	res = FPGA_OK;
@@ -936,6 +929,24 @@ static inline volatile uint8_t *get_user_offset(uio_handle *h,
 	return h->mmio_base + user_mmio + offset;
 }
 
+static inline bool mmio_in_bounds(uio_handle *h,
+				  uint32_t mmio_num,
+				  uint64_t offset,
+				  uint64_t width)
+{
+	uint64_t user_mmio;
+
+	if (mmio_num >= USER_MMIO_MAX)
+		return false;
+
+	user_mmio = h->token->user_mmio[mmio_num];
+	if ((user_mmio > h->mmio_size) ||
+	    (offset > h->mmio_size - user_mmio))
+		return false;
+
+	return width <= h->mmio_size - user_mmio - offset;
+}
+
 
 fpga_result __UIO_API__ uio_fpgaWriteMMIO64(fpga_handle handle,
 					    uint32_t mmio_num,
@@ -1066,33 +1077,135 @@ out_unlock:
 	return res;
 }
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__) && GCC_VERSION >= 40900
-static inline void copy512(const void *src, void *dst)
+fpga_result __UIO_API__ uio_fpgaWriteMMIO512(fpga_handle handle,
+					     uint32_t mmio_num,
+					     uint64_t offset,
+					     const void *value)
 {
-    asm volatile("vmovdqu64 (%0), %%zmm0;"
-		 "vmovdqu64 %%zmm0, (%1);"
-		 :
-		 : "r"(src), "r"(dst));
+	uio_handle *h;
+	uio_token *t;
+	fpga_result res = FPGA_OK;
+	int err;
+
+	if ((offset % 64) != 0) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = handle_check_and_lock(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if ((t->hdr.objtype == FPGA_DEVICE) || !h->mmio_wide) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_unlock;
+	}
+
+	if (mmio_num >= USER_MMIO_MAX) {
+		res = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	h->mmio_wide->write512(get_user_offset(h, mmio_num, offset), value);
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	return res;
 }
-#else
-static inline void copy512(const void *src, void *dst)
+
+fpga_result __UIO_API__ uio_fpgaReadMMIO512(fpga_handle handle,
+					    uint32_t mmio_num,
+					    uint64_t offset,
+					    void *value)
 {
-	UNUSED_PARAM(src);
-	UNUSED_PARAM(dst);
+	uio_handle *h;
+	uio_token *t;
+	fpga_result res = FPGA_OK;
+	int err;
+
+	if ((offset % 64) != 0) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = handle_check_and_lock(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if ((t->hdr.objtype == FPGA_DEVICE) || !h->mmio_wide) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_unlock;
+	}
+
+	if (mmio_num >= USER_MMIO_MAX) {
+		res = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	h->mmio_wide->read512(value, get_user_offset(h, mmio_num, offset));
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	return res;
 }
-#endif // x86
 
-fpga_result __UIO_API__ uio_fpgaWriteMMIO512(fpga_handle handle,
+fpga_result __UIO_API__ uio_fpgaCopyToMMIO(fpga_handle handle,
+					   uint32_t mmio_num,
+					   uint64_t offset,
+					   const void *src,
+					   uint64_t len)
+{
+	uio_handle *h;
+	uio_token *t;
+	fpga_result res = FPGA_OK;
+	int err;
+
+	ASSERT_NOT_NULL(src);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = handle_check_and_lock(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if (t->hdr.objtype == FPGA_DEVICE) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_unlock;
+	}
+
+	if (!mmio_in_bounds(h, mmio_num, offset, len)) {
+		res = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	opae_mmio_copy_to(h->mmio_wide, get_user_offset(h, mmio_num, offset),
+			  (const uint8_t *)src, len);
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	return res;
+}
+
+fpga_result __UIO_API__ uio_fpgaCopyFromMMIO(fpga_handle handle,
 					     uint32_t mmio_num,
 					     uint64_t offset,
-					     const void *value)
+					     void *dst,
+					     uint64_t len)
 {
 	uio_handle *h;
 	uio_token *t;
 	fpga_result res = FPGA_OK;
 	int err;
 
-	if ((offset % 64) != 0) {
+	ASSERT_NOT_NULL(dst);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
 		OPAE_ERR("Misaligned MMIO access");
 		return FPGA_INVALID_PARAM;
 	}
@@ -1102,18 +1215,129 @@ fpga_result __UIO_API__ uio_fpgaWriteMMIO512(fpga_handle handle,
 
 	t = h->token;
 
-	if ((t->hdr.objtype == FPGA_DEVICE) ||
-	    !(h->flags & OPAE_FLAG_HAS_AVX512)) {
+	if (t->hdr.objtype == FPGA_DEVICE) {
 		res = FPGA_NOT_SUPPORTED;
 		goto out_unlock;
 	}
 
-	if (mmio_num >= USER_MMIO_MAX) {
+	if (!mmio_in_bounds(h, mmio_num, offset, len)) {
 		res = FPGA_INVALID_PARAM;
 		goto out_unlock;
 	}
 
-	copy512(value, (uint8_t *)get_user_offset(h, mmio_num, offset));
+	opae_mmio_copy_from(h->mmio_wide, (uint8_t *)dst,
+			    get_user_offset(h, mmio_num, offset), len);
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	return res;
+}
+
+/*
+ * Validate one batch operation before it touches the BAR. The caller
+ * holds the handle lock. get_user_offset() takes a 32-bit offset, so
+ * larger offsets are rejected rather than silently truncated.
+ */
+static fpga_result batch_op_check(uio_handle *h, const fpga_mmio_op *op)
+{
+	if ((op->width != sizeof(uint32_t)) &&
+	    (op->width != sizeof(uint64_t))) {
+		OPAE_ERR("invalid MMIO width %u", op->width);
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (op->offset > UINT32_MAX) {
+		OPAE_ERR("MMIO offset out of range");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (op->offset % op->width) {
+		OPAE_ERR("misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!mmio_in_bounds(h, op->mmio_num, op->offset, op->width))
+		return FPGA_INVALID_PARAM;
+
+	return FPGA_OK;
+}
+
+fpga_result __UIO_API__ uio_fpgaReadMMIOBatch(fpga_handle handle,
+					      fpga_mmio_op *ops,
+					      uint32_t num_ops)
+{
+	uio_handle *h;
+	uio_token *t;
+	fpga_result res = FPGA_OK;
+	uint32_t i;
+	int err;
+
+	h = handle_check_and_lock(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if (t->hdr.objtype == FPGA_DEVICE) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_unlock;
+	}
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		volatile uint8_t *p;
+
+		res = batch_op_check(h, &ops[i]);
+		if (res)
+			goto out_unlock;
+
+		p = get_user_offset(h, ops[i].mmio_num, (uint32_t)ops[i].offset);
+
+		if (ops[i].width == sizeof(uint64_t)) {
+			ops[i].value = *((volatile uint64_t *)p);
+		} else if (ops[i].width == sizeof(uint32_t)) {
+			ops[i].value = *((volatile uint32_t *)p);
+		}
+	}
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	return res;
+}
+
+fpga_result __UIO_API__ uio_fpgaWriteMMIOBatch(fpga_handle handle,
+					       const fpga_mmio_op *ops,
+					       uint32_t num_ops)
+{
+	uio_handle *h;
+	uio_token *t;
+	fpga_result res = FPGA_OK;
+	uint32_t i;
+	int err;
+
+	h = handle_check_and_lock(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if (t->hdr.objtype == FPGA_DEVICE) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_unlock;
+	}
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		volatile uint8_t *p;
+
+		res = batch_op_check(h, &ops[i]);
+		if (res)
+			goto out_unlock;
+
+		p = get_user_offset(h, ops[i].mmio_num, (uint32_t)ops[i].offset);
+
+		if (ops[i].width == sizeof(uint64_t)) {
+			*((volatile uint64_t *)p) = ops[i].value;
+		} else if (ops[i].width == sizeof(uint32_t)) {
+			*((volatile uint32_t *)p) = (uint32_t)ops[i].value;
+		}
+	}
 
 out_unlock:
 	opae_mutex_unlock(err, &h->lock);
@@ -1319,6 +1543,41 @@ STATIC bool matches_filters(const fpga_properties *filters,
 	return false;
 }
 
+#define UIO_WALK_THREADS_MAX 16
+
+STATIC void *uio_walk_thread(void *arg)
+{
+	uio_walk((uio_pci_device_t *)arg);
+	return NULL;
+}
+
+// Walk the devices matching the filters. Each walk opens the device's
+// uio node and reads its feature list, so the devices are walked
+// concurrently.
+STATIC void uio_walk_devices(const fpga_properties *filters,
+			     uint32_t num_filters)
+{
+	uio_pci_device_t *dev;
+	pthread_t threads[UIO_WALK_THREADS_MAX];
+	uint32_t num_threads = 0;
+	uint32_t i;
+
+	for (dev = _pci_devices ; dev ; dev = dev->next) {
+		if (!pci_matches_filters(filters, num_filters, dev))
+			continue;
+
+		if ((num_threads < UIO_WALK_THREADS_MAX) &&
+		    !pthread_create(&threads[num_threads], NULL,
+				    uio_walk_thread, dev))
+			++num_threads;
+		else
+			uio_walk(dev);
+	}
+
+	for (i = 0 ; i < num_threads ; ++i)
+		pthread_join(threads[i], NULL);
+}
+
 fpga_result __UIO_API__ uio_fpgaEnumerate(const fpga_properties *filters,
 			       uint32_t num_filters, fpga_token *tokens,
 			       uint32_t max_tokens, uint32_t *num_matches)
@@ -1326,11 +1585,12 @@ fpga_result __UIO_API__ uio_fpgaEnumerate(const fpga_properties *filters,
 	uio_pci_device_t *dev = _pci_devices;
 	uint32_t matches = 0;
 
+	uio_walk_devices(filters, num_filters);
+
 	while (dev) {
 		if (pci_matches_filters(filters, num_filters, dev)) {
 			uio_token *tptr;
 
-			uio_walk(dev);
 			tptr = dev->tokens;
 
 			while (tptr) {
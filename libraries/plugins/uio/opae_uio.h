@@ -28,6 +28,8 @@
 #include <opae/uio.h>
 #include <opae/fpga.h>
 
+#include "mmio-wide.h"
+
 #define GUIDSTR_MAX 36
 
 #ifdef __GNUC__
@@ -96,7 +98,7 @@ typedef struct _uio_handle {
 	volatile uint8_t *mmio_base;
 	size_t mmio_size;
 	pthread_mutex_t lock;
-#define OPAE_FLAG_HAS_AVX512 (1u << 0)
+	const opae_mmio_wide *mmio_wide; // 512 bit MMIO kernels, or NULL
 	uint32_t flags;
 } uio_handle;
 
@@ -106,6 +106,16 @@ int __UIO_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "uio_fpgaReadMMIO32");
 	adapter->fpgaWriteMMIO512 =
 		dlsym(adapter->plugin.dl_handle, "uio_fpgaWriteMMIO512");
+	adapter->fpgaReadMMIO512 =
+		dlsym(adapter->plugin.dl_handle, "uio_fpgaReadMMIO512");
+	adapter->fpgaReadMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "uio_fpgaReadMMIOBatch");
+	adapter->fpgaWriteMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "uio_fpgaWriteMMIOBatch");
+	adapter->fpgaCopyToMMIO =
+		dlsym(adapter->plugin.dl_handle, "uio_fpgaCopyToMMIO");
+	adapter->fpgaCopyFromMMIO =
+		dlsym(adapter->plugin.dl_handle, "uio_fpgaCopyFromMMIO");
 	adapter->fpgaMapMMIO =
 		dlsym(adapter->plugin.dl_handle, "uio_fpgaMapMMIO");
 	adapter->fpgaUnmapMMIO =
@@ -0,0 +1,219 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "opae_int.h"
+#include "buffer_pool.h"
+
+#define BUFFER_POOL_MAX_ENV "LIBOPAE_BUFFER_POOL_MAX"
+
+static inline unsigned pool_class(uint64_t size)
+{
+	return size ? 63 - __builtin_clzll(size) : 0;
+}
+
+uint64_t vfio_buffer_pool_limit(void)
+{
+	const char *s = getenv(BUFFER_POOL_MAX_ENV);
+	char *end = NULL;
+	uint64_t limit;
+	unsigned shift = 0;
+
+	if (!s || !*s)
+		return 0;
+
+	limit = strtoull(s, &end, 0);
+
+	switch (*end) {
+	case 'g':
+	case 'G':
+		shift += 10;
+		// fall through
+	case 'm':
+	case 'M':
+		shift += 10;
+		// fall through
+	case 'k':
+	case 'K':
+		shift += 10;
+		++end;
+		break;
+	}
+
+	if (*end) {
+		OPAE_ERR("invalid %s value \"%s\"", BUFFER_POOL_MAX_ENV, s);
+		return 0;
+	}
+
+	if (limit > (UINT64_MAX >> shift)) {
+		OPAE_ERR("%s value \"%s\" is too large", BUFFER_POOL_MAX_ENV, s);
+		return 0;
+	}
+
+	return limit << shift;
+}
+
+vfio_buffer_pool *vfio_buffer_pool_create(uint64_t high_water)
+{
+	vfio_buffer_pool *pool;
+
+	pool = opae_calloc(1, sizeof(vfio_buffer_pool));
+	if (!pool) {
+		OPAE_ERR("malloc failed");
+		return NULL;
+	}
+
+	if (pthread_mutex_init(&pool->lock, NULL)) {
+		OPAE_ERR("pthread_mutex_init failed");
+		opae_free(pool);
+		return NULL;
+	}
+
+	pool->stats.high_water = high_water;
+
+	return pool;
+}
+
+static void pool_free_list(vfio_pooled_buffer *p)
+{
+	vfio_pooled_buffer *trash;
+
+	while (p) {
+		trash = p;
+		p = p->next;
+		opae_free(trash);
+	}
+}
+
+void vfio_buffer_pool_destroy(vfio_buffer_pool *pool)
+{
+	unsigned i;
+
+	if (!pool)
+		return;
+
+	for (i = 0 ; i < VFIO_POOL_CLASSES ; ++i)
+		pool_free_list(pool->classes[i]);
+	pool_free_list(pool->spare);
+
+	pthread_mutex_destroy(&pool->lock);
+	opae_free(pool);
+}
+
+struct opae_vfio_buffer *vfio_buffer_pool_get(vfio_buffer_pool *pool,
+					      size_t size)
+{
+	struct opae_vfio_buffer *binfo = NULL;
+	vfio_pooled_buffer **pp;
+	vfio_pooled_buffer *p;
+	int err;
+
+	opae_mutex_lock(err, &pool->lock);
+
+	for (pp = &pool->classes[pool_class(size)] ; *pp ; pp = &(*pp)->next) {
+		if ((*pp)->binfo->buffer_size == size)
+			break;
+	}
+
+	p = *pp;
+	if (p) {
+		*pp = p->next;
+		binfo = p->binfo;
+
+		p->binfo = NULL;
+		p->next = pool->spare;
+		pool->spare = p;
+
+		++pool->stats.hits;
+		--pool->stats.pooled_buffers;
+		pool->stats.pooled_bytes -= size;
+	} else {
+		++pool->stats.misses;
+	}
+
+	opae_mutex_unlock(err, &pool->lock);
+
+	return binfo;
+}
+
+int vfio_buffer_pool_put(vfio_buffer_pool *pool,
+			 struct opae_vfio_buffer *binfo)
+{
+	vfio_pooled_buffer *p;
+	unsigned c;
+	int err;
+	int res = 1;
+
+	opae_mutex_lock(err, &pool->lock);
+
+	if (pool->stats.pooled_bytes + binfo->buffer_size >
+	    pool->stats.high_water)
+		goto out_evict;
+
+	p = pool->spare;
+	if (p) {
+		pool->spare = p->next;
+	} else {
+		p = opae_malloc(sizeof(vfio_pooled_buffer));
+		if (!p)
+			goto out_evict;
+	}
+
+	// Most recently released first, while its pages are still warm.
+	c = pool_class(binfo->buffer_size);
+	p->binfo = binfo;
+	p->next = pool->classes[c];
+	pool->classes[c] = p;
+
+	++pool->stats.recycled;
+	++pool->stats.pooled_buffers;
+	pool->stats.pooled_bytes += binfo->buffer_size;
+	res = 0;
+	goto out_unlock;
+
+out_evict:
+	++pool->stats.evicted;
+out_unlock:
+	opae_mutex_unlock(err, &pool->lock);
+	return res;
+}
+
+void vfio_buffer_pool_get_stats(vfio_buffer_pool *pool,
+				fpga_buffer_pool_stats *stats)
+{
+	int err;
+
+	opae_mutex_lock(err, &pool->lock);
+	*stats = pool->stats;
+	opae_mutex_unlock(err, &pool->lock);
+}
@@ -0,0 +1,86 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VFIO_BUFFER_POOL_H
+#define VFIO_BUFFER_POOL_H
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <opae/types.h>
+#include <opae/vfio.h>
+
+// Number of size classes, one per power of two.
+#define VFIO_POOL_CLASSES 64
+
+// Bytes held by a pool when LIBOPAE_BUFFER_POOL_MAX isn't set.
+#define VFIO_POOL_DEFAULT_MAX (1024UL * 1024UL * 1024UL)
+
+typedef struct _vfio_pooled_buffer {
+	struct opae_vfio_buffer *binfo;
+	struct _vfio_pooled_buffer *next;
+} vfio_pooled_buffer;
+
+// Per-handle cache of released, still pinned and IOMMU-mapped buffers.
+typedef struct _vfio_buffer_pool {
+	pthread_mutex_t lock;
+	vfio_pooled_buffer *classes[VFIO_POOL_CLASSES]; // by floor(log2(size))
+	vfio_pooled_buffer *spare; // unused list entries
+	fpga_buffer_pool_stats stats;
+} vfio_buffer_pool;
+
+/*
+ * The value of LIBOPAE_BUFFER_POOL_MAX in bytes, accepting a K, M or G
+ * suffix, or 0 when the variable is unset, invalid, or too large for
+ * 64 bits.
+ */
+uint64_t vfio_buffer_pool_limit(void);
+
+vfio_buffer_pool *vfio_buffer_pool_create(uint64_t high_water);
+
+/*
+ * Releases the pool's bookkeeping. Buffers still held by the pool are
+ * unmapped when their container is closed.
+ */
+void vfio_buffer_pool_destroy(vfio_buffer_pool *pool);
+
+/*
+ * Remove and return a pooled buffer of exactly size bytes, or NULL when
+ * there is none.
+ */
+struct opae_vfio_buffer *vfio_buffer_pool_get(vfio_buffer_pool *pool,
+					      size_t size);
+
+/*
+ * Hand binfo to the pool. Returns 0 when the pool keeps the buffer, or
+ * non-zero when the caller must free it.
+ */
+int vfio_buffer_pool_put(vfio_buffer_pool *pool,
+			 struct opae_vfio_buffer *binfo);
+
+void vfio_buffer_pool_get_stats(vfio_buffer_pool *pool,
+				fpga_buffer_pool_stats *stats);
+
+#endif // VFIO_BUFFER_POOL_H
@@ -36,6 +36,7 @@
 #include <errno.h>
 #include <glob.h>
 #include <regex.h>
+#include <sched.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -48,6 +49,7 @@
 #undef _GNU_SOURCE
 
 #include <opae/fpga.h>
+#include <opae/mem_bind.h>
 
 #include "opae_vfio.h"
 #include "dfl.h"
@@ -471,6 +473,52 @@ event_handle_check_and_lock(fpga_event_handle event_handle)
 	return NULL;
 }
 
+/*
+ * Handles opened with FPGA_OPEN_LOCKLESS_MMIO don't take the handle
+ * lock in the MMIO accessors. Instead, each access is counted in
+ * mmio_users for its duration. vfio_fpgaClose() invalidates the handle
+ * magic and then waits for mmio_users to drain before the region is
+ * unmapped, so no access can observe a torn-down mapping. An access
+ * publishes itself in mmio_users before it checks the magic: checking
+ * first would let close slip in between the check and the count.
+ */
+STATIC vfio_handle *mmio_enter(fpga_handle handle)
+{
+	vfio_handle *h;
+
+	ASSERT_NOT_NULL_RESULT(handle, NULL);
+
+	h = (vfio_handle *)handle;
+	if (!(h->open_flags & FPGA_OPEN_LOCKLESS_MMIO))
+		return handle_check_and_lock(handle);
+
+	__atomic_add_fetch(&h->mmio_users, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&h->magic, __ATOMIC_SEQ_CST) != VFIO_HANDLE_MAGIC) {
+		__atomic_sub_fetch(&h->mmio_users, 1, __ATOMIC_SEQ_CST);
+		OPAE_ERR("invalid handle magic, or handle is closing");
+		return NULL;
+	}
+
+	return h;
+}
+
+STATIC void mmio_exit(vfio_handle *h)
+{
+	int err;
+
+	if (h->open_flags & FPGA_OPEN_LOCKLESS_MMIO)
+		__atomic_sub_fetch(&h->mmio_users, 1, __ATOMIC_RELEASE);
+	else
+		opae_mutex_unlock(err, &h->lock);
+}
+
+STATIC void mmio_quiesce(vfio_handle *h)
+{
+	__atomic_store_n(&h->magic, 0, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&h->mmio_users, __ATOMIC_SEQ_CST))
+		sched_yield();
+}
+
 STATIC int close_vfio_pair(vfio_pair_t **pair)
 {
 	ASSERT_NOT_NULL(pair);
@@ -673,6 +721,49 @@ close:
 	return res;
 }
 
+STATIC int vfio_slab_map(void *context, uint64_t size,
+			 void **vaddr, uint64_t *iova)
+{
+	struct opae_vfio *v = (struct opae_vfio *)context;
+	size_t sz = size;
+	uint8_t *virt = NULL;
+
+	if (opae_vfio_buffer_allocate_ex(v, &sz, &virt, iova, 0)) {
+		OPAE_DBG("could not allocate slab region");
+		return 1;
+	}
+
+	*vaddr = virt;
+	return 0;
+}
+
+STATIC void vfio_slab_unmap(void *context, void *vaddr,
+			    uint64_t iova, uint64_t size)
+{
+	UNUSED_PARAM(iova);
+	UNUSED_PARAM(size);
+
+	if (opae_vfio_buffer_free((struct opae_vfio *)context,
+				  (uint8_t *)vaddr))
+		OPAE_ERR("error freeing vfio slab region");
+}
+
+STATIC int vfio_sg_map(void *context, uint8_t *vaddr,
+		       size_t size, uint64_t *iova)
+{
+	size_t sz = size;
+	uint8_t *virt = vaddr;
+
+	return opae_vfio_buffer_allocate_ex((struct opae_vfio *)context,
+					    &sz, &virt, iova,
+					    OPAE_VFIO_BUF_PREALLOCATED);
+}
+
+STATIC int vfio_sg_unmap(void *context, uint8_t *vaddr)
+{
+	return opae_vfio_buffer_free((struct opae_vfio *)context, vaddr);
+}
+
 fpga_result __VFIO_API__ vfio_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 {
 	fpga_result res = FPGA_EXCEPTION;
@@ -681,6 +772,7 @@ fpga_result __VFIO_API__ vfio_fpgaOpen(fpga_token token, fpga_handle *handle, in
 	pthread_mutexattr_t mattr;
 	uint8_t *mmio = NULL;
 	size_t size = 0;
+	uint64_t pool_max;
 
 	ASSERT_NOT_NULL(token);
 	ASSERT_NOT_NULL(handle);
@@ -713,6 +805,7 @@ fpga_result __VFIO_API__ vfio_fpgaOpen(fpga_token token, fpga_handle *handle, in
 	}
 
 	_handle->magic = VFIO_HANDLE_MAGIC;
+	_handle->open_flags = flags;
 	_handle->token = clone_token(_token);
 	if (flags & FPGA_OPEN_HAS_PARENT_AFU)
 		_handle->parent_afu = handle_check_and_lock(*handle);
@@ -734,14 +827,21 @@ fpga_result __VFIO_API__ vfio_fpgaOpen(fpga_token token, fpga_handle *handle, in
 	_handle->mmio_size = size;
 
 	_handle->flags = 0;
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__)
-#if GCC_VERSION >= 40900
-	__builtin_cpu_init();
-	if (__builtin_cpu_supports("avx512f")) {
-		_handle->flags |= OPAE_FLAG_HAS_AVX512;
+	_handle->mmio_wide = opae_mmio_wide_select();
+	mem_slab_init(&_handle->slab, vfio_slab_map, vfio_slab_unmap,
+		      _handle->vfio_pair->device);
+	_handle->sg_map = vfio_sg_map;
+	_handle->sg_unmap = vfio_sg_unmap;
+
+	if (flags & FPGA_OPEN_BUFFER_POOL) {
+		pool_max = vfio_buffer_pool_limit();
+		_handle->pool = vfio_buffer_pool_create(pool_max ?
+				pool_max : VFIO_POOL_DEFAULT_MAX);
+		if (!_handle->pool) {
+			res = FPGA_NO_MEMORY;
+			goto out_attr_destroy;
+		}
 	}
-#endif // GCC_VERSION
-#endif // x86
 
 	if (_handle->parent_afu) {
 		if (opae_vfio_apply_group_constraint(
@@ -761,6 +861,7 @@ out_attr_destroy:
 	pthread_mutexattr_destroy(&mattr);
 	if (res && _handle) {
 		pthread_mutex_destroy(&_handle->lock);
+		vfio_buffer_pool_destroy(_handle->pool);
 		if (_handle->vfio_pair)
 			close_vfio_pair(&_handle->vfio_pair);
 		if (_handle->token) {
@@ -783,6 +884,9 @@ fpga_result __VFIO_API__ vfio_fpgaClose(fpga_handle handle)
 	h = handle_check_and_lock(handle);
 	ASSERT_NOT_NULL(h);
 
+	if (h->open_flags & FPGA_OPEN_LOCKLESS_MMIO)
+		mmio_quiesce(h);
+
 	t = token_check(h->token);
 	if (t) {
 		if (t->parent)
@@ -798,6 +902,29 @@ fpga_result __VFIO_API__ vfio_fpgaClose(fpga_handle handle)
 		h->flags &= ~(OPAE_FLAG_SVA_FD_VALID | OPAE_FLAG_PASID_VALID);
 	}
 
+	// Pooled buffers are unmapped along with the container.
+	vfio_buffer_pool_destroy(h->pool);
+	h->pool = NULL;
+
+	while (h->slab_buffers) {
+		vfio_slab_buffer *sb = h->slab_buffers;
+		h->slab_buffers = sb->next;
+		opae_free(sb);
+	}
+	mem_slab_destroy(&h->slab);
+
+	// SG segments are unmapped along with the container.
+	while (h->sg_buffers) {
+		vfio_sg_buffer *sgb = h->sg_buffers;
+		h->sg_buffers = sgb->next;
+		opae_free(sgb);
+	}
+	while (h->sg_segs) {
+		vfio_sg_seg *seg = h->sg_segs;
+		h->sg_segs = seg->next;
+		opae_free(seg);
+	}
+
 	close_vfio_pair(&h->vfio_pair);
 
 	if (pthread_mutex_unlock(&h->lock) ||
@@ -1004,6 +1131,23 @@ static inline volatile uint8_t *get_user_offset(vfio_handle *h,
 	return h->mmio_base + user_mmio + offset;
 }
 
+static inline bool mmio_in_bounds(vfio_handle *h,
+				  uint32_t mmio_num,
+				  uint64_t offset,
+				  uint64_t width)
+{
+	uint64_t user_mmio;
+
+	if (mmio_num >= USER_MMIO_MAX)
+		return false;
+
+	user_mmio = h->token->user_mmio[mmio_num];
+	if ((user_mmio > h->mmio_size) ||
+	    (offset > h->mmio_size - user_mmio))
+		return false;
+
+	return width <= h->mmio_size - user_mmio - offset;
+}
 
 fpga_result __VFIO_API__ vfio_fpgaWriteMMIO64(fpga_handle handle,
 					      uint32_t mmio_num,
@@ -1013,27 +1157,26 @@ fpga_result __VFIO_API__ vfio_fpgaWriteMMIO64(fpga_handle handle,
 	vfio_handle *h;
 	vfio_token *t;
 	fpga_result res = FPGA_OK;
-	int err;
 
-	h = handle_check_and_lock(handle);
+	h = mmio_enter(handle);
 	ASSERT_NOT_NULL(h);
 
 	t = h->token;
 
 	if (t->hdr.objtype == FPGA_DEVICE) {
 		res = FPGA_NOT_SUPPORTED;
-		goto out_unlock;
+		goto out_exit;
 	}
 
-	if (mmio_num >= USER_MMIO_MAX) {
+	if (!mmio_in_bounds(h, mmio_num, offset, sizeof(uint64_t))) {
 		res = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		goto out_exit;
 	}
 
 	*((volatile uint64_t *)get_user_offset(h, mmio_num, offset)) = value;
 
-out_unlock:
-	opae_mutex_unlock(err, &h->lock);
+out_exit:
+	mmio_exit(h);
 	return res;
 }
 
@@ -1045,27 +1188,26 @@ fpga_result __VFIO_API__ vfio_fpgaReadMMIO64(fpga_handle handle,
 	vfio_handle *h;
 	vfio_token *t;
 	fpga_result res = FPGA_OK;
-	int err;
 
-	h = handle_check_and_lock(handle);
+	h = mmio_enter(handle);
 	ASSERT_NOT_NULL(h);
 
 	t = h->token;
 
 	if (t->hdr.objtype == FPGA_DEVICE) {
 		res = FPGA_NOT_SUPPORTED;
-		goto out_unlock;
+		goto out_exit;
 	}
 
-	if (mmio_num >= USER_MMIO_MAX) {
+	if (!mmio_in_bounds(h, mmio_num, offset, sizeof(uint64_t))) {
 		res = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		goto out_exit;
 	}
 
 	*value = *((volatile uint64_t *)get_user_offset(h, mmio_num, offset));
 
-out_unlock:
-	opae_mutex_unlock(err, &h->lock);
+out_exit:
+	mmio_exit(h);
 	return res;
 }
 
@@ -1077,27 +1219,26 @@ fpga_result __VFIO_API__ vfio_fpgaWriteMMIO32(fpga_handle handle,
 	vfio_handle *h;
 	vfio_token *t;
 	fpga_result res = FPGA_OK;
-	int err;
 
-	h = handle_check_and_lock(handle);
+	h = mmio_enter(handle);
 	ASSERT_NOT_NULL(h);
 
 	t = h->token;
 
 	if (t->hdr.objtype == FPGA_DEVICE) {
 		res = FPGA_NOT_SUPPORTED;
-		goto out_unlock;
+		goto out_exit;
 	}
 
-	if (mmio_num >= USER_MMIO_MAX) {
+	if (!mmio_in_bounds(h, mmio_num, offset, sizeof(uint32_t))) {
 		res = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		goto out_exit;
 	}
 
 	*((volatile uint32_t *)get_user_offset(h, mmio_num, offset)) = value;
 
-out_unlock:
-	opae_mutex_unlock(err, &h->lock);
+out_exit:
+	mmio_exit(h);
 	return res;
 }
 
@@ -1109,82 +1250,270 @@ fpga_result __VFIO_API__ vfio_fpgaReadMMIO32(fpga_handle handle,
 	vfio_handle *h;
 	vfio_token *t;
 	fpga_result res = FPGA_OK;
-	int err;
 
-	h = handle_check_and_lock(handle);
+	h = mmio_enter(handle);
 	ASSERT_NOT_NULL(h);
 
 	t = h->token;
 
 	if (t->hdr.objtype == FPGA_DEVICE) {
 		res = FPGA_NOT_SUPPORTED;
-		goto out_unlock;
+		goto out_exit;
 	}
 
-	if (mmio_num >= USER_MMIO_MAX) {
+	if (!mmio_in_bounds(h, mmio_num, offset, sizeof(uint32_t))) {
 		res = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		goto out_exit;
 	}
 
 	*value = *((volatile uint32_t *)get_user_offset(h, mmio_num, offset));
 
-out_unlock:
-	opae_mutex_unlock(err, &h->lock);
+out_exit:
+	mmio_exit(h);
+	return res;
+}
+
+fpga_result __VFIO_API__ vfio_fpgaWriteMMIO512(fpga_handle handle,
+					       uint32_t mmio_num,
+					       uint64_t offset,
+					       const void *value)
+{
+	vfio_handle *h;
+	vfio_token *t;
+	fpga_result res = FPGA_OK;
 
+	if ((offset % 64) != 0) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = mmio_enter(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if ((t->hdr.objtype == FPGA_DEVICE) || !h->mmio_wide) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_exit;
+	}
+
+	if (!mmio_in_bounds(h, mmio_num, offset, 64)) {
+		res = FPGA_INVALID_PARAM;
+		goto out_exit;
+	}
+
+	h->mmio_wide->write512(get_user_offset(h, mmio_num, offset), value);
+
+out_exit:
+	mmio_exit(h);
 	return res;
 }
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__) && GCC_VERSION >= 40900
-static inline void copy512(const void *src, void *dst)
+fpga_result __VFIO_API__ vfio_fpgaReadMMIO512(fpga_handle handle,
+					      uint32_t mmio_num,
+					      uint64_t offset,
+					      void *value)
 {
-    asm volatile("vmovdqu64 (%0), %%zmm0;"
-		 "vmovdqu64 %%zmm0, (%1);"
-		 :
-		 : "r"(src), "r"(dst));
+	vfio_handle *h;
+	vfio_token *t;
+	fpga_result res = FPGA_OK;
+
+	if ((offset % 64) != 0) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = mmio_enter(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if ((t->hdr.objtype == FPGA_DEVICE) || !h->mmio_wide) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_exit;
+	}
+
+	if (!mmio_in_bounds(h, mmio_num, offset, 64)) {
+		res = FPGA_INVALID_PARAM;
+		goto out_exit;
+	}
+
+	h->mmio_wide->read512(value, get_user_offset(h, mmio_num, offset));
+
+out_exit:
+	mmio_exit(h);
+	return res;
 }
-#else
-static inline void copy512(const void *src, void *dst)
+
+fpga_result __VFIO_API__ vfio_fpgaCopyToMMIO(fpga_handle handle,
+					     uint32_t mmio_num,
+					     uint64_t offset,
+					     const void *src,
+					     uint64_t len)
 {
-	UNUSED_PARAM(src);
-	UNUSED_PARAM(dst);
+	vfio_handle *h;
+	vfio_token *t;
+	fpga_result res = FPGA_OK;
+
+	ASSERT_NOT_NULL(src);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
+		OPAE_ERR("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = mmio_enter(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if (t->hdr.objtype == FPGA_DEVICE) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_exit;
+	}
+
+	if (!mmio_in_bounds(h, mmio_num, offset, len)) {
+		res = FPGA_INVALID_PARAM;
+		goto out_exit;
+	}
+
+	opae_mmio_copy_to(h->mmio_wide, get_user_offset(h, mmio_num, offset),
+			  (const uint8_t *)src, len);
+
+out_exit:
+	mmio_exit(h);
+	return res;
 }
-#endif // x86
 
-fpga_result __VFIO_API__ vfio_fpgaWriteMMIO512(fpga_handle handle,
+fpga_result __VFIO_API__ vfio_fpgaCopyFromMMIO(fpga_handle handle,
 					       uint32_t mmio_num,
 					       uint64_t offset,
-					       const void *value)
+					       void *dst,
+					       uint64_t len)
 {
 	vfio_handle *h;
 	vfio_token *t;
 	fpga_result res = FPGA_OK;
-	int err;
 
-	if ((offset % 64) != 0) {
+	ASSERT_NOT_NULL(dst);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
 		OPAE_ERR("Misaligned MMIO access");
 		return FPGA_INVALID_PARAM;
 	}
 
-	h = handle_check_and_lock(handle);
+	h = mmio_enter(handle);
 	ASSERT_NOT_NULL(h);
 
 	t = h->token;
 
-	if ((t->hdr.objtype == FPGA_DEVICE) ||
-	    !(h->flags & OPAE_FLAG_HAS_AVX512)) {
+	if (t->hdr.objtype == FPGA_DEVICE) {
 		res = FPGA_NOT_SUPPORTED;
-		goto out_unlock;
+		goto out_exit;
 	}
 
-	if (mmio_num >= USER_MMIO_MAX) {
+	if (!mmio_in_bounds(h, mmio_num, offset, len)) {
 		res = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		goto out_exit;
 	}
 
-	copy512(value, (uint8_t *)get_user_offset(h, mmio_num, offset));
+	opae_mmio_copy_from(h->mmio_wide, (uint8_t *)dst,
+			    get_user_offset(h, mmio_num, offset), len);
 
-out_unlock:
-	opae_mutex_unlock(err, &h->lock);
+out_exit:
+	mmio_exit(h);
+	return res;
+}
+
+fpga_result __VFIO_API__ vfio_fpgaReadMMIOBatch(fpga_handle handle,
+						fpga_mmio_op *ops,
+						uint32_t num_ops)
+{
+	vfio_handle *h;
+	vfio_token *t;
+	fpga_result res = FPGA_OK;
+	uint32_t i;
+
+	h = mmio_enter(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if (t->hdr.objtype == FPGA_DEVICE) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_exit;
+	}
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		volatile uint8_t *p;
+
+		if (!mmio_in_bounds(h, ops[i].mmio_num,
+				    ops[i].offset, ops[i].width)) {
+			res = FPGA_INVALID_PARAM;
+			goto out_exit;
+		}
+
+		p = get_user_offset(h, ops[i].mmio_num, ops[i].offset);
+
+		if (ops[i].width == sizeof(uint64_t)) {
+			ops[i].value = *((volatile uint64_t *)p);
+		} else if (ops[i].width == sizeof(uint32_t)) {
+			ops[i].value = *((volatile uint32_t *)p);
+		} else {
+			OPAE_ERR("invalid MMIO width %u", ops[i].width);
+			res = FPGA_INVALID_PARAM;
+			goto out_exit;
+		}
+	}
+
+out_exit:
+	mmio_exit(h);
+	return res;
+}
+
+fpga_result __VFIO_API__ vfio_fpgaWriteMMIOBatch(fpga_handle handle,
+						 const fpga_mmio_op *ops,
+						 uint32_t num_ops)
+{
+	vfio_handle *h;
+	vfio_token *t;
+	fpga_result res = FPGA_OK;
+	uint32_t i;
+
+	h = mmio_enter(handle);
+	ASSERT_NOT_NULL(h);
+
+	t = h->token;
+
+	if (t->hdr.objtype == FPGA_DEVICE) {
+		res = FPGA_NOT_SUPPORTED;
+		goto out_exit;
+	}
+
+	for (i = 0 ; i < num_ops ; ++i) {
+		volatile uint8_t *p;
+
+		if (!mmio_in_bounds(h, ops[i].mmio_num,
+				    ops[i].offset, ops[i].width)) {
+			res = FPGA_INVALID_PARAM;
+			goto out_exit;
+		}
+
+		p = get_user_offset(h, ops[i].mmio_num, ops[i].offset);
+
+		if (ops[i].width == sizeof(uint64_t)) {
+			*((volatile uint64_t *)p) = ops[i].value;
+		} else if (ops[i].width == sizeof(uint32_t)) {
+			*((volatile uint32_t *)p) = (uint32_t)ops[i].value;
+		} else {
+			OPAE_ERR("invalid MMIO width %u", ops[i].width);
+			res = FPGA_INVALID_PARAM;
+			goto out_exit;
+		}
+	}
+
+out_exit:
+	mmio_exit(h);
 	return res;
 }
 
@@ -1387,6 +1716,59 @@ STATIC bool matches_filters(const fpga_properties *filters,
 	return false;
 }
 
+#define VFIO_WALK_THREADS_MAX 16
+
+STATIC void *vfio_walk_thread(void *arg)
+{
+	vfio_walk((vfio_pci_device_t *)arg);
+	return NULL;
+}
+
+STATIC bool vfio_is_virtfn(const vfio_pci_device_t *dev)
+{
+	char physfn[PCIADDR_MAX];
+
+	return !read_pci_link(dev->addr, "physfn", physfn, PCIADDR_MAX-1);
+}
+
+// Walk the devices matching the filters that haven't been seen yet.
+// Opening a device through vfio dominates enumeration time, so physical
+// functions are walked concurrently. A virtual function opens its physical
+// function during the walk, so virtual functions are walked one at a time
+// once the physical functions are done.
+STATIC void vfio_walk_devices(const fpga_properties *filters,
+			      uint32_t num_filters)
+{
+	vfio_pci_device_t *dev;
+	pthread_t threads[VFIO_WALK_THREADS_MAX];
+	uint32_t num_threads = 0;
+	uint32_t i;
+
+	for (dev = _pci_devices ; dev ; dev = dev->next) {
+		if (dev->tokens ||
+		    !pci_matches_filters(filters, num_filters, dev) ||
+		    vfio_is_virtfn(dev))
+			continue;
+
+		if ((num_threads < VFIO_WALK_THREADS_MAX) &&
+		    !pthread_create(&threads[num_threads], NULL,
+				    vfio_walk_thread, dev))
+			++num_threads;
+		else
+			vfio_walk(dev);
+	}
+
+	for (i = 0 ; i < num_threads ; ++i)
+		pthread_join(threads[i], NULL);
+
+	for (dev = _pci_devices ; dev ; dev = dev->next) {
+		if (!dev->tokens &&
+		    pci_matches_filters(filters, num_filters, dev) &&
+		    vfio_is_virtfn(dev))
+			vfio_walk(dev);
+	}
+}
+
 fpga_result __VFIO_API__ vfio_fpgaEnumerate(const fpga_properties *filters,
 			       uint32_t num_filters, fpga_token *tokens,
 			       uint32_t max_tokens, uint32_t *num_matches)
@@ -1394,14 +1776,13 @@ fpga_result __VFIO_API__ vfio_fpgaEnumerate(const fpga_properties *filters,
 	vfio_pci_device_t *dev = _pci_devices;
 	uint32_t matches = 0;
 
+	// Walk the devices that haven't been seen yet
+	vfio_walk_devices(filters, num_filters);
+
 	while (dev) {
 		if (pci_matches_filters(filters, num_filters, dev)) {
 			vfio_token *tptr;
 
-			// Walk the device if it hasn't been seen yet
-			if (!dev->tokens)
-				vfio_walk(dev);
-
 			tptr = dev->tokens;
 
 			while (tptr) {
@@ -1490,15 +1871,91 @@ fpga_result __VFIO_API__ vfio_fpgaDestroyToken(fpga_token *token)
 	return FPGA_INVALID_PARAM;
 }
 
-#define HUGE_1G (1*1024*1024*1024)
 #define HUGE_2M (2*1024*1024)
 #define ROUND_UP(N, M) ((N + M - 1) & ~(M-1))
 
-fpga_result __VFIO_API__ vfio_fpgaPrepareBuffer(fpga_handle handle,
-						uint64_t len,
-						void **buf_addr,
-						uint64_t *wsid,
-						int flags)
+STATIC fpga_result vfio_slab_prepare(vfio_handle *h,
+				     uint64_t len,
+				     void **buf_addr,
+				     uint64_t *wsid)
+{
+	vfio_slab_buffer *sb;
+	void *virt = NULL;
+	uint64_t iova = 0;
+	fpga_result res = FPGA_OK;
+	int err;
+
+	sb = opae_calloc(1, sizeof(vfio_slab_buffer));
+	if (!sb) {
+		OPAE_ERR("Failed to allocate memory for slab buffer");
+		return FPGA_NO_MEMORY;
+	}
+
+	if (opae_mutex_lock(err, &h->lock)) {
+		opae_free(sb);
+		return FPGA_EXCEPTION;
+	}
+
+	if (mem_slab_get(&h->slab, len, &virt, &iova)) {
+		OPAE_DBG("could not allocate slab buffer");
+		res = FPGA_NO_MEMORY;
+		goto out_unlock;
+	}
+
+	sb->binfo.buffer_ptr = (uint8_t *)virt;
+	sb->binfo.buffer_size = len;
+	sb->binfo.buffer_iova = iova;
+	sb->binfo.flags = OPAE_VFIO_BUF_SLAB;
+
+	sb->next = h->slab_buffers;
+	if (sb->next)
+		sb->next->prev = sb;
+	h->slab_buffers = sb;
+
+	*buf_addr = virt;
+	*wsid = (uint64_t)sb;
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	if (res)
+		opae_free(sb);
+	return res;
+}
+
+STATIC fpga_result vfio_slab_release(vfio_handle *h, vfio_slab_buffer *sb)
+{
+	fpga_result res = FPGA_OK;
+	int err;
+
+	if (opae_mutex_lock(err, &h->lock))
+		return FPGA_EXCEPTION;
+
+	if (mem_slab_put(&h->slab, sb->binfo.buffer_ptr)) {
+		OPAE_ERR("error freeing vfio slab buffer");
+		res = FPGA_NOT_FOUND;
+		goto out_unlock;
+	}
+
+	if (sb->prev)
+		sb->prev->next = sb->next;
+	else
+		h->slab_buffers = sb->next;
+	if (sb->next)
+		sb->next->prev = sb->prev;
+
+	opae_free(sb);
+
+out_unlock:
+	opae_mutex_unlock(err, &h->lock);
+	return res;
+}
+
+fpga_result __VFIO_API__ vfio_fpgaPrepareBufferEx(fpga_handle handle,
+						  uint64_t len,
+						  void **buf_addr,
+						  uint64_t *wsid,
+						  int flags,
+						  int numa_node)
 {
 	vfio_handle *h;
 	uint8_t *virt = NULL;
@@ -1525,20 +1982,59 @@ fpga_result __VFIO_API__ vfio_fpgaPrepareBuffer(fpga_handle handle,
 	h = handle_check(handle);
 	ASSERT_NOT_NULL(h);
 
+	if ((numa_node != FPGA_NUMA_NODE_ANY) &&
+	    !mem_bind_node_valid(numa_node)) {
+		OPAE_ERR("invalid NUMA node %d", numa_node);
+		return FPGA_INVALID_PARAM;
+	}
+
+	if ((numa_node == FPGA_NUMA_NODE_ANY) &&
+	    (flags & FPGA_BUF_NUMA_LOCAL) &&
+	    (h->token->device->numa_node != INVALID_NUMA_NODE))
+		numa_node = (int)h->token->device->numa_node;
+
+	// Neither slab regions nor pooled buffers have a fixed placement.
+	if (numa_node != FPGA_NUMA_NODE_ANY)
+		flags &= ~FPGA_BUF_SLAB;
+
+	if (flags & FPGA_BUF_SLAB) {
+		if (flags & FPGA_BUF_PREALLOCATED) {
+			OPAE_ERR("FPGA_BUF_SLAB with FPGA_BUF_PREALLOCATED");
+			return FPGA_INVALID_PARAM;
+		}
+		if (mem_slab_region_size(len))
+			return vfio_slab_prepare(h, len, buf_addr, wsid);
+	}
+
 	fpga_result res = FPGA_EXCEPTION;
 
 	struct opae_vfio *v = h->vfio_pair->device;
 	uint64_t iova = 0;
 	size_t sz;
-	if (len > HUGE_2M)
-		sz = ROUND_UP(len, HUGE_1G);
-	else if (len > 4096)
+	// Larger buffers are built from 2 MiB pages by libopaevfio,
+	// or from 1 GiB pages when len is a multiple of 1 GiB.
+	if (len > 4096)
 		sz = ROUND_UP(len, HUGE_2M);
 	else
 		sz = 4096;
-	if (opae_vfio_buffer_allocate_ex(v, &sz, &virt, &iova, flags)) {
+
+	if (h->pool && !(flags & FPGA_BUF_PREALLOCATED) &&
+	    (numa_node == FPGA_NUMA_NODE_ANY)) {
+		binfo = vfio_buffer_pool_get(h->pool, sz);
+		if (binfo) {
+			*buf_addr = binfo->buffer_ptr;
+			*wsid = (uint64_t)binfo;
+			return FPGA_OK;
+		}
+	}
+
+	// FPGA_BUF_PREALLOCATED and FPGA_BUF_PREFAULT have the values of
+	// OPAE_VFIO_BUF_PREALLOCATED and OPAE_VFIO_BUF_PREFAULT.
+	if (opae_vfio_buffer_allocate_node(v, &sz, &virt, &iova, flags,
+					   numa_node)) {
 		OPAE_DBG("could not allocate buffer");
-		return FPGA_EXCEPTION;
+		return (numa_node == FPGA_NUMA_NODE_ANY) ?
+			FPGA_EXCEPTION : FPGA_NO_MEMORY;
 	}
 	binfo = opae_vfio_buffer_info(v, virt);
 
@@ -1564,6 +2060,223 @@ out_free:
 	return res;
 }
 
+fpga_result __VFIO_API__ vfio_fpgaPrepareBuffer(fpga_handle handle,
+						uint64_t len,
+						void **buf_addr,
+						uint64_t *wsid,
+						int flags)
+{
+	return vfio_fpgaPrepareBufferEx(handle, len, buf_addr, wsid, flags,
+					FPGA_NUMA_NODE_ANY);
+}
+
+// Drop sgb's references to its segments, unmapping those left unused.
+// The caller holds h->lock.
+STATIC fpga_result vfio_sg_put_segs(vfio_handle *h, vfio_sg_buffer *sgb)
+{
+	void *context = h->vfio_pair->device;
+	fpga_result res = FPGA_OK;
+	vfio_sg_seg **pp;
+	vfio_sg_seg *seg;
+	uint32_t i;
+
+	for (i = 0 ; i < sgb->num_segs ; ++i) {
+		seg = sgb->segs[i];
+		if (--seg->refs)
+			continue;
+
+		for (pp = &h->sg_segs ; *pp != seg ; pp = &(*pp)->next)
+			;
+		*pp = seg->next;
+
+		if (h->sg_unmap(context, seg->vaddr)) {
+			OPAE_ERR("error freeing vfio buffer");
+			res = FPGA_NOT_FOUND;
+		}
+		opae_free(seg);
+	}
+
+	sgb->num_segs = 0;
+	return res;
+}
+
+STATIC fpga_result vfio_sg_release(vfio_handle *h, vfio_sg_buffer *sgb)
+{
+	fpga_result res;
+	int err;
+
+	if (opae_mutex_lock(err, &h->lock))
+		return FPGA_EXCEPTION;
+
+	res = vfio_sg_put_segs(h, sgb);
+
+	if (sgb->prev)
+		sgb->prev->next = sgb->next;
+	else
+		h->sg_buffers = sgb->next;
+	if (sgb->next)
+		sgb->next->prev = sgb->prev;
+
+	opae_mutex_unlock(err, &h->lock);
+
+	opae_free(sgb);
+	return res;
+}
+
+STATIC vfio_sg_seg *vfio_sg_seg_find(vfio_handle *h, uint8_t *vaddr)
+{
+	vfio_sg_seg *seg;
+
+	for (seg = h->sg_segs ; seg ; seg = seg->next) {
+		if (seg->vaddr == vaddr)
+			return seg;
+	}
+
+	return NULL;
+}
+
+fpga_result __VFIO_API__ vfio_fpgaPrepareBufferSG(fpga_handle handle,
+						  void *buf_addr,
+						  uint64_t len,
+						  uint64_t *wsid,
+						  fpga_sg_entry *sg,
+						  uint32_t *num_sg,
+						  int flags)
+{
+	const uint64_t pg_size = (uint64_t)sysconf(_SC_PAGE_SIZE);
+	vfio_handle *h;
+	vfio_sg_buffer *sgb;
+	vfio_sg_seg *seg;
+	void *context;
+	uint64_t start;
+	uint64_t end;
+	uint64_t cur;
+	uint64_t chunk;
+	uint32_t last;
+	int err;
+
+	ASSERT_NOT_NULL(buf_addr);
+	ASSERT_NOT_NULL(wsid);
+	ASSERT_NOT_NULL(sg);
+	ASSERT_NOT_NULL(num_sg);
+
+	h = handle_check(handle);
+	ASSERT_NOT_NULL(h);
+
+	if (!len || !*num_sg) {
+		OPAE_ERR("zero length or empty segment list");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (flags & ~(FPGA_BUF_READ_ONLY | FPGA_BUF_QUIET)) {
+		OPAE_ERR("unsupported flags 0x%x", flags);
+		return FPGA_INVALID_PARAM;
+	}
+
+	sgb = opae_calloc(1, sizeof(*sgb) + *num_sg * sizeof(vfio_sg_seg *));
+	if (!sgb) {
+		OPAE_ERR("calloc failed");
+		return FPGA_NO_MEMORY;
+	}
+
+	if (opae_mutex_lock(err, &h->lock)) {
+		opae_free(sgb);
+		return FPGA_EXCEPTION;
+	}
+
+	context = h->vfio_pair->device;
+	start = (uint64_t)buf_addr & ~(pg_size - 1);
+	end = ROUND_UP((uint64_t)buf_addr + len, pg_size);
+
+	// The IOMMU makes the whole range IOVA-contiguous when one free
+	// IOVA range can hold it. Otherwise, map it in halves, and so on.
+	chunk = end - start;
+	cur = start;
+	while (cur < end) {
+		uint64_t iova = 0;
+		size_t sz;
+
+		if (sgb->num_segs == *num_sg) {
+			if (!(flags & FPGA_BUF_QUIET))
+				OPAE_ERR("buffer needs more than %u segments",
+					 *num_sg);
+			goto out_release;
+		}
+
+		// A segment starting at cur is already mapped: share it.
+		seg = vfio_sg_seg_find(h, (uint8_t *)cur);
+		if (seg) {
+			sz = seg->size;
+			if (sz > end - cur)
+				sz = end - cur;
+			++seg->refs;
+			goto out_add;
+		}
+
+		if (chunk > end - cur)
+			chunk = end - cur;
+		sz = chunk;
+
+		if (h->sg_map(context, (uint8_t *)cur, sz, &iova)) {
+			if (chunk == pg_size) {
+				if (!(flags & FPGA_BUF_QUIET))
+					OPAE_ERR("could not map 0x%lx", cur);
+				goto out_release;
+			}
+			chunk = ROUND_UP(chunk / 2, pg_size);
+			continue;
+		}
+
+		seg = opae_calloc(1, sizeof(vfio_sg_seg));
+		if (!seg) {
+			OPAE_ERR("calloc failed");
+			h->sg_unmap(context, (uint8_t *)cur);
+			goto out_release;
+		}
+
+		seg->vaddr = (uint8_t *)cur;
+		seg->iova = iova;
+		seg->size = sz;
+		seg->refs = 1;
+		seg->next = h->sg_segs;
+		h->sg_segs = seg;
+
+out_add:
+		sg[sgb->num_segs].iova = seg->iova;
+		sg[sgb->num_segs].len = sz;
+		sgb->segs[sgb->num_segs++] = seg;
+		cur += sz;
+	}
+
+	// Trim the pinned pages to the caller's range.
+	last = sgb->num_segs - 1;
+	sg[0].iova += (uint64_t)buf_addr - start;
+	sg[0].len -= (uint64_t)buf_addr - start;
+	sg[last].len -= end - ((uint64_t)buf_addr + len);
+
+	sgb->binfo.buffer_ptr = buf_addr;
+	sgb->binfo.buffer_size = len;
+	sgb->binfo.buffer_iova = sg[0].iova;
+	sgb->binfo.flags = OPAE_VFIO_BUF_SG;
+
+	sgb->next = h->sg_buffers;
+	if (sgb->next)
+		sgb->next->prev = sgb;
+	h->sg_buffers = sgb;
+
+	*num_sg = sgb->num_segs;
+	*wsid = (uint64_t)sgb;
+
+	opae_mutex_unlock(err, &h->lock);
+	return FPGA_OK;
+
+out_release:
+	vfio_sg_put_segs(h, sgb);
+	opae_mutex_unlock(err, &h->lock);
+	opae_free(sgb);
+	return FPGA_NO_MEMORY;
+}
+
 fpga_result __VFIO_API__ vfio_fpgaReleaseBuffer(fpga_handle handle,
 						uint64_t wsid)
 {
@@ -1577,7 +2290,21 @@ fpga_result __VFIO_API__ vfio_fpgaReleaseBuffer(fpga_handle handle,
 
 	ASSERT_NOT_NULL(binfo);
 
-	if (opae_vfio_buffer_free(v, binfo->buffer_ptr)) {
+	if (binfo->flags & OPAE_VFIO_BUF_SLAB)
+		return vfio_slab_release(h, (vfio_slab_buffer *)binfo);
+
+	if (binfo->flags & OPAE_VFIO_BUF_SG)
+		return vfio_sg_release(h, (vfio_sg_buffer *)binfo);
+
+	// Keep the buffer pinned and mapped for the next fpgaPrepareBuffer().
+	if (h->pool && !(binfo->flags & OPAE_VFIO_BUF_PREALLOCATED) &&
+	    !vfio_buffer_pool_put(h->pool, binfo))
+		return FPGA_OK;
+
+	// A deferred free returns once the buffer is queued for unmapping.
+	if ((h->open_flags & FPGA_OPEN_DEFERRED_RELEASE) ?
+	    opae_vfio_buffer_free_deferred(v, binfo->buffer_ptr) :
+	    opae_vfio_buffer_free(v, binfo->buffer_ptr)) {
 		OPAE_ERR("error freeing vfio buffer");
 		res = FPGA_NOT_FOUND;
 	}
@@ -1585,6 +2312,20 @@ fpga_result __VFIO_API__ vfio_fpgaReleaseBuffer(fpga_handle handle,
 	return res;
 }
 
+fpga_result __VFIO_API__ vfio_fpgaDrainBufferReleases(fpga_handle handle)
+{
+	vfio_handle *h = handle_check(handle);
+
+	ASSERT_NOT_NULL(h);
+
+	if (opae_vfio_buffer_drain(h->vfio_pair->device)) {
+		OPAE_ERR("error draining vfio buffer releases");
+		return FPGA_EXCEPTION;
+	}
+
+	return FPGA_OK;
+}
+
 fpga_result __VFIO_API__ vfio_fpgaGetIOAddress(fpga_handle handle,
 					       uint64_t wsid,
 					       uint64_t *ioaddr)
@@ -1602,6 +2343,51 @@ fpga_result __VFIO_API__ vfio_fpgaGetIOAddress(fpga_handle handle,
 	return FPGA_OK;
 }
 
+fpga_result __VFIO_API__ vfio_fpgaGetBufferPoolStats(fpga_handle handle,
+						    fpga_buffer_pool_stats *stats)
+{
+	vfio_handle *h;
+
+	ASSERT_NOT_NULL(stats);
+
+	h = handle_check(handle);
+	ASSERT_NOT_NULL(h);
+
+	if (!h->pool)
+		return FPGA_NOT_SUPPORTED;
+
+	vfio_buffer_pool_get_stats(h->pool, stats);
+
+	return FPGA_OK;
+}
+
+fpga_result __VFIO_API__
+vfio_fpgaGetBufferPrepareStats(fpga_handle handle,
+			       fpga_buffer_prepare_stats *stats)
+{
+	struct opae_vfio_buffer_stats vstats;
+	vfio_handle *h;
+
+	ASSERT_NOT_NULL(stats);
+
+	h = handle_check(handle);
+	ASSERT_NOT_NULL(h);
+
+	if (opae_vfio_buffer_get_stats(h->vfio_pair->device, &vstats)) {
+		OPAE_ERR("error reading buffer statistics");
+		return FPGA_EXCEPTION;
+	}
+
+	stats->buffers = vstats.buffers;
+	stats->bytes = vstats.bytes;
+	stats->prefaulted = vstats.prefaulted;
+	stats->alloc_ns = vstats.alloc_ns;
+	stats->prefault_ns = vstats.prefault_ns;
+	stats->map_ns = vstats.map_ns;
+
+	return FPGA_OK;
+}
+
 fpga_result __VFIO_API__ vfio_fpgaBindSVA(fpga_handle handle, uint32_t *pasid)
 {
 	vfio_handle *h;
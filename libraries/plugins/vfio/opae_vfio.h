@@ -28,6 +28,10 @@
 #include <opae/vfio.h>
 #include <opae/fpga.h>
 
+#include "mmio-wide.h"
+#include "buffer_pool.h"
+#include <opae/mem_slab.h>
+
 #define GUIDSTR_MAX 36
 
 #ifdef __GNUC__
@@ -92,6 +96,41 @@ typedef struct _vfio_pair {
 	struct opae_vfio *physfn;
 } vfio_pair_t;
 
+// opae_vfio_buffer flag marking an FPGA_BUF_SLAB sub-allocation.
+#define OPAE_VFIO_BUF_SLAB (1u << 30)
+
+typedef struct _vfio_slab_buffer {
+	struct opae_vfio_buffer binfo; //< Must appear at offset 0! (wsid)
+	struct _vfio_slab_buffer *prev;
+	struct _vfio_slab_buffer *next;
+} vfio_slab_buffer;
+
+// opae_vfio_buffer flag marking an fpgaPrepareBufferSG() buffer.
+#define OPAE_VFIO_BUF_SG (1u << 29)
+
+// A pinned and mapped piece of an fpgaPrepareBufferSG() range.
+// libopaevfio keys its buffers by start address, so SG buffers that
+// begin in the same page share that page's segment.
+typedef struct _vfio_sg_seg {
+	uint8_t *vaddr;
+	uint64_t iova;
+	size_t size;
+	uint32_t refs;                 //< SG buffers using the segment
+	struct _vfio_sg_seg *next;
+} vfio_sg_seg;
+
+typedef int (*vfio_sg_map_fn)(void *context, uint8_t *vaddr,
+			      size_t size, uint64_t *iova);
+typedef int (*vfio_sg_unmap_fn)(void *context, uint8_t *vaddr);
+
+typedef struct _vfio_sg_buffer {
+	struct opae_vfio_buffer binfo; //< Must appear at offset 0! (wsid)
+	struct _vfio_sg_buffer *prev;
+	struct _vfio_sg_buffer *next;
+	uint32_t num_segs;
+	vfio_sg_seg *segs[];
+} vfio_sg_buffer;
+
 typedef struct _vfio_handle {
 	uint32_t magic;
 	vfio_token *token;
@@ -102,7 +141,16 @@ typedef struct _vfio_handle {
 	pthread_mutex_t lock;
 	int sva_fd;
 	int pasid;
-#define OPAE_FLAG_HAS_AVX512 (1u << 0)
+	int open_flags;       // flags given to fpgaOpen(), immutable
+	uint32_t mmio_users;  // in-flight FPGA_OPEN_LOCKLESS_MMIO accesses
+	const opae_mmio_wide *mmio_wide; // 512 bit MMIO kernels, or NULL
+	vfio_buffer_pool *pool; // FPGA_OPEN_BUFFER_POOL buffer cache, or NULL
+	struct mem_slab slab;   // FPGA_BUF_SLAB regions, protected by lock
+	vfio_slab_buffer *slab_buffers; // live FPGA_BUF_SLAB buffers
+	vfio_sg_buffer *sg_buffers; // live fpgaPrepareBufferSG() buffers
+	vfio_sg_seg *sg_segs;       // their segments, protected by lock
+	vfio_sg_map_fn sg_map;
+	vfio_sg_unmap_fn sg_unmap;
 #define OPAE_FLAG_SVA_FD_VALID (1u << 1)  // Indicates sva_fd file handle is valid
 #define OPAE_FLAG_PASID_VALID (1u << 2)   // Indicates pasid is set
 	uint32_t flags;
@@ -106,6 +106,16 @@ int __VFIO_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaReadMMIO32");
 	adapter->fpgaWriteMMIO512 =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaWriteMMIO512");
+	adapter->fpgaReadMMIO512 =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaReadMMIO512");
+	adapter->fpgaReadMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaReadMMIOBatch");
+	adapter->fpgaWriteMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaWriteMMIOBatch");
+	adapter->fpgaCopyToMMIO =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaCopyToMMIO");
+	adapter->fpgaCopyFromMMIO =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaCopyFromMMIO");
 	adapter->fpgaMapMMIO =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaMapMMIO");
 	adapter->fpgaUnmapMMIO =
@@ -118,12 +128,24 @@ int __VFIO_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaDestroyToken");
 	adapter->fpgaPrepareBuffer =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaPrepareBuffer");
+	adapter->fpgaPrepareBufferEx =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaPrepareBufferEx");
+	adapter->fpgaPrepareBufferSG =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaPrepareBufferSG");
 	adapter->fpgaReleaseBuffer =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaReleaseBuffer");
+	adapter->fpgaDrainBufferReleases =
+		dlsym(adapter->plugin.dl_handle,
+		      "vfio_fpgaDrainBufferReleases");
 	adapter->fpgaGetIOAddress =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaGetIOAddress");
 	adapter->fpgaBindSVA =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaBindSVA");
+	adapter->fpgaGetBufferPoolStats =
+		dlsym(adapter->plugin.dl_handle, "vfio_fpgaGetBufferPoolStats");
+	adapter->fpgaGetBufferPrepareStats =
+		dlsym(adapter->plugin.dl_handle,
+		      "vfio_fpgaGetBufferPrepareStats");
 	adapter->fpgaPinBuffer =
 		dlsym(adapter->plugin.dl_handle, "vfio_fpgaPinBuffer");
 	adapter->fpgaUnpinBuffer =
@@ -29,8 +29,10 @@
 #endif // HAVE_CONFIG_H
 
 #include "opae/access.h"
+#include "opae/buffer.h"
 #include "opae/utils.h"
 #include "common_int.h"
+#include "xfpga.h"
 #include "intel-fpga.h"
 
 #include "opae_drv.h"
@@ -41,28 +43,60 @@
 #include <sys/mman.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <opae/mem_prefault.h>
+#include <opae/mem_bind.h>
+
+STATIC uint64_t buffer_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/*
+ * Size of the pages that back a buffer from buffer_allocate()
+ */
+STATIC uint64_t buffer_page_size(uint64_t len)
+{
+	if (len > 2 * MB)
+		return 1 * GB;
+	if (len > 4 * KB)
+		return 2 * MB;
+	return 4 * KB;
+}
+
 /*
  * Allocate (mmap) new buffer
+ *
+ * With FPGA_BUF_PREFAULT in flags, a buffer of a single page is
+ * populated by mmap().
  */
 STATIC fpga_result buffer_allocate(void **addr, uint64_t len, int flags)
 {
 	void *addr_local = NULL;
-
-	UNUSED_PARAM(flags);
+	int populate = 0;
 
 	ASSERT_NOT_NULL(addr);
 
+	if ((flags & FPGA_BUF_PREFAULT) && (len <= buffer_page_size(len)))
+		populate = MAP_POPULATE;
+
 	/* ! FPGA_BUF_PREALLOCATED, allocate memory using huge pages
 	   For buffer > 2M, use 1G-hugepage to ensure pages are
 	   contiguous */
 	if (len > 2 * MB)
-		addr_local = mmap(ADDR, len, PROTECTION, FLAGS_1G, 0, 0);
+		addr_local = mmap(ADDR, len, PROTECTION, FLAGS_1G | populate,
+				  0, 0);
 	else if (len > 4 * KB)
-		addr_local = mmap(ADDR, len, PROTECTION, FLAGS_2M, 0, 0);
+		addr_local = mmap(ADDR, len, PROTECTION, FLAGS_2M | populate,
+				  0, 0);
 	else
-		addr_local = mmap(ADDR, len, PROTECTION, FLAGS_4K, 0, 0);
+		addr_local = mmap(ADDR, len, PROTECTION, FLAGS_4K | populate,
+				  0, 0);
 	if (addr_local == MAP_FAILED) {
 		if (errno == ENOMEM) {
 			if (len > 2 * MB)
@@ -117,9 +151,147 @@ STATIC fpga_result buffer_release(void *addr, uint64_t len)
 	return FPGA_OK;
 }
 
+/*
+ * Bind the pages of a buffer from buffer_allocate() to numa_node.
+ * Must be called before the pages are first touched.
+ */
+STATIC fpga_result buffer_bind(void *addr, uint64_t len, int numa_node)
+{
+	/* mbind() must cover whole hugepages; see buffer_release(). */
+	if (len > 2 * MB)
+		len = (len + (1 * GB - 1)) & (~(1 * GB - 1));
+	else if (len > 4 * KB)
+		len = 2 * MB;
+
+	if (mem_bind(addr, len, numa_node)) {
+		OPAE_MSG("mbind() to node %d failed: %s", numa_node,
+			 strerror(errno));
+		return FPGA_NO_MEMORY;
+	}
+
+	return FPGA_OK;
+}
+
+/*
+ * Populate the pages of a buffer from buffer_allocate(), after any
+ * NUMA binding and before the pages are pinned.
+ */
+STATIC void buffer_prefault(void *addr, uint64_t len, int numa_node)
+{
+	uint64_t pg_size = buffer_page_size(len);
+
+	len = (len + (pg_size - 1)) & ~(pg_size - 1);
+
+	/* On failure, the pages are faulted in by the DMA map. */
+	if (mem_prefault(addr, len, pg_size, numa_node))
+		OPAE_MSG("Failed to prefault buffer pages");
+}
+
+/*
+ * Account for a new DMA mapping in the handle's preparation statistics.
+ * Called with the handle lock held.
+ */
+STATIC void prep_stats_add(struct _fpga_handle *_handle, uint64_t len,
+			   bool prefaulted, uint64_t t_start,
+			   uint64_t t_alloc, uint64_t t_prefault,
+			   uint64_t t_map)
+{
+	fpga_buffer_prepare_stats *stats = &_handle->prep_stats;
+
+	++stats->buffers;
+	stats->bytes += len;
+	if (prefaulted)
+		++stats->prefaulted;
+	stats->alloc_ns += t_alloc - t_start;
+	stats->prefault_ns += t_prefault - t_alloc;
+	stats->map_ns += t_map - t_prefault;
+}
+
+int xfpga_slab_map(void *context, uint64_t size,
+		   void **vaddr, uint64_t *iova)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *)context;
+	void *addr = NULL;
+	uint64_t t_start = buffer_now_ns();
+	uint64_t t_alloc;
+
+	if (buffer_allocate(&addr, size, 0))
+		return 1;
+
+	t_alloc = buffer_now_ns();
+
+	if (opae_port_map(_handle->fddev, addr, size, 0, iova)) {
+		OPAE_MSG("FPGA_PORT_DMA_MAP ioctl failed: %s",
+			 strerror(errno));
+		buffer_release(addr, size);
+		return 2;
+	}
+
+	prep_stats_add(_handle, size, false, t_start, t_alloc, t_alloc,
+		       buffer_now_ns());
+
+	*vaddr = addr;
+	return 0;
+}
+
+void xfpga_slab_unmap(void *context, void *vaddr,
+		      uint64_t iova, uint64_t size)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *)context;
+
+	if (opae_port_unmap(_handle->fddev, iova))
+		OPAE_MSG("FPGA_PORT_DMA_UNMAP ioctl failed: %s",
+			 strerror(errno));
+
+	buffer_release(vaddr, size);
+}
+
+/*
+ * Carve a buffer from one of the handle's shared slab regions.
+ * Called with the handle lock held.
+ */
+STATIC fpga_result slab_prepare(struct _fpga_handle *_handle, uint64_t len,
+				void **buf_addr, uint64_t *wsid, int flags)
+{
+	void *addr = NULL;
+	uint64_t io_addr = 0;
+
+	if (!buf_addr) {
+		OPAE_MSG("buffer address is NULL");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (mem_slab_get(&_handle->slab, len, &addr, &io_addr)) {
+		if (!(flags & FPGA_BUF_QUIET))
+			OPAE_MSG("Could not allocate slab buffer");
+		return FPGA_NO_MEMORY;
+	}
+
+	if (!wsid_table_add(_handle->wsid_table, (uint64_t)addr, io_addr, len,
+			    flags, wsid)) {
+		mem_slab_put(&_handle->slab, addr);
+		OPAE_MSG("Failed to add workspace id");
+		return FPGA_NO_MEMORY;
+	}
+
+	*buf_addr = addr;
+	return FPGA_OK;
+}
+
 fpga_result __XFPGA_API__ xfpga_fpgaPrepareBuffer(fpga_handle handle, uint64_t len,
 					   void **buf_addr, uint64_t *wsid,
 					   int flags)
+{
+	return xfpga_fpgaPrepareBufferEx(handle, len, buf_addr, wsid, flags,
+					 FPGA_NUMA_NODE_ANY);
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaPrepareBufferEx(fpga_handle handle,
+						    uint64_t len,
+						    void **buf_addr,
+						    uint64_t *wsid,
+						    int flags,
+						    int numa_node)
 {
 	void *addr = NULL;
 	fpga_result result = FPGA_OK;
@@ -134,6 +306,11 @@ fpga_result __XFPGA_API__ xfpga_fpgaPrepareBuffer(fpga_handle handle, uint64_t l
 	uint32_t map_flags = (read_only ? FPGA_DMA_TO_DEV : 0);
 
 	uint64_t pg_size;
+	bool prefault = false;
+	int alloc_flags;
+	uint64_t t_start = buffer_now_ns();
+	uint64_t t_alloc = t_start;
+	uint64_t t_prefault = t_start;
 
 	result = handle_check_and_lock(_handle);
 	if (result)
@@ -147,12 +324,45 @@ fpga_result __XFPGA_API__ xfpga_fpgaPrepareBuffer(fpga_handle handle, uint64_t l
 	}
 
 	if (flags & (~(FPGA_BUF_PREALLOCATED | FPGA_BUF_QUIET |
-		       FPGA_BUF_READ_ONLY))) {
+		       FPGA_BUF_READ_ONLY | FPGA_BUF_SLAB |
+		       FPGA_BUF_NUMA_LOCAL | FPGA_BUF_PREFAULT))) {
 		OPAE_MSG("Unrecognized flags");
 		result = FPGA_INVALID_PARAM;
 		goto out_unlock;
 	}
 
+	if ((numa_node != FPGA_NUMA_NODE_ANY) &&
+	    !mem_bind_node_valid(numa_node)) {
+		OPAE_MSG("Invalid NUMA node %d", numa_node);
+		result = FPGA_INVALID_PARAM;
+		goto out_unlock;
+	}
+
+	if ((numa_node == FPGA_NUMA_NODE_ANY) &&
+	    (flags & FPGA_BUF_NUMA_LOCAL))
+		numa_node = _handle->numa_node;
+
+	/* Slab regions are shared, so they have no placement of their own. */
+	if (numa_node != FPGA_NUMA_NODE_ANY)
+		flags &= ~FPGA_BUF_SLAB;
+
+	if (flags & FPGA_BUF_SLAB) {
+		if (preallocated) {
+			OPAE_MSG("FPGA_BUF_SLAB with FPGA_BUF_PREALLOCATED");
+			result = FPGA_INVALID_PARAM;
+			goto out_unlock;
+		}
+
+		if (mem_slab_region_size(len)) {
+			result = slab_prepare(_handle, len, buf_addr,
+					      wsid, flags);
+			goto out_unlock;
+		}
+
+		/* Too large to share a region; allocate it on its own. */
+		flags &= ~FPGA_BUF_SLAB;
+	}
+
 	pg_size = (uint64_t) sysconf(_SC_PAGE_SIZE);
 
 	if (preallocated) {
@@ -201,10 +411,40 @@ fpga_result __XFPGA_API__ xfpga_fpgaPrepareBuffer(fpga_handle handle, uint64_t l
 			len = pg_size + (len & ~(pg_size - 1));
 		}
 
-		result = buffer_allocate(&addr, len, flags);
+		/* Pages populated by mmap() would precede the binding. */
+		prefault = (flags & FPGA_BUF_PREFAULT);
+		alloc_flags = (numa_node == FPGA_NUMA_NODE_ANY) ?
+			flags : (flags & ~FPGA_BUF_PREFAULT);
+
+		result = buffer_allocate(&addr, len, alloc_flags);
+
+		/* Buffers awaiting a deferred release may hold the pages. */
+		if ((result == FPGA_NO_MEMORY) && _handle->reaper &&
+		    mem_reaper_pending(_handle->reaper)) {
+			mem_reaper_drain(_handle->reaper);
+			result = buffer_allocate(&addr, len, alloc_flags);
+		}
+
 		if (result != FPGA_OK) {
 			goto out_unlock;
 		}
+
+		if (numa_node != FPGA_NUMA_NODE_ANY) {
+			result = buffer_bind(addr, len, numa_node);
+			if (result != FPGA_OK) {
+				buffer_release(addr, len);
+				goto out_unlock;
+			}
+		}
+
+		t_alloc = t_prefault = buffer_now_ns();
+
+		if (prefault &&
+		    ((numa_node != FPGA_NUMA_NODE_ANY) ||
+		     (len > buffer_page_size(len)))) {
+			buffer_prefault(addr, len, numa_node);
+			t_prefault = buffer_now_ns();
+		}
 	}
 
 	if (opae_port_map(_handle->fddev, addr, len, map_flags, &io_addr)) {
@@ -222,21 +462,20 @@ fpga_result __XFPGA_API__ xfpga_fpgaPrepareBuffer(fpga_handle handle, uint64_t l
 	}
 
 
-	/* Generate unique workspace ID */
-	*wsid = wsid_gen();
-
-	/* Add to workspace id in order to store buffer length */
-	if (!wsid_add(_handle->wsid_root, *wsid, (uint64_t)addr, io_addr, len,
-		      0, 0, flags)) {
+	/* Add to workspace table, generating the workspace ID */
+	if (!wsid_table_add(_handle->wsid_table, (uint64_t)addr, io_addr, len,
+			    flags, wsid)) {
 		if (!preallocated) {
 			buffer_release(addr, len);
 		}
 
-		OPAE_MSG("Failed to add workspace id %lu", *wsid);
+		OPAE_MSG("Failed to add workspace id");
 		result = FPGA_NO_MEMORY;
 		goto out_unlock;
 	}
 
+	prep_stats_add(_handle, len, prefault, t_start, t_alloc, t_prefault,
+		       buffer_now_ns());
 
 	/* Update buf_addr */
 	if (buf_addr)
@@ -253,6 +492,231 @@ out_unlock:
 	return result;
 }
 
+/*
+ * Segment record of an fpgaPrepareBufferSG() buffer,
+ * stored as the workspace addr.
+ */
+struct sg_buffer {
+	uint32_t num_segs;
+	struct _fpga_sg_seg *segs[];	/* mapping behind each segment */
+};
+
+/*
+ * Drop sgb's references to its segments, unmapping those left unused.
+ * The caller holds the handle lock.
+ */
+STATIC fpga_result sg_release(struct _fpga_handle *_handle,
+			      struct sg_buffer *sgb)
+{
+	fpga_result result = FPGA_OK;
+	struct _fpga_sg_seg **pp;
+	struct _fpga_sg_seg *seg;
+	uint32_t i;
+
+	for (i = 0 ; i < sgb->num_segs ; ++i) {
+		seg = sgb->segs[i];
+		if (--seg->refs)
+			continue;
+
+		for (pp = &_handle->sg_segs ; *pp != seg ; pp = &(*pp)->next)
+			;
+		*pp = seg->next;
+
+		if (opae_port_unmap(_handle->fddev, seg->iova)) {
+			OPAE_MSG("FPGA_PORT_DMA_UNMAP ioctl failed: %s",
+				 strerror(errno));
+			result = FPGA_INVALID_PARAM;
+		}
+		opae_free(seg);
+	}
+
+	opae_free(sgb);
+	return result;
+}
+
+/*
+ * Find the segment that maps the page at vaddr. When there is none,
+ * *limit is the start of the next mapped segment above vaddr, which
+ * a new mapping must not cross.
+ */
+STATIC struct _fpga_sg_seg *sg_seg_find(struct _fpga_handle *_handle,
+					uint64_t vaddr, uint64_t *limit)
+{
+	struct _fpga_sg_seg *seg;
+
+	*limit = UINT64_MAX;
+	for (seg = _handle->sg_segs ; seg ; seg = seg->next) {
+		if ((vaddr >= seg->vaddr) && (vaddr - seg->vaddr < seg->len))
+			return seg;
+		if ((seg->vaddr > vaddr) && (seg->vaddr < *limit))
+			*limit = seg->vaddr;
+	}
+
+	return NULL;
+}
+
+fpga_result __XFPGA_API__
+xfpga_fpgaPrepareBufferSG(fpga_handle handle, void *buf_addr, uint64_t len,
+			  uint64_t *wsid, fpga_sg_entry *sg, uint32_t *num_sg,
+			  int flags)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	fpga_result result;
+	struct sg_buffer *sgb;
+	struct _fpga_sg_seg *seg;
+	uint64_t pg_size;
+	uint64_t start;
+	uint64_t end;
+	uint64_t cur;
+	uint64_t chunk;
+	uint64_t size;
+	uint64_t limit;
+	uint64_t io_addr = 0;
+	uint64_t t_map;
+	uint32_t last;
+	int err;
+
+	bool quiet = (flags & FPGA_BUF_QUIET);
+	uint32_t map_flags = ((flags & FPGA_BUF_READ_ONLY) ?
+			      FPGA_DMA_TO_DEV : 0);
+
+	ASSERT_NOT_NULL(buf_addr);
+	ASSERT_NOT_NULL(wsid);
+	ASSERT_NOT_NULL(sg);
+	ASSERT_NOT_NULL(num_sg);
+
+	if (!len || !*num_sg) {
+		OPAE_MSG("Zero length or empty segment list");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (flags & (~(FPGA_BUF_QUIET | FPGA_BUF_READ_ONLY))) {
+		OPAE_MSG("Unrecognized flags");
+		return FPGA_INVALID_PARAM;
+	}
+
+	result = handle_check_and_lock(_handle);
+	if (result)
+		return result;
+
+	sgb = opae_calloc(1, sizeof(*sgb) +
+			  *num_sg * sizeof(struct _fpga_sg_seg *));
+	if (!sgb) {
+		OPAE_MSG("Failed to allocate segment record");
+		result = FPGA_NO_MEMORY;
+		goto out_unlock;
+	}
+
+	pg_size = (uint64_t) sysconf(_SC_PAGE_SIZE);
+	start = (uint64_t)buf_addr & ~(pg_size - 1);
+	end = ((uint64_t)buf_addr + len + pg_size - 1) & ~(pg_size - 1);
+
+	/*
+	 * The driver only maps physically contiguous pages. Map the largest
+	 * piece that it accepts, halving on failure, then try twice as much
+	 * for the next piece. Pages already mapped for another SG buffer
+	 * reuse that buffer's segment.
+	 */
+	result = FPGA_NO_MEMORY;
+	chunk = end - start;
+	cur = start;
+	while (cur < end) {
+		if (sgb->num_segs == *num_sg) {
+			if (!quiet)
+				OPAE_MSG("Buffer needs more than %u segments",
+					 *num_sg);
+			goto out_release;
+		}
+
+		seg = sg_seg_find(_handle, cur, &limit);
+		if (seg) {
+			if (seg->map_flags != map_flags) {
+				if (!quiet)
+					OPAE_MSG("Page already mapped with "
+						 "other access flags");
+				result = FPGA_INVALID_PARAM;
+				goto out_release;
+			}
+			size = seg->vaddr + seg->len - cur;
+			if (size > end - cur)
+				size = end - cur;
+			++seg->refs;
+			goto out_add;
+		}
+
+		if (chunk > end - cur)
+			chunk = end - cur;
+		if (chunk > limit - cur)
+			chunk = limit - cur;
+
+		t_map = buffer_now_ns();
+		if (opae_port_map(_handle->fddev, (void *)cur, chunk,
+				  map_flags, &io_addr)) {
+			if (chunk == pg_size) {
+				if (!quiet)
+					OPAE_MSG("FPGA_PORT_DMA_MAP ioctl failed: %s",
+						 strerror(errno));
+				goto out_release;
+			}
+			chunk = ((chunk / 2) + pg_size - 1) & ~(pg_size - 1);
+			continue;
+		}
+
+		prep_stats_add(_handle, chunk, false, t_map, t_map, t_map,
+			       buffer_now_ns());
+
+		seg = opae_calloc(1, sizeof(*seg));
+		if (!seg) {
+			OPAE_MSG("Failed to allocate segment record");
+			opae_port_unmap(_handle->fddev, io_addr);
+			goto out_release;
+		}
+
+		seg->vaddr = cur;
+		seg->len = chunk;
+		seg->iova = io_addr;
+		seg->map_flags = map_flags;
+		seg->refs = 1;
+		seg->next = _handle->sg_segs;
+		_handle->sg_segs = seg;
+
+		size = chunk;
+		chunk <<= 1;
+
+out_add:
+		sg[sgb->num_segs].iova = seg->iova + (cur - seg->vaddr);
+		sg[sgb->num_segs].len = size;
+		sgb->segs[sgb->num_segs++] = seg;
+		cur += size;
+	}
+
+	/* Trim the mapped pages to the caller's range. */
+	last = sgb->num_segs - 1;
+	sg[0].iova += (uint64_t)buf_addr - start;
+	sg[0].len -= (uint64_t)buf_addr - start;
+	sg[last].len -= end - ((uint64_t)buf_addr + len);
+
+	if (!wsid_table_add(_handle->wsid_table, (uint64_t)sgb, sg[0].iova,
+			    len, flags | XFPGA_BUF_SG, wsid)) {
+		OPAE_MSG("Failed to add workspace id");
+		goto out_release;
+	}
+
+	*num_sg = sgb->num_segs;
+	result = FPGA_OK;
+	goto out_unlock;
+
+out_release:
+	sg_release(_handle, sgb);
+
+out_unlock:
+	err = pthread_mutex_unlock(&_handle->lock);
+	if (err) {
+		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+	}
+	return result;
+}
+
 fpga_result __XFPGA_API__
 xfpga_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 {
@@ -269,7 +733,7 @@ xfpga_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 		return result;
 
 	/* Fetch the buffer physical address and length */
-	struct wsid_map *wm = wsid_find(_handle->wsid_root, wsid);
+	struct wsid_slot *wm = wsid_table_find(_handle->wsid_table, wsid);
 	if (!wm) {
 		OPAE_MSG("WSID not found");
 		result = FPGA_INVALID_PARAM;
@@ -282,6 +746,30 @@ xfpga_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 
 	bool preallocated = (wm->flags & FPGA_BUF_PREALLOCATED);
 
+	/* Scatter-gather buffers are unmapped segment by segment. */
+	if (wm->flags & XFPGA_BUF_SG) {
+		result = sg_release(_handle, (struct sg_buffer *)buf_addr);
+		goto ws_free;
+	}
+
+	/* Slab buffers share their region's DMA mapping. */
+	if (wm->flags & FPGA_BUF_SLAB) {
+		if (mem_slab_put(&_handle->slab, buf_addr)) {
+			OPAE_MSG("Slab buffer release failed");
+			result = FPGA_INVALID_PARAM;
+			goto ws_free;
+		}
+		result = FPGA_OK;
+		goto ws_free;
+	}
+
+	/* The reaper owns a queued buffer from here on. */
+	if (_handle->reaper && !preallocated &&
+	    !mem_reaper_put(_handle->reaper, buf_addr, iova, len, NULL)) {
+		result = FPGA_OK;
+		goto ws_free;
+	}
+
 	if (opae_port_unmap(_handle->fddev, iova)) {
 		OPAE_MSG("FPGA_PORT_DMA_UNMAP ioctl failed: %s",
 			 strerror(errno));
@@ -305,7 +793,7 @@ xfpga_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 
 ws_free:
 	/* Remove workspace */
-	wsid_del(_handle->wsid_root, wsid);
+	wsid_table_del(_handle->wsid_table, wsid);
 
 out_unlock:
 	err = pthread_mutex_unlock(&_handle->lock);
@@ -315,24 +803,38 @@ out_unlock:
 	return result;
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
-					  uint64_t *ioaddr)
+/*
+ * Release a batch of FPGA_OPEN_DEFERRED_RELEASE buffers on the
+ * reaper thread. The DFL port unmaps one buffer per ioctl, so there
+ * is no combined unmap of adjacent buffers as with VFIO.
+ */
+void xfpga_reap(void *context, struct mem_reaper_entry *batch)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *)context;
+
+	for ( ; batch ; batch = batch->next) {
+		if (opae_port_unmap(_handle->fddev, batch->iova))
+			OPAE_MSG("FPGA_PORT_DMA_UNMAP ioctl failed: %s",
+				 strerror(errno));
+
+		if (buffer_release(batch->vaddr, batch->size))
+			OPAE_MSG("Buffer release failed");
+	}
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaDrainBufferReleases(fpga_handle handle)
 {
 	struct _fpga_handle *_handle = (struct _fpga_handle *)handle;
-	struct wsid_map *wm;
-	fpga_result result = FPGA_OK;
+	fpga_result result;
 	int err;
 
 	result = handle_check_and_lock(_handle);
 	if (result)
 		return result;
 
-	wm = wsid_find(_handle->wsid_root, wsid);
-	if (!wm) {
-		OPAE_MSG("WSID not found");
-		result = FPGA_NOT_FOUND;
-	} else {
-		*ioaddr = wm->phys;
+	if (_handle->reaper && mem_reaper_drain(_handle->reaper)) {
+		OPAE_MSG("Failed to drain buffer releases");
+		result = FPGA_EXCEPTION;
 	}
 
 	err = pthread_mutex_unlock(&_handle->lock);
@@ -341,3 +843,52 @@ fpga_result __XFPGA_API__ xfpga_fpgaGetIOAddress(fpga_handle handle, uint64_t ws
 	}
 	return result;
 }
+
+fpga_result __XFPGA_API__ xfpga_fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
+					  uint64_t *ioaddr)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *)handle;
+
+	ASSERT_NOT_NULL(_handle);
+	ASSERT_NOT_NULL(ioaddr);
+
+	/*
+	 * No handle lock: the workspace table's slots stay in place
+	 * while the handle is open, and wsid_table_phys() detects a
+	 * slot released underneath it.
+	 */
+	if (_handle->magic != FPGA_HANDLE_MAGIC) {
+		OPAE_MSG("Invalid handle object");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!wsid_table_phys(_handle->wsid_table, wsid, ioaddr)) {
+		OPAE_MSG("WSID not found");
+		return FPGA_NOT_FOUND;
+	}
+
+	return FPGA_OK;
+}
+
+fpga_result __XFPGA_API__
+xfpga_fpgaGetBufferPrepareStats(fpga_handle handle,
+				fpga_buffer_prepare_stats *stats)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *)handle;
+	fpga_result result;
+	int err;
+
+	ASSERT_NOT_NULL(stats);
+
+	result = handle_check_and_lock(_handle);
+	if (result)
+		return result;
+
+	*stats = _handle->prep_stats;
+
+	err = pthread_mutex_unlock(&_handle->lock);
+	if (err) {
+		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+	}
+	return FPGA_OK;
+}
@@ -46,6 +46,13 @@ STATIC void unmap_mmio_region(struct wsid_map *wm)
 	}
 }
 
+STATIC void free_sg_record(struct wsid_slot *ws)
+{
+	/* Closing the device file unmaps the segments themselves. */
+	if (ws->flags & XFPGA_BUF_SG)
+		opae_free((void *)ws->addr);
+}
+
 fpga_result __XFPGA_API__ xfpga_fpgaClose(fpga_handle handle)
 {
 	struct _fpga_handle *_handle = (struct _fpga_handle *)handle;
@@ -65,13 +72,30 @@ fpga_result __XFPGA_API__ xfpga_fpgaClose(fpga_handle handle)
 		return FPGA_INVALID_PARAM;
 	}
 
-	wsid_tracker_cleanup(_handle->wsid_root, NULL);
-	wsid_tracker_cleanup(_handle->mmio_root, unmap_mmio_region);
+	/* Unmap deferred releases while the device file is open. */
+	if (_handle->reaper) {
+		mem_reaper_destroy(_handle->reaper);
+		opae_free(_handle->reaper);
+		_handle->reaper = NULL;
+	}
+
+	wsid_table_cleanup(_handle->wsid_table, free_sg_record);
+	while (_handle->sg_segs) {
+		struct _fpga_sg_seg *seg = _handle->sg_segs;
+		_handle->sg_segs = seg->next;
+		opae_free(seg);
+	}
 	free_umsg_buffer(handle);
+	mem_slab_destroy(&_handle->slab);
 
 	// free metric enum vector
 	free_fpga_enum_metrics_vector(_handle);
 
+	// Stop new lock-free MMIO and drain the accesses in flight
+	// before the regions are unmapped.
+	xfpga_mmio_quiesce(_handle);
+	wsid_tracker_cleanup(_handle->mmio_root, unmap_mmio_region);
+
 	opae_close(_handle->fddev);
 	if (_handle->fdfpgad >= 0)
 		opae_close(_handle->fdfpgad);
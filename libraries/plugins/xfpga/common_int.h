@@ -88,4 +88,26 @@ fpga_result prop_check_and_lock(struct _fpga_properties *prop);
 fpga_result handle_check_and_lock(struct _fpga_handle *handle);
 fpga_result event_handle_check_and_lock(struct _fpga_event_handle *eh);
 
+/*
+ * Workspace flag marking an fpgaPrepareBufferSG() buffer. The workspace
+ * addr is then its heap-allocated segment record, not the buffer.
+ */
+#define XFPGA_BUF_SG (1u << 30)
+
+/* FPGA_BUF_SLAB region callbacks. The context is the struct _fpga_handle. */
+int xfpga_slab_map(void *context, uint64_t size,
+		   void **vaddr, uint64_t *iova);
+void xfpga_slab_unmap(void *context, void *vaddr,
+		      uint64_t iova, uint64_t size);
+
+/* FPGA_OPEN_DEFERRED_RELEASE callback. The context is the struct _fpga_handle. */
+void xfpga_reap(void *context, struct mem_reaper_entry *batch);
+
+/*
+ * Invalidate the handle magic so that no new lock-free MMIO access can
+ * start, withdraw every published MMIO region, and wait for the accesses
+ * in flight to finish. Called by fpgaClose() with the handle lock held.
+ */
+void xfpga_mmio_quiesce(struct _fpga_handle *_handle);
+
 #endif // ___FPGA_COMMON_INT_H__
@@ -33,7 +33,9 @@
 #include "common_int.h"
 #include "opae_drv.h"
 #include "intel-fpga.h"
+#include "mmio-wide.h"
 
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
@@ -133,6 +135,13 @@ STATIC fpga_result map_mmio_region(fpga_handle handle, uint32_t mmio_num)
 		}
 	}
 
+	if (mmio_num < XFPGA_MMIO_REGIONS_MAX) {
+		struct _fpga_mmio_region *r = &_handle->mmio_regions[mmio_num];
+
+		r->len = rinfo.size;
+		__atomic_store_n(&r->base, (uint8_t *)addr, __ATOMIC_RELEASE);
+	}
+
 	return FPGA_OK;
 }
 
@@ -162,44 +171,158 @@ STATIC fpga_result find_or_map_wm(fpga_handle handle, uint32_t mmio_num,
 	return FPGA_OK;
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO32(fpga_handle handle,
-					 uint32_t mmio_num,
-					 uint64_t offset,
-					 uint32_t value)
+/* Count of lock-free accesses in flight to MMIO region mmio_num */
+static inline uint32_t *mmio_users_of(struct _fpga_handle *_handle,
+				      uint32_t mmio_num)
 {
+	if (mmio_num < XFPGA_MMIO_REGIONS_MAX)
+		return &_handle->mmio_regions[mmio_num].users;
+	return &_handle->mmio_users;
+}
 
-	int err;
-	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+/*
+ * Resolve the address of the width bytes at offset into MMIO region
+ * mmio_num. Regions already published in mmio_regions[] are resolved
+ * without taking the handle lock. Otherwise, the region is looked up (and
+ * mapped if necessary) under the lock.
+ *
+ * On success the access is counted in the region's users (mmio_users for
+ * regions past XFPGA_MMIO_REGIONS_MAX), and the caller must call
+ * mmio_exit() once it is done with *addr. Anyone unmapping a region
+ * first withdraws it from mmio_regions[] and then waits for its users
+ * to drain, so the mapping cannot go away under an access in flight.
+ */
+STATIC fpga_result mmio_range(struct _fpga_handle *_handle,
+			      uint32_t mmio_num,
+			      uint64_t offset,
+			      uint64_t width,
+			      volatile uint8_t **addr)
+{
 	struct wsid_map *wm = NULL;
 	fpga_result result = FPGA_OK;
+	uint8_t *base = NULL;
+	uint64_t len = 0;
+	int err;
 
-	if (offset % sizeof(uint32_t) != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
+	ASSERT_NOT_NULL(_handle);
+
+	if (mmio_num < XFPGA_MMIO_REGIONS_MAX) {
+		struct _fpga_mmio_region *r = &_handle->mmio_regions[mmio_num];
+
+		__atomic_add_fetch(&r->users, 1, __ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n(&_handle->magic, __ATOMIC_SEQ_CST) !=
+		    FPGA_HANDLE_MAGIC) {
+			__atomic_sub_fetch(&r->users, 1, __ATOMIC_SEQ_CST);
+			OPAE_MSG("Invalid handle object");
+			return FPGA_INVALID_PARAM;
+		}
+
+		base = __atomic_load_n(&r->base, __ATOMIC_SEQ_CST);
+		len = r->len;
+
+		if (!base) {
+			// Don't hold up an unmap while waiting for the lock.
+			__atomic_sub_fetch(&r->users, 1, __ATOMIC_SEQ_CST);
+		}
 	}
 
-	result = handle_check_and_lock(_handle);
-	if (result)
-		return result;
+	if (!base) {
+		result = handle_check_and_lock(_handle);
+		if (result)
+			return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
-	if (result)
-		goto out_unlock;
+		result = find_or_map_wm(_handle, mmio_num, &wm);
+		if (result == FPGA_OK) {
+			base = (uint8_t *)wm->offset;
+			len = wm->len;
+			// Nothing can unmap the region while the lock is held.
+			__atomic_add_fetch(mmio_users_of(_handle, mmio_num), 1,
+					   __ATOMIC_SEQ_CST);
+		}
 
-	if (offset > wm->len) {
+		err = pthread_mutex_unlock(&_handle->lock);
+		if (err) {
+			OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+		}
+
+		if (result)
+			return result;
+	}
+
+	if ((width > len) || (offset > len - width)) {
+		__atomic_sub_fetch(mmio_users_of(_handle, mmio_num), 1,
+				   __ATOMIC_RELEASE);
 		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		return FPGA_INVALID_PARAM;
 	}
 
-	*((volatile uint32_t *) ((uint8_t *)wm->offset + offset)) = value;
+	*addr = base + offset;
+	return FPGA_OK;
+}
 
-out_unlock:
-	err = pthread_mutex_unlock(&_handle->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+static inline void mmio_exit(struct _fpga_handle *_handle, uint32_t mmio_num)
+{
+	__atomic_sub_fetch(mmio_users_of(_handle, mmio_num), 1,
+			   __ATOMIC_RELEASE);
+}
+
+void xfpga_mmio_quiesce(struct _fpga_handle *_handle)
+{
+	uint32_t i;
+
+	__atomic_store_n(&_handle->magic, FPGA_INVALID_MAGIC,
+			 __ATOMIC_SEQ_CST);
+
+	for (i = 0 ; i < XFPGA_MMIO_REGIONS_MAX ; ++i)
+		__atomic_store_n(&_handle->mmio_regions[i].base, NULL,
+				 __ATOMIC_SEQ_CST);
+
+	for (i = 0 ; i < XFPGA_MMIO_REGIONS_MAX ; ++i) {
+		while (__atomic_load_n(&_handle->mmio_regions[i].users,
+				       __ATOMIC_SEQ_CST))
+			sched_yield();
 	}
-	return result;
+
+	while (__atomic_load_n(&_handle->mmio_users, __ATOMIC_SEQ_CST))
+		sched_yield();
+}
+
+/*
+ * Resolve the address of a width-byte access, which must be naturally
+ * aligned, at offset into MMIO region mmio_num.
+ */
+STATIC fpga_result mmio_addr(struct _fpga_handle *_handle,
+			     uint32_t mmio_num,
+			     uint64_t offset,
+			     uint64_t width,
+			     volatile uint8_t **addr)
+{
+	if (offset % width != 0) {
+		OPAE_MSG("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	return mmio_range(_handle, mmio_num, offset, width, addr);
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO32(fpga_handle handle,
+					 uint32_t mmio_num,
+					 uint64_t offset,
+					 uint32_t value)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
+
+	result = mmio_addr(_handle, mmio_num, offset, sizeof(uint32_t), &addr);
+	if (result)
+		return result;
+
+	*((volatile uint32_t *) addr) = value;
+	mmio_exit(_handle, mmio_num);
+
+	return FPGA_OK;
 }
 
 fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO32(fpga_handle handle,
@@ -207,109 +330,226 @@ fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO32(fpga_handle handle,
 					uint64_t offset,
 					uint32_t *value)
 {
-	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
-
-	if (offset % sizeof(uint32_t) != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
-	}
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
 
-	result = handle_check_and_lock(_handle);
+	result = mmio_addr(_handle, mmio_num, offset, sizeof(uint32_t), &addr);
 	if (result)
 		return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
+	*value = *((volatile uint32_t *) addr);
+	mmio_exit(_handle, mmio_num);
+
+	return FPGA_OK;
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO64(fpga_handle handle,
+					 uint32_t mmio_num,
+					 uint64_t offset,
+					 uint64_t value)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
+
+	result = mmio_addr(_handle, mmio_num, offset, sizeof(uint64_t), &addr);
 	if (result)
-		goto out_unlock;
+		return result;
 
-	if (offset > wm->len) {
-		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
-	}
+	*((volatile uint64_t *) addr) = value;
+	mmio_exit(_handle, mmio_num);
 
-	*value = *((volatile uint32_t *) ((uint8_t *)wm->offset + offset));
+	return FPGA_OK;
+}
 
-out_unlock:
-	err = pthread_mutex_unlock(&_handle->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
-	}
-	return result;
+fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO64(fpga_handle handle,
+					uint32_t mmio_num,
+					uint64_t offset,
+					uint64_t *value)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
+
+	result = mmio_addr(_handle, mmio_num, offset, sizeof(uint64_t), &addr);
+	if (result)
+		return result;
+
+	*value = *((volatile uint64_t *) addr);
+	mmio_exit(_handle, mmio_num);
+
+	return FPGA_OK;
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO64(fpga_handle handle,
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO512(fpga_handle handle,
 					 uint32_t mmio_num,
 					 uint64_t offset,
-					 uint64_t value)
+					 const void *value)
 {
-	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
 
-	if (offset % sizeof(uint64_t) != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
-	}
+	ASSERT_NOT_NULL(_handle);
 
-	result = handle_check_and_lock(_handle);
+	if (!_handle->mmio_wide)
+		return FPGA_NOT_SUPPORTED;
+
+	result = mmio_addr(_handle, mmio_num, offset, 64, &addr);
 	if (result)
 		return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
+	_handle->mmio_wide->write512(addr, value);
+	mmio_exit(_handle, mmio_num);
+
+	return FPGA_OK;
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO512(fpga_handle handle,
+					uint32_t mmio_num,
+					uint64_t offset,
+					void *value)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
+
+	ASSERT_NOT_NULL(_handle);
+
+	if (!_handle->mmio_wide)
+		return FPGA_NOT_SUPPORTED;
+
+	result = mmio_addr(_handle, mmio_num, offset, 64, &addr);
 	if (result)
-		goto out_unlock;
+		return result;
+
+	_handle->mmio_wide->read512(value, addr);
+	mmio_exit(_handle, mmio_num);
 
-	if (offset > wm->len) {
+	return FPGA_OK;
+}
+
+/*
+ * Validate one batch operation and resolve its address. The caller holds
+ * the handle lock. *wm caches the region of the previous operation, so
+ * runs of accesses to the same MMIO space skip the region lookup.
+ */
+STATIC fpga_result batch_op_addr(fpga_handle handle,
+				 const fpga_mmio_op *op,
+				 struct wsid_map **wm,
+				 volatile uint8_t **addr)
+{
+	fpga_result result;
+
+	if ((op->width != sizeof(uint32_t)) &&
+	    (op->width != sizeof(uint64_t))) {
+		OPAE_MSG("Invalid MMIO width %u", op->width);
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (op->offset % op->width != 0) {
+		OPAE_MSG("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!*wm || ((*wm)->index != op->mmio_num)) {
+		result = find_or_map_wm(handle, op->mmio_num, wm);
+		if (result)
+			return result;
+	}
+
+	if ((op->width > (*wm)->len) ||
+	    (op->offset > (*wm)->len - op->width)) {
 		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		return FPGA_INVALID_PARAM;
 	}
 
-	*((volatile uint64_t *) ((uint8_t *)wm->offset + offset)) = value;
+	*addr = (volatile uint8_t *)(*wm)->offset + op->offset;
+	return FPGA_OK;
+}
 
-out_unlock:
-	err = pthread_mutex_unlock(&_handle->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %s", strerror(err));
+fpga_result __XFPGA_API__ xfpga_fpgaCopyToMMIO(fpga_handle handle,
+					       uint32_t mmio_num,
+					       uint64_t offset,
+					       const void *src,
+					       uint64_t len)
+{
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
+
+	ASSERT_NOT_NULL(_handle);
+	ASSERT_NOT_NULL(src);
+
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
+		OPAE_MSG("Misaligned MMIO access");
+		return FPGA_INVALID_PARAM;
 	}
-	return result;
+
+	result = mmio_range(_handle, mmio_num, offset, len, &addr);
+	if (result)
+		return result;
+
+	opae_mmio_copy_to(_handle->mmio_wide, addr, (const uint8_t *)src, len);
+	mmio_exit(_handle, mmio_num);
+
+	return FPGA_OK;
 }
 
-fpga_result __XFPGA_API__ xfpga_fpgaReadMMIO64(fpga_handle handle,
-					uint32_t mmio_num,
-					uint64_t offset,
-					uint64_t *value)
+fpga_result __XFPGA_API__ xfpga_fpgaCopyFromMMIO(fpga_handle handle,
+						 uint32_t mmio_num,
+						 uint64_t offset,
+						 void *dst,
+						 uint64_t len)
 {
-	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
-	struct wsid_map *wm = NULL;
-	fpga_result result = FPGA_OK;
+	volatile uint8_t *addr = NULL;
+	fpga_result result;
+
+	ASSERT_NOT_NULL(_handle);
+	ASSERT_NOT_NULL(dst);
 
-	if (offset % sizeof(uint64_t) != 0) {
+	if ((offset % sizeof(uint64_t)) || (len % sizeof(uint64_t))) {
 		OPAE_MSG("Misaligned MMIO access");
 		return FPGA_INVALID_PARAM;
 	}
 
-	result = handle_check_and_lock(_handle);
+	result = mmio_range(_handle, mmio_num, offset, len, &addr);
 	if (result)
 		return result;
 
-	result = find_or_map_wm(handle, mmio_num, &wm);
+	opae_mmio_copy_from(_handle->mmio_wide, (uint8_t *)dst, addr, len);
+	mmio_exit(_handle, mmio_num);
+
+	return FPGA_OK;
+}
+
+fpga_result __XFPGA_API__ xfpga_fpgaReadMMIOBatch(fpga_handle handle,
+					  fpga_mmio_op *ops,
+					  uint32_t num_ops)
+{
+	int err;
+	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
+	struct wsid_map *wm = NULL;
+	volatile uint8_t *addr = NULL;
+	fpga_result result = FPGA_OK;
+	uint32_t i;
+
+	result = handle_check_and_lock(_handle);
 	if (result)
-		goto out_unlock;
+		return result;
 
-	if (offset > wm->len) {
-		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
-	}
+	for (i = 0 ; i < num_ops ; ++i) {
+		result = batch_op_addr(handle, &ops[i], &wm, &addr);
+		if (result)
+			goto out_unlock;
 
-	*value = *((volatile uint64_t *) ((uint8_t *)wm->offset + offset));
+		if (ops[i].width == sizeof(uint64_t))
+			ops[i].value = *((volatile uint64_t *) addr);
+		else
+			ops[i].value = *((volatile uint32_t *) addr);
+	}
 
 out_unlock:
 	err = pthread_mutex_unlock(&_handle->lock);
@@ -319,58 +559,32 @@ out_unlock:
 	return result;
 }
 
-#if (defined(__i386__) || defined(__x86_64__) || defined(__ia64__)) && GCC_VERSION >= 40900
-static inline void copy512(const void *src, void *dst)
-{
-    asm volatile("vmovdqu64 (%0), %%zmm0;"
-		 "vmovdqu64 %%zmm0, (%1);"
-		 :
-		 : "r"(src), "r"(dst));
-}
-#else
-static inline void copy512(const void *src, void *dst)
-{
-	UNUSED_PARAM(src);
-	UNUSED_PARAM(dst);
-}
-#endif // x86
-
-fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIO512(fpga_handle handle,
-					 uint32_t mmio_num,
-					 uint64_t offset,
-					 const void *value)
+fpga_result __XFPGA_API__ xfpga_fpgaWriteMMIOBatch(fpga_handle handle,
+					   const fpga_mmio_op *ops,
+					   uint32_t num_ops)
 {
 	int err;
 	struct _fpga_handle *_handle = (struct _fpga_handle *) handle;
 	struct wsid_map *wm = NULL;
+	volatile uint8_t *addr = NULL;
 	fpga_result result = FPGA_OK;
-
-	if (offset % 64 != 0) {
-		OPAE_MSG("Misaligned MMIO access");
-		return FPGA_INVALID_PARAM;
-	}
+	uint32_t i;
 
 	result = handle_check_and_lock(_handle);
 	if (result)
 		return result;
 
-	if (!(_handle->flags & OPAE_FLAG_HAS_MMX512)) {
-		result = FPGA_NOT_SUPPORTED;
-		goto out_unlock;
-	}
-
-	result = find_or_map_wm(handle, mmio_num, &wm);
-	if (result)
-		goto out_unlock;
+	for (i = 0 ; i < num_ops ; ++i) {
+		result = batch_op_addr(handle, &ops[i], &wm, &addr);
+		if (result)
+			goto out_unlock;
 
-	if (offset > wm->len) {
-		OPAE_MSG("offset out of bounds");
-		result = FPGA_INVALID_PARAM;
-		goto out_unlock;
+		if (ops[i].width == sizeof(uint64_t))
+			*((volatile uint64_t *) addr) = ops[i].value;
+		else
+			*((volatile uint32_t *) addr) = (uint32_t) ops[i].value;
 	}
 
-	copy512(value, (uint8_t *)wm->offset + offset);
-
 out_unlock:
 	err = pthread_mutex_unlock(&_handle->lock);
 	if (err) {
@@ -428,6 +642,18 @@ fpga_result __XFPGA_API__ xfpga_fpgaUnmapMMIO(fpga_handle handle,
 		goto out_unlock;
 	}
 
+	/*
+	 * Withdraw the region first, so that new lock-free accesses to it
+	 * fall back to the lock, then let those that resolved it finish.
+	 * Accesses to other regions don't hold up the unmap.
+	 */
+	if (mmio_num < XFPGA_MMIO_REGIONS_MAX)
+		__atomic_store_n(&_handle->mmio_regions[mmio_num].base,
+				 NULL, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(mmio_users_of(_handle, mmio_num),
+			       __ATOMIC_SEQ_CST))
+		sched_yield();
+
 	/* Unmap UAFU MMIO */
 	mmio_ptr = (void *) wm->offset;
 	if (munmap((void *) mmio_ptr, wm->len)) {
@@ -32,6 +32,7 @@
 #include <opae/access.h>
 #include <opae/utils.h>
 #include "types_int.h"
+#include "mmio-wide.h"
 #include "mock/opae_std.h"
 
 #include <string.h>
@@ -39,6 +40,25 @@
 #include <stdlib.h>
 #include <ctype.h>
 
+/*
+ * The NUMA node of the PCIe device above the FME or port at sysfspath,
+ * or -1 when it is unknown.
+ */
+STATIC int device_numa_node(const char *sysfspath)
+{
+	char path[SYSFS_PATH_MAX];
+	int node = -1;
+
+	if (snprintf(path, sizeof(path), "%s/../device/numa_node",
+		     sysfspath) >= (int)sizeof(path))
+		return -1;
+
+	if (sysfs_read_int(path, &node) != FPGA_OK)
+		return -1;
+
+	return node;
+}
+
 fpga_result __XFPGA_API__
 xfpga_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 {
@@ -59,7 +79,11 @@ xfpga_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 		return FPGA_INVALID_PARAM;
 	}
 
-	if (flags & ~FPGA_OPEN_SHARED) {
+	// MMIO through xfpga handles never takes the handle lock, so
+	// FPGA_OPEN_LOCKLESS_MMIO is accepted and needs no action.
+	// FPGA_OPEN_BUFFER_POOL is a hint that xfpga accepts and ignores.
+	if (flags & ~(FPGA_OPEN_SHARED | FPGA_OPEN_DEFERRED_RELEASE |
+		      FPGA_OPEN_LOCKLESS_MMIO | FPGA_OPEN_BUFFER_POOL)) {
 		OPAE_MSG("unrecognized flags");
 		return FPGA_INVALID_PARAM;
 	}
@@ -94,8 +118,8 @@ xfpga_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 	}
 
 	// Init workspace table
-	_handle->wsid_root = wsid_tracker_init(16384);
-	if (NULL == _handle->wsid_root) {
+	_handle->wsid_table = wsid_table_init();
+	if (NULL == _handle->wsid_table) {
 		result = FPGA_NO_MEMORY;
 		goto out_free2;
 	}
@@ -143,14 +167,22 @@ xfpga_fpgaOpen(fpga_token token, fpga_handle *handle, int flags)
 	pthread_mutexattr_destroy(&mattr);
 
 	_handle->flags = 0;
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__)
-#if GCC_VERSION >= 40900
-	__builtin_cpu_init();
-	if (__builtin_cpu_supports("avx512f")) {
-		_handle->flags |= OPAE_FLAG_HAS_MMX512;
+	_handle->mmio_wide = opae_mmio_wide_select();
+	mem_slab_init(&_handle->slab, xfpga_slab_map, xfpga_slab_unmap,
+		      _handle);
+	_handle->numa_node = device_numa_node(_token->sysfspath);
+
+	if (flags & FPGA_OPEN_DEFERRED_RELEASE) {
+		_handle->reaper = opae_malloc(sizeof(struct mem_reaper));
+		if (!_handle->reaper ||
+		    mem_reaper_init(_handle->reaper, xfpga_reap, _handle)) {
+			OPAE_MSG("Failed to init buffer reaper");
+			opae_free(_handle->reaper);
+			pthread_mutex_destroy(&_handle->lock);
+			result = FPGA_NO_MEMORY;
+			goto out_free;
+		}
 	}
-#endif // GCC_VERSION
-#endif // x86
 
 	// set handle return value
 	*handle = (void *)_handle;
@@ -161,7 +193,7 @@ out_attr_destroy:
 	pthread_mutexattr_destroy(&mattr);
 
 out_free:
-	wsid_tracker_cleanup(_handle->wsid_root, NULL);
+	wsid_table_cleanup(_handle->wsid_table, NULL);
 out_free2:
 	wsid_tracker_cleanup(_handle->mmio_root, NULL);
 out_free1:
@@ -82,6 +82,16 @@ int __XFPGA_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaReadMMIO32");
 	adapter->fpgaWriteMMIO512 =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaWriteMMIO512");
+	adapter->fpgaReadMMIO512 =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaReadMMIO512");
+	adapter->fpgaReadMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaReadMMIOBatch");
+	adapter->fpgaWriteMMIOBatch =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaWriteMMIOBatch");
+	adapter->fpgaCopyToMMIO =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaCopyToMMIO");
+	adapter->fpgaCopyFromMMIO =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaCopyFromMMIO");
 	adapter->fpgaMapMMIO =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaMapMMIO");
 	adapter->fpgaUnmapMMIO =
@@ -102,10 +112,20 @@ int __XFPGA_API__ opae_plugin_configure(opae_api_adapter_table *adapter,
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaGetUmsgPtr");
 	adapter->fpgaPrepareBuffer =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaPrepareBuffer");
+	adapter->fpgaPrepareBufferEx =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaPrepareBufferEx");
+	adapter->fpgaPrepareBufferSG =
+		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaPrepareBufferSG");
 	adapter->fpgaReleaseBuffer =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaReleaseBuffer");
+	adapter->fpgaDrainBufferReleases =
+		dlsym(adapter->plugin.dl_handle,
+		      "xfpga_fpgaDrainBufferReleases");
 	adapter->fpgaGetIOAddress =
 		dlsym(adapter->plugin.dl_handle, "xfpga_fpgaGetIOAddress");
+	adapter->fpgaGetBufferPrepareStats =
+		dlsym(adapter->plugin.dl_handle,
+		      "xfpga_fpgaGetBufferPrepareStats");
 	/*
 	**	adapter->fpgaGetOPAECVersion = dlsym(adapter->plugin.dl_handle,
 	*"xfpga_fpgaGetOPAECVersion");
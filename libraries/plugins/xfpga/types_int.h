@@ -41,6 +41,8 @@
 #include <opae/sysobject.h>
 #include <opae/types_enum.h>
 #include <opae/metrics.h>
+#include <opae/mem_slab.h>
+#include <opae/mem_reaper.h>
 #include "metrics/vector.h"
 
 #define SYSFS_FPGA_CLASS_PATH "/sys/class/fpga"
@@ -152,6 +154,32 @@ struct _fpga_bmc_metric {
 	struct fpga_metric fpga_metric;             // Metric value
 };
 
+/*
+ * Mapped MMIO region, published in _fpga_handle.mmio_regions[mmio_num]
+ * once mapped so that MMIO accessors can resolve it without the handle lock.
+ */
+struct _fpga_mmio_region {
+	uint8_t *base;
+	uint64_t len;
+	uint32_t users;                 // in-flight lock-free accesses
+};
+
+#define XFPGA_MMIO_REGIONS_MAX 32
+
+/*
+ * DMA-mapped run of pages backing fpgaPrepareBufferSG() buffers. The
+ * driver rejects a mapping that overlaps an existing one, so buffers
+ * that share a page share the segment that maps it.
+ */
+struct _fpga_sg_seg {
+	uint64_t vaddr;
+	uint64_t len;
+	uint64_t iova;
+	uint32_t map_flags;             // opae_port_map() flags
+	uint32_t refs;                  // SG buffers using the segment
+	struct _fpga_sg_seg *next;
+};
+
 /** Process-wide unique FPGA handle */
 struct _fpga_handle {
 	pthread_mutex_t lock;
@@ -162,8 +190,11 @@ struct _fpga_handle {
 	int fdfpgad;                    // file descriptor for the event daemon.
 	uint32_t num_irqs;              // number of interrupts supported
 	uint32_t irq_set;               // bitmask of irqs set
-	struct wsid_tracker *wsid_root; // wsid information (list)
+	struct wsid_table *wsid_table;  // buffer workspaces, by wsid slot
 	struct wsid_tracker *mmio_root; // MMIO information (list)
+	struct _fpga_mmio_region mmio_regions[XFPGA_MMIO_REGIONS_MAX]; // by mmio_num
+	uint32_t mmio_users;            // in-flight accesses to regions past
+	                                // XFPGA_MMIO_REGIONS_MAX
 	void *umsg_virt;	        // umsg Virtual Memory pointer
 	uint64_t umsg_size;	        // umsg Virtual Memory Size
 	uint64_t *umsg_iova;	        // umsg IOVA from driver
@@ -174,7 +205,12 @@ struct _fpga_handle {
 	void *bmc_handle;                                    // bmc module handle
 	struct _fpga_bmc_metric *_bmc_metric_cache_value;    // bmc cache values
 	uint64_t num_bmc_metric;                             // num of bmc values
-#define OPAE_FLAG_HAS_MMX512 (1u << 0)
+	const struct _opae_mmio_wide *mmio_wide;             // 512 bit MMIO kernels
+	struct mem_slab slab;                                // FPGA_BUF_SLAB regions
+	int numa_node;                  // NUMA node of the PCIe device, or -1
+	fpga_buffer_prepare_stats prep_stats; // fpgaGetBufferPrepareStats()
+	struct mem_reaper *reaper;      // FPGA_OPEN_DEFERRED_RELEASE, or NULL
+	struct _fpga_sg_seg *sg_segs;   // fpgaPrepareBufferSG() mappings
 	uint32_t flags;
 };
 
@@ -212,6 +248,36 @@ struct wsid_tracker {
 	struct wsid_map **table;
 };
 
+/*
+ * One buffer workspace. A slot is live while wsid is non-zero.
+ * The wsid encodes the slot's index and its generation, so a
+ * stale wsid never matches a reused slot.
+ */
+struct wsid_slot {
+	uint64_t wsid;
+	uint64_t addr;
+	uint64_t phys;
+	uint64_t len;
+	int flags;
+	uint32_t gen;
+	uint32_t next_free;
+};
+
+#define WSID_CHUNK_SLOTS 1024
+#define WSID_TABLE_CHUNKS 4096
+
+/*
+ * Per-handle table of buffer workspaces.
+ * Slots live in fixed-size chunks that are never moved or freed
+ * while the table exists, so readers may index them without
+ * holding the handle lock.
+ */
+struct wsid_table {
+	uint32_t n_chunks;
+	uint32_t free_head;
+	struct wsid_slot *chunks[WSID_TABLE_CHUNKS];
+};
+
 /*
  * Global list to store tokens received during enumeration
  * Since tokens as seen by the API are only void*, we need to keep the actual
@@ -29,6 +29,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include "wsid_list_int.h"
@@ -232,3 +233,240 @@ struct wsid_map *wsid_find_by_index(struct wsid_tracker *root, uint32_t index)
 	return NULL;
 }
 
+
+/*
+ * The buffer workspace table below is updated with the handle lock
+ * held, like the tracker above. wsid_table_phys() is the exception:
+ * it may run concurrently with updates, so the fields it reads are
+ * accessed atomically.
+ */
+
+#define WSID_FREE_NONE UINT32_MAX
+
+/**
+ * @brief Initialize an empty buffer workspace table
+ *
+ * @return the table, or NULL on allocation failure
+ */
+struct wsid_table *wsid_table_init(void)
+{
+	struct wsid_table *table = opae_calloc(1, sizeof(struct wsid_table));
+	if (!table)
+		return NULL;
+
+	table->free_head = WSID_FREE_NONE;
+	return table;
+}
+
+/**
+ * @brief Free the table and any remaining entries
+ *
+ * @param table
+ * @param clean called for each live entry, if not NULL
+ */
+void wsid_table_cleanup(struct wsid_table *table,
+			void (*clean)(struct wsid_slot *))
+{
+	uint32_t i;
+	uint32_t j;
+
+	if (!table)
+		return;
+
+	for (i = 0 ; i < table->n_chunks ; ++i) {
+		if (clean) {
+			for (j = 0 ; j < WSID_CHUNK_SLOTS ; ++j) {
+				if (table->chunks[i][j].wsid)
+					clean(&table->chunks[i][j]);
+			}
+		}
+		opae_free(table->chunks[i]);
+	}
+
+	opae_free(table);
+}
+
+/**
+ * @brief Add a chunk of free slots to the table
+ *        Only called when the free list is empty.
+ * @param table
+ *
+ * @return true if success, false otherwise
+ */
+static bool wsid_table_grow(struct wsid_table *table)
+{
+	struct wsid_slot *chunk;
+	uint32_t base;
+	uint32_t i;
+
+	if (table->n_chunks == WSID_TABLE_CHUNKS)
+		return false;
+
+	chunk = opae_calloc(WSID_CHUNK_SLOTS, sizeof(struct wsid_slot));
+	if (!chunk)
+		return false;
+
+	base = table->n_chunks * WSID_CHUNK_SLOTS;
+	for (i = 0 ; i < WSID_CHUNK_SLOTS ; ++i) {
+		chunk[i].gen = 1;
+		chunk[i].next_free = (i + 1 < WSID_CHUNK_SLOTS) ?
+			base + i + 1 : WSID_FREE_NONE;
+	}
+
+	table->free_head = base;
+	__atomic_store_n(&table->chunks[table->n_chunks], chunk,
+			 __ATOMIC_RELEASE);
+	++table->n_chunks;
+
+	return true;
+}
+
+/**
+ * @brief Map the slot index encoded in a wsid to its slot
+ * @param table
+ * @param wsid
+ *
+ * @return the slot, which may be free or owned by another
+ *         generation, or NULL if the index is out of range
+ */
+static inline struct wsid_slot *wsid_table_slot(struct wsid_table *table,
+						uint64_t wsid)
+{
+	uint32_t index = (uint32_t)wsid;
+	uint32_t c = index / WSID_CHUNK_SLOTS;
+	struct wsid_slot *chunk;
+
+	if (c >= WSID_TABLE_CHUNKS)
+		return NULL;
+
+	chunk = __atomic_load_n(&table->chunks[c], __ATOMIC_ACQUIRE);
+	if (!chunk)
+		return NULL;
+
+	return &chunk[index % WSID_CHUNK_SLOTS];
+}
+
+/**
+ * @brief Add a buffer workspace to the table
+ *        The new wsid is ((generation << 32) | slot index).
+ * @param table
+ * @param addr
+ * @param phys
+ * @param len
+ * @param flags
+ * @param wsid  receives the new workspace id
+ *
+ * @return true if success, false otherwise
+ */
+bool wsid_table_add(struct wsid_table *table,
+		    uint64_t addr,
+		    uint64_t phys,
+		    uint64_t len,
+		    int flags,
+		    uint64_t *wsid)
+{
+	struct wsid_slot *slot;
+	uint32_t index;
+
+	if (table->free_head == WSID_FREE_NONE && !wsid_table_grow(table))
+		return false;
+
+	index = table->free_head;
+	slot = wsid_table_slot(table, index);
+	table->free_head = slot->next_free;
+
+	/* Order the fields after the slot's earlier release. */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	slot->addr  = addr;
+	slot->len   = len;
+	slot->flags = flags;
+	__atomic_store_n(&slot->phys, phys, __ATOMIC_RELAXED);
+
+	*wsid = ((uint64_t)slot->gen << 32) | index;
+	__atomic_store_n(&slot->wsid, *wsid, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * @brief Remove a buffer workspace from the table
+ *        The slot's generation is advanced, so the wsid
+ *        won't be found again.
+ * @param table
+ * @param wsid
+ *
+ * @return true if success, false otherwise
+ */
+bool wsid_table_del(struct wsid_table *table, uint64_t wsid)
+{
+	struct wsid_slot *slot = wsid_table_find(table, wsid);
+
+	if (!slot)
+		return false;
+
+	__atomic_store_n(&slot->wsid, 0, __ATOMIC_RELAXED);
+
+	if (!++slot->gen)
+		slot->gen = 1;
+
+	slot->next_free = table->free_head;
+	table->free_head = (uint32_t)wsid;
+
+	return true;
+}
+
+/**
+ * @brief Find a live buffer workspace
+ *        Must be called with the handle lock held.
+ * @param table
+ * @param wsid
+ *
+ * @return the slot, or NULL if wsid is not live
+ */
+struct wsid_slot *wsid_table_find(struct wsid_table *table, uint64_t wsid)
+{
+	struct wsid_slot *slot;
+
+	if (!wsid)
+		return NULL;
+
+	slot = wsid_table_slot(table, wsid);
+	if (!slot || (slot->wsid != wsid))
+		return NULL;
+
+	return slot;
+}
+
+/**
+ * @brief Retrieve the IO address of a live buffer workspace
+ *        Safe to call without the handle lock. The slot is
+ *        read twice, so a concurrent release or reuse of the
+ *        slot is detected rather than reported as a match.
+ * @param table
+ * @param wsid
+ * @param phys
+ *
+ * @return true if wsid is live, false otherwise
+ */
+bool wsid_table_phys(struct wsid_table *table, uint64_t wsid, uint64_t *phys)
+{
+	struct wsid_slot *slot;
+	uint64_t p;
+
+	if (!wsid)
+		return false;
+
+	slot = wsid_table_slot(table, wsid);
+	if (!slot || (__atomic_load_n(&slot->wsid, __ATOMIC_ACQUIRE) != wsid))
+		return false;
+
+	p = __atomic_load_n(&slot->phys, __ATOMIC_RELAXED);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->wsid, __ATOMIC_RELAXED) != wsid)
+		return false;
+
+	*phys = p;
+	return true;
+}
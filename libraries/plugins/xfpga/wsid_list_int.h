@@ -50,4 +50,22 @@ uint64_t wsid_gen(void);
 struct wsid_map *wsid_find(struct wsid_tracker *root, uint64_t wsid);
 struct wsid_map *wsid_find_by_index(struct wsid_tracker *root, uint32_t index);
 
+/*
+ * Buffer workspace table manipulation functions
+ */
+struct wsid_table *wsid_table_init(void);
+void wsid_table_cleanup(struct wsid_table *table,
+			void (*clean)(struct wsid_slot *));
+
+bool wsid_table_add(struct wsid_table *table,
+		    uint64_t addr,
+		    uint64_t phys,
+		    uint64_t len,
+		    int      flags,
+		    uint64_t *wsid);
+bool wsid_table_del(struct wsid_table *table, uint64_t wsid);
+
+struct wsid_slot *wsid_table_find(struct wsid_table *table, uint64_t wsid);
+bool wsid_table_phys(struct wsid_table *table, uint64_t wsid, uint64_t *phys);
+
 #endif // ___FPGA_COMMON_INT_H__
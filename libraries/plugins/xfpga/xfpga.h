@@ -52,6 +52,18 @@ fpga_result xfpga_fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
 				 uint64_t offset, uint32_t *value);
 fpga_result xfpga_fpgaWriteMMIO512(fpga_handle handle, uint32_t mmio_num,
 				  uint64_t offset, const void *value);
+fpga_result xfpga_fpgaReadMMIO512(fpga_handle handle, uint32_t mmio_num,
+				 uint64_t offset, void *value);
+fpga_result xfpga_fpgaCopyToMMIO(fpga_handle handle, uint32_t mmio_num,
+				uint64_t offset, const void *src,
+				uint64_t len);
+fpga_result xfpga_fpgaCopyFromMMIO(fpga_handle handle, uint32_t mmio_num,
+				  uint64_t offset, void *dst, uint64_t len);
+fpga_result xfpga_fpgaReadMMIOBatch(fpga_handle handle, fpga_mmio_op *ops,
+				   uint32_t num_ops);
+fpga_result xfpga_fpgaWriteMMIOBatch(fpga_handle handle,
+				    const fpga_mmio_op *ops,
+				    uint32_t num_ops);
 fpga_result xfpga_fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
 			      uint64_t **mmio_ptr);
 fpga_result xfpga_fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num);
@@ -66,9 +78,19 @@ fpga_result xfpga_fpgaTriggerUmsg(fpga_handle handle, uint64_t value);
 fpga_result xfpga_fpgaGetUmsgPtr(fpga_handle handle, uint64_t **umsg_ptr);
 fpga_result xfpga_fpgaPrepareBuffer(fpga_handle handle, uint64_t len,
 				    void **buf_addr, uint64_t *wsid, int flags);
+fpga_result xfpga_fpgaPrepareBufferEx(fpga_handle handle, uint64_t len,
+				      void **buf_addr, uint64_t *wsid,
+				      int flags, int numa_node);
+fpga_result xfpga_fpgaPrepareBufferSG(fpga_handle handle, void *buf_addr,
+				      uint64_t len, uint64_t *wsid,
+				      fpga_sg_entry *sg, uint32_t *num_sg,
+				      int flags);
 fpga_result xfpga_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid);
+fpga_result xfpga_fpgaDrainBufferReleases(fpga_handle handle);
 fpga_result xfpga_fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
 				   uint64_t *ioaddr);
+fpga_result xfpga_fpgaGetBufferPrepareStats(fpga_handle handle,
+					    fpga_buffer_prepare_stats *stats);
 fpga_result xfpga_fpgaGetOPAECVersion(fpga_version *version);
 fpga_result xfpga_fpgaGetOPAECVersionString(char *version_str, size_t len);
 fpga_result xfpga_fpgaGetOPAECBuildString(char *build_str, size_t len);
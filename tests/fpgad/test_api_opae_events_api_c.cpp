@@ -60,10 +60,10 @@ TEST_P(fpgad_opae_events_api_c_p, events02) {
   const int num = 4;
   int i;
   api_client_event_registry registries[] = {
-    { 0, -1, 0, FPGA_EVENT_ERROR, 0, NULL },
-    { 1, -1, 0, FPGA_EVENT_ERROR, 0, NULL },
-    { 2, -1, 0, FPGA_EVENT_ERROR, 0, NULL },
-    { 3, -1, 0, FPGA_EVENT_ERROR, 0, NULL },
+    { 0, -1, 0, FPGA_EVENT_ERROR, 0, NULL, NULL, NULL },
+    { 1, -1, 0, FPGA_EVENT_ERROR, 0, NULL, NULL, NULL },
+    { 2, -1, 0, FPGA_EVENT_ERROR, 0, NULL, NULL, NULL },
+    { 3, -1, 0, FPGA_EVENT_ERROR, 0, NULL, NULL, NULL },
   };
   api_client_event_registry *l;
 
@@ -151,6 +151,50 @@ TEST_P(fpgad_opae_events_api_c_p, events03) {
   EXPECT_EQ(event_registry_list, (void *)NULL);
 }
 
+/**
+ * @test       events04
+ * @brief      Test: opae_api_unregister_all_events_for
+ * @details    Removes every registration of the given<br>
+ *             client, and only those.<br>
+ */
+TEST_P(fpgad_opae_events_api_c_p, events04) {
+  api_client_event_registry *l;
+  int i;
+
+  ASSERT_EQ(event_registry_list, (void *)NULL);
+
+  // 5 -> 6 -> 5 -> 6 -> 5 -> 6
+  for (i = 0 ; i < 6 ; ++i) {
+    ASSERT_EQ(opae_api_register_event(6 - (i & 1),
+                                      -1,
+                                      FPGA_EVENT_ERROR,
+                                      i), 0);
+  }
+
+  opae_api_unregister_all_events_for(5);
+
+  i = 0;
+  for (l = event_registry_list ; l ; l = l->next) {
+    EXPECT_EQ(l->conn_socket, 6);
+    if (l->next) {
+      EXPECT_EQ(l->next->prev, l);
+    }
+    ++i;
+  }
+  EXPECT_EQ(i, 3);
+
+  EXPECT_NE(opae_api_unregister_event(5, FPGA_EVENT_ERROR, 1), 0);
+  EXPECT_EQ(opae_api_unregister_event(6, FPGA_EVENT_ERROR, 2), 0);
+
+  opae_api_unregister_all_events_for(6);
+  EXPECT_EQ(event_registry_list, (void *)NULL);
+
+  // Unknown clients.
+  opae_api_unregister_all_events_for(-1);
+  opae_api_unregister_all_events_for(1 << 20);
+  EXPECT_NE(opae_api_register_event(-1, -1, FPGA_EVENT_ERROR, 0), 0);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(fpgad_opae_events_api_c_p);
 INSTANTIATE_TEST_SUITE_P(fpgad_c, fpgad_opae_events_api_c_p,
                          ::testing::ValuesIn(test_platform::platforms({ "skx-p" })));
@@ -33,21 +33,33 @@ extern "C" {
 
 #define EVENT_DISPATCH_QUEUE_DEPTH 512
 
+typedef struct _evt_dispatch_slot {
+  uint64_t seq;
+  event_dispatch_queue_item item;
+} evt_dispatch_slot;
+
 typedef struct _evt_dispatch_queue {
-  event_dispatch_queue_item q[EVENT_DISPATCH_QUEUE_DEPTH];
-  unsigned head;
-  unsigned tail;
-  pthread_mutex_t lock;
+  evt_dispatch_slot q[EVENT_DISPATCH_QUEUE_DEPTH];
+  uint64_t tail __attribute__((aligned(64)));
+  uint64_t head __attribute__((aligned(64)));
+  evt_queue_stats stats;
 } evt_dispatch_queue;
 
 extern evt_dispatch_queue normal_queue;
 extern evt_dispatch_queue high_priority_queue;
 
+void evt_queue_init(evt_dispatch_queue *q);
 bool evt_queue_is_full(evt_dispatch_queue *q);
+bool evt_queue_is_empty(evt_dispatch_queue *q);
+bool evt_queue_try_put(evt_dispatch_queue *q,
+                       fpgad_respond_event_t callback,
+                       fpgad_monitored_device *device,
+                       void *context);
 }
 
 #include <thread>
 #include <chrono>
+#include <vector>
 
 #define NO_OPAE_C
 #include "mock/opae_fixtures.h"
@@ -79,16 +91,18 @@ class fpgad_evt_c_p : public opae_base_p<> {
  */
 TEST_P(fpgad_evt_c_p, q_full0) {
   evt_dispatch_queue q;
+  fpgad_monitored_device d;
 
-  // case 0
-  q.head = 0;
-  q.tail = EVENT_DISPATCH_QUEUE_DEPTH - 1;
-  EXPECT_TRUE(evt_queue_is_full(&q));
+  evt_queue_init(&q);
+  EXPECT_TRUE(evt_queue_is_empty(&q));
+
+  for (unsigned i = 0 ; i < EVENT_DISPATCH_QUEUE_DEPTH ; ++i) {
+    EXPECT_FALSE(evt_queue_is_full(&q));
+    EXPECT_TRUE(evt_queue_try_put(&q, NULL, &d, NULL));
+  }
 
-  // case 1
-  q.head = 1;
-  q.tail = 0;
   EXPECT_TRUE(evt_queue_is_full(&q));
+  EXPECT_FALSE(evt_queue_try_put(&q, NULL, &d, NULL));
 }
 
 static void test_evt_response(fpgad_monitored_device *dev,
@@ -102,18 +116,20 @@ static void test_evt_response(fpgad_monitored_device *dev,
  * @test       q_full1
  * @brief      Test: evt_queue_response
  * @details    When normal_queue is full,<br>
- *             the function logs an error and returns false.<br>
+ *             the function counts a drop and returns false.<br>
  */
 TEST_P(fpgad_evt_c_p, q_full1) {
   fpgad_monitored_device d;
 
-  normal_queue.head = 1;
-  normal_queue.tail = 0;
+  evt_queue_init(&normal_queue);
+  for (unsigned i = 0 ; i < EVENT_DISPATCH_QUEUE_DEPTH ; ++i)
+    EXPECT_TRUE(evt_queue_response(test_evt_response, &d, NULL));
+
   EXPECT_FALSE(evt_queue_response(test_evt_response,
                                   &d,
                                   NULL));
-  normal_queue.head = 0;
-  normal_queue.tail = 0;
+  EXPECT_EQ(normal_queue.stats.dropped_newest, 1);
+  evt_queue_init(&normal_queue);
 }
 
 static void stop_running_response(fpgad_monitored_device *dev,
@@ -149,3 +165,224 @@ TEST_P(fpgad_evt_c_p, normal_dispatch) {
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(fpgad_evt_c_p);
 INSTANTIATE_TEST_SUITE_P(fpgad_evt_c, fpgad_evt_c_p,
                          ::testing::ValuesIn(test_platform::platforms({ "skx-p" })));
+
+class fpgad_evt_queue_c : public ::testing::Test {
+ protected:
+
+  virtual void SetUp() override {
+    saved_ = global_config;
+    global_config.poll_interval_usec = 100 * 1000;
+    global_config.queue_policy = FPGAD_QUEUE_DROP_NEWEST;
+    global_config.running = true;
+
+    evt_queue_init(&normal_queue);
+    evt_queue_init(&high_priority_queue);
+  }
+
+  virtual void TearDown() override {
+    evt_queue_init(&normal_queue);
+    evt_queue_init(&high_priority_queue);
+
+    global_config = saved_;
+  }
+
+  void fill(unsigned count) {
+    for (unsigned i = 0 ; i < count ; ++i)
+      EXPECT_TRUE(evt_queue_response(test_evt_response,
+                                     &device_,
+                                     (void *)(uintptr_t)i));
+  }
+
+  struct fpgad_config saved_;
+  fpgad_monitored_device device_;
+};
+
+/**
+ * @test       batch
+ * @brief      Test: evt_queue_get_batch, evt_queue_get_stats
+ * @details    Batch dequeue returns up to max items in FIFO order,<br>
+ *             wrapping around the ring, and the stats track depth.<br>
+ */
+TEST_F(fpgad_evt_queue_c, batch) {
+  event_dispatch_queue_item items[16];
+  evt_queue_stats stats;
+  uintptr_t expect = 0;
+  unsigned n;
+
+  // Advance the ring so that the batches below wrap.
+  fill(EVENT_DISPATCH_QUEUE_DEPTH - 5);
+  while ((n = evt_queue_get_batch(items, 16))) {
+    for (unsigned i = 0 ; i < n ; ++i)
+      EXPECT_EQ((uintptr_t)items[i].context, expect++);
+  }
+  EXPECT_EQ(expect, EVENT_DISPATCH_QUEUE_DEPTH - 5);
+
+  fill(40);
+  evt_queue_get_stats(false, &stats);
+  EXPECT_EQ(stats.depth, 40);
+  EXPECT_EQ(stats.enqueued, EVENT_DISPATCH_QUEUE_DEPTH + 35);
+
+  EXPECT_EQ(evt_queue_get_batch(items, 16), 16);
+  for (unsigned i = 0 ; i < 16 ; ++i)
+    EXPECT_EQ((uintptr_t)items[i].context, i);
+  EXPECT_EQ(evt_queue_get_batch(items, 16), 16);
+  EXPECT_EQ((uintptr_t)items[0].context, 16);
+  EXPECT_EQ(evt_queue_get_batch(items, 16), 8);
+  EXPECT_EQ((uintptr_t)items[7].context, 39);
+  EXPECT_EQ(evt_queue_get_batch(items, 16), 0);
+
+  evt_queue_get_stats(true, &stats);
+  EXPECT_EQ(stats.depth, 0);
+  EXPECT_EQ(stats.enqueued, 0);
+}
+
+/**
+ * @test       drop_oldest
+ * @brief      Test: evt_queue_response
+ * @details    Under FPGAD_QUEUE_DROP_OLDEST, a full queue evicts<br>
+ *             its oldest items to accept new ones.<br>
+ */
+TEST_F(fpgad_evt_queue_c, drop_oldest) {
+  event_dispatch_queue_item item;
+  evt_queue_stats stats;
+
+  global_config.queue_policy = FPGAD_QUEUE_DROP_OLDEST;
+  fill(EVENT_DISPATCH_QUEUE_DEPTH + 3);
+
+  evt_queue_get_stats(false, &stats);
+  EXPECT_EQ(stats.depth, EVENT_DISPATCH_QUEUE_DEPTH);
+  EXPECT_EQ(stats.dropped_oldest, 3);
+  EXPECT_EQ(stats.dropped_newest, 0);
+
+  ASSERT_TRUE(evt_queue_get(&item));
+  EXPECT_EQ((uintptr_t)item.context, 3);
+}
+
+/**
+ * @test       block
+ * @brief      Test: evt_queue_response
+ * @details    Under FPGAD_QUEUE_BLOCK, a producer facing a full queue<br>
+ *             waits for the consumer to make room. When none does<br>
+ *             within poll_interval_usec, the new item is dropped.<br>
+ */
+TEST_F(fpgad_evt_queue_c, block) {
+  evt_queue_stats stats;
+
+  global_config.queue_policy = FPGAD_QUEUE_BLOCK;
+  global_config.poll_interval_usec = 2000;
+  fill(EVENT_DISPATCH_QUEUE_DEPTH);
+
+  EXPECT_FALSE(evt_queue_response(test_evt_response, &device_, NULL));
+  evt_queue_get_stats(false, &stats);
+  EXPECT_EQ(stats.blocked, 1);
+  EXPECT_EQ(stats.dropped_newest, 1);
+
+  global_config.poll_interval_usec = 1000 * 1000;
+  std::thread consumer([] {
+    event_dispatch_queue_item item;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    evt_queue_get(&item);
+  });
+
+  EXPECT_TRUE(evt_queue_response(test_evt_response, &device_, NULL));
+  consumer.join();
+
+  evt_queue_get_stats(false, &stats);
+  EXPECT_EQ(stats.blocked, 2);
+  EXPECT_EQ(stats.dropped_newest, 1);
+  EXPECT_EQ(stats.depth, EVENT_DISPATCH_QUEUE_DEPTH);
+}
+
+/**
+ * @test       mpsc
+ * @brief      Test: evt_queue_response, evt_queue_get_batch
+ * @details    Several producers racing into one queue under<br>
+ *             FPGAD_QUEUE_BLOCK lose nothing, and each producer's<br>
+ *             items arrive in the order it queued them.<br>
+ */
+TEST_F(fpgad_evt_queue_c, mpsc) {
+  const unsigned producers = 4;
+  const unsigned per_producer = 20000;
+  std::vector<std::thread> threads;
+  std::vector<uintptr_t> next(producers, 0);
+  event_dispatch_queue_item items[16];
+  unsigned received = 0;
+  evt_queue_stats stats;
+  fpgad_monitored_device *d = &device_;
+
+  global_config.queue_policy = FPGAD_QUEUE_BLOCK;
+  global_config.poll_interval_usec = 10 * 1000 * 1000;
+
+  for (unsigned p = 0 ; p < producers ; ++p) {
+    threads.emplace_back([p, d] {
+      for (uintptr_t i = 0 ; i < per_producer ; ++i)
+        evt_queue_response(test_evt_response, d,
+                           (void *)((uintptr_t)p << 32 | i));
+    });
+  }
+
+  while (received < producers * per_producer) {
+    unsigned n = evt_queue_get_batch(items, 16);
+    for (unsigned i = 0 ; i < n ; ++i) {
+      uintptr_t v = (uintptr_t)items[i].context;
+      uintptr_t p = v >> 32;
+      ASSERT_LT(p, producers);
+      EXPECT_EQ(v & 0xffffffff, next[p]);
+      next[p] = (v & 0xffffffff) + 1;
+    }
+    received += n;
+  }
+
+  for (auto &t : threads)
+    t.join();
+
+  evt_queue_get_stats(false, &stats);
+  EXPECT_EQ(stats.enqueued, producers * per_producer);
+  EXPECT_EQ(stats.dropped_newest, 0);
+  EXPECT_EQ(stats.depth, 0);
+}
+
+static void count_response(fpgad_monitored_device *dev,
+                           void *context)
+{
+  UNUSED_PARAM(dev);
+  ++*(int *)context;
+}
+
+/**
+ * @test       dispatch
+ * @brief      Test: event_dispatcher_thread, evt_queue_get_stats
+ * @details    The dispatcher runs queued high and normal priority<br>
+ *             items and records their dispatch latency.<br>
+ */
+TEST_F(fpgad_evt_queue_c, dispatch) {
+  evt_queue_stats normal;
+  evt_queue_stats high;
+  int count = 0;
+
+  device_.object_id = 0;
+
+  std::thread dispatch_thr = std::thread(event_dispatcher_thread,
+                                         &event_dispatcher_config);
+  while (!evt_dispatcher_is_ready())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  for (int i = 0 ; i < 10 ; ++i) {
+    EXPECT_TRUE(evt_queue_response(count_response, &device_, &count));
+    EXPECT_TRUE(evt_queue_response_high(count_response, &device_, &count));
+  }
+
+  for (int i = 0 ; i < 1000 && __atomic_load_n(&count, __ATOMIC_RELAXED) < 20 ; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  global_config.running = false;
+  dispatch_thr.join();
+
+  EXPECT_EQ(count, 20);
+  evt_queue_get_stats(false, &normal);
+  evt_queue_get_stats(true, &high);
+  EXPECT_EQ(normal.dispatched, 10);
+  EXPECT_EQ(high.dispatched, 10);
+  EXPECT_GT(normal.latency_total_nsec, 0);
+  EXPECT_GE(normal.latency_total_nsec, normal.latency_max_nsec);
+}
@@ -27,22 +27,32 @@
 #include <config.h>
 #endif // HAVE_CONFIG_H
 
-#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 extern "C" {
 #include "fpgad/api/logging.h"
+#include "fpgad/api/opae_events_api.h"
 #include "fpgad/events_api_thread.h"
 
-#define MAX_CLIENT_CONNECTIONS 1023
-#define SRV_SOCKET             0
-#define FIRST_CLIENT_SOCKET    1
-
-extern struct pollfd pollfds[MAX_CLIENT_CONNECTIONS+1];
-extern nfds_t num_fds;
+extern size_t client_table_size;
+extern size_t num_clients;
 
+api_client *find_client(int conn_socket);
+int add_client(int conn_socket);
 void remove_client(int conn_socket);
+void remove_all_clients(void);
+bool events_api_is_ready(void);
 }
 
+#include <thread>
+#include <chrono>
+#include <vector>
+
 #define NO_OPAE_C
 #include "mock/opae_fixtures.h"
 
@@ -54,59 +64,249 @@ class fpgad_events_api_c_p : public opae_base_p<> {
   virtual void SetUp() override {
     opae_base_p<>::SetUp();
 
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &saved_nofile_), 0);
+
+    memset(&config_, 0, sizeof(config_));
+    config_.poll_interval_usec = 100 * 1000;
+    config_.running = true;
+    snprintf(socket_, sizeof(socket_),
+             "/tmp/fpgad_events_api_%d", getpid());
+    config_.api_socket = socket_;
+
+    thr_config_.global = &config_;
+    thr_config_.sched_policy = SCHED_OTHER;
+    thr_config_.sched_priority = 0;
+
     log_set(stdout);
   }
 
   virtual void TearDown() override {
+    if (thr_.joinable()) {
+      config_.running = false;
+      thr_.join();
+    }
+    unlink(socket_);
+
     log_close();
 
+    setrlimit(RLIMIT_NOFILE, &saved_nofile_);
+
     opae_base_p<>::TearDown();
   }
 
+  void start() {
+    thr_ = std::thread(events_api_thread, &thr_config_);
+    while (!events_api_is_ready())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  static void count_registry(api_client_event_registry *r, void *context) {
+    UNUSED_PARAM(r);
+    ++*(size_t *)context;
+  }
+
+  // Wait up to 30s for count clients, each with count registrations.
+  bool wait_for_clients(size_t count) {
+    for (int i = 0 ; i < 30000 ; ++i) {
+      size_t registered = 0;
+
+      opae_api_for_each_registered_event(count_registry, &registered);
+      if (__atomic_load_n(&num_clients, __ATOMIC_RELAXED) == count &&
+          registered == count)
+        return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  struct fpgad_config config_;
+  events_api_thread_config thr_config_;
+  char socket_[64];
+  std::thread thr_;
+  struct rlimit saved_nofile_;
 };
 
 /**
  * @test       remove0
- * @brief      Test: remove_client
+ * @brief      Test: add_client, remove_client
  * @details    Test the fn's ability to remove,<br>
- *             clients from various places in the array.<br>
+ *             clients from various places in the table.<br>
  */
 TEST_P(fpgad_events_api_c_p, remove0) {
-  int conn_socket = -1;
+  int fds[4];
+  int i;
 
-  // (only one client)
-  pollfds[FIRST_CLIENT_SOCKET+0].fd = conn_socket;
-  num_fds = 2;
-
-  remove_client(conn_socket);
-  EXPECT_EQ(num_fds, 1);
+  for (i = 0 ; i < 4 ; ++i) {
+    fds[i] = eventfd(0, 0);
+    ASSERT_GE(fds[i], 0);
+    ASSERT_EQ(add_client(fds[i]), 0);
+  }
+  EXPECT_EQ(num_clients, 4);
 
   // (client in middle)
-  pollfds[FIRST_CLIENT_SOCKET+0].fd = 0;
-  pollfds[FIRST_CLIENT_SOCKET+1].fd = conn_socket;
-  pollfds[FIRST_CLIENT_SOCKET+2].fd = conn_socket;
-  pollfds[FIRST_CLIENT_SOCKET+3].fd = 3;
-  num_fds = 5;
-
-  remove_client(conn_socket);
-  EXPECT_EQ(num_fds, 3);
-  EXPECT_EQ(pollfds[FIRST_CLIENT_SOCKET+0].fd, 0);
-  EXPECT_EQ(pollfds[FIRST_CLIENT_SOCKET+1].fd, 3);
+  remove_client(fds[1]);
+  EXPECT_EQ(num_clients, 3);
+  EXPECT_EQ(find_client(fds[1]), nullptr);
+  EXPECT_NE(find_client(fds[0]), nullptr);
+  EXPECT_NE(find_client(fds[2]), nullptr);
 
   // (client at end)
-  pollfds[FIRST_CLIENT_SOCKET+0].fd = 0;
-  pollfds[FIRST_CLIENT_SOCKET+1].fd = 1;
-  pollfds[FIRST_CLIENT_SOCKET+2].fd = conn_socket;
-  num_fds = 4;
+  remove_client(fds[3]);
+  EXPECT_EQ(num_clients, 2);
+  EXPECT_NE(find_client(fds[2]), nullptr);
 
-  remove_client(conn_socket);
-  EXPECT_EQ(num_fds, 3);
-  EXPECT_EQ(pollfds[FIRST_CLIENT_SOCKET+0].fd, 0);
-  EXPECT_EQ(pollfds[FIRST_CLIENT_SOCKET+1].fd, 1);
+  // (unknown client)
+  remove_client(-1);
+  EXPECT_EQ(num_clients, 2);
 
-  num_fds = 1;
+  remove_all_clients();
+  EXPECT_EQ(num_clients, 0);
+}
+
+/**
+ * @test       stress
+ * @brief      Test: events_api_thread, opae_api_unregister_all_events_for
+ * @details    A child process opens 10k connections to the<br>
+ *             events API socket, each registering an eventfd<br>
+ *             for FPGA_EVENT_ERROR. The thread serves them all,<br>
+ *             then drops each client and its registration<br>
+ *             as it hangs up.<br>
+ */
+TEST_P(fpgad_events_api_c_p, stress) {
+  const size_t clients = 10000;
+  struct rlimit rl;
+  int go[2];
+  pid_t pid;
+  int status = 0;
+  char c = 0;
+
+  // The thread holds a socket and an eventfd per client.
+  ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &rl), 0);
+  if (rl.rlim_max != RLIM_INFINITY && rl.rlim_max < 2 * clients + 256)
+    GTEST_SKIP() << "RLIMIT_NOFILE hard limit too low";
+  rl.rlim_cur = rl.rlim_max;
+  ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &rl), 0);
+
+  start();
+
+  ASSERT_EQ(pipe(go), 0);
+
+  pid = fork();
+  ASSERT_GE(pid, 0);
+  if (!pid) {
+    std::vector<int> socks;
+    struct sockaddr_un addr;
+    struct event_request req;
+    struct msghdr mh;
+    struct cmsghdr *cmh;
+    struct iovec iov[1];
+    char buf[CMSG_SPACE(sizeof(int))];
+
+    close(go[1]);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_, sizeof(addr.sun_path) - 1);
+
+    memset(&req, 0, sizeof(req));
+    req.type = REGISTER_EVENT;
+    req.event = FPGA_EVENT_ERROR;
+
+    for (size_t i = 0 ; i < clients ; ++i) {
+      int s = socket(AF_UNIX, SOCK_STREAM, 0);
+      int fd = eventfd(0, 0);
+
+      if (s < 0 || fd < 0 ||
+          connect(s, (struct sockaddr *)&addr, sizeof(addr)))
+        _exit(1);
+
+      iov[0].iov_base = &req;
+      iov[0].iov_len = sizeof(req);
+      memset(buf, 0, sizeof(buf));
+      memset(&mh, 0, sizeof(mh));
+      mh.msg_iov = iov;
+      mh.msg_iovlen = 1;
+      mh.msg_control = buf;
+      mh.msg_controllen = CMSG_LEN(sizeof(int));
+      cmh = CMSG_FIRSTHDR(&mh);
+      cmh->cmsg_len = CMSG_LEN(sizeof(int));
+      cmh->cmsg_level = SOL_SOCKET;
+      cmh->cmsg_type = SCM_RIGHTS;
+      *((int *)CMSG_DATA(cmh)) = fd;
+
+      if (sendmsg(s, &mh, 0) != (ssize_t)sizeof(req))
+        _exit(1);
+
+      // The server holds its own copy of the eventfd.
+      close(fd);
+      socks.push_back(s);
+    }
+
+    // Hold the connections until the parent has counted them.
+    if (read(go[0], &c, 1) != 1)
+      _exit(2);
+
+    for (size_t i = 0 ; i < socks.size() ; ++i)
+      close(socks[i]);
+    _exit(0);
+  }
+
+  close(go[0]);
+
+  EXPECT_TRUE(wait_for_clients(clients));
+
+  ASSERT_EQ(write(go[1], &c, 1), 1);
+  close(go[1]);
+
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  EXPECT_TRUE(wait_for_clients(0));
 }
 
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(fpgad_events_api_c_p);
 INSTANTIATE_TEST_SUITE_P(fpgad_events_api_c, fpgad_events_api_c_p,
                          ::testing::ValuesIn(test_platform::platforms({ "skx-p" })));
+
+/**
+ * @test       table
+ * @brief      Test: add_client, find_client, remove_client
+ * @details    The client table grows past its initial size,<br>
+ *             and every client stays reachable by its fd<br>
+ *             through growth and removal.<br>
+ */
+TEST(fpgad_events_api_c, table) {
+  std::vector<int> fds;
+  size_t i;
+
+  for (i = 0 ; i < 1000 ; ++i) {
+    int fd = eventfd(0, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(add_client(fd), 0);
+    fds.push_back(fd);
+  }
+  EXPECT_EQ(num_clients, 1000);
+  EXPECT_GE(client_table_size, 1000);
+
+  for (i = 0 ; i < fds.size() ; ++i) {
+    api_client *cl = find_client(fds[i]);
+    ASSERT_NE(cl, nullptr);
+    EXPECT_EQ(cl->conn_socket, fds[i]);
+  }
+
+  for (i = 0 ; i < fds.size() ; i += 2)
+    remove_client(fds[i]);
+  EXPECT_EQ(num_clients, 500);
+
+  for (i = 0 ; i < fds.size() ; ++i) {
+    if (i & 1)
+      EXPECT_NE(find_client(fds[i]), nullptr);
+    else
+      EXPECT_EQ(find_client(fds[i]), nullptr);
+  }
+
+  remove_all_clients();
+  EXPECT_EQ(num_clients, 0);
+  EXPECT_EQ(client_table_size, 0);
+}
@@ -35,24 +35,23 @@ extern "C" {
 
 #define EVENT_DISPATCH_QUEUE_DEPTH 512
 
-typedef struct _evt_dispatch_queue {
-  event_dispatch_queue_item q[EVENT_DISPATCH_QUEUE_DEPTH];
-  unsigned head;
-  unsigned tail;
-  pthread_mutex_t lock;
-} evt_dispatch_queue;
-
-extern evt_dispatch_queue normal_queue;
-extern evt_dispatch_queue high_priority_queue;
-
 void mon_queue_response(fpgad_detection_status status,
                         fpgad_respond_event_t response,
                         fpgad_monitored_device *d,
                         void *response_context);
 
 void mon_monitor(fpgad_monitored_device *d);
+
+extern fpgad_monitored_device *monitored_device_list;
+extern uint64_t mon_wheel_tick;
+int mon_sched_run(uint64_t now_usec, uint64_t max_usec);
+void mon_sched_wait(int timeout_ms);
+void mon_sched_destroy(void);
 }
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #define NO_OPAE_C
 #include "mock/opae_fixtures.h"
 
@@ -82,6 +81,23 @@ static void test_evt_response(fpgad_monitored_device *dev,
   UNUSED_PARAM(context);
 }
 
+static void drain_queues()
+{
+  event_dispatch_queue_item items[EVENT_DISPATCH_QUEUE_DEPTH];
+  evt_queue_get_batch(items, EVENT_DISPATCH_QUEUE_DEPTH);
+  evt_queue_get_high_batch(items, EVENT_DISPATCH_QUEUE_DEPTH);
+}
+
+static void fill_queue(bool high, fpgad_monitored_device *d)
+{
+  for (unsigned i = 0 ; i < EVENT_DISPATCH_QUEUE_DEPTH ; ++i) {
+    if (high)
+      evt_queue_response_high(test_evt_response, d, NULL);
+    else
+      evt_queue_response(test_evt_response, d, NULL);
+  }
+}
+
 /**
  * @test       high_q_full
  * @brief      Test: mon_queue_response
@@ -89,20 +105,23 @@ static void test_evt_response(fpgad_monitored_device *dev,
  *             calls to the function log an error and drop the request.<br>
  */
 TEST_P(fpgad_monitor_c_p, high_q_full) {
+  evt_queue_stats before;
+  evt_queue_stats after;
+  fpgad_monitored_device d;
 
-  high_priority_queue.head = 1;
-  high_priority_queue.tail = 0;
+  drain_queues();
+  fill_queue(true, &d);
 
-  fpgad_monitored_device d;
+  evt_queue_get_stats(true, &before);
   mon_queue_response(FPGAD_STATUS_DETECTED_HIGH,
                      test_evt_response,
                      &d,
                      NULL);
-  EXPECT_EQ(high_priority_queue.head, 1);
-  EXPECT_EQ(high_priority_queue.tail, 0);
+  evt_queue_get_stats(true, &after);
+  EXPECT_EQ(after.depth, EVENT_DISPATCH_QUEUE_DEPTH);
+  EXPECT_EQ(after.dropped_newest, before.dropped_newest + 1);
 
-  high_priority_queue.head = 0;
-  high_priority_queue.tail = 0;
+  drain_queues();
 }
 
 /**
@@ -112,20 +131,23 @@ TEST_P(fpgad_monitor_c_p, high_q_full) {
  *             calls to the function log an error and drop the request.<br>
  */
 TEST_P(fpgad_monitor_c_p, normal_q_full) {
+  evt_queue_stats before;
+  evt_queue_stats after;
+  fpgad_monitored_device d;
 
-  normal_queue.head = 1;
-  normal_queue.tail = 0;
+  drain_queues();
+  fill_queue(false, &d);
 
-  fpgad_monitored_device d;
+  evt_queue_get_stats(false, &before);
   mon_queue_response(FPGAD_STATUS_DETECTED,
                      test_evt_response,
                      &d,
                      NULL);
-  EXPECT_EQ(normal_queue.head, 1);
-  EXPECT_EQ(normal_queue.tail, 0);
+  evt_queue_get_stats(false, &after);
+  EXPECT_EQ(after.depth, EVENT_DISPATCH_QUEUE_DEPTH);
+  EXPECT_EQ(after.dropped_newest, before.dropped_newest + 1);
 
-  normal_queue.head = 0;
-  normal_queue.tail = 0;
+  drain_queues();
 }
 
 /**
@@ -173,17 +195,163 @@ TEST_P(fpgad_monitor_c_p, null_response0) {
   d.detections = detections;
   d.responses = responses;
 
-  normal_queue.head = 0;
-  normal_queue.tail = 0;
+  evt_queue_stats stats;
 
-  mon_monitor(&d);
-  EXPECT_EQ(normal_queue.head, 0);
-  EXPECT_EQ(normal_queue.tail, 0);
+  drain_queues();
 
-  normal_queue.head = 0;
-  normal_queue.tail = 0;
+  mon_monitor(&d);
+  evt_queue_get_stats(false, &stats);
+  EXPECT_EQ(stats.depth, 0);
 }
 
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(fpgad_monitor_c_p);
 INSTANTIATE_TEST_SUITE_P(fpgad_monitor_c, fpgad_monitor_c_p,
                          ::testing::ValuesIn(test_platform::platforms({ "skx-p" })));
+
+typedef struct _sched_test_context {
+  int count;
+  int fd;
+} sched_test_context;
+
+static fpgad_detection_status
+counting_detection(fpgad_monitored_device *dev,
+                   void *context)
+{
+  sched_test_context *c = (sched_test_context *)context;
+  uint64_t value;
+  UNUSED_PARAM(dev);
+  ++c->count;
+  if (c->fd >= 0) {
+    EXPECT_EQ(read(c->fd, &value, sizeof(value)), (ssize_t)sizeof(value));
+  }
+  return FPGAD_STATUS_NOT_DETECTED;
+}
+
+class fpgad_monitor_sched_c : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    memset(&config_, 0, sizeof(config_));
+    config_.poll_interval_usec = 10000;
+    memset(&d_, 0, sizeof(d_));
+    d_.config = &config_;
+    d_.type = FPGAD_PLUGIN_TYPE_CALLBACK;
+  }
+
+  virtual void TearDown() override {
+    monitored_device_list = nullptr;
+    mon_sched_destroy();
+  }
+
+  struct fpgad_config config_;
+  fpgad_monitored_device d_;
+};
+
+/**
+ * @test       intervals
+ * @brief      Test: mon_sched_run
+ * @details    Each detection runs on its own interval, or on<br>
+ *             the global poll interval when none is given.<br>
+ *             The fn returns the milliseconds until the next<br>
+ *             detection is due.<br>
+ */
+TEST_F(fpgad_monitor_sched_c, intervals) {
+  sched_test_context contexts[2] = { { 0, -1 }, { 0, -1 } };
+  fpgad_detect_event_t detections[] = {
+    counting_detection,
+    counting_detection,
+    nullptr
+  };
+  void *detection_contexts[] = { &contexts[0], &contexts[1] };
+  uint64_t intervals[] = { 0, 2000 };
+
+  d_.detections = detections;
+  d_.detection_contexts = detection_contexts;
+  d_.detection_intervals = intervals;
+
+  mon_monitor_device(&d_);
+  uint64_t start = mon_wheel_tick * 1000;
+
+  EXPECT_EQ(mon_sched_run(start, 10000), 2);
+  EXPECT_EQ(contexts[0].count, 1);
+  EXPECT_EQ(contexts[1].count, 1);
+
+  EXPECT_EQ(mon_sched_run(start + 1000, 10000), 1);
+  EXPECT_EQ(contexts[1].count, 1);
+
+  EXPECT_EQ(mon_sched_run(start + 2000, 10000), 2);
+  EXPECT_EQ(contexts[0].count, 1);
+  EXPECT_EQ(contexts[1].count, 2);
+
+  EXPECT_EQ(mon_sched_run(start + 10000, 10000), 2);
+  EXPECT_EQ(contexts[0].count, 2);
+  EXPECT_EQ(contexts[1].count, 3);
+}
+
+/**
+ * @test       idle
+ * @brief      Test: mon_sched_run
+ * @details    When no detection is due within the maximum wait,<br>
+ *             the fn returns the maximum wait.<br>
+ */
+TEST_F(fpgad_monitor_sched_c, idle) {
+  sched_test_context context = { 0, -1 };
+  fpgad_detect_event_t detections[] = {
+    counting_detection,
+    nullptr
+  };
+  void *detection_contexts[] = { &context };
+  uint64_t intervals[] = { 5000000 };
+
+  d_.detections = detections;
+  d_.detection_contexts = detection_contexts;
+  d_.detection_intervals = intervals;
+
+  mon_monitor_device(&d_);
+  uint64_t start = mon_wheel_tick * 1000;
+
+  EXPECT_EQ(mon_sched_run(start, 100000), 100);
+  EXPECT_EQ(context.count, 1);
+  EXPECT_EQ(mon_sched_run(start + 100000, 100000), 100);
+  EXPECT_EQ(context.count, 1);
+}
+
+/**
+ * @test       fd
+ * @brief      Test: mon_sched_wait
+ * @details    A detection with a descriptor runs as soon as the<br>
+ *             descriptor is signaled, independent of its interval.<br>
+ */
+TEST_F(fpgad_monitor_sched_c, fd) {
+  int fd = eventfd(0, EFD_NONBLOCK);
+  ASSERT_GE(fd, 0);
+
+  sched_test_context context = { 0, fd };
+  fpgad_detect_event_t detections[] = {
+    counting_detection,
+    nullptr
+  };
+  void *detection_contexts[] = { &context };
+  uint64_t intervals[] = { 5000000 };
+  int fds[] = { fd };
+  uint64_t one = 1;
+
+  d_.detections = detections;
+  d_.detection_contexts = detection_contexts;
+  d_.detection_intervals = intervals;
+  d_.detection_fds = fds;
+
+  mon_monitor_device(&d_);
+
+  // Consume the wakeup from adding the device.
+  mon_sched_wait(0);
+  EXPECT_EQ(context.count, 0);
+
+  ASSERT_EQ(write(fd, &one, sizeof(one)), (ssize_t)sizeof(one));
+  mon_sched_wait(1000);
+  EXPECT_EQ(context.count, 1);
+
+  mon_sched_wait(0);
+  EXPECT_EQ(context.count, 1);
+
+  close(fd);
+}
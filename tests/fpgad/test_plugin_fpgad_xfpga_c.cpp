@@ -83,6 +83,11 @@ void fpgad_xfpga_respond_AP6_and_Null_GBS(fpgad_monitored_device *d,
 void fpgad_xfpga_respond_AP6(fpgad_monitored_device *d,
                              void *context);
 
+int fpgad_xfpga_schedule(fpgad_monitored_device *d,
+                         const char *dir);
+
+void fpgad_xfpga_unschedule(fpgad_monitored_device *d);
+
 int fpgad_plugin_configure(fpgad_monitored_device *d,
                            const char *cfg);
 
@@ -99,6 +104,11 @@ extern fpgad_respond_event_t fpgad_xfpga_fme_responses[1];
 extern void *fpgad_xfpga_fme_response_contexts[1];
 }
 
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #define NO_OPAE_C
 #include "mock/opae_fixtures.h"
 
@@ -412,8 +422,12 @@ TEST_P(mock_port_fpgad_xfpga_c_p, configure) {
   EXPECT_EQ(d.detection_contexts, fpgad_xfpga_port_detection_contexts);
   EXPECT_EQ(d.responses, fpgad_xfpga_port_responses);
   EXPECT_EQ(d.response_contexts, fpgad_xfpga_port_response_contexts);
+  EXPECT_NE(d.detection_intervals, nullptr);
+  EXPECT_NE(d.detection_fds, nullptr);
 
   fpgad_plugin_destroy(&d);
+  EXPECT_EQ(d.detection_intervals, nullptr);
+  EXPECT_EQ(d.detection_fds, nullptr);
 }
 
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(mock_port_fpgad_xfpga_c_p);
@@ -594,3 +608,120 @@ TEST_P(mock_fme_fpgad_xfpga_c_p, configure) {
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(mock_fme_fpgad_xfpga_c_p);
 INSTANTIATE_TEST_SUITE_P(fpgad_c, mock_fme_fpgad_xfpga_c_p,
                          ::testing::ValuesIn(test_platform::mock_platforms({ "skx-p" })));
+
+class fpgad_xfpga_schedule_c : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    strcpy(dir_, "/tmp/fpgad-xfpga-XXXXXX");
+    ASSERT_NE(mkdtemp(dir_), nullptr);
+    path_ = std::string(dir_);
+    ASSERT_EQ(mkdir((path_ + "/errors").c_str(), 0755), 0);
+    write_file("ap1_event", "0\n");
+    write_file("ap2_event", "0\n");
+    write_file("power_state", "0\n");
+    write_file("errors/errors", "0x0000000000000000\n");
+
+    memset(&d_, 0, sizeof(d_));
+    d_.object_type = FPGA_ACCELERATOR;
+    d_.type = FPGAD_PLUGIN_TYPE_CALLBACK;
+    d_.detections = fpgad_xfpga_port_detections;
+    d_.detection_contexts = fpgad_xfpga_port_detection_contexts;
+    d_.responses = fpgad_xfpga_port_responses;
+    d_.response_contexts = fpgad_xfpga_port_response_contexts;
+    log_set(stdout);
+  }
+
+  virtual void TearDown() override {
+    log_close();
+    fpgad_xfpga_unschedule(&d_);
+    unlink((path_ + "/errors/errors").c_str());
+    rmdir((path_ + "/errors").c_str());
+    unlink((path_ + "/ap1_event").c_str());
+    unlink((path_ + "/ap2_event").c_str());
+    unlink((path_ + "/power_state").c_str());
+    rmdir(dir_);
+  }
+
+  void write_file(const char *name, const char *value)
+  {
+    FILE *fp = fopen((path_ + "/" + name).c_str(), "w");
+    ASSERT_NE(fp, nullptr);
+    fputs(value, fp);
+    fclose(fp);
+  }
+
+  char dir_[32];
+  std::string path_;
+  fpgad_monitored_device d_;
+};
+
+/**
+ * @test       schedule
+ * @brief      Test: fpgad_xfpga_schedule, fpgad_xfpga_unschedule
+ * @details    The AP and AP6 detections of a Port get a descriptor<br>
+ *             on their sysfs attribute and the global poll interval.<br>
+ *             The other errors are polled at a slower interval,<br>
+ *             without a descriptor.<br>
+ */
+TEST_F(fpgad_xfpga_schedule_c, schedule) {
+  ASSERT_EQ(fpgad_xfpga_schedule(&d_, dir_), 0);
+  ASSERT_NE(d_.detection_intervals, nullptr);
+  ASSERT_NE(d_.detection_fds, nullptr);
+
+  // AP1, AP2, power state and AP6.
+  const unsigned ap[] = { 0, 1, 2, 4 };
+  for (unsigned i : ap) {
+    EXPECT_EQ(d_.detection_intervals[i], 0);
+    EXPECT_GE(d_.detection_fds[i], 0);
+  }
+  EXPECT_EQ(d_.detections[4], fpgad_xfpga_detect_High_Priority_Error);
+
+  for (unsigned i = 3 ; d_.detections[i] ; ++i) {
+    if (i == 4)
+      continue;
+    EXPECT_GT(d_.detection_intervals[i], 0);
+    EXPECT_EQ(d_.detection_fds[i], -1);
+  }
+
+  fpgad_xfpga_unschedule(&d_);
+  EXPECT_EQ(d_.detection_intervals, nullptr);
+  EXPECT_EQ(d_.detection_fds, nullptr);
+}
+
+/**
+ * @test       poll_only
+ * @brief      Test: fpgad_xfpga_schedule
+ * @details    Without a sysfs directory, no detection<br>
+ *             gets a descriptor.<br>
+ */
+TEST_F(fpgad_xfpga_schedule_c, poll_only) {
+  ASSERT_EQ(fpgad_xfpga_schedule(&d_, nullptr), 0);
+
+  for (unsigned i = 0 ; d_.detections[i] ; ++i)
+    EXPECT_EQ(d_.detection_fds[i], -1);
+  EXPECT_EQ(d_.detection_intervals[4], 0);
+}
+
+/**
+ * @test       fd_read
+ * @brief      Test: fpgad_xfpga_detect_High_Priority_Error
+ * @details    A detection with a descriptor reads its attribute<br>
+ *             through the descriptor, rather than the token.<br>
+ */
+TEST_F(fpgad_xfpga_schedule_c, fd_read) {
+  ASSERT_EQ(fpgad_xfpga_schedule(&d_, dir_), 0);
+  void *ap6 = d_.detection_contexts[4];
+
+  write_file("errors/errors", "0x0004000000000000\n");
+  EXPECT_EQ(fpgad_xfpga_detect_High_Priority_Error(&d_, ap6),
+            FPGAD_STATUS_DETECTED_HIGH);
+  EXPECT_EQ(d_.num_error_occurrences, 1);
+
+  EXPECT_EQ(fpgad_xfpga_detect_High_Priority_Error(&d_, ap6),
+            FPGAD_STATUS_NOT_DETECTED);
+
+  write_file("errors/errors", "0x0000000000000000\n");
+  EXPECT_EQ(fpgad_xfpga_detect_High_Priority_Error(&d_, ap6),
+            FPGAD_STATUS_NOT_DETECTED);
+  EXPECT_EQ(d_.num_error_occurrences, 0);
+}
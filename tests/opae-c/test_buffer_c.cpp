@@ -137,6 +137,105 @@ TEST_P(buffer_c_p, neg_test2) {
   EXPECT_EQ(fpgaReleaseBuffer(NULL, wsid), FPGA_INVALID_PARAM);
 }
 
+/**
+ * @test       pool_stats
+ * @brief      Test: fpgaGetBufferPoolStats
+ * @details    When the handle or stats pointer is NULL,<br>
+ *             fpgaGetBufferPoolStats returns FPGA_INVALID_PARAM.<br>
+ *             When the plugin has no buffer pool for the handle,<br>
+ *             it returns FPGA_NOT_SUPPORTED.<br>
+ */
+TEST_P(buffer_c_p, pool_stats) {
+  fpga_buffer_pool_stats stats;
+  EXPECT_EQ(fpgaGetBufferPoolStats(NULL, &stats), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetBufferPoolStats(accel_, NULL), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetBufferPoolStats(accel_, &stats), FPGA_NOT_SUPPORTED);
+}
+
+/**
+ * @test       prep_stats
+ * @brief      Test: fpgaGetBufferPrepareStats
+ * @details    When the handle or stats pointer is NULL,<br>
+ *             fpgaGetBufferPrepareStats returns FPGA_INVALID_PARAM.<br>
+ *             A buffer prepared with FPGA_BUF_PREFAULT is counted<br>
+ *             as a prefaulted DMA mapping.<br>
+ */
+TEST_P(buffer_c_p, prep_stats) {
+  fpga_buffer_prepare_stats before;
+  fpga_buffer_prepare_stats after;
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+  EXPECT_EQ(fpgaGetBufferPrepareStats(NULL, &before), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetBufferPrepareStats(accel_, NULL), FPGA_INVALID_PARAM);
+  ASSERT_EQ(fpgaGetBufferPrepareStats(accel_, &before), FPGA_OK);
+  ASSERT_EQ(fpgaPrepareBuffer(accel_, (uint64_t) pg_size_, &buf_addr,
+                              &wsid, FPGA_BUF_PREFAULT), FPGA_OK);
+  ASSERT_EQ(fpgaGetBufferPrepareStats(accel_, &after), FPGA_OK);
+  EXPECT_EQ(after.buffers, before.buffers + 1);
+  EXPECT_EQ(after.prefaulted, before.prefaulted + 1);
+  EXPECT_EQ(fpgaReleaseBuffer(accel_, wsid), FPGA_OK);
+}
+
+/**
+ * @test       prep_ex
+ * @brief      Test: fpgaPrepareBufferEx
+ * @details    When called with FPGA_NUMA_NODE_ANY,<br>
+ *             fpgaPrepareBufferEx behaves as fpgaPrepareBuffer.<br>
+ *             When called with a null fpga handle,<br>
+ *             it returns FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(buffer_c_p, prep_ex) {
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+  EXPECT_EQ(fpgaPrepareBufferEx(NULL, (uint64_t) pg_size_, &buf_addr,
+                                &wsid, 0, FPGA_NUMA_NODE_ANY),
+            FPGA_INVALID_PARAM);
+  ASSERT_EQ(fpgaPrepareBufferEx(accel_, (uint64_t) pg_size_, &buf_addr,
+                                &wsid, 0, FPGA_NUMA_NODE_ANY), FPGA_OK);
+  EXPECT_NE(buf_addr, nullptr);
+  EXPECT_EQ(fpgaReleaseBuffer(accel_, wsid), FPGA_OK);
+}
+
+/**
+ * @test       prep_sg
+ * @brief      Test: fpgaPrepareBufferSG
+ * @details    When called with a null fpga handle, buffer, or<br>
+ *             segment list, fpgaPrepareBufferSG returns<br>
+ *             FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(buffer_c_p, prep_sg) {
+  uint8_t buf[64];
+  fpga_sg_entry sg[2];
+  uint32_t num_sg = 2;
+  uint64_t wsid = 0;
+  EXPECT_EQ(fpgaPrepareBufferSG(NULL, buf, sizeof(buf), &wsid,
+                                sg, &num_sg, 0), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaPrepareBufferSG(accel_, NULL, sizeof(buf), &wsid,
+                                sg, &num_sg, 0), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaPrepareBufferSG(accel_, buf, sizeof(buf), &wsid,
+                                NULL, &num_sg, 0), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaPrepareBufferSG(accel_, buf, sizeof(buf), &wsid,
+                                sg, NULL, 0), FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test       drain
+ * @brief      Test: fpgaDrainBufferReleases
+ * @details    When called with a null fpga handle,<br>
+ *             fpgaDrainBufferReleases returns FPGA_INVALID_PARAM.<br>
+ *             When the handle was not opened with<br>
+ *             FPGA_OPEN_DEFERRED_RELEASE, it returns FPGA_OK.<br>
+ */
+TEST_P(buffer_c_p, drain) {
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+  EXPECT_EQ(fpgaDrainBufferReleases(NULL), FPGA_INVALID_PARAM);
+  ASSERT_EQ(fpgaPrepareBuffer(accel_, (uint64_t) pg_size_, &buf_addr,
+                              &wsid, 0), FPGA_OK);
+  EXPECT_EQ(fpgaReleaseBuffer(accel_, wsid), FPGA_OK);
+  EXPECT_EQ(fpgaDrainBufferReleases(accel_), FPGA_OK);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(buffer_c_p);
 INSTANTIATE_TEST_SUITE_P(buffer_c, buffer_c_p,
                          ::testing::ValuesIn(test_platform::platforms({
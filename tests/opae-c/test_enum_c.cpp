@@ -32,10 +32,18 @@
 extern "C" {
 #include "intel-fpga.h"
 #include "fpga-dfl.h"
+#include "opae_int.h"
+#include "adapter.h"
+
+extern opae_api_adapter_table *adapter_list;
 }
 
 #include "mock/opae_fixtures.h"
 
+#include <chrono>
+#include <thread>
+#include <vector>
+
 static bool gEnableIRQ = true;
 
 using namespace opae::testing;
@@ -771,6 +779,44 @@ TEST_P(enum_c_mock_p, clone_token02) {
   EXPECT_EQ(fpgaDestroyToken(&token), FPGA_OK);
 }
 
+/**
+ * @test       clone_token_threads
+ * @brief      Test: fpgaCloneToken, fpgaDestroyToken
+ * @details    When several threads concurrently clone and destroy<br>
+ *             the same token, each clone is valid and the wrapped<br>
+ *             token reference count returns to its original value.<br>
+ */
+TEST_P(enum_c_mock_p, clone_token_threads) {
+  matches_ = 0;
+  fpga_token token = nullptr;
+
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, &token, 1, &matches_), FPGA_OK);
+  ASSERT_GT(matches_, 0);
+
+  opae_wrapped_token *wt = opae_validate_wrapped_token(token);
+  ASSERT_NE(wt, nullptr);
+  const uint32_t refs = wt->ref_count;
+
+  std::vector<std::thread> threads;
+  for (int t = 0 ; t < 8 ; ++t) {
+    threads.emplace_back([token]() {
+      for (int i = 0 ; i < 500 ; ++i) {
+        fpga_token clone = nullptr;
+        fpga_properties props = nullptr;
+        EXPECT_EQ(fpgaCloneToken(token, &clone), FPGA_OK);
+        EXPECT_EQ(fpgaGetProperties(clone, &props), FPGA_OK);
+        EXPECT_EQ(fpgaDestroyProperties(&props), FPGA_OK);
+        EXPECT_EQ(fpgaDestroyToken(&clone), FPGA_OK);
+      }
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+
+  EXPECT_EQ(wt->ref_count, refs);
+  EXPECT_EQ(fpgaDestroyToken(&token), FPGA_OK);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(enum_c_mock_p);
 INSTANTIATE_TEST_SUITE_P(enum_c, enum_c_mock_p,
                          ::testing::ValuesIn(test_platform::mock_platforms({
@@ -857,3 +903,112 @@ INSTANTIATE_TEST_SUITE_P(enum_c, enum_c_socket_p,
                                                                         "dfl-n6000-sku1",
                                                                         "dfl-c6100"
                                                                       })));
+
+extern "C" {
+
+#define FAUX_TOKENS 4
+static int faux_tokens[2][FAUX_TOKENS];
+static int faux_destroyed;
+
+static fpga_result faux_enumerate(int *base, const fpga_properties *filters,
+                                  uint32_t num_filters, fpga_token *tokens,
+                                  uint32_t max_tokens, uint32_t *num_matches)
+{
+  uint32_t i;
+  UNUSED_PARAM(filters);
+  UNUSED_PARAM(num_filters);
+  for (i = 0 ; tokens && (i < max_tokens) && (i < FAUX_TOKENS) ; ++i)
+    tokens[i] = &base[i];
+  *num_matches = FAUX_TOKENS;
+  return FPGA_OK;
+}
+
+static fpga_result faux_enumerate0(const fpga_properties *filters,
+                                   uint32_t num_filters, fpga_token *tokens,
+                                   uint32_t max_tokens, uint32_t *num_matches)
+{
+  return faux_enumerate(faux_tokens[0], filters, num_filters,
+                        tokens, max_tokens, num_matches);
+}
+
+static fpga_result faux_enumerate1(const fpga_properties *filters,
+                                   uint32_t num_filters, fpga_token *tokens,
+                                   uint32_t max_tokens, uint32_t *num_matches)
+{
+  // Finish after adapter 0 to show that the merge order is fixed.
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  return faux_enumerate(faux_tokens[1], filters, num_filters,
+                        tokens, max_tokens, num_matches);
+}
+
+static fpga_result faux_destroy_token(fpga_token *token)
+{
+  ++faux_destroyed;
+  *token = NULL;
+  return FPGA_OK;
+}
+
+}
+
+class enum_c_adapters_f : public ::testing::Test {
+ protected:
+  enum_c_adapters_f() {}
+
+  virtual void SetUp() override {
+    memset(adapters_, 0, sizeof(adapters_));
+    adapters_[0].plugin.path = (char *)"faux0";
+    adapters_[0].fpgaEnumerate = faux_enumerate1;
+    adapters_[0].fpgaDestroyToken = faux_destroy_token;
+    adapters_[0].next = &adapters_[1];
+    adapters_[1].plugin.path = (char *)"faux1";
+    adapters_[1].fpgaEnumerate = faux_enumerate0;
+    adapters_[1].fpgaDestroyToken = faux_destroy_token;
+
+    faux_destroyed = 0;
+
+    saved_adapters_ = adapter_list;
+    adapter_list = &adapters_[0];
+  }
+
+  virtual void TearDown() override {
+    adapter_list = saved_adapters_;
+  }
+
+  opae_api_adapter_table adapters_[2];
+  opae_api_adapter_table *saved_adapters_;
+};
+
+/**
+ * @test       merge_order
+ * @brief      Test: fpgaEnumerate
+ * @details    Adapters enumerate concurrently, but the returned tokens<br>
+ *             are ordered by adapter. Adapter tokens beyond max_tokens<br>
+ *             are returned to their adapter.<br>
+ */
+TEST_F(enum_c_adapters_f, merge_order) {
+  fpga_token tokens[2 * FAUX_TOKENS];
+  uint32_t matches = 0;
+  uint32_t i;
+
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, nullptr, 0, &matches), FPGA_OK);
+  EXPECT_EQ(2 * FAUX_TOKENS, matches);
+
+  EXPECT_EQ(fpgaEnumerate(nullptr, 0, tokens, FAUX_TOKENS + 1, &matches),
+            FPGA_OK);
+  EXPECT_EQ(2 * FAUX_TOKENS, matches);
+  // FAUX_TOKENS - 1 from adapter 1 didn't fit
+  EXPECT_EQ(FAUX_TOKENS - 1, faux_destroyed);
+
+  for (i = 0 ; i < FAUX_TOKENS + 1 ; ++i) {
+    opae_wrapped_token *wt = opae_validate_wrapped_token(tokens[i]);
+    ASSERT_NE(nullptr, wt);
+    if (i < FAUX_TOKENS) {
+      EXPECT_EQ(&adapters_[0], wt->adapter_table);
+      EXPECT_EQ(&faux_tokens[1][i], wt->opae_token);
+    } else {
+      EXPECT_EQ(&adapters_[1], wt->adapter_table);
+      EXPECT_EQ(&faux_tokens[0][0], wt->opae_token);
+    }
+    EXPECT_EQ(fpgaDestroyToken(&tokens[i]), FPGA_OK);
+  }
+}
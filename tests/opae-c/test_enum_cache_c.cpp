@@ -0,0 +1,272 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <cstring>
+
+extern "C" {
+#include "opae_int.h"
+#include "adapter.h"
+#include "props.h"
+#include "enum-cache.h"
+
+bool opae_enum_cache_matches(const struct _fpga_properties *filter,
+                             const struct _fpga_properties *p);
+bool opae_enum_cache_uevent_is_hotplug(const char *msg, size_t len);
+extern opae_api_adapter_table *adapter_list;
+}
+
+#include "mock/opae_fixtures.h"
+
+using namespace opae::testing;
+
+/**
+ * @test       matches
+ * @brief      Test: opae_enum_cache_matches
+ * @details    A cached resource matches a filter only when every field<br>
+ *             set in the filter is valid in the resource and equal.<br>
+ */
+TEST(enum_cache, matches) {
+  struct _fpga_properties *filter = opae_properties_create();
+  struct _fpga_properties *p = opae_properties_create();
+  fpga_properties fp = filter;
+  fpga_properties pp = p;
+  ASSERT_NE(nullptr, filter);
+  ASSERT_NE(nullptr, p);
+
+  ASSERT_EQ(fpgaPropertiesSetObjectType(pp, FPGA_ACCELERATOR), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetBus(pp, 0x5e), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetNumMMIO(pp, 2), FPGA_OK);
+
+  // empty filter matches anything
+  EXPECT_TRUE(opae_enum_cache_matches(filter, p));
+
+  ASSERT_EQ(fpgaPropertiesSetBus(fp, 0x5e), FPGA_OK);
+  EXPECT_TRUE(opae_enum_cache_matches(filter, p));
+
+  ASSERT_EQ(fpgaPropertiesSetObjectType(fp, FPGA_ACCELERATOR), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetNumMMIO(fp, 2), FPGA_OK);
+  EXPECT_TRUE(opae_enum_cache_matches(filter, p));
+
+  ASSERT_EQ(fpgaPropertiesSetNumMMIO(fp, 3), FPGA_OK);
+  EXPECT_FALSE(opae_enum_cache_matches(filter, p));
+  ASSERT_EQ(fpgaPropertiesSetNumMMIO(fp, 2), FPGA_OK);
+
+  ASSERT_EQ(fpgaPropertiesSetBus(fp, 0x5f), FPGA_OK);
+  EXPECT_FALSE(opae_enum_cache_matches(filter, p));
+  ASSERT_EQ(fpgaPropertiesSetBus(fp, 0x5e), FPGA_OK);
+
+  // socket id is not known for the resource
+  ASSERT_EQ(fpgaPropertiesSetSocketID(fp, 0), FPGA_OK);
+  EXPECT_FALSE(opae_enum_cache_matches(filter, p));
+
+  EXPECT_EQ(fpgaDestroyProperties(&fp), FPGA_OK);
+  EXPECT_EQ(fpgaDestroyProperties(&pp), FPGA_OK);
+}
+
+/**
+ * @test       can_filter
+ * @brief      Test: opae_enum_cache_can_filter
+ * @details    Filters naming a parent token or a runtime-varying field<br>
+ *             are not evaluated against the cache.<br>
+ */
+TEST(enum_cache, can_filter) {
+  fpga_properties filter = opae_properties_create();
+  ASSERT_NE(nullptr, filter);
+
+  EXPECT_TRUE(opae_enum_cache_can_filter(nullptr, 0));
+  EXPECT_TRUE(opae_enum_cache_can_filter(&filter, 1));
+
+  ASSERT_EQ(fpgaPropertiesSetObjectType(filter, FPGA_ACCELERATOR), FPGA_OK);
+  EXPECT_TRUE(opae_enum_cache_can_filter(&filter, 1));
+
+  ASSERT_EQ(fpgaPropertiesSetAcceleratorState(filter,
+                                              FPGA_ACCELERATOR_UNASSIGNED),
+            FPGA_OK);
+  EXPECT_FALSE(opae_enum_cache_can_filter(&filter, 1));
+
+  EXPECT_EQ(fpgaClearProperties(filter), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetNumErrors(filter, 0), FPGA_OK);
+  EXPECT_FALSE(opae_enum_cache_can_filter(&filter, 1));
+
+  EXPECT_EQ(fpgaDestroyProperties(&filter), FPGA_OK);
+}
+
+/**
+ * @test       uevent
+ * @brief      Test: opae_enum_cache_uevent_is_hotplug
+ * @details    Only add/remove/bind/unbind/move events for PCI or FPGA<br>
+ *             subsystems invalidate the cache.<br>
+ */
+TEST(enum_cache, uevent) {
+  const char bind[] = "bind@/devices/pci0000:00/0000:00:01.0\0"
+                      "ACTION=bind\0SUBSYSTEM=pci\0";
+  const char change[] = "change@/devices/pci0000:00/0000:00:01.0\0"
+                        "ACTION=change\0SUBSYSTEM=pci\0";
+  const char usb[] = "add@/devices/usb1/1-1\0ACTION=add\0SUBSYSTEM=usb\0";
+  const char vfio[] = "add@/devices/virtual/vfio/42\0ACTION=add\0"
+                      "SUBSYSTEM=vfio\0";
+  const char nosub[] = "remove@/devices/foo\0ACTION=remove\0";
+
+  EXPECT_TRUE(opae_enum_cache_uevent_is_hotplug(bind, sizeof(bind)));
+  EXPECT_FALSE(opae_enum_cache_uevent_is_hotplug(change, sizeof(change)));
+  EXPECT_FALSE(opae_enum_cache_uevent_is_hotplug(usb, sizeof(usb)));
+  EXPECT_TRUE(opae_enum_cache_uevent_is_hotplug(vfio, sizeof(vfio)));
+  EXPECT_TRUE(opae_enum_cache_uevent_is_hotplug(nosub, sizeof(nosub)));
+}
+
+extern "C" {
+
+#define FAKE_TOKENS 3
+static int fake_tokens[FAKE_TOKENS];
+static int fake_enumerate_called;
+static int fake_destroy_called;
+
+static fpga_result fake_enumerate(const fpga_properties *filters,
+                                  uint32_t num_filters, fpga_token *tokens,
+                                  uint32_t max_tokens, uint32_t *num_matches)
+{
+  uint32_t i;
+  UNUSED_PARAM(filters);
+  UNUSED_PARAM(num_filters);
+  ++fake_enumerate_called;
+  for (i = 0 ; tokens && (i < max_tokens) && (i < FAKE_TOKENS) ; ++i)
+    tokens[i] = &fake_tokens[i];
+  *num_matches = FAKE_TOKENS;
+  return FPGA_OK;
+}
+
+static fpga_result fake_get_properties(fpga_token token,
+                                       fpga_properties *prop)
+{
+  fpga_properties p = opae_properties_create();
+  if (!p)
+    return FPGA_NO_MEMORY;
+  fpgaPropertiesSetObjectType(p, FPGA_ACCELERATOR);
+  fpgaPropertiesSetBus(p, (uint8_t)((int *)token - fake_tokens));
+  *prop = p;
+  return FPGA_OK;
+}
+
+static fpga_result fake_clone_token(fpga_token src, fpga_token *dst)
+{
+  *dst = src;
+  return FPGA_OK;
+}
+
+static fpga_result fake_destroy_token(fpga_token *token)
+{
+  ++fake_destroy_called;
+  *token = NULL;
+  return FPGA_OK;
+}
+
+}
+
+class enum_cache_f : public ::testing::Test {
+ protected:
+  enum_cache_f() {}
+
+  virtual void SetUp() override {
+    memset(&adapter_, 0, sizeof(adapter_));
+    adapter_.plugin.path = (char *)"fake";
+    adapter_.fpgaEnumerate = fake_enumerate;
+    adapter_.fpgaGetProperties = fake_get_properties;
+    adapter_.fpgaCloneToken = fake_clone_token;
+    adapter_.fpgaDestroyToken = fake_destroy_token;
+
+    fake_enumerate_called = 0;
+    fake_destroy_called = 0;
+
+    saved_adapters_ = adapter_list;
+    adapter_list = &adapter_;
+
+    opae_enum_cache_release();
+    opae_enum_cache_invalidate();
+  }
+
+  virtual void TearDown() override {
+    opae_enum_cache_release();
+    adapter_list = saved_adapters_;
+  }
+
+  opae_api_adapter_table adapter_;
+  opae_api_adapter_table *saved_adapters_;
+};
+
+/**
+ * @test       enumerate
+ * @brief      Test: opae_enum_cache_enumerate
+ * @details    The first enumeration scans the plugins and fills the<br>
+ *             cache. Later enumerations filter the cache without calling<br>
+ *             the plugin, until the cache is invalidated.<br>
+ */
+TEST_F(enum_cache_f, enumerate) {
+  fpga_token tokens[FAKE_TOKENS] = { nullptr, nullptr, nullptr };
+  fpga_properties filter = opae_properties_create();
+  uint32_t matches = 0;
+  ASSERT_NE(nullptr, filter);
+
+  EXPECT_EQ(opae_enum_cache_enumerate(nullptr, 0, nullptr, 0, &matches),
+            FPGA_OK);
+  EXPECT_EQ(FAKE_TOKENS, matches);
+  // count + fill
+  EXPECT_EQ(2, fake_enumerate_called);
+
+  ASSERT_EQ(fpgaPropertiesSetBus(filter, 1), FPGA_OK);
+  EXPECT_EQ(opae_enum_cache_enumerate(&filter, 1, tokens, FAKE_TOKENS,
+                                      &matches), FPGA_OK);
+  EXPECT_EQ(1, matches);
+  EXPECT_EQ(2, fake_enumerate_called);
+
+  opae_wrapped_token *wt = opae_validate_wrapped_token(tokens[0]);
+  ASSERT_NE(nullptr, wt);
+  EXPECT_EQ(&fake_tokens[1], wt->opae_token);
+  EXPECT_EQ(nullptr, tokens[1]);
+  EXPECT_EQ(fpgaDestroyToken(&tokens[0]), FPGA_OK);
+  EXPECT_EQ(1, fake_destroy_called);
+
+  // max_tokens limits the tokens returned, not the match count.
+  EXPECT_EQ(opae_enum_cache_enumerate(nullptr, 0, tokens, 1, &matches),
+            FPGA_OK);
+  EXPECT_EQ(FAKE_TOKENS, matches);
+  EXPECT_NE(nullptr, tokens[0]);
+  EXPECT_EQ(nullptr, tokens[1]);
+  EXPECT_EQ(fpgaDestroyToken(&tokens[0]), FPGA_OK);
+
+  EXPECT_EQ(fpgaInvalidateEnumerationCache(), FPGA_OK);
+  EXPECT_EQ(opae_enum_cache_enumerate(&filter, 1, nullptr, 0, &matches),
+            FPGA_OK);
+  EXPECT_EQ(1, matches);
+  EXPECT_EQ(4, fake_enumerate_called);
+  // the stale entries were released
+  EXPECT_EQ(2 + FAKE_TOKENS, fake_destroy_called);
+
+  EXPECT_EQ(fpgaDestroyProperties(&filter), FPGA_OK);
+}
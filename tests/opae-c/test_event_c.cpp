@@ -28,6 +28,10 @@
 #endif // HAVE_CONFIG_H
 
 #include <poll.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 #include "mock/opae_fpgad_fixtures.h"
 
 using namespace opae::testing;
@@ -286,3 +290,369 @@ TEST_P(events_handle_p, manual_ap6) {
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(events_handle_p);
 INSTANTIATE_TEST_SUITE_P(events, events_handle_p,
                          ::testing::ValuesIn(test_platform::mock_platforms({"skx-p"})));
+
+// Plugin stand-in whose event handles are eventfds.
+static fpga_result wait_test_get_os_object(const fpga_event_handle eh, int *fd)
+{
+  *fd = *(int *)eh;
+  return FPGA_OK;
+}
+
+static fpga_result wait_test_destroy(fpga_event_handle *eh)
+{
+  close(*(int *)*eh);
+  return FPGA_OK;
+}
+
+// For handles whose descriptor is owned by another handle.
+static fpga_result wait_test_destroy_borrowed(fpga_event_handle *eh)
+{
+  (void)eh;
+  return FPGA_OK;
+}
+
+class event_wait_c : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    memset(&adapter_, 0, sizeof(adapter_));
+    adapter_.fpgaGetOSObjectFromEventHandle = wait_test_get_os_object;
+    adapter_.fpgaDestroyEventHandle = wait_test_destroy;
+
+    for (int i = 0 ; i < num_handles ; ++i) {
+      fds_[i] = eventfd(0, EFD_NONBLOCK);
+      ASSERT_GE(fds_[i], 0);
+      opae_wrapped_event_handle *we =
+        opae_allocate_wrapped_event_handle(&fds_[i], &adapter_);
+      ASSERT_NE(we, nullptr);
+      we->flags |= OPAE_WRAPPED_EVENT_HANDLE_CREATED;
+      handles_[i] = we;
+    }
+  }
+
+  virtual void TearDown() override {
+    for (int i = 0 ; i < num_handles ; ++i) {
+      if (handles_[i]) {
+        EXPECT_EQ(fpgaDestroyEventHandle(&handles_[i]), FPGA_OK);
+      }
+    }
+  }
+
+  void signal(int i) {
+    uint64_t one = 1;
+    ASSERT_EQ(write(fds_[i], &one, sizeof(one)), (ssize_t)sizeof(one));
+  }
+
+  void consume(int i) {
+    uint64_t count = 0;
+    ASSERT_EQ(read(fds_[i], &count, sizeof(count)), (ssize_t)sizeof(count));
+  }
+
+  static const int num_handles = 8;
+  opae_api_adapter_table adapter_;
+  int fds_[num_handles];
+  fpga_event_handle handles_[num_handles];
+};
+
+/**
+ * @test       invalid
+ * @brief      Test: fpgaWaitForEvents
+ * @details    When any pointer is NULL, no handles are given,<br>
+ *             a handle is repeated or has not been registered,<br>
+ *             fpgaWaitForEvents returns FPGA_INVALID_PARAM.<br>
+ */
+TEST_F(event_wait_c, invalid) {
+  uint32_t ready[num_handles];
+  uint32_t num_ready = 0;
+  fpga_event_handle repeated[2] = { handles_[0], handles_[0] };
+  fpga_event_handle unregistered = nullptr;
+
+  EXPECT_EQ(fpgaWaitForEvents(nullptr, 1, 0, ready, &num_ready),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWaitForEvents(handles_, 1, 0, nullptr, &num_ready),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWaitForEvents(handles_, 1, 0, ready, nullptr),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWaitForEvents(handles_, 0, 0, ready, &num_ready),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWaitForEvents(repeated, 2, 0, ready, &num_ready),
+            FPGA_INVALID_PARAM);
+
+  ASSERT_EQ(fpgaCreateEventHandle(&unregistered), FPGA_OK);
+  EXPECT_EQ(fpgaWaitForEvents(&unregistered, 1, 0, ready, &num_ready),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaDestroyEventHandle(&unregistered), FPGA_OK);
+}
+
+/**
+ * @test       ready
+ * @brief      Test: fpgaWaitForEvents
+ * @details    fpgaWaitForEvents reports the indices of exactly<br>
+ *             the signaled handles, and times out with none<br>
+ *             ready once the events have been consumed.<br>
+ */
+TEST_F(event_wait_c, ready) {
+  uint32_t ready[num_handles];
+  uint32_t num_ready = 99;
+
+  EXPECT_EQ(fpgaWaitForEvents(handles_, num_handles, 0,
+                              ready, &num_ready), FPGA_OK);
+  EXPECT_EQ(num_ready, 0);
+
+  signal(2);
+  signal(5);
+
+  ASSERT_EQ(fpgaWaitForEvents(handles_, num_handles, 1000,
+                              ready, &num_ready), FPGA_OK);
+  ASSERT_EQ(num_ready, 2);
+  EXPECT_EQ(std::min(ready[0], ready[1]), 2);
+  EXPECT_EQ(std::max(ready[0], ready[1]), 5);
+
+  consume(2);
+  consume(5);
+
+  EXPECT_EQ(fpgaWaitForEvents(handles_, num_handles, 10,
+                              ready, &num_ready), FPGA_OK);
+  EXPECT_EQ(num_ready, 0);
+}
+
+/**
+ * @test       subset
+ * @brief      Test: fpgaWaitForEvents
+ * @details    A signaled handle that is not passed to a later<br>
+ *             call is not reported by it, and is reported again<br>
+ *             once it is passed. Indices are relative to the<br>
+ *             array of each call.<br>
+ */
+TEST_F(event_wait_c, subset) {
+  uint32_t ready[num_handles];
+  uint32_t num_ready = 0;
+
+  EXPECT_EQ(fpgaWaitForEvents(handles_, num_handles, 0,
+                              ready, &num_ready), FPGA_OK);
+
+  signal(1);
+  signal(6);
+
+  ASSERT_EQ(fpgaWaitForEvents(&handles_[4], 4, 1000,
+                              ready, &num_ready), FPGA_OK);
+  ASSERT_EQ(num_ready, 1);
+  EXPECT_EQ(ready[0], 2);
+  consume(6);
+
+  EXPECT_EQ(fpgaWaitForEvents(&handles_[4], 4, 10,
+                              ready, &num_ready), FPGA_OK);
+  EXPECT_EQ(num_ready, 0);
+
+  ASSERT_EQ(fpgaWaitForEvents(handles_, 2, 1000,
+                              ready, &num_ready), FPGA_OK);
+  ASSERT_EQ(num_ready, 1);
+  EXPECT_EQ(ready[0], 1);
+  consume(1);
+}
+
+/**
+ * @test       shared
+ * @brief      Test: fpgaWaitForEvents
+ * @details    Distinct handles that share a descriptor, as uio<br>
+ *             event handles of one device do, may be waited on<br>
+ *             together and are all reported when it is signaled.<br>
+ *             The same handle is still rejected when repeated.<br>
+ */
+TEST_F(event_wait_c, shared) {
+  uint32_t ready[num_handles + 1];
+  uint32_t num_ready = 0;
+  opae_api_adapter_table shared_adapter = adapter_;
+  shared_adapter.fpgaDestroyEventHandle = wait_test_destroy_borrowed;
+
+  opae_wrapped_event_handle *we =
+    opae_allocate_wrapped_event_handle(&fds_[3], &shared_adapter);
+  ASSERT_NE(we, nullptr);
+  we->flags |= OPAE_WRAPPED_EVENT_HANDLE_CREATED;
+  fpga_event_handle shared = we;
+
+  fpga_event_handle both[3] = { handles_[3], handles_[4], shared };
+  fpga_event_handle repeated[3] = { handles_[3], shared, shared };
+
+  EXPECT_EQ(fpgaWaitForEvents(both, 3, 0, ready, &num_ready), FPGA_OK);
+  EXPECT_EQ(num_ready, 0);
+
+  signal(3);
+  ASSERT_EQ(fpgaWaitForEvents(both, 3, 1000, ready, &num_ready), FPGA_OK);
+  ASSERT_EQ(num_ready, 2);
+  EXPECT_EQ(std::min(ready[0], ready[1]), 0);
+  EXPECT_EQ(std::max(ready[0], ready[1]), 2);
+
+  // Alone, either handle sees the descriptor.
+  ASSERT_EQ(fpgaWaitForEvents(&shared, 1, 1000, ready, &num_ready), FPGA_OK);
+  ASSERT_EQ(num_ready, 1);
+  EXPECT_EQ(ready[0], 0);
+  ASSERT_EQ(fpgaWaitForEvents(&handles_[3], 1, 1000, ready, &num_ready),
+            FPGA_OK);
+  ASSERT_EQ(num_ready, 1);
+  consume(3);
+
+  EXPECT_EQ(fpgaWaitForEvents(repeated, 3, 0, ready, &num_ready),
+            FPGA_INVALID_PARAM);
+
+  EXPECT_EQ(fpgaDestroyEventHandle(&shared), FPGA_OK);
+
+  // The remaining handle keeps working after the other is destroyed.
+  signal(3);
+  ASSERT_EQ(fpgaWaitForEvents(&handles_[3], 1, 1000, ready, &num_ready),
+            FPGA_OK);
+  ASSERT_EQ(num_ready, 1);
+  consume(3);
+}
+
+/**
+ * @test       bad_fd
+ * @brief      Test: fpgaWaitForEvents
+ * @details    A plugin that hands back a negative descriptor gets<br>
+ *             FPGA_INVALID_PARAM instead of a wait.<br>
+ */
+TEST_F(event_wait_c, bad_fd) {
+  uint32_t ready[1];
+  uint32_t num_ready = 0;
+  int bad = -5;
+  opae_api_adapter_table bad_adapter = adapter_;
+  bad_adapter.fpgaDestroyEventHandle = wait_test_destroy_borrowed;
+
+  opae_wrapped_event_handle *we =
+    opae_allocate_wrapped_event_handle(&bad, &bad_adapter);
+  ASSERT_NE(we, nullptr);
+  we->flags |= OPAE_WRAPPED_EVENT_HANDLE_CREATED;
+  fpga_event_handle eh = we;
+
+  EXPECT_EQ(fpgaWaitForEvents(&eh, 1, 0, ready, &num_ready),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaDestroyEventHandle(&eh), FPGA_OK);
+}
+
+/**
+ * @test       destroy
+ * @brief      Test: fpgaWaitForEvents
+ * @details    A handle destroyed after being waited on leaves<br>
+ *             the wait set, and waits on the remaining handles<br>
+ *             are unaffected.<br>
+ */
+TEST_F(event_wait_c, destroy) {
+  uint32_t ready[num_handles];
+  uint32_t num_ready = 0;
+
+  EXPECT_EQ(fpgaWaitForEvents(handles_, num_handles, 0,
+                              ready, &num_ready), FPGA_OK);
+  EXPECT_EQ(fpgaDestroyEventHandle(&handles_[0]), FPGA_OK);
+  handles_[0] = nullptr;
+
+  signal(3);
+  ASSERT_EQ(fpgaWaitForEvents(&handles_[1], num_handles - 1, 1000,
+                              ready, &num_ready), FPGA_OK);
+  ASSERT_EQ(num_ready, 1);
+  EXPECT_EQ(ready[0], 2);
+  consume(3);
+}
+
+/**
+ * @test       completion_invalid
+ * @brief      Test: fpgaWaitForCompletion, fpgaWaitForCompletionCSR
+ * @details    When the event handle, completion word or fpga<br>
+ *             handle is NULL, or the event handle has not been<br>
+ *             registered, the fns return FPGA_INVALID_PARAM.<br>
+ */
+TEST_F(event_wait_c, completion_invalid) {
+  volatile uint64_t word = 0;
+  fpga_event_handle unregistered = nullptr;
+
+  EXPECT_EQ(fpgaWaitForCompletion(nullptr, &word, 1, 1, 0, nullptr),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWaitForCompletion(handles_[0], nullptr, 1, 1, 0, nullptr),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWaitForCompletionCSR(nullptr, 0, 0, 1, 1, handles_[0],
+                                     0, nullptr), FPGA_INVALID_PARAM);
+
+  ASSERT_EQ(fpgaCreateEventHandle(&unregistered), FPGA_OK);
+  EXPECT_EQ(fpgaWaitForCompletion(unregistered, &word, 1, 1, 0, nullptr),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaDestroyEventHandle(&unregistered), FPGA_OK);
+}
+
+/**
+ * @test       completion_spin
+ * @brief      Test: fpgaWaitForCompletion
+ * @details    When the completion word is already set,<br>
+ *             the wait is resolved by spinning, without<br>
+ *             blocking on the event.<br>
+ */
+TEST_F(event_wait_c, completion_spin) {
+  volatile uint64_t word = 0x3;
+  fpga_wait_stats stats;
+
+  ASSERT_EQ(fpgaWaitForCompletion(handles_[0], &word, 0x1, 0x1,
+                                  1000, &stats), FPGA_OK);
+  EXPECT_EQ(stats.path, FPGA_WAIT_SPIN);
+  EXPECT_EQ(stats.polls, 1);
+  EXPECT_EQ(stats.wakeups, 0);
+  EXPECT_EQ(stats.block_ns, 0);
+  EXPECT_GT(stats.budget_ns, 0);
+}
+
+/**
+ * @test       completion_timeout
+ * @brief      Test: fpgaWaitForCompletion
+ * @details    When the completion word is never set,<br>
+ *             the wait spins for its budget, blocks on the<br>
+ *             event, and returns FPGA_BUSY after the timeout.<br>
+ */
+TEST_F(event_wait_c, completion_timeout) {
+  volatile uint64_t word = 0;
+  fpga_wait_stats stats;
+
+  EXPECT_EQ(fpgaWaitForCompletion(handles_[0], &word, 0x1, 0x1,
+                                  20, &stats), FPGA_BUSY);
+  EXPECT_EQ(stats.path, FPGA_WAIT_TIMEOUT);
+  EXPECT_GE(stats.spin_ns + stats.block_ns, 20000000);
+
+  EXPECT_EQ(fpgaWaitForCompletion(handles_[0], &word, 0x1, 0x1,
+                                  0, nullptr), FPGA_BUSY);
+}
+
+/**
+ * @test       completion_event
+ * @brief      Test: fpgaWaitForCompletion
+ * @details    When the completion arrives after the spin budget,<br>
+ *             the wait is resolved by the event. A stale signal<br>
+ *             that arrives before the completion word is set<br>
+ *             does not end the wait. Repeated slow completions<br>
+ *             shrink the spin budget of the handle.<br>
+ */
+TEST_F(event_wait_c, completion_event) {
+  volatile uint64_t word = 0;
+  fpga_wait_stats stats;
+  uint64_t first_budget = 0;
+
+  for (int i = 0 ; i < 4 ; ++i) {
+    word = 0;
+    signal(1);
+
+    std::thread t([this, &word] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      word = 1;
+      signal(1);
+    });
+
+    EXPECT_EQ(fpgaWaitForCompletion(handles_[1], &word, 0x1, 0x1,
+                                    5000, &stats), FPGA_OK);
+    t.join();
+
+    EXPECT_EQ(stats.path, FPGA_WAIT_EVENT);
+    EXPECT_GE(stats.wakeups, 1);
+    EXPECT_GE(stats.polls, 2);
+    EXPECT_GT(stats.block_ns, 0);
+
+    if (!i) {
+      first_budget = stats.budget_ns;
+    }
+  }
+
+  EXPECT_LT(stats.budget_ns, first_budget);
+}
@@ -0,0 +1,162 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+extern "C" {
+#include <opae/enum.h>
+#include "opae_int.h"
+#include "pluginmgr.h"
+
+extern opae_api_adapter_table *adapter_list;
+}
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "gtest/gtest.h"
+
+/*
+ * Measures the latency of library initialization, which is what short
+ * lived tools such as fpgainfo pay on every invocation. Plugins are
+ * loaded on first use, so the first fpgaEnumerate() after initialization
+ * is reported separately. Initialization is timed with the platform
+ * detection cache disabled (every PCI device is read from sysfs) and with
+ * a warm cache. Both must register the same adapters, none of which is
+ * loaded before the first enumeration.
+ */
+
+static const int BENCH_ITERATIONS = 20;
+
+class init_bench_f : public ::testing::Test {
+ protected:
+  init_bench_f() {}
+
+  virtual void SetUp() override {
+    const char *saved = getenv("LIBOPAE_PLATFORM_CACHE");
+    had_cache_env_ = saved != nullptr;
+    if (saved)
+      saved_cache_env_ = saved;
+
+    char path[] = "/tmp/opae-init-bench-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    unlink(path);
+    cache_path_ = path;
+
+    opae_plugin_mgr_finalize_all();
+  }
+
+  virtual void TearDown() override {
+    opae_plugin_mgr_finalize_all();
+    unlink(cache_path_.c_str());
+
+    if (had_cache_env_)
+      setenv("LIBOPAE_PLATFORM_CACHE", saved_cache_env_.c_str(), 1);
+    else
+      unsetenv("LIBOPAE_PLATFORM_CACHE");
+
+    opae_plugin_mgr_initialize(NULL);
+  }
+
+  // Number of registered adapters whose plugin has not been loaded.
+  uint32_t num_deferred() {
+    uint32_t count = 0;
+    for (opae_api_adapter_table *aptr = adapter_list ; aptr ;
+         aptr = aptr->next) {
+      if (aptr->deferred)
+        ++count;
+    }
+    return count;
+  }
+
+  // Average cost in microseconds of initialize + finalize.
+  double time_init() {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0 ; i < BENCH_ITERATIONS ; ++i) {
+      opae_plugin_mgr_initialize(NULL);
+      opae_plugin_mgr_finalize_all();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() /
+           BENCH_ITERATIONS;
+  }
+
+  bool had_cache_env_;
+  std::string saved_cache_env_;
+  std::string cache_path_;
+};
+
+/**
+ * @test       initialize
+ * @brief      Benchmark: opae_plugin_mgr_initialize
+ * @details    Report the average latency of library initialization<br>
+ *             with and without the platform detection cache, and of<br>
+ *             the first enumeration, which loads the plugins.<br>
+ */
+TEST_F(init_bench_f, initialize) {
+  uint32_t matches = 0;
+
+  setenv("LIBOPAE_PLATFORM_CACHE", "0", 1);
+  opae_plugin_mgr_initialize(NULL);
+  uint32_t cold_adapters = opae_plugin_mgr_num_adapters();
+  EXPECT_EQ(cold_adapters, num_deferred());
+  opae_plugin_mgr_finalize_all();
+  double cold_us = time_init();
+
+  setenv("LIBOPAE_PLATFORM_CACHE", cache_path_.c_str(), 1);
+  opae_plugin_mgr_initialize(NULL);
+  opae_plugin_mgr_finalize_all();
+  EXPECT_EQ(0, access(cache_path_.c_str(), R_OK));
+  double warm_us = time_init();
+
+  opae_plugin_mgr_initialize(NULL);
+  EXPECT_EQ(cold_adapters, opae_plugin_mgr_num_adapters());
+  EXPECT_EQ(cold_adapters, num_deferred());
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_NE(FPGA_INVALID_PARAM, fpgaEnumerate(nullptr, 0, nullptr, 0,
+                                              &matches));
+  auto end = std::chrono::steady_clock::now();
+  double enum_us =
+    std::chrono::duration<double, std::micro>(end - start).count();
+
+  // The first enumeration loads every adapter that can be loaded.
+  for (opae_api_adapter_table *aptr = adapter_list ; aptr ;
+       aptr = aptr->next) {
+    EXPECT_TRUE(!aptr->deferred || aptr->load_failed) << aptr->plugin.path;
+  }
+
+  printf("initialize: %8.1f us (no platform cache), %8.1f us (cached); "
+         "first fpgaEnumerate: %8.1f us, %u matches\n",
+         cold_us, warm_us, enum_us, matches);
+}
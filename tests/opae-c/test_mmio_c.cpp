@@ -29,9 +29,17 @@
 
 #include <linux/ioctl.h>
 
+extern "C" {
+#include "opae_int.h"
+#include "adapter.h"
+}
+
 #include "fpga-dfl.h"
 #include "mock/opae_fixtures.h"
 
+#define OPAE_MMIO_INLINE_CHECKED 1
+#include <opae/mmio_inline.h>
+
 using namespace opae::testing;
 
 static int mmio_ioctl(mock_object * m, int request, va_list argp){
@@ -206,9 +214,235 @@ TEST_P(mmio_c_p, mmio512_neg_test) {
 }
 #endif // TEST_SUPPORTS_AVX512
 
+/**
+ * @test       mmio512_read
+ * @brief      Test: fpgaReadMMIO512
+ * @details    Write the scratchpad registers with fpgaWriteMMIO64,<br>
+ *             read them back with fpgaReadMMIO512.<br>
+ *             Values read should equal values written.<br>
+ */
+#if defined(__x86_64__)
+TEST_P(mmio_c_p, mmio512_read) {
+  uint64_t val_written[8];
+  uint64_t val_read[8];
+  int i;
+  for (i = 0; i < 8; i++) {
+    val_written[i] = 0xdeadbeefdecafbad << (i + 1);
+    EXPECT_EQ(fpgaWriteMMIO64(accel_, which_mmio_,
+                              CSR_SCRATCHPAD0 + i * 8, val_written[i]), FPGA_OK);
+  }
+  EXPECT_EQ(fpgaReadMMIO512(accel_, which_mmio_,
+                            CSR_SCRATCHPAD0, val_read), FPGA_OK);
+  EXPECT_EQ(0, memcmp(val_written, val_read, sizeof(val_read)));
+  EXPECT_EQ(fpgaReadMMIO512(NULL, which_mmio_,
+                            CSR_SCRATCHPAD0, val_read), FPGA_INVALID_PARAM);
+}
+#endif // __x86_64__
+
+/**
+ * @test       mmio_batch
+ * @brief      Test: fpgaWriteMMIOBatch, fpgaReadMMIOBatch
+ * @details    Write the scratchpad register with fpgaWriteMMIOBatch,<br>
+ *             read the register back with fpgaReadMMIOBatch.<br>
+ *             Values written should equal values read.<br>
+ */
+TEST_P(mmio_c_p, mmio_batch) {
+  const fpga_mmio_op wops[2] = {
+    { which_mmio_, sizeof(uint32_t), CSR_SCRATCHPAD0, 0xc0cac01a },
+    { which_mmio_, sizeof(uint32_t), CSR_SCRATCHPAD0 + 4, 0xdeadbeef }
+  };
+  fpga_mmio_op rops[2] = {
+    { which_mmio_, sizeof(uint64_t), CSR_SCRATCHPAD0, 0 },
+    { which_mmio_, sizeof(uint32_t), CSR_SCRATCHPAD0 + 4, 0 }
+  };
+  EXPECT_EQ(fpgaWriteMMIOBatch(accel_, wops, 2), FPGA_OK);
+  EXPECT_EQ(fpgaReadMMIOBatch(accel_, rops, 2), FPGA_OK);
+  EXPECT_EQ(0xdeadbeefc0cac01a, rops[0].value);
+  EXPECT_EQ(0xdeadbeef, rops[1].value);
+}
+
+/**
+ * @test       mmio_batch_fallback
+ * @brief      Test: fpgaWriteMMIOBatch, fpgaReadMMIOBatch
+ * @details    When the plugin does not provide batch entry points,<br>
+ *             the API falls back to per-operation MMIO calls.<br>
+ *             Values written should equal values read, and an<br>
+ *             invalid width results in FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(mmio_c_p, mmio_batch_fallback) {
+  opae_wrapped_handle *wrapped_handle = (opae_wrapped_handle *)accel_;
+  opae_api_adapter_table *adapter = wrapped_handle->adapter_table;
+  auto read_batch = adapter->fpgaReadMMIOBatch;
+  auto write_batch = adapter->fpgaWriteMMIOBatch;
+
+  adapter->fpgaReadMMIOBatch = nullptr;
+  adapter->fpgaWriteMMIOBatch = nullptr;
+
+  const fpga_mmio_op wops[2] = {
+    { which_mmio_, sizeof(uint64_t), CSR_SCRATCHPAD0, 0xdecafbadfeedbeef },
+    { which_mmio_, sizeof(uint32_t), CSR_SCRATCHPAD0, 0xc0cac01a }
+  };
+  fpga_mmio_op rops[2] = {
+    { which_mmio_, sizeof(uint64_t), CSR_SCRATCHPAD0, 0 },
+    { which_mmio_, 2, CSR_SCRATCHPAD0, 0 }
+  };
+  EXPECT_EQ(fpgaWriteMMIOBatch(accel_, wops, 2), FPGA_OK);
+  EXPECT_EQ(fpgaReadMMIOBatch(accel_, rops, 2), FPGA_INVALID_PARAM);
+  EXPECT_EQ(0xdecafbadc0cac01a, rops[0].value);
+
+  adapter->fpgaReadMMIOBatch = read_batch;
+  adapter->fpgaWriteMMIOBatch = write_batch;
+}
+
+/**
+ * @test       mmio_batch_neg_test
+ * @brief      Test: fpgaWriteMMIOBatch, fpgaReadMMIOBatch
+ * @details    When the handle or the ops array is invalid,<br>
+ *             the API returns FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(mmio_c_p, mmio_batch_neg_test) {
+  fpga_mmio_op op = { which_mmio_, sizeof(uint64_t), CSR_SCRATCHPAD0, 0 };
+  EXPECT_EQ(fpgaWriteMMIOBatch(NULL, &op, 1), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaReadMMIOBatch(NULL, &op, 1), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaWriteMMIOBatch(accel_, NULL, 1), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaReadMMIOBatch(accel_, NULL, 1), FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test       mmio_copy
+ * @brief      Test: fpgaCopyToMMIO, fpgaCopyFromMMIO
+ * @details    Copy a block that starts and ends off a 64 byte<br>
+ *             boundary to MMIO with fpgaCopyToMMIO, then read it<br>
+ *             back with fpgaCopyFromMMIO and fpgaReadMMIO64.<br>
+ *             Values read should equal values written.<br>
+ */
+TEST_P(mmio_c_p, mmio_copy) {
+  uint64_t val_written[24];
+  uint64_t val_read[24];
+  uint64_t value = 0;
+  int i;
+  for (i = 0; i < 24; i++) {
+    val_written[i] = 0xdeadbeefdecafbad + i;
+  }
+  memset(val_read, 0, sizeof(val_read));
+  EXPECT_EQ(fpgaCopyToMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0 + 8,
+                           val_written, sizeof(val_written)), FPGA_OK);
+  EXPECT_EQ(fpgaCopyFromMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0 + 8,
+                             val_read, sizeof(val_read)), FPGA_OK);
+  EXPECT_EQ(0, memcmp(val_written, val_read, sizeof(val_read)));
+  EXPECT_EQ(fpgaReadMMIO64(accel_, which_mmio_,
+                           CSR_SCRATCHPAD0 + 8 * 24, &value), FPGA_OK);
+  EXPECT_EQ(val_written[23], value);
+}
+
+/**
+ * @test       mmio_copy_fallback
+ * @brief      Test: fpgaCopyToMMIO, fpgaCopyFromMMIO
+ * @details    When the plugin does not provide block copy entry<br>
+ *             points, the API falls back to 64 bit MMIO calls.<br>
+ *             Values read should equal values written.<br>
+ */
+TEST_P(mmio_c_p, mmio_copy_fallback) {
+  opae_wrapped_handle *wrapped_handle = (opae_wrapped_handle *)accel_;
+  opae_api_adapter_table *adapter = wrapped_handle->adapter_table;
+  auto copy_to = adapter->fpgaCopyToMMIO;
+  auto copy_from = adapter->fpgaCopyFromMMIO;
+
+  adapter->fpgaCopyToMMIO = nullptr;
+  adapter->fpgaCopyFromMMIO = nullptr;
+
+  uint64_t val_written[4] = { 1, 2, 3, 4 };
+  uint64_t val_read[4] = { 0, 0, 0, 0 };
+  EXPECT_EQ(fpgaCopyToMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0,
+                           val_written, sizeof(val_written)), FPGA_OK);
+  EXPECT_EQ(fpgaCopyFromMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0,
+                             val_read, sizeof(val_read)), FPGA_OK);
+  EXPECT_EQ(0, memcmp(val_written, val_read, sizeof(val_read)));
+
+  adapter->fpgaCopyToMMIO = copy_to;
+  adapter->fpgaCopyFromMMIO = copy_from;
+}
+
+/**
+ * @test       mmio_copy_neg_test
+ * @brief      Test: fpgaCopyToMMIO, fpgaCopyFromMMIO
+ * @details    When the handle or buffer is invalid, or the offset<br>
+ *             or length is not a multiple of 8,<br>
+ *             then the functions return FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(mmio_c_p, mmio_copy_neg_test) {
+  uint64_t buf[2] = { 0, 0 };
+  EXPECT_EQ(fpgaCopyToMMIO(NULL, which_mmio_, CSR_SCRATCHPAD0,
+                           buf, sizeof(buf)), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaCopyFromMMIO(NULL, which_mmio_, CSR_SCRATCHPAD0,
+                             buf, sizeof(buf)), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaCopyToMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0,
+                           NULL, sizeof(buf)), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaCopyFromMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0,
+                             NULL, sizeof(buf)), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaCopyToMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0 + 4,
+                           buf, sizeof(buf)), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaCopyFromMMIO(accel_, which_mmio_, CSR_SCRATCHPAD0,
+                             buf, 12), FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test       mmio_region
+ * @brief      Test: fpgaMMIORegionInit, fpgaMMIORegionWrite64,
+ *             fpgaMMIORegionRead64, fpgaMMIORegionRead32
+ * @details    Map the MMIO space with fpgaMMIORegionInit,<br>
+ *             write the scratchpad register with the inline accessors,<br>
+ *             read the register back with fpgaReadMMIO64.<br>
+ *             Values written should equal values read.<br>
+ */
+TEST_P(mmio_c_p, mmio_region) {
+  fpga_mmio_region region = { nullptr, 0, 0 };
+  ASSERT_EQ(fpgaMMIORegionInit(accel_, which_mmio_, 0x40000, &region), FPGA_OK);
+  ASSERT_NE(region.base, nullptr);
+
+  fpgaMMIORegionWrite64(&region, CSR_SCRATCHPAD0, 0xdeadbeefdecafbad);
+  uint64_t val_read = 0;
+  EXPECT_EQ(fpgaReadMMIO64(accel_, which_mmio_,
+                           CSR_SCRATCHPAD0, &val_read), FPGA_OK);
+  EXPECT_EQ(0xdeadbeefdecafbad, val_read);
+  EXPECT_EQ(0xdecafbad, fpgaMMIORegionRead32(&region, CSR_SCRATCHPAD0));
+
+  EXPECT_EQ(fpgaMMIORegionInit(accel_, which_mmio_, 0, NULL),
+            FPGA_INVALID_PARAM);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(mmio_c_p);
 INSTANTIATE_TEST_SUITE_P(mmio_c, mmio_c_p,
                          ::testing::ValuesIn(test_platform::platforms({
                                                                         "dfl-d5005",
                                                                         "dfl-n3000"
                                                                       })));
+
+/**
+ * @test       mmio_inline_accessors
+ * @brief      Test: fpgaMMIORegionRead32, fpgaMMIORegionWrite32,
+ *             fpgaMMIORegionRead64, fpgaMMIORegionWrite64
+ * @details    Given a region descriptor over host memory,<br>
+ *             the inline accessors read and write the expected<br>
+ *             locations with the expected widths.<br>
+ */
+TEST(mmio_inline, accessors) {
+  uint64_t mem[4] = { 0, 0, 0, 0 };
+  fpga_mmio_region region;
+  region.base = (volatile uint8_t *)mem;
+  region.size = sizeof(mem);
+  region.caps = FPGA_MMIO_CAP_32 | FPGA_MMIO_CAP_64;
+
+  fpgaMMIORegionWrite64(&region, 8, 0xdeadbeefdecafbad);
+  fpgaMMIORegionWrite32(&region, 16, 0xc0cac01a);
+  fpgaMMIORegionWrite32(&region, 28, 0xfeedbeef);
+
+  EXPECT_EQ(0u, mem[0]);
+  EXPECT_EQ(0xdeadbeefdecafbad, mem[1]);
+  EXPECT_EQ(0xc0cac01a, mem[2]);
+  EXPECT_EQ(0xfeedbeef00000000, mem[3]);
+
+  EXPECT_EQ(0xdeadbeefdecafbad, fpgaMMIORegionRead64(&region, 8));
+  EXPECT_EQ(0xdeadbeef, fpgaMMIORegionRead32(&region, 12));
+  EXPECT_EQ(0xfeedbeef, fpgaMMIORegionRead32(&region, 28));
+}
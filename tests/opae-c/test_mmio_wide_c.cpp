@@ -0,0 +1,165 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "mmio-wide.h"
+}
+
+#include "mock/opae_fixtures.h"
+
+using namespace opae::testing;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+static std::vector<const opae_mmio_wide *> supported_kernels()
+{
+  std::vector<const opae_mmio_wide *> kernels;
+
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    kernels.push_back(&opae_mmio_wide_avx512);
+  if (__builtin_cpu_supports("avx"))
+    kernels.push_back(&opae_mmio_wide_avx);
+  kernels.push_back(&opae_mmio_wide_sse2);
+
+  return kernels;
+}
+
+/**
+ * @test       select
+ * @brief      Test: opae_mmio_wide_select
+ * @details    On x86-64 a kernel is always available, and it is<br>
+ *             the widest one the host CPU supports.<br>
+ */
+TEST(mmio_wide, select) {
+  const opae_mmio_wide *wide = opae_mmio_wide_select();
+  ASSERT_NE(nullptr, wide);
+  EXPECT_EQ(supported_kernels().front(), wide);
+}
+
+/**
+ * @test       copy
+ * @brief      Test: opae_mmio_wide write512, read512
+ * @details    For each kernel the host supports, write512 copies the<br>
+ *             64 bytes from an unaligned source to an aligned<br>
+ *             destination, read512 copies them back to an unaligned<br>
+ *             buffer, and neither touches the surrounding bytes.<br>
+ */
+TEST(mmio_wide, copy) {
+  struct {
+    alignas(64) uint8_t header[64];
+    uint8_t between[64];
+    uint8_t footer[64];
+  } mmio;
+  uint8_t src[65];
+  uint8_t dst[66];
+  size_t i;
+
+  for (i = 0 ; i < sizeof(src) ; ++i)
+    src[i] = (uint8_t)(i * 7 + 1);
+
+  for (auto wide : supported_kernels()) {
+    SCOPED_TRACE(wide->name);
+
+    memset(&mmio, 0, sizeof(mmio));
+    memset(dst, 0, sizeof(dst));
+
+    wide->write512(mmio.between, src + 1);
+    EXPECT_EQ(0, memcmp(mmio.between, src + 1, 64));
+    for (i = 0 ; i < 64 ; ++i) {
+      EXPECT_EQ(0, mmio.header[i]);
+      EXPECT_EQ(0, mmio.footer[i]);
+    }
+
+    wide->read512(dst + 1, mmio.between);
+    EXPECT_EQ(0, memcmp(dst + 1, src + 1, 64));
+    EXPECT_EQ(0, dst[0]);
+    EXPECT_EQ(0, dst[65]);
+  }
+}
+
+/**
+ * @test       copy_range
+ * @brief      Test: opae_mmio_copy_to, opae_mmio_copy_from
+ * @details    For each kernel the host supports, and for none,<br>
+ *             a range with an unaligned head and tail is copied<br>
+ *             to MMIO and back exactly, without touching the<br>
+ *             bytes around it.<br>
+ */
+TEST(mmio_wide, copy_range) {
+  alignas(64) uint8_t mmio[512];
+  uint8_t src[264];
+  uint8_t dst[264];
+  const size_t offset = 24;
+  const size_t len = 256;
+  size_t i;
+
+  for (i = 0 ; i < sizeof(src) ; ++i)
+    src[i] = (uint8_t)(i * 13 + 5);
+
+  std::vector<const opae_mmio_wide *> kernels = supported_kernels();
+  kernels.push_back(nullptr);
+
+  for (auto wide : kernels) {
+    SCOPED_TRACE(wide ? wide->name : "none");
+
+    memset(mmio, 0, sizeof(mmio));
+    memset(dst, 0, sizeof(dst));
+
+    opae_mmio_copy_to(wide, mmio + offset, src + 1, len);
+    EXPECT_EQ(0, memcmp(mmio + offset, src + 1, len));
+    for (i = 0 ; i < offset ; ++i)
+      EXPECT_EQ(0, mmio[i]);
+    for (i = offset + len ; i < sizeof(mmio) ; ++i)
+      EXPECT_EQ(0, mmio[i]);
+
+    opae_mmio_copy_from(wide, dst + 1, mmio + offset, len);
+    EXPECT_EQ(0, memcmp(dst + 1, src + 1, len));
+    EXPECT_EQ(0, dst[0]);
+    EXPECT_EQ(0, dst[len + 1]);
+  }
+}
+
+#else
+
+/**
+ * @test       select
+ * @brief      Test: opae_mmio_wide_select
+ * @details    Hosts other than x86-64 have no kernel.<br>
+ */
+TEST(mmio_wide, select) {
+  EXPECT_EQ(nullptr, opae_mmio_wide_select());
+}
+
+#endif // x86_64
@@ -32,6 +32,7 @@
 extern "C" {
 #include "opae_int.h"
 #include "pluginmgr.h"
+#include "cfg-file.h"
 
 int opae_plugin_mgr_initialize_all(void);
 void *opae_plugin_mgr_find_plugin(const char *lib_path);
@@ -46,6 +47,28 @@ int process_cfg_buffer(const char *buffer, const char *filename);
 extern opae_api_adapter_table *adapter_list;
 extern int finalizing;
 int opae_plugin_mgr_finalize_all(void);
+uint32_t opae_plugin_mgr_num_adapters(void);
+opae_api_adapter_table *
+opae_plugin_mgr_alloc_deferred_adapter(const char *lib_path,
+				       const char *config);
+int opae_plugin_mgr_load_adapter(opae_api_adapter_table *adapter);
+
+typedef struct _opae_platform_cache {
+  uint64_t key;
+  opae_pci_device *devices;
+  uint32_t num_devices;
+  uint32_t capacity;
+} opae_platform_cache;
+int opae_plugin_mgr_platform_cache_path(char *path, size_t len);
+int opae_plugin_mgr_platform_cache_add(opae_platform_cache *cache,
+                                       const opae_pci_device *dev);
+int opae_plugin_mgr_platform_cache_load(opae_platform_cache *cache,
+                                        const char *path);
+void opae_plugin_mgr_platform_cache_save(const opae_platform_cache *cache,
+                                         const char *path);
+uint32_t opae_plugin_mgr_for_each_adapter_parallel(
+	void (*callback)(const opae_api_adapter_table *, uint32_t, void *),
+	void *context, uint32_t max_adapters);
 }
 
 #include "mock/opae_fixtures.h"
@@ -106,6 +129,109 @@ TEST(pluginmgr, multi_finalize) {
   finalizing = 0;
 }
 
+/**
+ * @test       deferred_load
+ * @brief      Test: opae_plugin_mgr_load_adapter
+ * @details    A deferred adapter is not loaded until first use. When the<br>
+ *             plugin can't be loaded, the adapter is marked failed and<br>
+ *             is skipped from then on. The adapter owns a copy of its<br>
+ *             config, which outlives the platform data table.<br>
+ */
+TEST(pluginmgr, deferred_load) {
+  opae_api_adapter_table *at;
+  char config[] = "{ \"key\": 0 }";
+
+  at = opae_plugin_mgr_alloc_deferred_adapter("libthatdoesntexist.so", config);
+  ASSERT_NE(nullptr, at);
+  EXPECT_TRUE(at->deferred);
+  EXPECT_EQ(nullptr, at->plugin.dl_handle);
+
+  // The adapter keeps its own copy of the config.
+  ASSERT_NE(nullptr, at->deferred_config);
+  EXPECT_NE(config, at->deferred_config);
+  config[0] = '\0';
+  EXPECT_STREQ("{ \"key\": 0 }", at->deferred_config);
+
+  EXPECT_NE(0, opae_plugin_mgr_load_adapter(at));
+  EXPECT_TRUE(at->load_failed);
+  EXPECT_NE(0, opae_plugin_mgr_load_adapter(at));
+
+  EXPECT_EQ(0, opae_plugin_mgr_free_adapter(at));
+}
+
+/**
+ * @test       platform_cache_path
+ * @brief      Test: opae_plugin_mgr_platform_cache_path
+ * @details    LIBOPAE_PLATFORM_CACHE names the cache file, and an empty<br>
+ *             value or "0" disables the cache.<br>
+ */
+TEST(pluginmgr, platform_cache_path) {
+  char path[PATH_MAX];
+  const char *saved = getenv("LIBOPAE_PLATFORM_CACHE");
+  std::string restore = saved ? saved : "";
+
+  setenv("LIBOPAE_PLATFORM_CACHE", "0", 1);
+  EXPECT_NE(0, opae_plugin_mgr_platform_cache_path(path, sizeof(path)));
+
+  setenv("LIBOPAE_PLATFORM_CACHE", "", 1);
+  EXPECT_NE(0, opae_plugin_mgr_platform_cache_path(path, sizeof(path)));
+
+  setenv("LIBOPAE_PLATFORM_CACHE", "/tmp/platforms", 1);
+  EXPECT_EQ(0, opae_plugin_mgr_platform_cache_path(path, sizeof(path)));
+  EXPECT_STREQ("/tmp/platforms", path);
+
+  char tiny[8];
+  EXPECT_NE(0, opae_plugin_mgr_platform_cache_path(tiny, sizeof(tiny)));
+
+  if (saved)
+    setenv("LIBOPAE_PLATFORM_CACHE", restore.c_str(), 1);
+  else
+    unsetenv("LIBOPAE_PLATFORM_CACHE");
+}
+
+/**
+ * @test       platform_cache
+ * @brief      Test: opae_plugin_mgr_platform_cache_save/load
+ * @details    Saved device IDs are loaded back only for the same key.<br>
+ *             A truncated file is rejected.<br>
+ */
+TEST(pluginmgr, platform_cache) {
+  char path[] = "/tmp/opae-platforms-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  opae_platform_cache cache = { 0x1234abcd5678ef00ULL, nullptr, 0, 0 };
+  opae_pci_device n6000 = { nullptr, 0x8086, 0xbcce, 0x8086, 0x1770 };
+  opae_pci_device other = { nullptr, 0x1af4, 0x1000, 0x1af4, 0x0001 };
+  ASSERT_EQ(0, opae_plugin_mgr_platform_cache_add(&cache, &n6000));
+  ASSERT_EQ(0, opae_plugin_mgr_platform_cache_add(&cache, &other));
+  opae_plugin_mgr_platform_cache_save(&cache, path);
+
+  opae_platform_cache loaded = { cache.key, nullptr, 0, 0 };
+  ASSERT_EQ(0, opae_plugin_mgr_platform_cache_load(&loaded, path));
+  ASSERT_EQ(2u, loaded.num_devices);
+  EXPECT_EQ(0xbcce, loaded.devices[0].device_id);
+  EXPECT_EQ(0x1770, loaded.devices[0].subsystem_device_id);
+  EXPECT_EQ(0x1af4, loaded.devices[1].vendor_id);
+  opae_free(loaded.devices);
+
+  opae_platform_cache stale = { cache.key + 1, nullptr, 0, 0 };
+  EXPECT_NE(0, opae_plugin_mgr_platform_cache_load(&stale, path));
+  opae_free(stale.devices);
+
+  FILE *fp = fopen(path, "a");
+  ASSERT_NE(nullptr, fp);
+  fprintf(fp, "8086 bcce");
+  fclose(fp);
+  opae_platform_cache truncated = { cache.key, nullptr, 0, 0 };
+  EXPECT_NE(0, opae_plugin_mgr_platform_cache_load(&truncated, path));
+  opae_free(truncated.devices);
+
+  opae_free(cache.devices);
+  unlink(path);
+}
+
 extern "C" {
 
 static int test_plugin_initialize_called;
@@ -251,6 +377,46 @@ TEST_P(pluginmgr_c_p, register_err01) {
   EXPECT_EQ(2, test_plugin_finalize_called);
 }
 
+extern "C" {
+
+static void test_parallel_callback(const opae_api_adapter_table *adapter,
+                                   uint32_t index, void *context)
+{
+  const opae_api_adapter_table **seen =
+    (const opae_api_adapter_table **)context;
+  seen[index] = adapter;
+}
+
+}
+
+/**
+ * @test       foreach_parallel
+ * @brief      Test: opae_plugin_mgr_for_each_adapter_parallel
+ * @details    The callback is invoked once for each adapter, with the<br>
+ *             adapter's position in the list as index, up to<br>
+ *             max_adapters adapters.<br>
+ */
+TEST_P(pluginmgr_c_p, foreach_parallel) {
+  const opae_api_adapter_table *seen[2] = { nullptr, nullptr };
+
+  EXPECT_EQ(2, opae_plugin_mgr_num_adapters());
+  EXPECT_EQ(0, opae_plugin_mgr_for_each_adapter_parallel(nullptr, seen, 2));
+
+  EXPECT_EQ(2, opae_plugin_mgr_for_each_adapter_parallel(
+                   test_parallel_callback, seen, 2));
+  EXPECT_EQ(faux_adapter0_, seen[0]);
+  EXPECT_EQ(faux_adapter1_, seen[1]);
+
+  seen[0] = seen[1] = nullptr;
+  EXPECT_EQ(1, opae_plugin_mgr_for_each_adapter_parallel(
+                   test_parallel_callback, seen, 1));
+  EXPECT_EQ(faux_adapter0_, seen[0]);
+  EXPECT_EQ(nullptr, seen[1]);
+
+  EXPECT_EQ(0, opae_plugin_mgr_finalize_all());
+  EXPECT_EQ(nullptr, adapter_list);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(pluginmgr_c_p);
 INSTANTIATE_TEST_SUITE_P(pluginmgr_c, pluginmgr_c_p,
                          ::testing::ValuesIn(test_platform::platforms({})));
@@ -274,11 +440,12 @@ TEST_P(pluginmgr_mock_c_p, alloc_adapter02) {
  * @test       alloc_adapter03
  * @brief      Test: opae_plugin_mgr_initialize
  * @details    When calloc fails,<br>
- *             opae_plugin_mgr_alloc_adapter returns NULL.<br>
+ *             opae_plugin_mgr_alloc_deferred_adapter returns NULL,<br>
+ *             and opae_plugin_mgr_initialize returns non-zero.<br>
  */
 TEST_P(pluginmgr_mock_c_p, alloc_adapter03) {
   opae_plugin_mgr_finalize_all();
-  system_->invalidate_calloc(0, "opae_plugin_mgr_alloc_adapter");
+  system_->invalidate_calloc(0, "opae_plugin_mgr_alloc_deferred_adapter");
   EXPECT_NE(0, opae_plugin_mgr_initialize(NULL));
   opae_plugin_mgr_finalize_all();
 }
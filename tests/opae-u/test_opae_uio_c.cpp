@@ -89,6 +89,17 @@ fpga_result uio_fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
                                uint64_t offset, uint32_t *value);
 fpga_result uio_fpgaWriteMMIO512(fpga_handle handle, uint32_t mmio_num,
                                  uint64_t offset, const void *value);
+fpga_result uio_fpgaReadMMIO512(fpga_handle handle, uint32_t mmio_num,
+                                uint64_t offset, void *value);
+fpga_result uio_fpgaCopyToMMIO(fpga_handle handle, uint32_t mmio_num,
+                               uint64_t offset, const void *src, uint64_t len);
+fpga_result uio_fpgaCopyFromMMIO(fpga_handle handle, uint32_t mmio_num,
+                                 uint64_t offset, void *dst, uint64_t len);
+fpga_result uio_fpgaReadMMIOBatch(fpga_handle handle, fpga_mmio_op *ops,
+                                  uint32_t num_ops);
+fpga_result uio_fpgaWriteMMIOBatch(fpga_handle handle,
+                                   const fpga_mmio_op *ops,
+                                   uint32_t num_ops);
 fpga_result uio_fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
                             uint64_t **mmio_ptr);
 fpga_result uio_fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num);
@@ -141,16 +152,6 @@ static inline volatile uint8_t *get_user_offset(uio_handle *h,
         return h->mmio_base + user_mmio + offset;
 }
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__) && GCC_VERSION >= 40900
-static inline void copy512(const void *src, void *dst)
-{
-    asm volatile("vmovdqu64 (%0), %%zmm0;"
-                 "vmovdqu64 %%zmm0, (%1);"
-                 :
-                 : "r"(src), "r"(dst));
-}
-#endif
-
 extern uio_pci_device_t *_pci_devices;
 extern libopae_config_data *opae_u_supported_devices;
 
@@ -1984,15 +1985,7 @@ class uio_mmio_f : public ::testing::Test
     handle_.mmio_base = mmio_;
     handle_.mmio_size = sizeof(mmio_);
     handle_.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__)
-#if GCC_VERSION >= 40900
-    __builtin_cpu_init();
-    if (__builtin_cpu_supports("avx512f")) {
-      handle_.flags |= OPAE_FLAG_HAS_AVX512;
-    }
-#endif // GCC_VERSION
-#endif // x86
+    handle_.mmio_wide = opae_mmio_wide_select();
   }
 
   virtual void TearDown() override
@@ -2002,7 +1995,7 @@ class uio_mmio_f : public ::testing::Test
 
   uio_pci_device_t device_;
   uio_token token_;
-  uint8_t mmio_[4096];
+  alignas(64) uint8_t mmio_[4096];
   uio_handle handle_;
 };
 
@@ -2228,46 +2221,6 @@ TEST_F(uio_mmio_f, uio_fpgaReadMMIO32_ok)
   EXPECT_EQ(rvalue, value);
 }
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__) && GCC_VERSION >= 40900
-/**
- * @test    copy512_ok
- * @brief   Test: copy512()
- * @details The function copies the 64 bytes at src
- *          to dst.
- */
-TEST(opae_u, copy512_ok)
-{
-  __builtin_cpu_init();
-  if (!__builtin_cpu_supports("avx512f")) {
-    GTEST_SKIP() << "CPU doesn't have AVX512 support.";
-  }
-
-  struct
-  {
-    uint64_t header;
-    uint8_t between[64];
-    uint64_t footer;
-  } src, dst;
-
-  src.header = 0xdecafbaddeadbeef;
-  memset(src.between, 0xaf, sizeof(src.between));
-  src.footer = 0xbeefdeadbaddecaf;
-
-  memset(&dst, 0, sizeof(dst));
-
-  copy512(src.between, dst.between);
-
-  EXPECT_EQ(0, dst.header);
-  EXPECT_EQ(0, dst.footer);
-  EXPECT_EQ(0, memcmp(src.between, dst.between, sizeof(src.between)));
-}
-#else
-TEST(opae_u, copy512_ok)
-{
-  GTEST_SKIP() << "Invalid platform or gcc too old.";
-}
-#endif
-
 /**
  * @test    uio_fpgaWriteMMIO512_err0
  * @brief   Test: uio_fpgaWriteMMIO512()
@@ -2310,9 +2263,8 @@ TEST_F(uio_mmio_f, uio_fpgaWriteMMIO512_err1)
 /**
  * @test    uio_fpgaWriteMMIO512_err2
  * @brief   Test: uio_fpgaWriteMMIO512()
- * @details When the flags field of the handle<br>
- *          doesn't contain OPAE_FLAG_HAS_AVX512,<br>
- *          then the function<br>
+ * @details When the host has no 512 bit<br>
+ *          MMIO kernel, then the function<br>
  *          returns FPGA_NOT_SUPPORTED.
  */
 TEST_F(uio_mmio_f, uio_fpgaWriteMMIO512_err2)
@@ -2324,7 +2276,7 @@ TEST_F(uio_mmio_f, uio_fpgaWriteMMIO512_err2)
     0x0000000500000005, 0x0000000600000006, 0x0000000700000007, 0x0000000800000008
   };
 
-  handle_.flags = 0;
+  handle_.mmio_wide = NULL;
   EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaWriteMMIO512(&handle_, mmio_num, offset, values));
 }
 
@@ -2344,7 +2296,6 @@ TEST_F(uio_mmio_f, uio_fpgaWriteMMIO512_err3)
     0x0000000500000005, 0x0000000600000006, 0x0000000700000007, 0x0000000800000008
   };
 
-  handle_.flags |= OPAE_FLAG_HAS_AVX512;
   EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaWriteMMIO512(&handle_, mmio_num, offset, values));
 }
 
@@ -2366,14 +2317,202 @@ TEST_F(uio_mmio_f, uio_fpgaWriteMMIO512_ok)
     0x0000000500000005, 0x0000000600000006, 0x0000000700000007, 0x0000000800000008
   };
 
-  if (!(handle_.flags & OPAE_FLAG_HAS_AVX512)) {
-    GTEST_SKIP() << "CPU doesn't have AVX512 support.";
+  if (!handle_.mmio_wide) {
+    GTEST_SKIP() << "No 512 bit MMIO support on this host.";
   }
 
   EXPECT_EQ(FPGA_OK, uio_fpgaWriteMMIO512(&handle_, mmio_num, offset, values));
   EXPECT_EQ(0, memcmp(values, mmio_, sizeof(values)));
 }
 
+/**
+ * @test    uio_fpgaReadMMIO512_err0
+ * @brief   Test: uio_fpgaReadMMIO512()
+ * @details When the offset is misaligned,<br>
+ *          the token is an FPGA_DEVICE,<br>
+ *          the host has no 512 bit MMIO kernel,<br>
+ *          or mmio_num is out of bounds,<br>
+ *          then the function fails.
+ */
+TEST_F(uio_mmio_f, uio_fpgaReadMMIO512_err0)
+{
+  uint64_t values[8];
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaReadMMIO512(&handle_, 0, 1, values));
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaReadMMIO512(&handle_, USER_MMIO_MAX, 0, values));
+
+  token_.hdr.objtype = FPGA_DEVICE;
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaReadMMIO512(&handle_, 0, 0, values));
+
+  token_.hdr.objtype = FPGA_ACCELERATOR;
+  handle_.mmio_wide = NULL;
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaReadMMIO512(&handle_, 0, 0, values));
+}
+
+/**
+ * @test    uio_fpgaReadMMIO512_ok
+ * @brief   Test: uio_fpgaReadMMIO512()
+ * @details When the parameters are valid,<br>
+ *          then the function copies the 64<br>
+ *          bytes at the mmio location to value,<br>
+ *          and the function returns FPGA_OK.
+ */
+TEST_F(uio_mmio_f, uio_fpgaReadMMIO512_ok)
+{
+  const uint64_t offset = 64;
+  uint64_t values[8];
+  uint32_t i;
+
+  if (!handle_.mmio_wide) {
+    GTEST_SKIP() << "No 512 bit MMIO support on this host.";
+  }
+
+  for (i = 0 ; i < sizeof(values) ; ++i)
+    mmio_[offset + i] = (uint8_t)i;
+
+  EXPECT_EQ(FPGA_OK, uio_fpgaReadMMIO512(&handle_, 0, offset, values));
+  EXPECT_EQ(0, memcmp(values, mmio_ + offset, sizeof(values)));
+}
+
+/**
+ * @test    uio_fpgaCopyMMIO_err0
+ * @brief   Test: uio_fpgaCopyToMMIO(), uio_fpgaCopyFromMMIO()
+ * @details When the offset or length is not a multiple of 8,<br>
+ *          the range exceeds the mmio,<br>
+ *          or the token is an FPGA_DEVICE,<br>
+ *          then the functions fail.
+ */
+TEST_F(uio_mmio_f, uio_fpgaCopyMMIO_err0)
+{
+  uint64_t values[4] = { 0, 0, 0, 0 };
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaCopyToMMIO(&handle_, 0, 4, values, sizeof(values)));
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaCopyFromMMIO(&handle_, 0, 0, values, 12));
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaCopyToMMIO(&handle_, 0, sizeof(mmio_) - 8, values, sizeof(values)));
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaCopyFromMMIO(&handle_, USER_MMIO_MAX, 0, values, sizeof(values)));
+
+  token_.hdr.objtype = FPGA_DEVICE;
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaCopyToMMIO(&handle_, 0, 0, values, sizeof(values)));
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaCopyFromMMIO(&handle_, 0, 0, values, sizeof(values)));
+}
+
+/**
+ * @test    uio_fpgaCopyMMIO_ok
+ * @brief   Test: uio_fpgaCopyToMMIO(), uio_fpgaCopyFromMMIO()
+ * @details When the parameters are valid,<br>
+ *          then the functions copy the block<br>
+ *          to and from the mmio,<br>
+ *          and return FPGA_OK.
+ */
+TEST_F(uio_mmio_f, uio_fpgaCopyMMIO_ok)
+{
+  const uint64_t offset = 8;
+  uint64_t values[40];
+  uint64_t readback[40];
+  uint32_t i;
+
+  for (i = 0 ; i < 40 ; ++i)
+    values[i] = 0x0000000100000001 * (i + 1);
+  memset(readback, 0, sizeof(readback));
+
+  EXPECT_EQ(FPGA_OK, uio_fpgaCopyToMMIO(&handle_, 0, offset, values, sizeof(values)));
+  EXPECT_EQ(0, memcmp(values, mmio_ + offset, sizeof(values)));
+
+  EXPECT_EQ(FPGA_OK, uio_fpgaCopyFromMMIO(&handle_, 0, offset, readback, sizeof(readback)));
+  EXPECT_EQ(0, memcmp(values, readback, sizeof(readback)));
+}
+
+/**
+ * @test    uio_fpgaMMIOBatch_err0
+ * @brief   Test: uio_fpgaReadMMIOBatch(), uio_fpgaWriteMMIOBatch()
+ * @details When the objtype field of the token<br>
+ *          header is FPGA_DEVICE, then the functions<br>
+ *          return FPGA_NOT_SUPPORTED.
+ */
+TEST_F(uio_mmio_f, uio_fpgaMMIOBatch_err0)
+{
+  fpga_mmio_op ops[1] = { { 0, sizeof(uint64_t), 0, 0 } };
+  token_.hdr.objtype = FPGA_DEVICE;
+
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaReadMMIOBatch(&handle_, ops, 1));
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, uio_fpgaWriteMMIOBatch(&handle_, ops, 1));
+}
+
+/**
+ * @test    uio_fpgaMMIOBatch_err1
+ * @brief   Test: uio_fpgaReadMMIOBatch(), uio_fpgaWriteMMIOBatch()
+ * @details When an operation has an invalid width<br>
+ *          or mmio_num, then the functions stop at<br>
+ *          that operation and return FPGA_INVALID_PARAM.
+ */
+TEST_F(uio_mmio_f, uio_fpgaMMIOBatch_err1)
+{
+  fpga_mmio_op ops[2] = {
+    { 0, sizeof(uint64_t), 0, 0xdecafbadfeedbeef },
+    { 0, 2, 8, 0 }
+  };
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaWriteMMIOBatch(&handle_, ops, 2));
+  EXPECT_EQ(0xdecafbadfeedbeef, *(uint64_t *)mmio_);
+
+  ops[1].width = sizeof(uint64_t);
+  ops[1].mmio_num = USER_MMIO_MAX;
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaReadMMIOBatch(&handle_, ops, 2));
+}
+
+/**
+ * @test    uio_fpgaMMIOBatch_err2
+ * @brief   Test: uio_fpgaReadMMIOBatch(), uio_fpgaWriteMMIOBatch()
+ * @details When an operation is misaligned, extends<br>
+ *          past the end of the mmio, or has an offset<br>
+ *          that does not fit in 32 bits, then the<br>
+ *          functions return FPGA_INVALID_PARAM<br>
+ *          without accessing the mmio.
+ */
+TEST_F(uio_mmio_f, uio_fpgaMMIOBatch_err2)
+{
+  fpga_mmio_op ops[1] = { { 0, sizeof(uint64_t), 4, 0xdecafbadfeedbeef } };
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaWriteMMIOBatch(&handle_, ops, 1));
+  EXPECT_EQ(0, *(uint64_t *)mmio_);
+
+  ops[0].offset = sizeof(mmio_);
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaWriteMMIOBatch(&handle_, ops, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaReadMMIOBatch(&handle_, ops, 1));
+
+  ops[0].offset = (uint64_t)UINT32_MAX + 1;
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaWriteMMIOBatch(&handle_, ops, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, uio_fpgaReadMMIOBatch(&handle_, ops, 1));
+}
+
+/**
+ * @test    uio_fpgaMMIOBatch_ok
+ * @brief   Test: uio_fpgaReadMMIOBatch(), uio_fpgaWriteMMIOBatch()
+ * @details When the parameters are valid,<br>
+ *          then the functions perform each access<br>
+ *          in order and return FPGA_OK.
+ */
+TEST_F(uio_mmio_f, uio_fpgaMMIOBatch_ok)
+{
+  const fpga_mmio_op wops[3] = {
+    { 0, sizeof(uint64_t), 0, 0xdecafbadfeedbeef },
+    { 0, sizeof(uint32_t), 8, 0xc0cac01a },
+    { 0, sizeof(uint32_t), 12, 0xdeadbeef }
+  };
+  fpga_mmio_op rops[3] = {
+    { 0, sizeof(uint64_t), 0, 0 },
+    { 0, sizeof(uint32_t), 8, 0 },
+    { 0, sizeof(uint64_t), 8, 0 }
+  };
+
+  EXPECT_EQ(FPGA_OK, uio_fpgaWriteMMIOBatch(&handle_, wops, 3));
+  EXPECT_EQ(FPGA_OK, uio_fpgaReadMMIOBatch(&handle_, rops, 3));
+
+  EXPECT_EQ(0xdecafbadfeedbeef, rops[0].value);
+  EXPECT_EQ(0xc0cac01a, rops[1].value);
+  EXPECT_EQ(0xdeadbeefc0cac01a, rops[2].value);
+}
+
 /**
  * @test    uio_fpgaMapMMIO_err0
  * @brief   Test: uio_fpgaMapMMIO()
@@ -0,0 +1,210 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "mock/opae_std.h"
+
+extern "C" {
+#include "buffer_pool.h"
+}
+
+class buffer_pool_f : public ::testing::Test
+{
+  protected:
+
+  buffer_pool_f() :
+    pool_(nullptr)
+  {}
+
+  virtual void SetUp() override
+  {
+    unsetenv("LIBOPAE_BUFFER_POOL_MAX");
+
+    memset(bufs_, 0, sizeof(bufs_));
+    for (size_t i = 0 ; i < sizeof(bufs_) / sizeof(bufs_[0]) ; ++i) {
+      bufs_[i].buffer_ptr = (uint8_t *)(0x100000 * (i + 1));
+      bufs_[i].buffer_iova = 0x100000 * (i + 1);
+    }
+
+    pool_ = vfio_buffer_pool_create(16384);
+    ASSERT_NE(pool_, nullptr);
+  }
+
+  virtual void TearDown() override
+  {
+    vfio_buffer_pool_destroy(pool_);
+    unsetenv("LIBOPAE_BUFFER_POOL_MAX");
+  }
+
+  vfio_buffer_pool *pool_;
+  struct opae_vfio_buffer bufs_[4];
+};
+
+/**
+ * @test    limit
+ * @brief   Test: vfio_buffer_pool_limit()
+ * @details The fn returns the byte value of<br>
+ *          LIBOPAE_BUFFER_POOL_MAX, honoring a K, M or G<br>
+ *          suffix, and 0 when it is unset, invalid,<br>
+ *          or overflows 64 bits once scaled.
+ */
+TEST_F(buffer_pool_f, limit)
+{
+  EXPECT_EQ(0, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "4096", 1);
+  EXPECT_EQ(4096, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "0x2000", 1);
+  EXPECT_EQ(8192, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "8k", 1);
+  EXPECT_EQ(8192, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "64M", 1);
+  EXPECT_EQ(64UL << 20, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "2G", 1);
+  EXPECT_EQ(2UL << 30, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "2GB", 1);
+  EXPECT_EQ(0, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "lots", 1);
+  EXPECT_EQ(0, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "17179869183G", 1);
+  EXPECT_EQ(17179869183UL << 30, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "17179869184G", 1);
+  EXPECT_EQ(0, vfio_buffer_pool_limit());
+
+  setenv("LIBOPAE_BUFFER_POOL_MAX", "0x40000000000000k", 1);
+  EXPECT_EQ(0, vfio_buffer_pool_limit());
+}
+
+/**
+ * @test    get_put
+ * @brief   Test: vfio_buffer_pool_get(), vfio_buffer_pool_put()
+ * @details A buffer handed to the pool is returned<br>
+ *          only for a request of exactly its size,<br>
+ *          most recently released first.
+ */
+TEST_F(buffer_pool_f, get_put)
+{
+  fpga_buffer_pool_stats stats;
+
+  bufs_[0].buffer_size = 4096;
+  bufs_[1].buffer_size = 4096;
+  bufs_[2].buffer_size = 6144;
+
+  EXPECT_EQ(nullptr, vfio_buffer_pool_get(pool_, 4096));
+
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[0]));
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[2]));
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[1]));
+
+  // Same size class as 6144, but a different size.
+  EXPECT_EQ(nullptr, vfio_buffer_pool_get(pool_, 5120));
+
+  EXPECT_EQ(&bufs_[2], vfio_buffer_pool_get(pool_, 6144));
+  EXPECT_EQ(&bufs_[1], vfio_buffer_pool_get(pool_, 4096));
+  EXPECT_EQ(&bufs_[0], vfio_buffer_pool_get(pool_, 4096));
+  EXPECT_EQ(nullptr, vfio_buffer_pool_get(pool_, 4096));
+
+  vfio_buffer_pool_get_stats(pool_, &stats);
+  EXPECT_EQ(3, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(3, stats.recycled);
+  EXPECT_EQ(0, stats.evicted);
+  EXPECT_EQ(0, stats.pooled_buffers);
+  EXPECT_EQ(0, stats.pooled_bytes);
+  EXPECT_EQ(16384, stats.high_water);
+}
+
+/**
+ * @test    high_water
+ * @brief   Test: vfio_buffer_pool_put()
+ * @details When keeping a buffer would take the pool<br>
+ *          over its high-water mark, the fn returns<br>
+ *          non-zero so that the caller frees the buffer.
+ */
+TEST_F(buffer_pool_f, high_water)
+{
+  fpga_buffer_pool_stats stats;
+
+  bufs_[0].buffer_size = 8192;
+  bufs_[1].buffer_size = 4096;
+  bufs_[2].buffer_size = 8192;
+  bufs_[3].buffer_size = 4096;
+
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[0]));
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[1]));
+  EXPECT_NE(0, vfio_buffer_pool_put(pool_, &bufs_[2]));
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[3]));
+
+  vfio_buffer_pool_get_stats(pool_, &stats);
+  EXPECT_EQ(3, stats.recycled);
+  EXPECT_EQ(1, stats.evicted);
+  EXPECT_EQ(3, stats.pooled_buffers);
+  EXPECT_EQ(16384, stats.pooled_bytes);
+
+  EXPECT_EQ(&bufs_[0], vfio_buffer_pool_get(pool_, 8192));
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool_, &bufs_[2]));
+
+  vfio_buffer_pool_get_stats(pool_, &stats);
+  EXPECT_EQ(3, stats.pooled_buffers);
+  EXPECT_EQ(16384, stats.pooled_bytes);
+}
+
+/**
+ * @test    destroy
+ * @brief   Test: vfio_buffer_pool_destroy()
+ * @details The fn accepts NULL, and releases a pool<br>
+ *          that still holds buffers.
+ */
+TEST(buffer_pool, destroy)
+{
+  struct opae_vfio_buffer binfo;
+  vfio_buffer_pool *pool;
+
+  vfio_buffer_pool_destroy(nullptr);
+
+  pool = vfio_buffer_pool_create(VFIO_POOL_DEFAULT_MAX);
+  ASSERT_NE(pool, nullptr);
+
+  memset(&binfo, 0, sizeof(binfo));
+  binfo.buffer_size = 2 * 1024 * 1024;
+  EXPECT_EQ(0, vfio_buffer_pool_put(pool, &binfo));
+
+  vfio_buffer_pool_destroy(pool);
+}
@@ -39,6 +39,7 @@
 using namespace opae::testing;
 
 #include <opae/types_enum.h>
+#include <opae/mem_bind.h>
 #include "cfg-file.h"
 #include "props.h"
 
@@ -64,6 +65,7 @@ vfio_token *token_check(fpga_token token);
 vfio_handle *handle_check(fpga_handle handle);
 vfio_event_handle *event_handle_check(fpga_event_handle event_handle);
 vfio_handle *handle_check_and_lock(fpga_handle handle);
+void mmio_quiesce(vfio_handle *h);
 vfio_event_handle *event_handle_check_and_lock(fpga_event_handle event_handle);
 
 int close_vfio_pair(vfio_pair_t **pair);
@@ -89,6 +91,17 @@ fpga_result vfio_fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
                                uint64_t offset, uint32_t *value);
 fpga_result vfio_fpgaWriteMMIO512(fpga_handle handle, uint32_t mmio_num,
                                  uint64_t offset, const void *value);
+fpga_result vfio_fpgaReadMMIO512(fpga_handle handle, uint32_t mmio_num,
+                                 uint64_t offset, void *value);
+fpga_result vfio_fpgaCopyToMMIO(fpga_handle handle, uint32_t mmio_num,
+                                uint64_t offset, const void *src, uint64_t len);
+fpga_result vfio_fpgaCopyFromMMIO(fpga_handle handle, uint32_t mmio_num,
+                                  uint64_t offset, void *dst, uint64_t len);
+fpga_result vfio_fpgaReadMMIOBatch(fpga_handle handle, fpga_mmio_op *ops,
+                                   uint32_t num_ops);
+fpga_result vfio_fpgaWriteMMIOBatch(fpga_handle handle,
+                                    const fpga_mmio_op *ops,
+                                    uint32_t num_ops);
 fpga_result vfio_fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
                             uint64_t **mmio_ptr);
 fpga_result vfio_fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num);
@@ -117,10 +130,32 @@ fpga_result vfio_fpgaPrepareBuffer(fpga_handle handle,
                                    void **buf_addr,
                                    uint64_t *wsid,
                                    int flags);
+fpga_result vfio_fpgaPrepareBufferEx(fpga_handle handle,
+                                     uint64_t len,
+                                     void **buf_addr,
+                                     uint64_t *wsid,
+                                     int flags,
+                                     int numa_node);
+fpga_result vfio_fpgaPrepareBufferSG(fpga_handle handle,
+                                     void *buf_addr,
+                                     uint64_t len,
+                                     uint64_t *wsid,
+                                     fpga_sg_entry *sg,
+                                     uint32_t *num_sg,
+                                     int flags);
+int vfio_sg_map(void *context, uint8_t *vaddr,
+                size_t size, uint64_t *iova);
+int vfio_sg_unmap(void *context, uint8_t *vaddr);
 fpga_result vfio_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid);
 fpga_result vfio_fpgaGetIOAddress(fpga_handle handle,
                                   uint64_t wsid,
                                   uint64_t *ioaddr);
+fpga_result vfio_fpgaGetBufferPoolStats(fpga_handle handle,
+                                        fpga_buffer_pool_stats *stats);
+fpga_result vfio_fpgaGetBufferPrepareStats(fpga_handle handle,
+                                           fpga_buffer_prepare_stats *stats);
+
+fpga_result vfio_fpgaDrainBufferReleases(fpga_handle handle);
 
 fpga_result vfio_fpgaCreateEventHandle(fpga_event_handle *event_handle);
 fpga_result vfio_fpgaDestroyEventHandle(fpga_event_handle *event_handle);
@@ -152,16 +187,6 @@ static inline volatile uint8_t *get_user_offset(vfio_handle *h,
         return h->mmio_base + user_mmio + offset;
 }
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__) && GCC_VERSION >= 40900
-static inline void copy512(const void *src, void *dst)
-{
-    asm volatile("vmovdqu64 (%0), %%zmm0;"
-                 "vmovdqu64 %%zmm0, (%1);"
-                 :
-                 : "r"(src), "r"(dst));
-}
-#endif
-
 extern vfio_pci_device_t *_pci_devices;
 extern libopae_config_data *opae_v_supported_devices;
 
@@ -1751,20 +1776,13 @@ class vfio_mmio_f : public ::testing::Test
 
     memset(mmio_, 0, sizeof(mmio_));
 
+    memset(&handle_, 0, sizeof(handle_));
     handle_.magic = VFIO_HANDLE_MAGIC;
     handle_.token = &token_;
     handle_.mmio_base = mmio_;
     handle_.mmio_size = sizeof(mmio_);
     handle_.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
-
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__)
-#if GCC_VERSION >= 40900
-    __builtin_cpu_init();
-    if (__builtin_cpu_supports("avx512f")) {
-      handle_.flags |= OPAE_FLAG_HAS_AVX512;
-    }
-#endif // GCC_VERSION
-#endif // x86
+    handle_.mmio_wide = opae_mmio_wide_select();
   }
 
   virtual void TearDown() override
@@ -1774,7 +1792,7 @@ class vfio_mmio_f : public ::testing::Test
 
   vfio_pci_device_t device_;
   vfio_token token_;
-  uint8_t mmio_[4096];
+  alignas(64) uint8_t mmio_[4096];
   vfio_handle handle_;
 };
 
@@ -2000,45 +2018,132 @@ TEST_F(vfio_mmio_f, vfio_fpgaReadMMIO32_ok)
   EXPECT_EQ(rvalue, value);
 }
 
-#if defined(__i386__) || defined(__x86_64__) || defined(__ia64__) && GCC_VERSION >= 40900
 /**
- * @test    copy512_ok
- * @brief   Test: copy512()
- * @details The function copies the 64 bytes at src
- *          to dst.
+ * @test    vfio_fpgaReadMMIO64_err2
+ * @brief   Test: vfio_fpgaReadMMIO64()
+ * @details When the given offset is beyond<br>
+ *          the end of the mapped region, then<br>
+ *          the function returns FPGA_INVALID_PARAM.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaReadMMIO64_err2)
+{
+  const uint32_t mmio_num = 0;
+  const uint64_t offset = sizeof(mmio_) - sizeof(uint32_t); // <- straddles end
+  uint64_t value = 0;
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIO64(&handle_, mmio_num, offset, &value));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIO64(&handle_, mmio_num, ~0ULL, &value));
+}
+
+/**
+ * @test    vfio_fpgaMMIO_lockless_ok
+ * @brief   Test: vfio_fpgaWriteMMIO64(), vfio_fpgaReadMMIO64()
+ * @details When the handle was opened with<br>
+ *          FPGA_OPEN_LOCKLESS_MMIO, then MMIO accesses<br>
+ *          succeed while another thread holds the handle<br>
+ *          lock, and leave no accessor registered.
  */
-TEST(opae_v, copy512_ok)
+TEST_F(vfio_mmio_f, vfio_fpgaMMIO_lockless_ok)
 {
-  __builtin_cpu_init();
-  if (!__builtin_cpu_supports("avx512f")) {
-    GTEST_SKIP() << "CPU doesn't have AVX512 support.";
+  const uint32_t mmio_num = 0;
+  const uint64_t offset = 8;
+  const uint64_t wvalue = 0xdecafbadfeedbeef;
+  uint64_t rvalue = 0;
+
+  handle_.open_flags = FPGA_OPEN_LOCKLESS_MMIO;
+
+  pthread_mutex_t held = PTHREAD_MUTEX_INITIALIZER;
+  ASSERT_EQ(0, pthread_mutex_lock(&held));
+
+  pthread_t owner;
+  struct lock_owner {
+    pthread_mutex_t *handle_lock;
+    pthread_mutex_t *held;
+  } args = { &handle_.lock, &held };
+
+  ASSERT_EQ(0, pthread_create(&owner, nullptr, [](void *p) -> void * {
+    lock_owner *a = (lock_owner *)p;
+    pthread_mutex_lock(a->handle_lock);
+    pthread_mutex_lock(a->held);
+    pthread_mutex_unlock(a->held);
+    pthread_mutex_unlock(a->handle_lock);
+    return nullptr;
+  }, &args));
+
+  while (pthread_mutex_trylock(&handle_.lock) == 0) {
+    pthread_mutex_unlock(&handle_.lock);
+    sched_yield();
   }
 
-  struct
-  {
-    uint64_t header;
-    uint8_t between[64];
-    uint64_t footer;
-  } src, dst;
+  EXPECT_EQ(FPGA_OK, vfio_fpgaWriteMMIO64(&handle_, mmio_num, offset, wvalue));
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReadMMIO64(&handle_, mmio_num, offset, &rvalue));
+  EXPECT_EQ(wvalue, rvalue);
+  EXPECT_EQ(0, handle_.mmio_users);
 
-  src.header = 0xdecafbaddeadbeef;
-  memset(src.between, 0xaf, sizeof(src.between));
-  src.footer = 0xbeefdeadbaddecaf;
+  pthread_mutex_unlock(&held);
+  pthread_join(owner, nullptr);
+}
 
-  memset(&dst, 0, sizeof(dst));
+/**
+ * @test    vfio_fpgaMMIO_lockless_err0
+ * @brief   Test: vfio_fpgaReadMMIO32()
+ * @details When a handle opened with<br>
+ *          FPGA_OPEN_LOCKLESS_MMIO has been invalidated<br>
+ *          by fpgaClose(), then the function fails<br>
+ *          and leaves no accessor registered.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaMMIO_lockless_err0)
+{
+  uint32_t value = 0;
 
-  copy512(src.between, dst.between);
+  handle_.open_flags = FPGA_OPEN_LOCKLESS_MMIO;
+  handle_.magic = 0;
 
-  EXPECT_EQ(0, dst.header);
-  EXPECT_EQ(0, dst.footer);
-  EXPECT_EQ(0, memcmp(src.between, dst.between, sizeof(src.between)));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIO32(&handle_, 0, 0, &value));
+  EXPECT_EQ(0, handle_.mmio_users);
 }
-#else
-TEST(opae_v, copy512_ok)
+
+/**
+ * @test    vfio_fpgaMMIO_lockless_quiesce
+ * @brief   Test: vfio_fpgaReadMMIO64(), mmio_quiesce()
+ * @details When lock-free readers race with mmio_quiesce(),<br>
+ *          then mmio_quiesce() returns only once no access<br>
+ *          is registered, and accesses started after it<br>
+ *          returns fail.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaMMIO_lockless_quiesce)
 {
-  GTEST_SKIP() << "Invalid platform or gcc too old.";
+  struct reader {
+    vfio_handle *h;
+    volatile bool stop;
+  } args = { &handle_, false };
+  pthread_t readers[4];
+  uint64_t value = 0;
+  int i;
+
+  handle_.open_flags = FPGA_OPEN_LOCKLESS_MMIO;
+
+  for (i = 0 ; i < 4 ; ++i) {
+    ASSERT_EQ(0, pthread_create(&readers[i], nullptr, [](void *p) -> void * {
+      reader *r = (reader *)p;
+      uint64_t v = 0;
+      while (!r->stop &&
+             vfio_fpgaReadMMIO64(r->h, 0, 0, &v) == FPGA_OK)
+        ;
+      return nullptr;
+    }, &args));
+  }
+
+  usleep(5000);
+  mmio_quiesce(&handle_);
+  EXPECT_EQ(0, __atomic_load_n(&handle_.mmio_users, __ATOMIC_SEQ_CST));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIO64(&handle_, 0, 0, &value));
+
+  args.stop = true;
+  for (i = 0 ; i < 4 ; ++i)
+    pthread_join(readers[i], nullptr);
+  EXPECT_EQ(0, handle_.mmio_users);
 }
-#endif
 
 /**
  * @test    vfio_fpgaWriteMMIO512_err0
@@ -2082,9 +2187,8 @@ TEST_F(vfio_mmio_f, vfio_fpgaWriteMMIO512_err1)
 /**
  * @test    vfio_fpgaWriteMMIO512_err2
  * @brief   Test: vfio_fpgaWriteMMIO512()
- * @details When the flags field of the handle<br>
- *          doesn't contain OPAE_FLAG_HAS_AVX512,<br>
- *          then the function<br>
+ * @details When the host has no 512 bit<br>
+ *          MMIO kernel, then the function<br>
  *          returns FPGA_NOT_SUPPORTED.
  */
 TEST_F(vfio_mmio_f, vfio_fpgaWriteMMIO512_err2)
@@ -2096,7 +2200,7 @@ TEST_F(vfio_mmio_f, vfio_fpgaWriteMMIO512_err2)
     0x0000000500000005, 0x0000000600000006, 0x0000000700000007, 0x0000000800000008
   };
 
-  handle_.flags = 0;
+  handle_.mmio_wide = NULL;
   EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaWriteMMIO512(&handle_, mmio_num, offset, values));
 }
 
@@ -2116,7 +2220,6 @@ TEST_F(vfio_mmio_f, vfio_fpgaWriteMMIO512_err3)
     0x0000000500000005, 0x0000000600000006, 0x0000000700000007, 0x0000000800000008
   };
 
-  handle_.flags |= OPAE_FLAG_HAS_AVX512;
   EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaWriteMMIO512(&handle_, mmio_num, offset, values));
 }
 
@@ -2138,14 +2241,177 @@ TEST_F(vfio_mmio_f, vfio_fpgaWriteMMIO512_ok)
     0x0000000500000005, 0x0000000600000006, 0x0000000700000007, 0x0000000800000008
   };
 
-  if (!(handle_.flags & OPAE_FLAG_HAS_AVX512)) {
-    GTEST_SKIP() << "CPU doesn't have AVX512 support.";
+  if (!handle_.mmio_wide) {
+    GTEST_SKIP() << "No 512 bit MMIO support on this host.";
   }
 
   EXPECT_EQ(FPGA_OK, vfio_fpgaWriteMMIO512(&handle_, mmio_num, offset, values));
   EXPECT_EQ(0, memcmp(values, mmio_, sizeof(values)));
 }
 
+/**
+ * @test    vfio_fpgaReadMMIO512_err0
+ * @brief   Test: vfio_fpgaReadMMIO512()
+ * @details When the offset is misaligned,<br>
+ *          the token is an FPGA_DEVICE,<br>
+ *          the host has no 512 bit MMIO kernel,<br>
+ *          or mmio_num is out of bounds,<br>
+ *          then the function fails.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaReadMMIO512_err0)
+{
+  uint64_t values[8];
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIO512(&handle_, 0, 1, values));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIO512(&handle_, USER_MMIO_MAX, 0, values));
+
+  token_.hdr.objtype = FPGA_DEVICE;
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaReadMMIO512(&handle_, 0, 0, values));
+
+  token_.hdr.objtype = FPGA_ACCELERATOR;
+  handle_.mmio_wide = NULL;
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaReadMMIO512(&handle_, 0, 0, values));
+}
+
+/**
+ * @test    vfio_fpgaReadMMIO512_ok
+ * @brief   Test: vfio_fpgaReadMMIO512()
+ * @details When the parameters are valid,<br>
+ *          then the function copies the 64<br>
+ *          bytes at the mmio location to value,<br>
+ *          and the function returns FPGA_OK.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaReadMMIO512_ok)
+{
+  const uint64_t offset = 64;
+  uint64_t values[8];
+  uint32_t i;
+
+  if (!handle_.mmio_wide) {
+    GTEST_SKIP() << "No 512 bit MMIO support on this host.";
+  }
+
+  for (i = 0 ; i < sizeof(values) ; ++i)
+    mmio_[offset + i] = (uint8_t)i;
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReadMMIO512(&handle_, 0, offset, values));
+  EXPECT_EQ(0, memcmp(values, mmio_ + offset, sizeof(values)));
+}
+
+/**
+ * @test    vfio_fpgaCopyMMIO_err0
+ * @brief   Test: vfio_fpgaCopyToMMIO(), vfio_fpgaCopyFromMMIO()
+ * @details When the offset or length is not a multiple of 8,<br>
+ *          the range exceeds the mmio,<br>
+ *          or the token is an FPGA_DEVICE,<br>
+ *          then the functions fail.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaCopyMMIO_err0)
+{
+  uint64_t values[4] = { 0, 0, 0, 0 };
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaCopyToMMIO(&handle_, 0, 4, values, sizeof(values)));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaCopyFromMMIO(&handle_, 0, 0, values, 12));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaCopyToMMIO(&handle_, 0, sizeof(mmio_) - 8, values, sizeof(values)));
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaCopyFromMMIO(&handle_, USER_MMIO_MAX, 0, values, sizeof(values)));
+
+  token_.hdr.objtype = FPGA_DEVICE;
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaCopyToMMIO(&handle_, 0, 0, values, sizeof(values)));
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaCopyFromMMIO(&handle_, 0, 0, values, sizeof(values)));
+}
+
+/**
+ * @test    vfio_fpgaCopyMMIO_ok
+ * @brief   Test: vfio_fpgaCopyToMMIO(), vfio_fpgaCopyFromMMIO()
+ * @details When the parameters are valid,<br>
+ *          then the functions copy the block<br>
+ *          to and from the mmio,<br>
+ *          and return FPGA_OK.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaCopyMMIO_ok)
+{
+  const uint64_t offset = 8;
+  uint64_t values[40];
+  uint64_t readback[40];
+  uint32_t i;
+
+  for (i = 0 ; i < 40 ; ++i)
+    values[i] = 0x0000000100000001 * (i + 1);
+  memset(readback, 0, sizeof(readback));
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaCopyToMMIO(&handle_, 0, offset, values, sizeof(values)));
+  EXPECT_EQ(0, memcmp(values, mmio_ + offset, sizeof(values)));
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaCopyFromMMIO(&handle_, 0, offset, readback, sizeof(readback)));
+  EXPECT_EQ(0, memcmp(values, readback, sizeof(readback)));
+}
+
+/**
+ * @test    vfio_fpgaMMIOBatch_err0
+ * @brief   Test: vfio_fpgaReadMMIOBatch(), vfio_fpgaWriteMMIOBatch()
+ * @details When the objtype field of the token<br>
+ *          header is FPGA_DEVICE, then the functions<br>
+ *          return FPGA_NOT_SUPPORTED.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaMMIOBatch_err0)
+{
+  fpga_mmio_op ops[1] = { { 0, sizeof(uint64_t), 0, 0 } };
+  token_.hdr.objtype = FPGA_DEVICE;
+
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaReadMMIOBatch(&handle_, ops, 1));
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaWriteMMIOBatch(&handle_, ops, 1));
+}
+
+/**
+ * @test    vfio_fpgaMMIOBatch_err1
+ * @brief   Test: vfio_fpgaReadMMIOBatch(), vfio_fpgaWriteMMIOBatch()
+ * @details When an operation has an invalid width<br>
+ *          or is out of bounds, then the functions<br>
+ *          stop at that operation and return FPGA_INVALID_PARAM.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaMMIOBatch_err1)
+{
+  fpga_mmio_op ops[2] = {
+    { 0, sizeof(uint64_t), 0, 0xdecafbadfeedbeef },
+    { 0, 2, 8, 0 }
+  };
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaWriteMMIOBatch(&handle_, ops, 2));
+  EXPECT_EQ(0xdecafbadfeedbeef, *(uint64_t *)mmio_);
+
+  ops[1].width = sizeof(uint64_t);
+  ops[1].offset = sizeof(mmio_);
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaReadMMIOBatch(&handle_, ops, 2));
+}
+
+/**
+ * @test    vfio_fpgaMMIOBatch_ok
+ * @brief   Test: vfio_fpgaReadMMIOBatch(), vfio_fpgaWriteMMIOBatch()
+ * @details When the parameters are valid,<br>
+ *          then the functions perform each access<br>
+ *          in order and return FPGA_OK.
+ */
+TEST_F(vfio_mmio_f, vfio_fpgaMMIOBatch_ok)
+{
+  const fpga_mmio_op wops[3] = {
+    { 0, sizeof(uint64_t), 0, 0xdecafbadfeedbeef },
+    { 0, sizeof(uint32_t), 8, 0xc0cac01a },
+    { 0, sizeof(uint32_t), 12, 0xdeadbeef }
+  };
+  fpga_mmio_op rops[3] = {
+    { 0, sizeof(uint64_t), 0, 0 },
+    { 0, sizeof(uint32_t), 8, 0 },
+    { 0, sizeof(uint64_t), 8, 0 }
+  };
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaWriteMMIOBatch(&handle_, wops, 3));
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReadMMIOBatch(&handle_, rops, 3));
+
+  EXPECT_EQ(0xdecafbadfeedbeef, rops[0].value);
+  EXPECT_EQ(0xc0cac01a, rops[1].value);
+  EXPECT_EQ(0xdeadbeefc0cac01a, rops[2].value);
+}
+
 /**
  * @test    vfio_fpgaMapMMIO_err0
  * @brief   Test: vfio_fpgaMapMMIO()
@@ -3105,6 +3371,559 @@ TEST(opae_v, release_buffer_err0)
   EXPECT_EQ(FPGA_NOT_FOUND, vfio_fpgaReleaseBuffer(&handle, (uint64_t)&binfo));
 }
 
+/**
+ * @test    buffer_pool_ok
+ * @brief   Test: vfio_fpgaPrepareBuffer(), vfio_fpgaReleaseBuffer()
+ * @details When the handle has a buffer pool,<br>
+ *          vfio_fpgaReleaseBuffer() keeps the buffer in the<br>
+ *          pool, and vfio_fpgaPrepareBuffer() of the same size<br>
+ *          class returns it without touching the device.
+ */
+TEST(opae_v, buffer_pool_ok)
+{
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  handle.pool = vfio_buffer_pool_create(VFIO_POOL_DEFAULT_MAX);
+  ASSERT_NE(handle.pool, nullptr);
+
+  uint8_t page[4096];
+  struct opae_vfio_buffer binfo;
+  memset(&binfo, 0, sizeof(binfo));
+  binfo.buffer_ptr = page;
+  binfo.buffer_size = sizeof(page);
+  binfo.buffer_iova = 0x10000;
+
+  fpga_buffer_pool_stats stats;
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, (uint64_t)&binfo));
+  EXPECT_EQ(FPGA_OK, vfio_fpgaPrepareBuffer(&handle, 64, &buf_addr, &wsid, 0));
+  EXPECT_EQ(page, buf_addr);
+  EXPECT_EQ((uint64_t)&binfo, wsid);
+
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetBufferPoolStats(&handle, &stats));
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(0, stats.misses);
+  EXPECT_EQ(1, stats.recycled);
+  EXPECT_EQ(0, stats.pooled_buffers);
+  EXPECT_EQ(0, stats.pooled_bytes);
+
+  // A 2 MiB request doesn't match the pooled 4 KiB buffer,
+  // so it reaches the (missing) device.
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, (uint64_t)&binfo));
+  EXPECT_EQ(FPGA_EXCEPTION, vfio_fpgaPrepareBuffer(&handle, 8192, &buf_addr,
+                                                   &wsid, 0));
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetBufferPoolStats(&handle, &stats));
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(1, stats.pooled_buffers);
+  EXPECT_EQ(4096, stats.pooled_bytes);
+
+  vfio_buffer_pool_destroy(handle.pool);
+}
+
+/**
+ * @test    buffer_pool_err0
+ * @brief   Test: vfio_fpgaReleaseBuffer(), vfio_fpgaGetBufferPoolStats()
+ * @details Pre-allocated buffers bypass the pool, and<br>
+ *          vfio_fpgaGetBufferPoolStats() returns<br>
+ *          FPGA_NOT_SUPPORTED for a handle without a pool.
+ */
+TEST(opae_v, buffer_pool_err0)
+{
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  fpga_buffer_pool_stats stats;
+  EXPECT_EQ(FPGA_INVALID_PARAM, vfio_fpgaGetBufferPoolStats(&handle, nullptr));
+  EXPECT_EQ(FPGA_NOT_SUPPORTED, vfio_fpgaGetBufferPoolStats(&handle, &stats));
+
+  handle.pool = vfio_buffer_pool_create(VFIO_POOL_DEFAULT_MAX);
+  ASSERT_NE(handle.pool, nullptr);
+
+  struct opae_vfio_buffer binfo;
+  memset(&binfo, 0, sizeof(binfo));
+  binfo.buffer_size = 4096;
+  binfo.flags = OPAE_VFIO_BUF_PREALLOCATED;
+
+  EXPECT_EQ(FPGA_NOT_FOUND, vfio_fpgaReleaseBuffer(&handle, (uint64_t)&binfo));
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetBufferPoolStats(&handle, &stats));
+  EXPECT_EQ(0, stats.recycled);
+  EXPECT_EQ(0, stats.pooled_buffers);
+
+  vfio_buffer_pool_destroy(handle.pool);
+}
+
+/**
+ * @test    numa_local
+ * @brief   Test: vfio_fpgaPrepareBufferEx()
+ * @details When FPGA_BUF_NUMA_LOCAL is given and the device<br>
+ *          reports a NUMA node, the pool is bypassed so that<br>
+ *          the buffer is allocated (and bound) on that node.<br>
+ *          Without a known node, the pool is used as usual.<br>
+ *          Nodes that don't exist give FPGA_INVALID_PARAM.
+ */
+TEST(opae_v, numa_local)
+{
+  vfio_pci_device_t device;
+  memset(&device, 0, sizeof(device));
+  device.numa_node = 0;
+
+  vfio_token token;
+  memset(&token, 0, sizeof(token));
+  token.device = &device;
+
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  handle.token = &token;
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  handle.pool = vfio_buffer_pool_create(VFIO_POOL_DEFAULT_MAX);
+  ASSERT_NE(handle.pool, nullptr);
+
+  uint8_t page[4096];
+  struct opae_vfio_buffer binfo;
+  memset(&binfo, 0, sizeof(binfo));
+  binfo.buffer_ptr = page;
+  binfo.buffer_size = sizeof(page);
+
+  fpga_buffer_pool_stats stats;
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, (uint64_t)&binfo));
+
+  // The (missing) device can't provide node-local memory.
+  EXPECT_EQ(FPGA_NO_MEMORY, vfio_fpgaPrepareBuffer(&handle, 64, &buf_addr,
+                                                   &wsid, FPGA_BUF_NUMA_LOCAL));
+  EXPECT_EQ(FPGA_NO_MEMORY, vfio_fpgaPrepareBufferEx(&handle, 64, &buf_addr,
+                                                     &wsid, 0, 0));
+
+  // Nodes that don't exist are rejected before allocating.
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBufferEx(&handle, 64, &buf_addr, &wsid, 0, -2));
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBufferEx(&handle, 64, &buf_addr, &wsid, 0,
+                                     mem_bind_num_nodes()));
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBufferEx(&handle, 64, &buf_addr, &wsid, 0,
+                                     INT_MAX));
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetBufferPoolStats(&handle, &stats));
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(1, stats.pooled_buffers);
+
+  device.numa_node = INVALID_NUMA_NODE;
+  EXPECT_EQ(FPGA_OK, vfio_fpgaPrepareBuffer(&handle, 64, &buf_addr,
+                                            &wsid, FPGA_BUF_NUMA_LOCAL));
+  EXPECT_EQ(page, buf_addr);
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetBufferPoolStats(&handle, &stats));
+  EXPECT_EQ(1, stats.hits);
+
+  vfio_buffer_pool_destroy(handle.pool);
+}
+
+/**
+ * @test    prepare_buffer_sg_err0
+ * @brief   Test: vfio_fpgaPrepareBufferSG()
+ * @details Invalid lengths, segment counts and flags return<br>
+ *          FPGA_INVALID_PARAM. When no piece of the range<br>
+ *          can be mapped (the "device" member of the vfio_pair<br>
+ *          is NULL), the function returns FPGA_NO_MEMORY<br>
+ *          and leaves nothing mapped.
+ */
+TEST(opae_v, prepare_buffer_sg_err0)
+{
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+  handle.sg_map = vfio_sg_map;
+  handle.sg_unmap = vfio_sg_unmap;
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  uint8_t *heap = (uint8_t *)aligned_alloc(4096, 4 * 4096);
+  ASSERT_NE(nullptr, heap);
+  fpga_sg_entry sg[4];
+  uint32_t num_sg = 0;
+  uint64_t wsid = 0;
+
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBufferSG(&handle, heap, 4096, &wsid,
+                                     sg, &num_sg, 0));
+  num_sg = 4;
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBufferSG(&handle, heap, 0, &wsid,
+                                     sg, &num_sg, 0));
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBufferSG(&handle, heap, 4096, &wsid,
+                                     sg, &num_sg, FPGA_BUF_SLAB));
+  EXPECT_EQ(FPGA_NO_MEMORY,
+            vfio_fpgaPrepareBufferSG(&handle, heap + 100, 3 * 4096, &wsid,
+                                     sg, &num_sg, FPGA_BUF_QUIET));
+  EXPECT_EQ(4, num_sg);
+  EXPECT_EQ(nullptr, handle.sg_segs);
+  EXPECT_EQ(nullptr, handle.sg_buffers);
+
+  free(heap);
+}
+
+// vaddr -> IOVA of each live test mapping.
+static std::map<uint8_t *, uint64_t> sg_test_maps;
+static int sg_test_map_calls;
+
+static int sg_test_map(void *context, uint8_t *vaddr,
+                       size_t size, uint64_t *iova)
+{
+  (void) context;
+  (void) size;
+  // libopaevfio keys mappings by vaddr.
+  if (sg_test_maps.count(vaddr))
+    return 1;
+  *iova = 0x80000000 + 0x100000 * ++sg_test_map_calls;
+  sg_test_maps[vaddr] = *iova;
+  return 0;
+}
+
+static int sg_test_unmap(void *context, uint8_t *vaddr)
+{
+  (void) context;
+  return sg_test_maps.erase(vaddr) ? 0 : 1;
+}
+
+/**
+ * @test    prepare_buffer_sg_shared
+ * @brief   Test: vfio_fpgaPrepareBufferSG(), vfio_fpgaReleaseBuffer()
+ * @details Two sub-page buffers within one page share that<br>
+ *          page's mapping, which stays mapped until both are<br>
+ *          released, in either order. A buffer that starts<br>
+ *          in a shared page maps only the pages after it.
+ */
+TEST(opae_v, prepare_buffer_sg_shared)
+{
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  handle.sg_map = sg_test_map;
+  handle.sg_unmap = sg_test_unmap;
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  uint8_t *heap = (uint8_t *)aligned_alloc(4096, 2 * 4096);
+  ASSERT_NE(nullptr, heap);
+  sg_test_maps.clear();
+  sg_test_map_calls = 0;
+
+  for (int order = 0 ; order < 2 ; ++order) {
+    fpga_sg_entry sg_a[2];
+    fpga_sg_entry sg_b[2];
+    uint32_t num_a = 2;
+    uint32_t num_b = 2;
+    uint64_t wsid_a = 0;
+    uint64_t wsid_b = 0;
+
+    ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBufferSG(&handle, heap + 100, 1000,
+                                                &wsid_a, sg_a, &num_a, 0));
+    ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBufferSG(&handle, heap + 1100, 1000,
+                                                &wsid_b, sg_b, &num_b, 0));
+    ASSERT_EQ(1, sg_test_maps.size());
+    uint64_t page_iova = sg_test_maps[heap];
+
+    EXPECT_EQ(1, num_a);
+    EXPECT_EQ(page_iova + 100, sg_a[0].iova);
+    EXPECT_EQ(1000, sg_a[0].len);
+    EXPECT_EQ(1, num_b);
+    EXPECT_EQ(page_iova + 1100, sg_b[0].iova);
+    EXPECT_EQ(1000, sg_b[0].len);
+
+    uint64_t first = order ? wsid_b : wsid_a;
+    uint64_t second = order ? wsid_a : wsid_b;
+
+    EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, first));
+    ASSERT_EQ(1, sg_test_maps.count(heap));
+    EXPECT_EQ(page_iova, sg_test_maps[heap]);
+    EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, second));
+    EXPECT_EQ(0, sg_test_maps.size());
+    EXPECT_EQ(nullptr, handle.sg_segs);
+    EXPECT_EQ(nullptr, handle.sg_buffers);
+  }
+
+  // A pinned whole page, and a buffer straddling it and the next.
+  fpga_sg_entry sg_a[2];
+  fpga_sg_entry sg_b[2];
+  uint32_t num_a = 2;
+  uint32_t num_b = 2;
+  uint64_t wsid_a = 0;
+  uint64_t wsid_b = 0;
+
+  ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBufferSG(&handle, heap, 4096,
+                                              &wsid_a, sg_a, &num_a, 0));
+  ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBufferSG(&handle, heap + 4000, 200,
+                                              &wsid_b, sg_b, &num_b, 0));
+  ASSERT_EQ(2, num_b);
+  EXPECT_EQ(sg_test_maps[heap] + 4000, sg_b[0].iova);
+  EXPECT_EQ(96, sg_b[0].len);
+  EXPECT_EQ(sg_test_maps[heap + 4096], sg_b[1].iova);
+  EXPECT_EQ(104, sg_b[1].len);
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, wsid_a));
+  EXPECT_EQ(2, sg_test_maps.size());
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, wsid_b));
+  EXPECT_EQ(0, sg_test_maps.size());
+
+  free(heap);
+}
+
+/**
+ * @test    close_sg_buffers
+ * @brief   Test: vfio_fpgaClose()
+ * @details SG buffers that are still prepared when the handle<br>
+ *          is closed are freed along with it.
+ */
+TEST(opae_v, close_sg_buffers)
+{
+  vfio_handle *h = (vfio_handle *)opae_calloc(1, sizeof(*h));
+  ASSERT_NE(nullptr, h);
+  h->magic = VFIO_HANDLE_MAGIC;
+  h->lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  h->sg_map = sg_test_map;
+  h->sg_unmap = sg_test_unmap;
+  h->vfio_pair = (vfio_pair_t *)opae_calloc(1, sizeof(vfio_pair_t));
+  ASSERT_NE(nullptr, h->vfio_pair);
+
+  uint8_t *heap = (uint8_t *)aligned_alloc(4096, 4096);
+  ASSERT_NE(nullptr, heap);
+  sg_test_maps.clear();
+
+  fpga_sg_entry sg[1];
+  uint32_t num_sg = 1;
+  uint64_t wsid = 0;
+
+  ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBufferSG(h, heap + 100, 1000,
+                                              &wsid, sg, &num_sg, 0));
+  num_sg = 1;
+  ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBufferSG(h, heap + 1100, 1000,
+                                              &wsid, sg, &num_sg, 0));
+  EXPECT_NE(nullptr, h->sg_buffers);
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaClose(h));
+
+  free(heap);
+}
+
+/**
+ * @test    prepare_stats
+ * @brief   Test: vfio_fpgaGetBufferPrepareStats()
+ * @details The statistics are those kept by libopaevfio for<br>
+ *          the handle's device. A NULL stats pointer returns<br>
+ *          FPGA_INVALID_PARAM.
+ */
+TEST(opae_v, prepare_stats)
+{
+  struct opae_vfio v;
+  memset(&v, 0, sizeof(v));
+  v.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  v.buffer_stats.buffers = 3;
+  v.buffer_stats.bytes = 3 * 2048 * 1024;
+  v.buffer_stats.prefaulted = 2;
+  v.buffer_stats.alloc_ns = 100;
+  v.buffer_stats.prefault_ns = 200;
+  v.buffer_stats.map_ns = 300;
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  pair.device = &v;
+
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  handle.vfio_pair = &pair;
+
+  fpga_buffer_prepare_stats stats;
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaGetBufferPrepareStats(&handle, nullptr));
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetBufferPrepareStats(&handle, &stats));
+  EXPECT_EQ(3, stats.buffers);
+  EXPECT_EQ(3 * 2048 * 1024, stats.bytes);
+  EXPECT_EQ(2, stats.prefaulted);
+  EXPECT_EQ(100, stats.alloc_ns);
+  EXPECT_EQ(200, stats.prefault_ns);
+  EXPECT_EQ(300, stats.map_ns);
+}
+
+static void drain_test_reap(void *context, struct mem_reaper_entry *batch)
+{
+  int *count = (int *)context;
+  while (batch) {
+    struct mem_reaper_entry *next = batch->next;
+    ++*count;
+    free(batch->vaddr);
+    batch = next;
+  }
+}
+
+/**
+ * @test    drain_releases
+ * @brief   Test: vfio_fpgaDrainBufferReleases()
+ * @details When buffers are queued on the device's reaper,<br>
+ *          vfio_fpgaDrainBufferReleases returns FPGA_OK only<br>
+ *          after each of them has been released.
+ */
+TEST(opae_v, drain_releases)
+{
+  int count = 0;
+  struct opae_vfio v;
+  memset(&v, 0, sizeof(v));
+  v.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  ASSERT_EQ(0, mem_reaper_init(&v.reaper, drain_test_reap, &count));
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  pair.device = &v;
+
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  handle.vfio_pair = &pair;
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaDrainBufferReleases(&handle));
+
+  for (int i = 0 ; i < 4 ; ++i) {
+    ASSERT_EQ(0, mem_reaper_put(&v.reaper, malloc(64),
+                                0x1000 * i, 64, nullptr));
+  }
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaDrainBufferReleases(&handle));
+  EXPECT_EQ(4, count);
+  EXPECT_EQ(0, mem_reaper_pending(&v.reaper));
+
+  mem_reaper_destroy(&v.reaper);
+}
+
+static int slab_test_map(void *context, uint64_t size,
+                         void **vaddr, uint64_t *iova)
+{
+  (void) context;
+  *vaddr = aligned_alloc(4096, size);
+  *iova = 0x80000000;
+  return *vaddr ? 0 : 1;
+}
+
+static void slab_test_unmap(void *context, void *vaddr,
+                            uint64_t iova, uint64_t size)
+{
+  (void) context;
+  (void) iova;
+  (void) size;
+  free(vaddr);
+}
+
+/**
+ * @test    slab_ok
+ * @brief   Test: vfio_fpgaPrepareBuffer(), vfio_fpgaReleaseBuffer()
+ * @details When FPGA_BUF_SLAB is given,<br>
+ *          buffers are carved from one shared region,<br>
+ *          each with its own wsid and IO address.
+ */
+TEST(opae_v, slab_ok)
+{
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  mem_slab_init(&handle.slab, slab_test_map, slab_test_unmap, nullptr);
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  void *a = nullptr;
+  void *b = nullptr;
+  uint64_t wsid_a = 0;
+  uint64_t wsid_b = 0;
+  uint64_t iova = 0;
+
+  ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBuffer(&handle, 4096, &a,
+                                            &wsid_a, FPGA_BUF_SLAB));
+  ASSERT_EQ(FPGA_OK, vfio_fpgaPrepareBuffer(&handle, 8192, &b,
+                                            &wsid_b, FPGA_BUF_SLAB));
+  EXPECT_NE(wsid_a, wsid_b);
+  EXPECT_EQ(MEM_SLAB_SMALL_REGION, handle.slab.pinned);
+
+  ASSERT_EQ(FPGA_OK, vfio_fpgaGetIOAddress(&handle, wsid_b, &iova));
+  EXPECT_EQ(0x80000000 + ((uint8_t *)b - handle.slab.regions->vaddr), iova);
+
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, wsid_a));
+  EXPECT_EQ(FPGA_OK, vfio_fpgaReleaseBuffer(&handle, wsid_b));
+  EXPECT_EQ(nullptr, handle.slab_buffers);
+
+  mem_slab_destroy(&handle.slab);
+}
+
+/**
+ * @test    slab_err0
+ * @brief   Test: vfio_fpgaPrepareBuffer(), vfio_fpgaReleaseBuffer()
+ * @details FPGA_BUF_SLAB can't be combined with<br>
+ *          FPGA_BUF_PREALLOCATED, and releasing a slab buffer<br>
+ *          that the slab doesn't own returns FPGA_NOT_FOUND.
+ */
+TEST(opae_v, slab_err0)
+{
+  vfio_handle handle;
+  memset(&handle, 0, sizeof(handle));
+  handle.magic = VFIO_HANDLE_MAGIC;
+  handle.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+  mem_slab_init(&handle.slab, slab_test_map, slab_test_unmap, nullptr);
+
+  vfio_pair_t pair;
+  memset(&pair, 0, sizeof(pair));
+  handle.vfio_pair = &pair;
+
+  uint8_t page[4096];
+  void *buf_addr = page;
+  uint64_t wsid = 0;
+
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            vfio_fpgaPrepareBuffer(&handle, sizeof(page), &buf_addr, &wsid,
+                                   FPGA_BUF_SLAB|FPGA_BUF_PREALLOCATED));
+
+  vfio_slab_buffer *sb = (vfio_slab_buffer *)opae_calloc(1, sizeof(*sb));
+  ASSERT_NE(nullptr, sb);
+  sb->binfo.buffer_ptr = page;
+  sb->binfo.flags = OPAE_VFIO_BUF_SLAB;
+
+  EXPECT_EQ(FPGA_NOT_FOUND, vfio_fpgaReleaseBuffer(&handle, (uint64_t)sb));
+
+  opae_free(sb);
+  mem_slab_destroy(&handle.slab);
+}
+
 /**
  * @test    get_io_addr_ok
  * @brief   Test: vfio_fpgaGetIOAddress()
@@ -62,6 +62,17 @@ fpga_result vfio_fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
                                 uint64_t offset, uint32_t *value);
 fpga_result vfio_fpgaWriteMMIO512(fpga_handle handle, uint32_t mmio_num,
                                   uint64_t offset, const void *value);
+fpga_result vfio_fpgaReadMMIO512(fpga_handle handle, uint32_t mmio_num,
+                                 uint64_t offset, void *value);
+fpga_result vfio_fpgaCopyToMMIO(fpga_handle handle, uint32_t mmio_num,
+                                uint64_t offset, const void *src, uint64_t len);
+fpga_result vfio_fpgaCopyFromMMIO(fpga_handle handle, uint32_t mmio_num,
+                                  uint64_t offset, void *dst, uint64_t len);
+fpga_result vfio_fpgaReadMMIOBatch(fpga_handle handle, fpga_mmio_op *ops,
+                                   uint32_t num_ops);
+fpga_result vfio_fpgaWriteMMIOBatch(fpga_handle handle,
+                                    const fpga_mmio_op *ops,
+                                    uint32_t num_ops);
 fpga_result vfio_fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
                              uint64_t **mmio_ptr);
 fpga_result vfio_fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num);
@@ -75,10 +86,28 @@ fpga_result vfio_fpgaPrepareBuffer(fpga_handle handle,
                                    void **buf_addr,
                                    uint64_t *wsid,
                                    int flags);
+fpga_result vfio_fpgaPrepareBufferEx(fpga_handle handle,
+                                     uint64_t len,
+                                     void **buf_addr,
+                                     uint64_t *wsid,
+                                     int flags,
+                                     int numa_node);
+fpga_result vfio_fpgaPrepareBufferSG(fpga_handle handle,
+                                     void *buf_addr,
+                                     uint64_t len,
+                                     uint64_t *wsid,
+                                     fpga_sg_entry *sg,
+                                     uint32_t *num_sg,
+                                     int flags);
 fpga_result vfio_fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid);
+fpga_result vfio_fpgaDrainBufferReleases(fpga_handle handle);
 fpga_result vfio_fpgaGetIOAddress(fpga_handle handle,
                                   uint64_t wsid,
                                   uint64_t *ioaddr);
+fpga_result vfio_fpgaGetBufferPoolStats(fpga_handle handle,
+                                        fpga_buffer_pool_stats *stats);
+fpga_result vfio_fpgaGetBufferPrepareStats(fpga_handle handle,
+                                           fpga_buffer_prepare_stats *stats);
 fpga_result vfio_fpgaCreateEventHandle(fpga_event_handle *event_handle);
 fpga_result vfio_fpgaDestroyEventHandle(fpga_event_handle *event_handle);
 fpga_result vfio_fpgaGetOSObjectFromEventHandle(const fpga_event_handle eh,
@@ -160,14 +189,24 @@ TEST(opae_v, vfio_plugin_config)
   EXPECT_EQ(vfio_fpgaWriteMMIO32, adapter.fpgaWriteMMIO32);
   EXPECT_EQ(vfio_fpgaReadMMIO32, adapter.fpgaReadMMIO32);
   EXPECT_EQ(vfio_fpgaWriteMMIO512, adapter.fpgaWriteMMIO512);
+  EXPECT_EQ(vfio_fpgaReadMMIO512, adapter.fpgaReadMMIO512);
+  EXPECT_EQ(vfio_fpgaReadMMIOBatch, adapter.fpgaReadMMIOBatch);
+  EXPECT_EQ(vfio_fpgaWriteMMIOBatch, adapter.fpgaWriteMMIOBatch);
+  EXPECT_EQ(vfio_fpgaCopyToMMIO, adapter.fpgaCopyToMMIO);
+  EXPECT_EQ(vfio_fpgaCopyFromMMIO, adapter.fpgaCopyFromMMIO);
   EXPECT_EQ(vfio_fpgaMapMMIO, adapter.fpgaMapMMIO);
   EXPECT_EQ(vfio_fpgaUnmapMMIO, adapter.fpgaUnmapMMIO);
   EXPECT_EQ(vfio_fpgaEnumerate, adapter.fpgaEnumerate);
   EXPECT_EQ(vfio_fpgaCloneToken, adapter.fpgaCloneToken);
   EXPECT_EQ(vfio_fpgaDestroyToken, adapter.fpgaDestroyToken);
   EXPECT_EQ(vfio_fpgaPrepareBuffer, adapter.fpgaPrepareBuffer);
+  EXPECT_EQ(vfio_fpgaPrepareBufferEx, adapter.fpgaPrepareBufferEx);
+  EXPECT_EQ(vfio_fpgaPrepareBufferSG, adapter.fpgaPrepareBufferSG);
   EXPECT_EQ(vfio_fpgaReleaseBuffer, adapter.fpgaReleaseBuffer);
+  EXPECT_EQ(vfio_fpgaDrainBufferReleases, adapter.fpgaDrainBufferReleases);
   EXPECT_EQ(vfio_fpgaGetIOAddress, adapter.fpgaGetIOAddress);
+  EXPECT_EQ(vfio_fpgaGetBufferPoolStats, adapter.fpgaGetBufferPoolStats);
+  EXPECT_EQ(vfio_fpgaGetBufferPrepareStats, adapter.fpgaGetBufferPrepareStats);
   EXPECT_EQ(vfio_fpgaCreateEventHandle, adapter.fpgaCreateEventHandle);
   EXPECT_EQ(vfio_fpgaDestroyEventHandle, adapter.fpgaDestroyEventHandle);
   EXPECT_EQ(vfio_fpgaGetOSObjectFromEventHandle, adapter.fpgaGetOSObjectFromEventHandle);
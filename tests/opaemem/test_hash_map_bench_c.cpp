@@ -0,0 +1,151 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <chrono>
+#include <cstdio>
+
+#include "gtest/gtest.h"
+
+#include <opae/hash_map.h>
+
+/*
+ * Compares the chained and open addressing hash maps on page-aligned
+ * u64 keys, as used by libopaevfio's buffer map. The chained map is
+ * initialized with libopaevfio's former bucket count, so that it is
+ * measured as it was deployed. The open addressing map grows with its
+ * contents, so its lookup cost should stay flat from 1k to 100k items.
+ */
+
+static const uint32_t CHAINED_BUCKETS = 19441;
+static const uint32_t BENCH_ITEMS[] = { 1000, 10000, 100000 };
+static const size_t BENCH_COUNTS = sizeof(BENCH_ITEMS) / sizeof(BENCH_ITEMS[0]);
+
+static double ns_per(std::chrono::steady_clock::time_point start,
+                     uint64_t ops)
+{
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+// Fill a map with n items, look up random keys, then empty it. Returns the
+// best of several runs of the lookups, in ns per opae_hash_map_find call.
+static double hash_map_bench_run(const char *name, int flags,
+                                 uint32_t num_buckets, uint32_t n)
+{
+  const uint64_t lookups = 200000;
+  uint64_t seed = 0x9e3779b97f4a7c15;
+  uint64_t misses = 0;
+  uint64_t key;
+  uint64_t i;
+  void *value = nullptr;
+  double find_ns = 0.0;
+  opae_hash_map hm;
+
+  EXPECT_EQ(FPGA_OK, opae_hash_map_init(&hm, num_buckets, 0,
+                                        flags | OPAE_HASH_MAP_UNIQUE_KEYSPACE,
+                                        opae_u64_key_hash,
+                                        opae_u64_key_compare,
+                                        nullptr, nullptr));
+
+  auto start = std::chrono::steady_clock::now();
+  for (i = 0 ; i < n ; ++i) {
+    EXPECT_EQ(FPGA_OK, opae_hash_map_add(&hm, (void *)(i << 12),
+                                         (void *)(i + 1)));
+  }
+  double add_ns = ns_per(start, n);
+
+  for (int run = 0 ; run < 5 ; ++run) {
+    start = std::chrono::steady_clock::now();
+    for (i = 0 ; i < lookups ; ++i) {
+      seed = seed * 6364136223846793005 + 1442695040888963407;
+      key = (seed >> 20) % n;
+      if ((opae_hash_map_find(&hm, (void *)(key << 12), &value) != FPGA_OK) ||
+          ((uint64_t)value != key + 1))
+        ++misses;
+    }
+    double ns = ns_per(start, lookups);
+    if (!run || ns < find_ns)
+      find_ns = ns;
+  }
+  EXPECT_EQ(0u, misses);
+
+  EXPECT_EQ(FPGA_NOT_FOUND, opae_hash_map_find(&hm, (void *)((uint64_t)n << 12),
+                                               &value));
+
+  start = std::chrono::steady_clock::now();
+  for (i = 0 ; i < n ; ++i) {
+    EXPECT_EQ(FPGA_OK, opae_hash_map_remove(&hm, (void *)(i << 12)));
+  }
+  double remove_ns = ns_per(start, n);
+
+  EXPECT_TRUE(opae_hash_map_is_empty(&hm));
+  EXPECT_EQ(FPGA_OK, opae_hash_map_destroy(&hm));
+
+  printf("%-8s items %7u: add %7.1f ns/op, find %7.1f ns/op, "
+         "remove %7.1f ns/op\n",
+         name, n, add_ns, find_ns, remove_ns);
+
+  return find_ns;
+}
+
+/**
+ * @test       chained
+ * @brief      Benchmark: opae_hash_map_add, opae_hash_map_find,
+ *             opae_hash_map_remove
+ * @details    Report the average cost of each call for the chained<br>
+ *             hash map holding increasing numbers of items, checking<br>
+ *             that every lookup finds its value.<br>
+ */
+TEST(hash_map_bench, chained) {
+  for (size_t c = 0 ; c < BENCH_COUNTS ; ++c)
+    hash_map_bench_run("chained", 0, CHAINED_BUCKETS, BENCH_ITEMS[c]);
+}
+
+/**
+ * @test       open
+ * @brief      Benchmark: opae_hash_map_add, opae_hash_map_find,
+ *             opae_hash_map_remove
+ * @details    Report the average cost of each call for the open<br>
+ *             addressing hash map, starting from a small table that<br>
+ *             must grow, and check that the lookup cost at the largest<br>
+ *             item count stays within a generous factor of the cost at<br>
+ *             the smallest.<br>
+ */
+TEST(hash_map_bench, open) {
+  double find_ns[BENCH_COUNTS];
+
+  for (size_t c = 0 ; c < BENCH_COUNTS ; ++c)
+    find_ns[c] = hash_map_bench_run("open", OPAE_HASH_MAP_OPEN_ADDRESSING,
+                                    1024, BENCH_ITEMS[c]);
+
+  // Probe sequences that grew with the item count would cost 100x more.
+  EXPECT_LT(find_ns[BENCH_COUNTS - 1], 4.0 * find_ns[0] + 50.0);
+}
@@ -0,0 +1,222 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "gtest/gtest.h"
+
+#include <opae/hash_map.h>
+
+static uint32_t cleanups;
+
+static void count_cleanup(void *value, void *context)
+{
+  (void) value;
+  (void) context;
+  ++cleanups;
+}
+
+// Sends every key to bucket 0, to exercise collisions.
+static uint32_t zero_key_hash(uint32_t num_buckets,
+                              uint32_t hash_seed,
+                              void *key)
+{
+  (void) num_buckets;
+  (void) hash_seed;
+  (void) key;
+  return 0;
+}
+
+static uint32_t bad_key_hash(uint32_t num_buckets,
+                             uint32_t hash_seed,
+                             void *key)
+{
+  (void) hash_seed;
+  (void) key;
+  return num_buckets;
+}
+
+class hash_map_f : public ::testing::TestWithParam<int> {
+ protected:
+  hash_map_f() {}
+
+  virtual void SetUp() override {
+    cleanups = 0;
+    ASSERT_EQ(FPGA_OK, opae_hash_map_init(&hm_, 13, 0, GetParam(),
+                                          opae_u64_key_hash,
+                                          opae_u64_key_compare,
+                                          nullptr, count_cleanup));
+  }
+
+  virtual void TearDown() override {
+    EXPECT_EQ(FPGA_OK, opae_hash_map_destroy(&hm_));
+  }
+
+  opae_hash_map hm_;
+};
+
+/**
+ * @test       add_find_remove
+ * @brief      Test: opae_hash_map_add, opae_hash_map_find,
+ *             opae_hash_map_remove
+ * @details    Page-aligned keys can be added well past the initial<br>
+ *             size, found, and removed, with value_cleanup called<br>
+ *             once per removed value.<br>
+ */
+TEST_P(hash_map_f, add_find_remove) {
+  const uint64_t n = 10000;
+  uint64_t i;
+  void *value = nullptr;
+
+  EXPECT_TRUE(opae_hash_map_is_empty(&hm_));
+
+  for (i = 0 ; i < n ; ++i) {
+    ASSERT_EQ(FPGA_OK, opae_hash_map_add(&hm_, (void *)(i << 12),
+                                         (void *)(i + 1)));
+  }
+  EXPECT_FALSE(opae_hash_map_is_empty(&hm_));
+
+  for (i = 0 ; i < n ; ++i) {
+    ASSERT_EQ(FPGA_OK, opae_hash_map_find(&hm_, (void *)(i << 12), &value));
+    EXPECT_EQ((void *)(i + 1), value);
+  }
+  EXPECT_EQ(FPGA_NOT_FOUND, opae_hash_map_find(&hm_, (void *)1, &value));
+
+  for (i = 0 ; i < n ; i += 2) {
+    ASSERT_EQ(FPGA_OK, opae_hash_map_remove(&hm_, (void *)(i << 12)));
+  }
+  EXPECT_EQ(n / 2, cleanups);
+
+  for (i = 0 ; i < n ; ++i) {
+    EXPECT_EQ((i & 1) ? FPGA_OK : FPGA_NOT_FOUND,
+              opae_hash_map_find(&hm_, (void *)(i << 12), nullptr));
+  }
+  EXPECT_EQ(FPGA_NOT_FOUND, opae_hash_map_remove(&hm_, (void *)0));
+
+  for (i = 1 ; i < n ; i += 2) {
+    ASSERT_EQ(FPGA_OK, opae_hash_map_remove(&hm_, (void *)(i << 12)));
+  }
+  EXPECT_EQ(n, cleanups);
+  EXPECT_TRUE(opae_hash_map_is_empty(&hm_));
+}
+
+/**
+ * @test       churn
+ * @brief      Test: opae_hash_map_add, opae_hash_map_remove
+ * @details    Repeatedly adding and removing keys leaves the map<br>
+ *             consistent, and destroy cleans up the remaining values.<br>
+ */
+TEST_P(hash_map_f, churn) {
+  uint64_t i;
+
+  for (i = 0 ; i < 100000 ; ++i) {
+    ASSERT_EQ(FPGA_OK, opae_hash_map_add(&hm_, (void *)i, (void *)i));
+    if (i >= 4) {
+      ASSERT_EQ(FPGA_OK, opae_hash_map_remove(&hm_, (void *)(i - 4)));
+    }
+  }
+
+  for (i = 100000 - 4 ; i < 100000 ; ++i) {
+    EXPECT_EQ(FPGA_OK, opae_hash_map_find(&hm_, (void *)i, nullptr));
+  }
+  EXPECT_EQ(100000 - 4, cleanups);
+}
+
+INSTANTIATE_TEST_SUITE_P(hash_map, hash_map_f,
+                         ::testing::Values(0,
+                                           OPAE_HASH_MAP_UNIQUE_KEYSPACE,
+                                           OPAE_HASH_MAP_OPEN_ADDRESSING,
+                                           OPAE_HASH_MAP_OPEN_ADDRESSING |
+                                           OPAE_HASH_MAP_UNIQUE_KEYSPACE));
+
+/**
+ * @test       replace
+ * @brief      Test: opae_hash_map_add
+ * @details    Without OPAE_HASH_MAP_UNIQUE_KEYSPACE, adding an existing<br>
+ *             key replaces its value, even when all keys collide.<br>
+ */
+TEST(hash_map, replace) {
+  int flags[] = { 0, OPAE_HASH_MAP_OPEN_ADDRESSING };
+  opae_hash_map hm;
+  void *value = nullptr;
+  uint64_t i;
+
+  for (int f : flags) {
+    cleanups = 0;
+    ASSERT_EQ(FPGA_OK, opae_hash_map_init(&hm, 4, 0, f,
+                                          zero_key_hash,
+                                          opae_u64_key_compare,
+                                          nullptr, count_cleanup));
+    for (i = 0 ; i < 10 ; ++i) {
+      ASSERT_EQ(FPGA_OK, opae_hash_map_add(&hm, (void *)i, (void *)i));
+    }
+    ASSERT_EQ(FPGA_OK, opae_hash_map_add(&hm, (void *)5, (void *)50));
+    EXPECT_EQ(1, cleanups);
+    ASSERT_EQ(FPGA_OK, opae_hash_map_find(&hm, (void *)5, &value));
+    EXPECT_EQ((void *)50, value);
+    ASSERT_EQ(FPGA_OK, opae_hash_map_find(&hm, (void *)9, &value));
+    EXPECT_EQ((void *)9, value);
+
+    EXPECT_EQ(FPGA_OK, opae_hash_map_destroy(&hm));
+    EXPECT_EQ(11, cleanups);
+  }
+}
+
+/**
+ * @test       err
+ * @brief      Test: opae_hash_map_init, opae_hash_map_add,
+ *             opae_hash_map_find
+ * @details    NULL parameters and out-of-range key hashes<br>
+ *             return FPGA_INVALID_PARAM.<br>
+ */
+TEST(hash_map, err) {
+  int flags[] = { 0, OPAE_HASH_MAP_OPEN_ADDRESSING };
+  opae_hash_map hm;
+
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            opae_hash_map_init(nullptr, 4, 0, 0, opae_u64_key_hash,
+                               opae_u64_key_compare, nullptr, nullptr));
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            opae_hash_map_init(&hm, 4, 0, 0, nullptr,
+                               opae_u64_key_compare, nullptr, nullptr));
+  EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_add(nullptr, nullptr, nullptr));
+  EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_find(nullptr, nullptr, nullptr));
+  EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_remove(nullptr, nullptr));
+  EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_destroy(nullptr));
+
+  for (int f : flags) {
+    ASSERT_EQ(FPGA_OK, opae_hash_map_init(&hm, 4, 0, f, bad_key_hash,
+                                          opae_u64_key_compare,
+                                          nullptr, nullptr));
+    EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_add(&hm, (void *)1, nullptr));
+    EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_find(&hm, (void *)1, nullptr));
+    EXPECT_EQ(FPGA_INVALID_PARAM, opae_hash_map_remove(&hm, (void *)1));
+    EXPECT_EQ(FPGA_OK, opae_hash_map_destroy(&hm));
+  }
+}
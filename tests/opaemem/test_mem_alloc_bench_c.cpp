@@ -0,0 +1,216 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <opae/mem_alloc.h>
+
+/*
+ * Measures the per-call cost of mem_alloc_get() and mem_alloc_put() as the
+ * number of live allocations grows. Every call should cost O(log n) in the
+ * number of tracked ranges, so the per-call cost should grow slowly from
+ * 1k to 100k live allocations.
+ */
+
+static const uint64_t BENCH_PAGE = 4096;
+static const uint64_t BENCH_BASE = UINT64_C(1) << 32;
+static const uint32_t BENCH_LIVE[] = { 1000, 10000, 100000 };
+static const size_t BENCH_COUNTS = sizeof(BENCH_LIVE) / sizeof(BENCH_LIVE[0]);
+
+class mem_alloc_bench {
+ public:
+  explicit mem_alloc_bench(uint32_t n) : n_(n), addrs_(n) {
+    mem_alloc_init(&m_);
+    EXPECT_EQ(mem_alloc_add_free(&m_, BENCH_BASE,
+                                 (uint64_t)n * 1024 * BENCH_PAGE), 0);
+  }
+
+  ~mem_alloc_bench() {
+    mem_alloc_destroy(&m_);
+  }
+
+  // Verify that every allocation was returned and coalesced.
+  void expect_empty() {
+    EXPECT_EQ(m_.allocated.next, &m_.allocated);
+    ASSERT_NE(m_.free.next, &m_.free);
+    EXPECT_EQ(m_.free.next->next, &m_.free);
+    EXPECT_EQ(m_.free.next->address, BENCH_BASE);
+  }
+
+  // Verify that the live allocations are aligned, inside the free space
+  // and don't overlap.
+  void expect_disjoint(const std::vector<uint64_t> &sizes) {
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    uint32_t i;
+
+    for (i = 0 ; i < n_ ; ++i)
+      ranges.push_back(std::make_pair(addrs_[i], sizes[i]));
+    std::sort(ranges.begin(), ranges.end());
+
+    for (i = 0 ; i < n_ ; ++i) {
+      ASSERT_EQ(0u, ranges[i].first % BENCH_PAGE);
+      ASSERT_GE(ranges[i].first, BENCH_BASE);
+      if (i) {
+        ASSERT_GE(ranges[i].first,
+                  ranges[i - 1].first + ranges[i - 1].second);
+      }
+    }
+    ASSERT_LE(ranges[n_ - 1].first + ranges[n_ - 1].second,
+              BENCH_BASE + (uint64_t)n_ * 1024 * BENCH_PAGE);
+  }
+
+  uint32_t n_;
+  struct mem_alloc m_;
+  std::vector<uint64_t> addrs_;
+};
+
+static double ns_per(std::chrono::steady_clock::time_point start,
+                     uint64_t ops)
+{
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+/**
+ * @test       pages
+ * @brief      Benchmark: mem_alloc_get, mem_alloc_put
+ * @details    For increasing numbers of pages, allocate every page,<br>
+ *             free every other one, refill the holes, then free<br>
+ *             everything, reporting the average cost of each phase.<br>
+ *             The allocations must not overlap, and the cost of a<br>
+ *             call at 100k live allocations must stay within a<br>
+ *             generous factor of its cost at 1k.<br>
+ */
+TEST(mem_alloc_bench, pages) {
+  double cost_ns[BENCH_COUNTS];
+
+  for (size_t c = 0 ; c < BENCH_COUNTS ; ++c) {
+    const uint32_t n = BENCH_LIVE[c];
+    mem_alloc_bench b(n);
+    std::vector<uint64_t> &addrs = b.addrs_;
+    uint32_t i;
+
+    auto start = std::chrono::steady_clock::now();
+    for (i = 0 ; i < n ; ++i) {
+      ASSERT_EQ(mem_alloc_get(&b.m_, &addrs[i], BENCH_PAGE), 0);
+    }
+    double get_ns = ns_per(start, n);
+
+    // Leave n / 2 single-page holes that can't coalesce.
+    start = std::chrono::steady_clock::now();
+    for (i = 0 ; i < n ; i += 2) {
+      ASSERT_EQ(mem_alloc_put(&b.m_, addrs[i]), 0);
+    }
+    double put_ns = ns_per(start, (n + 1) / 2);
+
+    start = std::chrono::steady_clock::now();
+    for (i = 0 ; i < n ; i += 2) {
+      ASSERT_EQ(mem_alloc_get(&b.m_, &addrs[i], BENCH_PAGE), 0);
+    }
+    double refill_ns = ns_per(start, (n + 1) / 2);
+
+    b.expect_disjoint(std::vector<uint64_t>(n, BENCH_PAGE));
+
+    start = std::chrono::steady_clock::now();
+    for (i = 0 ; i < n ; ++i) {
+      ASSERT_EQ(mem_alloc_put(&b.m_, addrs[i]), 0);
+    }
+    double drain_ns = ns_per(start, n);
+
+    b.expect_empty();
+
+    cost_ns[c] = (get_ns + put_ns + refill_ns + drain_ns) / 4.0;
+
+    printf("allocations %6u: get %7.1f ns/op, put %7.1f ns/op, "
+           "refill %7.1f ns/op, drain %7.1f ns/op\n",
+           n, get_ns, put_ns, refill_ns, drain_ns);
+  }
+
+  // A linear search of the ranges would cost 100x more here.
+  EXPECT_LT(cost_ns[BENCH_COUNTS - 1], 10.0 * cost_ns[0] + 500.0);
+}
+
+/**
+ * @test       mixed
+ * @brief      Benchmark: mem_alloc_get, mem_alloc_put
+ * @details    For increasing numbers of live allocations of 4K to 2M,<br>
+ *             replace them in pseudo-random order, reporting the<br>
+ *             average cost of a put/get pair. The allocations must not<br>
+ *             overlap, and the cost of a pair at 100k live allocations<br>
+ *             must stay within a generous factor of its cost at 1k.<br>
+ */
+TEST(mem_alloc_bench, mixed) {
+  const uint64_t rounds = 100000;
+  double pair_ns[BENCH_COUNTS];
+
+  for (size_t c = 0 ; c < BENCH_COUNTS ; ++c) {
+    const uint32_t n = BENCH_LIVE[c];
+    mem_alloc_bench b(n);
+    std::vector<uint64_t> &addrs = b.addrs_;
+    std::vector<uint64_t> sizes(n);
+    uint64_t seed = 0x9e3779b97f4a7c15;
+    uint64_t r;
+    uint32_t i;
+
+    for (i = 0 ; i < n ; ++i) {
+      seed = seed * 6364136223846793005 + 1442695040888963407;
+      sizes[i] = BENCH_PAGE << ((seed >> 40) % 10);
+      ASSERT_EQ(mem_alloc_get(&b.m_, &addrs[i], sizes[i]), 0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (r = 0 ; r < rounds ; ++r) {
+      seed = seed * 6364136223846793005 + 1442695040888963407;
+      i = (seed >> 20) % n;
+      sizes[i] = BENCH_PAGE << ((seed >> 40) % 10);
+      ASSERT_EQ(mem_alloc_put(&b.m_, addrs[i]), 0);
+      ASSERT_EQ(mem_alloc_get(&b.m_, &addrs[i], sizes[i]), 0);
+    }
+    pair_ns[c] = ns_per(start, rounds);
+
+    b.expect_disjoint(sizes);
+
+    for (i = 0 ; i < n ; ++i) {
+      ASSERT_EQ(mem_alloc_put(&b.m_, addrs[i]), 0);
+    }
+
+    b.expect_empty();
+
+    printf("allocations %6u: put+get %7.1f ns/pair\n", n, pair_ns[c]);
+  }
+
+  EXPECT_LT(pair_ns[BENCH_COUNTS - 1], 10.0 * pair_ns[0] + 500.0);
+}
@@ -32,11 +32,19 @@
 
 #include <opae/mem_alloc.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <vector>
+
 #define ALIGNED(__addr, __size) ((__addr + __size - 1) & ~(__size - 1))
 
 extern "C" {
 struct mem_link *mem_link_alloc(uint64_t address, uint64_t size);
-void mem_alloc_coalesce(struct mem_link *head, struct mem_link *l);
+struct mem_link *mem_tree_find(struct mem_link *root, uint64_t address);
+struct mem_link *mem_tree_floor(struct mem_link *root, uint64_t address);
+void mem_alloc_coalesce(struct mem_alloc *m, struct mem_link *l);
 int mem_alloc_allocate_node(struct mem_alloc *m,
                             struct mem_link *node,
                             uint64_t *address,
@@ -48,6 +56,91 @@ int mem_alloc_allocate_split_node(struct mem_alloc *m,
 				  uint64_t size);
 int mem_alloc_free_node(struct mem_alloc *m,
                         struct mem_link *node);
+struct mem_link *mem_alloc_find_fit(struct mem_alloc *m,
+                                    uint64_t size);
+}
+
+static int tree_check(const struct mem_link *n,
+                      std::vector<const struct mem_link *> &inorder)
+{
+  int l, r;
+
+  if (!n)
+    return 0;
+
+  l = tree_check(n->left, inorder);
+  inorder.push_back(n);
+  r = tree_check(n->right, inorder);
+
+  EXPECT_LE(std::abs(l - r), 1);
+  EXPECT_EQ(n->height, 1 + std::max(l, r));
+
+  return 1 + std::max(l, r);
+}
+
+static size_t list_check(const struct mem_link *head,
+                         const struct mem_link *root,
+                         bool sorted)
+{
+  std::vector<const struct mem_link *> inorder;
+  std::map<uint64_t, const struct mem_link *> listed;
+  const struct mem_link *p;
+
+  tree_check(root, inorder);
+
+  for (p = head->next ; p != head ; p = p->next) {
+    EXPECT_EQ(p->next->prev, p);
+    if (sorted && p->next != head) {
+      EXPECT_LT(p->address, p->next->address);
+    }
+    listed[p->address] = p;
+  }
+
+  // The tree and the list hold the same nodes.
+  EXPECT_EQ(inorder.size(), listed.size());
+  size_t i = 0;
+  for (auto &l : listed) {
+    if (i < inorder.size()) {
+      EXPECT_EQ(inorder[i], l.second);
+    }
+    ++i;
+  }
+
+  return listed.size();
+}
+
+/*
+ * Verify the invariants of m: each list matches its address tree, the
+ * trees are balanced, free ranges are sorted and fully coalesced, and
+ * every free range is in the size bin that matches its size.
+ */
+static void mem_alloc_check(struct mem_alloc *m)
+{
+  const struct mem_link *p;
+  size_t nfree = list_check(&m->free, m->free_root, true);
+  size_t nbinned = 0;
+  unsigned bin;
+
+  list_check(&m->allocated, m->allocated_root, false);
+
+  for (p = m->free.next ; p != &m->free ; p = p->next) {
+    if (p->next != &m->free) {
+      EXPECT_LT(p->address + p->size, p->next->address);
+    }
+  }
+
+  for (bin = 0 ; bin < MEM_ALLOC_BINS ; ++bin) {
+    EXPECT_EQ(m->free_bins[bin] != nullptr,
+              (m->bins_mask & (UINT64_C(1) << bin)) != 0);
+    for (p = m->free_bins[bin] ; p ; p = p->bin_next) {
+      EXPECT_EQ(bin, 63u - __builtin_clzll(p->size));
+      if (p->bin_next) {
+        EXPECT_EQ(p->bin_next->bin_prev, p);
+      }
+      ++nbinned;
+    }
+  }
+  EXPECT_EQ(nfree, nbinned);
 }
 
 /**
@@ -67,6 +160,10 @@ TEST(mem_alloc, init)
 
   EXPECT_EQ(m.allocated.prev, &m.allocated);
   EXPECT_EQ(m.allocated.next, &m.allocated);
+
+  EXPECT_EQ(m.free_root, nullptr);
+  EXPECT_EQ(m.allocated_root, nullptr);
+  EXPECT_EQ(m.bins_mask, 0);
 }
 
 /**
@@ -124,122 +221,136 @@ TEST(mem_alloc, link_alloc)
   EXPECT_EQ(link->size, size);
   EXPECT_EQ(link->prev, link);
   EXPECT_EQ(link->next, link);
+  EXPECT_EQ(link->left, nullptr);
+  EXPECT_EQ(link->right, nullptr);
+  EXPECT_EQ(link->height, 1);
 
   opae_free(link);
 }
 
+/**
+ * @test    tree_lookup
+ * @brief   Test: mem_tree_find(), mem_tree_floor()
+ * @details mem_tree_find() returns the node with the<br>
+ *          given address, and mem_tree_floor() the node<br>
+ *          with the greatest address not above it.
+ */
+TEST(mem_alloc, tree_lookup)
+{
+  struct mem_alloc allocator;
+  uint64_t i;
+
+  mem_alloc_init(&allocator);
+
+  for (i = 0 ; i < 100 ; ++i) {
+    ASSERT_EQ(mem_alloc_add_free(&allocator, (i * 37 % 100) * 8192, 4096), 0);
+  }
+  mem_alloc_check(&allocator);
+  EXPECT_LE(allocator.free_root->height, 9);
+
+  EXPECT_EQ(mem_tree_find(allocator.free_root, 4096), nullptr);
+  ASSERT_NE(mem_tree_find(allocator.free_root, 8192), nullptr);
+  EXPECT_EQ(mem_tree_find(allocator.free_root, 8192)->address, 8192);
+
+  EXPECT_EQ(mem_tree_floor(allocator.free_root, 8191)->address, 0);
+  EXPECT_EQ(mem_tree_floor(allocator.free_root, 8192)->address, 8192);
+  EXPECT_EQ(mem_tree_floor(allocator.free_root, ~UINT64_C(0))->address,
+            99 * 8192);
+
+  mem_alloc_destroy(&allocator);
+  EXPECT_EQ(mem_tree_floor(allocator.free_root, 8192), nullptr);
+}
+
 /**
  * @test    coalesce0
  * @brief   Test: mem_alloc_coalesce()
- * @details When the l (2nd) parameter<br>
- *          is equal to the head (1st)<br>
- *          parameter, the fn simply returns.
+ * @details When the given node has no adjacent<br>
+ *          neighbor in the free list, the fn<br>
+ *          leaves the node unchanged.
  */
 TEST(mem_alloc, coalesce0)
 {
-  const uint64_t addr = 1UL;
-  const uint64_t size = 2UL;
-  struct mem_link *link = mem_link_alloc(addr, size);
+  struct mem_alloc allocator;
+  struct mem_link *l;
 
-  ASSERT_NE(link, nullptr);
-  EXPECT_EQ(link->address, addr);
-  EXPECT_EQ(link->size, size);
-  EXPECT_EQ(link->prev, link);
-  EXPECT_EQ(link->next, link);
+  mem_alloc_init(&allocator);
 
-  mem_alloc_coalesce(link, link);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 1024), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 4096, 1024), 0);
 
-  EXPECT_EQ(link->address, addr);
-  EXPECT_EQ(link->size, size);
-  EXPECT_EQ(link->prev, link);
-  EXPECT_EQ(link->next, link);
+  l = allocator.free.next;
+  mem_alloc_coalesce(&allocator, l);
 
-  opae_free(link);
+  EXPECT_EQ(allocator.free.next, l);
+  EXPECT_EQ(l->address, 0);
+  EXPECT_EQ(l->size, 1024);
+  EXPECT_EQ(l->next->address, 4096);
+  EXPECT_EQ(l->next->size, 1024);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
 }
 
 /**
  * @test    coalesce1
  * @brief   Test: mem_alloc_coalesce()
- * @details When the node prior to the l<br>
- *          (2nd) parameter in the list is not<br>
- *          the list head, and when the prior node<br>
- *          meets the criteria for coalescing, the fn<br>
- *          coalesces the previous node into the l node.
+ * @details When a range is added directly after<br>
+ *          an existing free range, the new range<br>
+ *          is coalesced into the previous node.
  */
 TEST(mem_alloc, coalesce1)
 {
-  struct mem_link head;
-  struct mem_link *zero = mem_link_alloc(0, 1024);
-  struct mem_link *one = mem_link_alloc(1024, 1024);
-
-  ASSERT_NE(zero, nullptr);
-  ASSERT_NE(one, nullptr);
-
-  head.next = zero;
-  zero->prev = &head;
-  
-  zero->next = one;
-  one->prev = zero;
-
-  one->next = &head;
-  head.prev = one;
-
-  // head -> zero -> one
-  mem_alloc_coalesce(&head, one);
-
-  // head -> one
-  // (zero has been freed)
-  EXPECT_EQ(head.prev, one);
-  EXPECT_EQ(head.next, one);
-  EXPECT_EQ(one->prev, &head);
-  EXPECT_EQ(one->next, &head);
-  EXPECT_EQ(one->address, 0);
-  EXPECT_EQ(one->size, 2048);
-
-  opae_free(one);
+  struct mem_alloc allocator;
+  struct mem_link *zero;
+
+  mem_alloc_init(&allocator);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 1024), 0);
+  zero = allocator.free.next;
+
+  // head -> zero, then [1024, 2048) is merged into zero
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 1024, 1024), 0);
+
+  EXPECT_EQ(allocator.free.prev, zero);
+  EXPECT_EQ(allocator.free.next, zero);
+  EXPECT_EQ(zero->prev, &allocator.free);
+  EXPECT_EQ(zero->next, &allocator.free);
+  EXPECT_EQ(zero->address, 0);
+  EXPECT_EQ(zero->size, 2048);
+  EXPECT_EQ(allocator.free_root, zero);
+  EXPECT_EQ(allocator.free_bins[11], zero);
+  EXPECT_EQ(allocator.bins_mask, UINT64_C(1) << 11);
+
+  mem_alloc_destroy(&allocator);
 }
 
 /**
  * @test    coalesce2
  * @brief   Test: mem_alloc_coalesce()
- * @details When the node just after the l<br>
- *          (2nd) parameter in the list is not<br>
- *          the list head, and when the next node<br>
- *          meets the criteria for coalescing, the fn<br>
- *          coalesces l into the next node.
+ * @details When a range is added that fills the<br>
+ *          gap between two free ranges, all three<br>
+ *          are coalesced into a single node.
  */
 TEST(mem_alloc, coalesce2)
 {
-  struct mem_link head;
-  struct mem_link *zero = mem_link_alloc(0, 1024);
-  struct mem_link *one = mem_link_alloc(1024, 1024);
-
-  ASSERT_NE(zero, nullptr);
-  ASSERT_NE(one, nullptr);
-
-  head.next = zero;
-  zero->prev = &head;
-  
-  zero->next = one;
-  one->prev = zero;
-
-  one->next = &head;
-  head.prev = one;
-
-  // head -> zero -> one
-  mem_alloc_coalesce(&head, zero);
-
-  // head -> one
-  // (zero has been freed)
- 
-  EXPECT_EQ(head.prev, one);
-  EXPECT_EQ(head.next, one);
-  EXPECT_EQ(one->prev, &head);
-  EXPECT_EQ(one->next, &head);
-  EXPECT_EQ(one->address, 0);
-  EXPECT_EQ(one->size, 2048);
-
-  opae_free(one);
+  struct mem_alloc allocator;
+  struct mem_link *l;
+
+  mem_alloc_init(&allocator);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 2048, 1024), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 1024), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 1024, 1024), 0);
+
+  l = allocator.free.next;
+  EXPECT_EQ(allocator.free.prev, l);
+  EXPECT_EQ(l->next, &allocator.free);
+  EXPECT_EQ(l->address, 0);
+  EXPECT_EQ(l->size, 3072);
+  EXPECT_EQ(allocator.free_root, l);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -340,6 +451,30 @@ TEST(mem_alloc, add_free2)
   opae_free(l);
 }
 
+/**
+ * @test    add_free3
+ * @brief   Test: mem_alloc_add_free()
+ * @details Double-free's are detected for any<br>
+ *          range in the free list, not just the first.
+ */
+TEST(mem_alloc, add_free3)
+{
+  struct mem_alloc allocator;
+  const uint64_t size = 1024UL;
+
+  mem_alloc_init(&allocator);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 4096, size), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 8192, size), 0);
+
+  EXPECT_NE(mem_alloc_add_free(&allocator, 4096, size), 0);
+  EXPECT_NE(mem_alloc_add_free(&allocator, 8192, size), 0);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
+}
+
 /**
  * @test    allocate_node0
  * @brief   Test: mem_alloc_allocate_node()
@@ -529,45 +664,45 @@ TEST(mem_alloc, alloc_split_node1)
 /**
  * @test    get0
  * @brief   Test: mem_alloc_get()
- * @details The fn allocates from the free list<br>
- *          using a first fit algorithm.
+ * @details The fn allocates from the smallest<br>
+ *          free range that satisfies the request.
  */
 TEST(mem_alloc, get0)
 {
   struct mem_alloc allocator;
-  struct mem_link *l, *trash;
+  struct mem_link *l;
   const uint64_t size = 1024UL;
   uint64_t addr = 8192;
 
   mem_alloc_init(&allocator);
 
   EXPECT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
-  EXPECT_EQ(mem_alloc_add_free(&allocator, 2048, size), 0);
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 2048, 512), 0);
 
-  // address: 0, 1024, 2048
+  // address: 0, 1024, 2048, 2560
   //          x           x
 
   EXPECT_EQ(mem_alloc_get(&allocator, &addr, 512), 0);
-  EXPECT_EQ(addr, 0);
+  EXPECT_EQ(addr, 2048);
 
   l = allocator.free.next;
-  EXPECT_EQ(l->address, 512);
-  EXPECT_EQ(l->size, 512);
-
-  trash = l;
-  l = l->next;
-  opae_free(trash);
-
-  EXPECT_EQ(l->address, 2048);
+  EXPECT_EQ(l->address, 0);
   EXPECT_EQ(l->size, size);
+  EXPECT_EQ(l->next, &allocator.free);
 
-  opae_free(l);
   l = allocator.allocated.next;
+  EXPECT_EQ(l->address, 2048);
+  EXPECT_EQ(l->size, 512);
 
-  EXPECT_EQ(l->address, 0);
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, 512), 0);
+  EXPECT_EQ(addr, 0);
+
+  l = allocator.free.next;
+  EXPECT_EQ(l->address, 512);
   EXPECT_EQ(l->size, 512);
+  mem_alloc_check(&allocator);
 
-  opae_free(l);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -593,44 +728,165 @@ TEST(mem_alloc, get1)
   opae_free(allocator.free.next);
 }
 
+/**
+ * @test    get2
+ * @brief   Test: mem_alloc_get()
+ * @details The fn returns addresses aligned to the<br>
+ *          (power of two) request size, skipping ranges<br>
+ *          that are large enough only when unaligned.
+ */
+TEST(mem_alloc, get2)
+{
+  struct mem_alloc allocator;
+  const uint64_t fourK = 4096UL;
+  const uint64_t twoM = 2 * 1024UL * 1024UL;
+  uint64_t addr = 0;
+
+  mem_alloc_init(&allocator);
+
+  // Large enough, but not once aligned.
+  EXPECT_EQ(mem_alloc_add_free(&allocator, fourK, twoM), 0);
+  // Aligned and large enough.
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 8 * twoM, 4 * twoM), 0);
+
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, twoM), 0);
+  EXPECT_EQ(addr, 8 * twoM);
+
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, fourK), 0);
+  EXPECT_EQ(addr, fourK);
+
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, 2 * fourK), 0);
+  EXPECT_EQ(addr, 2 * fourK);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    get3
+ * @brief   Test: mem_alloc_get()
+ * @details When only ranges that are too short once<br>
+ *          aligned remain in the request's size bin,<br>
+ *          the fn still finds the one that fits.
+ */
+TEST(mem_alloc, get3)
+{
+  struct mem_alloc allocator;
+  const uint64_t fourK = 4096UL;
+  uint64_t addr = 0;
+  uint64_t i;
+
+  mem_alloc_init(&allocator);
+
+  // The only range that holds an aligned 8K block, placed
+  // behind more misaligned 8K ranges than a bin scan examines.
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0x1000000 + fourK,
+                               3 * fourK), 0);
+  for (i = 0 ; i < 64 ; ++i) {
+    EXPECT_EQ(mem_alloc_add_free(&allocator,
+                                 i * 16 * fourK + fourK,
+                                 2 * fourK), 0);
+  }
+
+  EXPECT_EQ(allocator.bins_mask, UINT64_C(1) << 13);
+  EXPECT_EQ(mem_alloc_get(&allocator, &addr, 2 * fourK), 0);
+  EXPECT_EQ(addr, 0x1000000 + 2 * fourK);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    find_fit
+ * @brief   Test: mem_alloc_find_fit()
+ * @details When the request's own size bin is empty,<br>
+ *          the fn returns a range from the next<br>
+ *          non-empty bin rather than a larger one.
+ */
+TEST(mem_alloc, find_fit)
+{
+  struct mem_alloc allocator;
+  struct mem_link *l;
+
+  mem_alloc_init(&allocator);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 1UL << 30, 1UL << 30), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 1UL << 24, 1UL << 20), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 16384), 0);
+
+  l = mem_alloc_find_fit(&allocator, 4096);
+  ASSERT_NE(l, nullptr);
+  EXPECT_EQ(l->address, 0);
+
+  l = mem_alloc_find_fit(&allocator, 32768);
+  ASSERT_NE(l, nullptr);
+  EXPECT_EQ(l->address, 1UL << 24);
+
+  // Not a power of two: 12K is binned with the 16K range.
+  l = mem_alloc_find_fit(&allocator, 12288);
+  ASSERT_NE(l, nullptr);
+  EXPECT_EQ(l->address, 0);
+
+  EXPECT_EQ(mem_alloc_find_fit(&allocator, 1UL << 31), nullptr);
+
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    get4
+ * @brief   Test: mem_alloc_get()
+ * @details A request for zero bytes is rejected.
+ */
+TEST(mem_alloc, get4)
+{
+  struct mem_alloc allocator;
+  uint64_t addr = 0;
+
+  mem_alloc_init(&allocator);
+
+  EXPECT_EQ(mem_alloc_add_free(&allocator, 0, 4096), 0);
+  EXPECT_NE(mem_alloc_get(&allocator, &addr, 0), 0);
+  EXPECT_EQ(allocator.allocated.next, &allocator.allocated);
+
+  mem_alloc_destroy(&allocator);
+}
+
 /**
  * @test    free_node
  * @brief   Test: mem_alloc_free_node()
  * @details When the allocated list contains the<br>
- *          target node, that node is freed, and<br>
- *          the address and size are added back<br>
- *          to the free list in a new node.
+ *          target node, that node is removed from<br>
+ *          the allocated list and recycled as a<br>
+ *          free list node.
  */
 TEST(mem_alloc, free_node)
 {
   struct mem_alloc allocator;
-  const uint64_t addr = 0;
   const uint64_t size = 1024;
-  struct mem_link *node = mem_link_alloc(addr, size);
-
-  ASSERT_NE(node, nullptr);
+  struct mem_link *node;
+  uint64_t addr = 8192;
 
   mem_alloc_init(&allocator);
 
-  allocator.allocated.next = node;
-  allocator.allocated.prev = node;
-  node->prev = &allocator.allocated;
-  node->next = &allocator.allocated;
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, size), 0);
+  ASSERT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
+  EXPECT_EQ(addr, 0);
 
+  node = allocator.allocated.next;
   EXPECT_EQ(mem_alloc_free_node(&allocator, node), 0);
   EXPECT_EQ(allocator.allocated.prev, &allocator.allocated);
   EXPECT_EQ(allocator.allocated.next, &allocator.allocated);
+  EXPECT_EQ(allocator.allocated_root, nullptr);
 
-  EXPECT_NE(allocator.free.prev, &allocator.free);
-  EXPECT_NE(allocator.free.next, &allocator.free);
-
-  node = allocator.free.next;
+  EXPECT_EQ(allocator.free.prev, node);
+  EXPECT_EQ(allocator.free.next, node);
   EXPECT_EQ(node->prev, &allocator.free);
   EXPECT_EQ(node->next, &allocator.free);
-  EXPECT_EQ(node->address, addr);
+  EXPECT_EQ(node->address, 0);
   EXPECT_EQ(node->size, size);
+  EXPECT_EQ(allocator.free_root, node);
 
-  opae_free(node);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -638,41 +894,42 @@ TEST(mem_alloc, free_node)
  * @brief   Test: mem_alloc_put()
  * @details When the allocated list contains the<br>
  *          target address, that node is freed, and<br>
- *          the address and size are added back<br>
- *          to the free list in a new node.
+ *          the address and size are coalesced back<br>
+ *          into the free list.
  */
 TEST(mem_alloc, put0)
 {
   struct mem_alloc allocator;
-  const uint64_t addr = 0;
   const uint64_t size = 1024;
-  struct mem_link *node = mem_link_alloc(addr, size);
-
-  ASSERT_NE(node, nullptr);
+  struct mem_link *node;
+  uint64_t addr[3];
+  int i;
 
   mem_alloc_init(&allocator);
 
-  allocator.allocated.next = node;
-  allocator.allocated.prev = node;
-  node->prev = &allocator.allocated;
-  node->next = &allocator.allocated;
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 3 * size), 0);
+  for (i = 0 ; i < 3 ; ++i) {
+    ASSERT_EQ(mem_alloc_get(&allocator, &addr[i], size), 0);
+  }
+  EXPECT_EQ(allocator.free.next, &allocator.free);
 
-  EXPECT_EQ(mem_alloc_put(&allocator, addr), 0);
+  EXPECT_EQ(mem_alloc_put(&allocator, addr[0]), 0);
+  EXPECT_EQ(mem_alloc_put(&allocator, addr[2]), 0);
+  mem_alloc_check(&allocator);
+  EXPECT_EQ(mem_alloc_put(&allocator, addr[1]), 0);
 
   EXPECT_EQ(allocator.allocated.prev, &allocator.allocated);
   EXPECT_EQ(allocator.allocated.next, &allocator.allocated);
 
-  EXPECT_NE(allocator.free.prev, &allocator.free);
-  EXPECT_NE(allocator.free.next, &allocator.free);
-
   node = allocator.free.next;
 
   EXPECT_EQ(node->prev, &allocator.free);
   EXPECT_EQ(node->next, &allocator.free);
-  EXPECT_EQ(node->address, addr);
-  EXPECT_EQ(node->size, size);
+  EXPECT_EQ(node->address, 0);
+  EXPECT_EQ(node->size, 3 * size);
+  mem_alloc_check(&allocator);
 
-  opae_free(node);
+  mem_alloc_destroy(&allocator);
 }
 
 /**
@@ -711,3 +968,135 @@ TEST(mem_alloc, put1)
 
   opae_free(node);
 }
+
+/**
+ * @test    put2
+ * @brief   Test: mem_alloc_put()
+ * @details An address can only be freed once.
+ */
+TEST(mem_alloc, put2)
+{
+  struct mem_alloc allocator;
+  uint64_t addr = 0;
+
+  mem_alloc_init(&allocator);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 8192), 0);
+  ASSERT_EQ(mem_alloc_get(&allocator, &addr, 4096), 0);
+
+  EXPECT_EQ(mem_alloc_put(&allocator, addr), 0);
+  EXPECT_NE(mem_alloc_put(&allocator, addr), 0);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    apply_constraint
+ * @brief   Test: mem_alloc_apply_constraint()
+ * @details After the call, the free list of the first<br>
+ *          allocator holds only the ranges that are also<br>
+ *          free in the constraint allocator.
+ */
+TEST(mem_alloc, apply_constraint)
+{
+  struct mem_alloc allocator;
+  struct mem_alloc constr;
+  struct mem_link *l;
+
+  mem_alloc_init(&allocator);
+  mem_alloc_init(&constr);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0, 0x10000), 0);
+  ASSERT_EQ(mem_alloc_add_free(&allocator, 0x20000, 0x1000), 0);
+
+  ASSERT_EQ(mem_alloc_add_free(&constr, 0x1000, 0x1000), 0);
+  ASSERT_EQ(mem_alloc_add_free(&constr, 0x4000, 0x4000), 0);
+  ASSERT_EQ(mem_alloc_add_free(&constr, 0xc000, 0x10000), 0);
+
+  EXPECT_EQ(mem_alloc_apply_constraint(&allocator, &constr), 0);
+
+  l = allocator.free.next;
+  EXPECT_EQ(l->address, 0x1000);
+  EXPECT_EQ(l->size, 0x1000);
+  l = l->next;
+  EXPECT_EQ(l->address, 0x4000);
+  EXPECT_EQ(l->size, 0x4000);
+  l = l->next;
+  EXPECT_EQ(l->address, 0xc000);
+  EXPECT_EQ(l->size, 0x4000);
+  EXPECT_EQ(l->next, &allocator.free);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&constr);
+  mem_alloc_destroy(&allocator);
+}
+
+/**
+ * @test    random
+ * @brief   Test: mem_alloc_get(), mem_alloc_put()
+ * @details Over a long series of mixed-size allocations<br>
+ *          and releases, the allocator returns aligned,<br>
+ *          non-overlapping blocks, keeps its trees balanced,<br>
+ *          and coalesces back into the original range.
+ */
+TEST(mem_alloc, random)
+{
+  struct mem_alloc allocator;
+  std::map<uint64_t, uint64_t> live;
+  const uint64_t base = 0x100000000UL;
+  const uint64_t span = 1UL << 40;
+  uint64_t seed = 0x2545f4914f6cdd1dUL;
+  int i;
+
+  mem_alloc_init(&allocator);
+
+  ASSERT_EQ(mem_alloc_add_free(&allocator, base, span), 0);
+
+  for (i = 0 ; i < 20000 ; ++i) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+
+    if (live.empty() || ((seed >> 33) % 3)) {
+      uint64_t size = 4096UL << ((seed >> 40) % 10);
+      uint64_t addr = 0;
+
+      ASSERT_EQ(mem_alloc_get(&allocator, &addr, size), 0);
+      EXPECT_EQ(addr & (size - 1), 0);
+      EXPECT_GE(addr, base);
+      EXPECT_LE(addr + size, base + span);
+
+      auto next = live.lower_bound(addr);
+      if (next != live.end()) {
+        EXPECT_LE(addr + size, next->first);
+      }
+      if (next != live.begin()) {
+        auto prev = std::prev(next);
+        EXPECT_LE(prev->first + prev->second, addr);
+      }
+      live[addr] = size;
+    } else {
+      auto it = live.begin();
+      std::advance(it, (seed >> 20) % live.size());
+      ASSERT_EQ(mem_alloc_put(&allocator, it->first), 0);
+      live.erase(it);
+    }
+
+    if (!(i % 1000))
+      mem_alloc_check(&allocator);
+  }
+
+  mem_alloc_check(&allocator);
+
+  for (auto &l : live) {
+    ASSERT_EQ(mem_alloc_put(&allocator, l.first), 0);
+  }
+
+  EXPECT_EQ(allocator.allocated.next, &allocator.allocated);
+  ASSERT_NE(allocator.free.next, &allocator.free);
+  EXPECT_EQ(allocator.free.next->address, base);
+  EXPECT_EQ(allocator.free.next->size, span);
+  EXPECT_EQ(allocator.free.next->next, &allocator.free);
+  mem_alloc_check(&allocator);
+
+  mem_alloc_destroy(&allocator);
+}
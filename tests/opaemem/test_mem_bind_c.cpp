@@ -0,0 +1,91 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "gtest/gtest.h"
+
+#include <opae/mem_bind.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <climits>
+
+#define PAGE 4096UL
+
+/**
+ * @test       node_valid
+ * @brief      Test: mem_bind_num_nodes, mem_bind_node_valid
+ * @details    Nodes from 0 up to, but not including, the number of<br>
+ *             possible nodes are valid. Negative nodes and nodes<br>
+ *             beyond the count are not.<br>
+ */
+TEST(mem_bind, node_valid)
+{
+  int nodes = mem_bind_num_nodes();
+
+  ASSERT_GE(nodes, 1);
+  ASSERT_LE(nodes, MEM_BIND_MAX_NODES);
+
+  EXPECT_TRUE(mem_bind_node_valid(0));
+  EXPECT_TRUE(mem_bind_node_valid(nodes - 1));
+  EXPECT_FALSE(mem_bind_node_valid(nodes));
+  EXPECT_FALSE(mem_bind_node_valid(MEM_BIND_MAX_NODES));
+  EXPECT_FALSE(mem_bind_node_valid(INT_MAX));
+  EXPECT_FALSE(mem_bind_node_valid(-1));
+  EXPECT_FALSE(mem_bind_node_valid(-2));
+  EXPECT_FALSE(mem_bind_node_valid(INT_MIN));
+}
+
+/**
+ * @test       bind
+ * @brief      Test: mem_bind
+ * @details    An invalid node fails with EINVAL before mbind() is<br>
+ *             called. Node 0 always exists, so binding a fresh<br>
+ *             mapping to it succeeds and the pages can be touched.<br>
+ */
+TEST(mem_bind, bind)
+{
+  const size_t len = 4 * PAGE;
+  void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, addr);
+
+  errno = 0;
+  EXPECT_NE(0, mem_bind(addr, len, -2));
+  EXPECT_EQ(EINVAL, errno);
+
+  errno = 0;
+  EXPECT_NE(0, mem_bind(addr, len, INT_MAX));
+  EXPECT_EQ(EINVAL, errno);
+
+  EXPECT_EQ(0, mem_bind(addr, len, 0)) << strerror(errno);
+  memset(addr, 0xa5, len);
+  EXPECT_EQ(0xa5, ((unsigned char *)addr)[len - 1]);
+
+  munmap(addr, len);
+}
@@ -0,0 +1,157 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "gtest/gtest.h"
+#include "mock/opae_std.h"
+
+#include <opae/mem_prefault.h>
+#include <sys/mman.h>
+
+#include <vector>
+
+extern "C" {
+uint32_t mem_prefault_count(uint64_t len, uint64_t page_size,
+                            const cpu_set_t *cpus);
+}
+
+#define PAGE 4096UL
+
+/*
+ * Count the resident pages of [addr, addr + len).
+ */
+static size_t resident(void *addr, size_t len)
+{
+  std::vector<unsigned char> vec(len / PAGE);
+  size_t count = 0;
+
+  if (mincore(addr, len, vec.data()))
+    return 0;
+
+  for (unsigned char v : vec)
+    count += v & 1;
+
+  return count;
+}
+
+/**
+ * @test       count
+ * @brief      Test: mem_prefault_count
+ * @details    The worker count is bounded by the number of pages,<br>
+ *             by MEM_PREFAULT_MIN_CHUNK bytes per worker, by<br>
+ *             MEM_PREFAULT_MAX_THREADS, and by the number of CPUs.<br>
+ */
+TEST(mem_prefault, count)
+{
+  const uint64_t GiB = 1024UL * 1024 * 1024;
+  cpu_set_t cpus;
+
+  EXPECT_EQ(1, mem_prefault_count(PAGE, PAGE, NULL));
+  EXPECT_EQ(1, mem_prefault_count(MEM_PREFAULT_MIN_CHUNK, PAGE, NULL));
+  EXPECT_EQ(2, mem_prefault_count(2 * MEM_PREFAULT_MIN_CHUNK, PAGE, NULL));
+  EXPECT_EQ(MEM_PREFAULT_MAX_THREADS,
+            mem_prefault_count(64 * GiB, PAGE, NULL));
+  EXPECT_EQ(4, mem_prefault_count(4 * GiB, GiB, NULL));
+
+  CPU_ZERO(&cpus);
+  CPU_SET(0, &cpus);
+  CPU_SET(1, &cpus);
+  EXPECT_EQ(2, mem_prefault_count(4 * GiB, GiB, &cpus));
+
+  EXPECT_EQ(1, mem_prefault_threads(4 * GiB, 0, -1));
+  EXPECT_LE(mem_prefault_threads(4 * GiB, PAGE, -1),
+            MEM_PREFAULT_MAX_THREADS);
+}
+
+/**
+ * @test       invalid
+ * @brief      Test: mem_prefault
+ * @details    A NULL address, a zero page size, or a length that<br>
+ *             is not a multiple of the page size is rejected.<br>
+ */
+TEST(mem_prefault, invalid)
+{
+  uint8_t buf[PAGE];
+
+  EXPECT_NE(0, mem_prefault(NULL, PAGE, PAGE, -1));
+  EXPECT_NE(0, mem_prefault(buf, PAGE, 0, -1));
+  EXPECT_NE(0, mem_prefault(buf, PAGE + 1, PAGE, -1));
+}
+
+/**
+ * @test       populate
+ * @brief      Test: mem_prefault
+ * @details    Every page of a newly mapped range is resident<br>
+ *             after the call, whether it is populated by the caller<br>
+ *             or by several workers, and the range still reads as<br>
+ *             zero.<br>
+ */
+TEST(mem_prefault, populate)
+{
+  const size_t sizes[] = { 4 * PAGE, 4 * MEM_PREFAULT_MIN_CHUNK + PAGE };
+
+  for (size_t len : sizes) {
+    uint8_t *p = (uint8_t *)mmap(NULL, len, PROT_READ|PROT_WRITE,
+                                 MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, (void *)p);
+
+    EXPECT_EQ(0, resident(p, len));
+    EXPECT_EQ(0, mem_prefault(p, len, PAGE, -1));
+    EXPECT_EQ(len / PAGE, resident(p, len));
+
+    EXPECT_EQ(0, p[0]);
+    EXPECT_EQ(0, p[len - 1]);
+
+    munmap(p, len);
+  }
+}
+
+/**
+ * @test       node
+ * @brief      Test: mem_prefault
+ * @details    Workers pinned to a NUMA node's CPUs populate the<br>
+ *             range. A node that does not exist falls back to the<br>
+ *             CPUs of the calling thread.<br>
+ */
+TEST(mem_prefault, node)
+{
+  const size_t len = 2 * MEM_PREFAULT_MIN_CHUNK;
+  const int nodes[] = { 0, 4095 };
+
+  for (int node : nodes) {
+    uint8_t *p = (uint8_t *)mmap(NULL, len, PROT_READ|PROT_WRITE,
+                                 MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(MAP_FAILED, (void *)p);
+
+    EXPECT_EQ(0, mem_prefault(p, len, PAGE, node));
+    EXPECT_EQ(len / PAGE, resident(p, len));
+
+    munmap(p, len);
+  }
+}
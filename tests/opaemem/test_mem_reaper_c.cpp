@@ -0,0 +1,196 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "gtest/gtest.h"
+#include "mock/opae_std.h"
+
+#include <opae/mem_reaper.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+struct mem_reaper_entry *mem_reaper_sort(struct mem_reaper_entry *list);
+}
+
+class mem_reaper_f : public ::testing::Test {
+ protected:
+
+  virtual void SetUp() override
+  {
+    hold_ = false;
+    held_ = false;
+    ASSERT_EQ(0, mem_reaper_init(&r_, reap, this));
+  }
+
+  virtual void TearDown() override
+  {
+    mem_reaper_destroy(&r_);
+  }
+
+  static void reap(void *context, struct mem_reaper_entry *batch)
+  {
+    mem_reaper_f *f = reinterpret_cast<mem_reaper_f *>(context);
+    std::vector<uint64_t> iovas;
+
+    for ( ; batch ; batch = batch->next)
+      iovas.push_back(batch->iova);
+
+    std::unique_lock<std::mutex> lock(f->m_);
+    f->batches_.push_back(iovas);
+    f->held_ = true;
+    f->cv_.notify_all();
+    f->cv_.wait(lock, [f] { return !f->hold_; });
+  }
+
+  void release()
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    hold_ = false;
+    cv_.notify_all();
+  }
+
+  struct mem_reaper r_;
+  std::mutex m_;
+  std::condition_variable cv_;
+  bool hold_;
+  bool held_;
+  std::vector<std::vector<uint64_t>> batches_;
+};
+
+/**
+ * @test       sort
+ * @brief      Test: mem_reaper_sort
+ * @details    A list of entries is sorted by ascending IO address.<br>
+ */
+TEST(mem_reaper, sort)
+{
+  const uint64_t iovas[] = { 5, 3, 9, 1, 7, 2, 8 };
+  struct mem_reaper_entry e[7];
+  struct mem_reaper_entry *list = NULL;
+  uint64_t prev = 0;
+  int count = 0;
+
+  for (int i = 0 ; i < 7 ; ++i) {
+    e[i].iova = iovas[i];
+    e[i].next = list;
+    list = &e[i];
+  }
+
+  for (list = mem_reaper_sort(list) ; list ; list = list->next) {
+    EXPECT_LT(prev, list->iova);
+    prev = list->iova;
+    ++count;
+  }
+  EXPECT_EQ(7, count);
+  EXPECT_EQ(NULL, mem_reaper_sort(NULL));
+}
+
+/**
+ * @test       drain
+ * @brief      Test: mem_reaper_put, mem_reaper_drain
+ * @details    Every queued buffer has been passed to the callback<br>
+ *             when mem_reaper_drain returns.<br>
+ */
+TEST_F(mem_reaper_f, drain)
+{
+  size_t count = 0;
+
+  for (uint64_t i = 0 ; i < 100 ; ++i)
+    ASSERT_EQ(0, mem_reaper_put(&r_, NULL, i * 4096, 4096, NULL));
+
+  EXPECT_EQ(0, mem_reaper_drain(&r_));
+  EXPECT_EQ(0, mem_reaper_pending(&r_));
+
+  for (auto &b : batches_)
+    count += b.size();
+  EXPECT_EQ(100, count);
+  EXPECT_EQ(100, r_.entries);
+  EXPECT_EQ(batches_.size(), r_.batches);
+}
+
+/**
+ * @test       batch
+ * @brief      Test: mem_reaper_put
+ * @details    Buffers queued while the callback runs are handed<br>
+ *             to the next call as one batch, sorted by IO address.<br>
+ */
+TEST_F(mem_reaper_f, batch)
+{
+  hold_ = true;
+  ASSERT_EQ(0, mem_reaper_put(&r_, NULL, 0, 4096, NULL));
+
+  {
+    std::unique_lock<std::mutex> lock(m_);
+    cv_.wait(lock, [this] { return held_; });
+  }
+
+  for (uint64_t i = 10 ; i > 0 ; --i)
+    ASSERT_EQ(0, mem_reaper_put(&r_, NULL, i * 4096, 4096, NULL));
+  EXPECT_EQ(11, mem_reaper_pending(&r_));
+
+  release();
+  EXPECT_EQ(0, mem_reaper_drain(&r_));
+
+  ASSERT_EQ(2, batches_.size());
+  ASSERT_EQ(10, batches_[1].size());
+  for (uint64_t i = 0 ; i < 10 ; ++i)
+    EXPECT_EQ((i + 1) * 4096, batches_[1][i]);
+}
+
+/**
+ * @test       destroy
+ * @brief      Test: mem_reaper_destroy
+ * @details    Queued buffers are released when the reaper is<br>
+ *             destroyed, and a reaper that was never used has no<br>
+ *             thread to stop.<br>
+ */
+TEST(mem_reaper, destroy)
+{
+  struct mem_reaper r;
+  size_t count = 0;
+  auto reap = [](void *context, struct mem_reaper_entry *batch) {
+    size_t *n = reinterpret_cast<size_t *>(context);
+    for ( ; batch ; batch = batch->next)
+      ++*n;
+  };
+
+  ASSERT_EQ(0, mem_reaper_init(&r, reap, &count));
+  mem_reaper_destroy(&r);
+
+  ASSERT_EQ(0, mem_reaper_init(&r, reap, &count));
+  for (uint64_t i = 0 ; i < 8 ; ++i)
+    ASSERT_EQ(0, mem_reaper_put(&r, NULL, i * 4096, 4096, NULL));
+  mem_reaper_destroy(&r);
+  EXPECT_EQ(8, count);
+
+  EXPECT_NE(0, mem_reaper_init(&r, NULL, NULL));
+}
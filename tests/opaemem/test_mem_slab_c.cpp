@@ -0,0 +1,253 @@
+// Copyright(c) 2024, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "gtest/gtest.h"
+#include "mock/opae_std.h"
+
+#include <opae/mem_slab.h>
+#include <sys/mman.h>
+
+#include <set>
+
+class mem_slab_f : public ::testing::Test {
+ protected:
+
+  virtual void SetUp() override
+  {
+    maps_ = 0;
+    unmaps_ = 0;
+    fail_map_ = false;
+    next_iova_ = 0x40000000000UL;
+    mem_slab_init(&s_, map, unmap, this);
+  }
+
+  virtual void TearDown() override
+  {
+    mem_slab_destroy(&s_);
+    EXPECT_EQ(maps_, unmaps_);
+  }
+
+  static int map(void *context, uint64_t size, void **vaddr, uint64_t *iova)
+  {
+    mem_slab_f *f = reinterpret_cast<mem_slab_f *>(context);
+    void *p;
+
+    if (f->fail_map_)
+      return 1;
+
+    p = mmap(NULL, size, PROT_READ|PROT_WRITE,
+             MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED)
+      return 1;
+
+    *vaddr = p;
+    *iova = f->next_iova_;
+    f->next_iova_ += size;
+    ++f->maps_;
+    return 0;
+  }
+
+  static void unmap(void *context, void *vaddr, uint64_t iova, uint64_t size)
+  {
+    mem_slab_f *f = reinterpret_cast<mem_slab_f *>(context);
+    (void) iova;
+    munmap(vaddr, size);
+    ++f->unmaps_;
+  }
+
+  struct mem_slab s_;
+  int maps_;
+  int unmaps_;
+  bool fail_map_;
+  uint64_t next_iova_;
+};
+
+/**
+ * @test       region_size
+ * @brief      Test: mem_slab_region_size
+ * @details    Requests up to 1 MiB use 2 MiB regions, requests up to<br>
+ *             256 MiB use 1 GiB regions, and larger or empty requests<br>
+ *             are not sub-allocated.<br>
+ */
+TEST(mem_slab, region_size)
+{
+  EXPECT_EQ(0, mem_slab_region_size(0));
+  EXPECT_EQ(MEM_SLAB_SMALL_REGION, mem_slab_region_size(1));
+  EXPECT_EQ(MEM_SLAB_SMALL_REGION, mem_slab_region_size(MEM_SLAB_SMALL_MAX));
+  EXPECT_EQ(MEM_SLAB_LARGE_REGION, mem_slab_region_size(MEM_SLAB_SMALL_MAX + 1));
+  EXPECT_EQ(MEM_SLAB_LARGE_REGION, mem_slab_region_size(MEM_SLAB_LARGE_MAX));
+  EXPECT_EQ(0, mem_slab_region_size(MEM_SLAB_LARGE_MAX + 1));
+}
+
+/**
+ * @test       share
+ * @brief      Test: mem_slab_get, mem_slab_put
+ * @details    Small buffers are carved from a single 2 MiB region.<br>
+ *             Each buffer is page aligned, buffers don't overlap, and<br>
+ *             each IO address is the region's IO address plus the<br>
+ *             buffer's offset into the region.<br>
+ */
+TEST_F(mem_slab_f, share)
+{
+  const int count = MEM_SLAB_SMALL_REGION / MEM_SLAB_GRANULE;
+  std::set<uint64_t> addrs;
+  void *vaddr[count];
+  uint64_t iova = 0;
+  int i;
+
+  for (i = 0 ; i < count ; ++i) {
+    ASSERT_EQ(0, mem_slab_get(&s_, 100, &vaddr[i], &iova));
+    EXPECT_EQ(0, (uint64_t)vaddr[i] % MEM_SLAB_GRANULE);
+    EXPECT_EQ(s_.regions->iova +
+              ((uint8_t *)vaddr[i] - s_.regions->vaddr), iova);
+    addrs.insert((uint64_t)vaddr[i]);
+  }
+
+  EXPECT_EQ(count, addrs.size());
+  EXPECT_EQ(1, maps_);
+  EXPECT_EQ(MEM_SLAB_SMALL_REGION, s_.pinned);
+  EXPECT_EQ(count, s_.regions->allocs);
+
+  // The region is full: the next request maps a second one.
+  ASSERT_EQ(0, mem_slab_get(&s_, 100, &vaddr[0], &iova));
+  EXPECT_EQ(2, maps_);
+  EXPECT_EQ(2 * MEM_SLAB_SMALL_REGION, s_.pinned);
+  EXPECT_EQ(0, mem_slab_put(&s_, vaddr[0]));
+
+  for (i = 1 ; i < count ; ++i)
+    EXPECT_EQ(0, mem_slab_put(&s_, vaddr[i]));
+}
+
+/**
+ * @test       release
+ * @brief      Test: mem_slab_put
+ * @details    An empty region is released while another region of<br>
+ *             the same size remains, and the last region of each size<br>
+ *             is kept for later requests.<br>
+ */
+TEST_F(mem_slab_f, release)
+{
+  void *a = nullptr;
+  void *b = nullptr;
+  void *c = nullptr;
+  uint64_t iova = 0;
+
+  ASSERT_EQ(0, mem_slab_get(&s_, MEM_SLAB_SMALL_MAX, &a, &iova));
+  ASSERT_EQ(0, mem_slab_get(&s_, MEM_SLAB_SMALL_MAX, &b, &iova));
+  ASSERT_EQ(0, mem_slab_get(&s_, MEM_SLAB_SMALL_MAX, &c, &iova));
+  EXPECT_EQ(2, maps_);
+
+  EXPECT_EQ(0, mem_slab_put(&s_, c));
+  EXPECT_EQ(1, unmaps_);
+  EXPECT_EQ(MEM_SLAB_SMALL_REGION, s_.pinned);
+
+  EXPECT_EQ(0, mem_slab_put(&s_, a));
+  EXPECT_EQ(0, mem_slab_put(&s_, b));
+  EXPECT_EQ(1, unmaps_);
+  ASSERT_NE(nullptr, s_.regions);
+  EXPECT_EQ(0, s_.regions->allocs);
+
+  // The retained region serves the next request.
+  ASSERT_EQ(0, mem_slab_get(&s_, 4096, &a, &iova));
+  EXPECT_EQ(2, maps_);
+  EXPECT_EQ(0, mem_slab_put(&s_, a));
+}
+
+/**
+ * @test       large
+ * @brief      Test: mem_slab_get
+ * @details    Requests over 1 MiB are carved from 1 GiB regions,<br>
+ *             which are kept apart from the 2 MiB regions.<br>
+ */
+TEST_F(mem_slab_f, large)
+{
+  void *a = nullptr;
+  void *b = nullptr;
+  void *c = nullptr;
+  uint64_t iova = 0;
+
+  ASSERT_EQ(0, mem_slab_get(&s_, 3 * 1024 * 1024, &a, &iova));
+  ASSERT_EQ(0, mem_slab_get(&s_, 3 * 1024 * 1024, &b, &iova));
+  ASSERT_EQ(0, mem_slab_get(&s_, 4096, &c, &iova));
+  EXPECT_EQ(2, maps_);
+  EXPECT_EQ(MEM_SLAB_LARGE_REGION + MEM_SLAB_SMALL_REGION, s_.pinned);
+
+  EXPECT_EQ(0, mem_slab_put(&s_, a));
+  EXPECT_EQ(0, mem_slab_put(&s_, b));
+  EXPECT_EQ(0, mem_slab_put(&s_, c));
+}
+
+/**
+ * @test       err
+ * @brief      Test: mem_slab_get, mem_slab_put
+ * @details    mem_slab_get fails for requests that are too large and<br>
+ *             when the map callback fails. mem_slab_put fails for<br>
+ *             addresses that it did not return and for double frees.<br>
+ */
+TEST_F(mem_slab_f, err)
+{
+  void *a = nullptr;
+  uint64_t iova = 0;
+  int local;
+
+  EXPECT_NE(0, mem_slab_get(&s_, 0, &a, &iova));
+  EXPECT_NE(0, mem_slab_get(&s_, MEM_SLAB_LARGE_MAX + 1, &a, &iova));
+
+  fail_map_ = true;
+  EXPECT_NE(0, mem_slab_get(&s_, 4096, &a, &iova));
+  EXPECT_EQ(nullptr, s_.regions);
+  fail_map_ = false;
+
+  EXPECT_NE(0, mem_slab_put(&s_, &local));
+
+  ASSERT_EQ(0, mem_slab_get(&s_, 4096, &a, &iova));
+  EXPECT_NE(0, mem_slab_put(&s_, (uint8_t *)a + 8));
+  EXPECT_EQ(0, mem_slab_put(&s_, a));
+  EXPECT_NE(0, mem_slab_put(&s_, a));
+}
+
+/**
+ * @test       destroy
+ * @brief      Test: mem_slab_destroy
+ * @details    mem_slab_destroy releases every region, including<br>
+ *             those with live sub-allocations.<br>
+ */
+TEST_F(mem_slab_f, destroy)
+{
+  void *a = nullptr;
+  uint64_t iova = 0;
+
+  ASSERT_EQ(0, mem_slab_get(&s_, 4096, &a, &iova));
+  ASSERT_EQ(0, mem_slab_get(&s_, 2 * 1024 * 1024, &a, &iova));
+  mem_slab_destroy(&s_);
+  EXPECT_EQ(2, unmaps_);
+  EXPECT_EQ(0, s_.pinned);
+  EXPECT_EQ(nullptr, s_.regions);
+}
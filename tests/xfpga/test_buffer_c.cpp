@@ -42,6 +42,7 @@ extern "C" {
 #include <linux/ioctl.h>
 #include <sys/mman.h>
 
+#include <map>
 #include <tuple>
 
 #include "error_int.h"
@@ -52,6 +53,7 @@ extern "C" {
 #include "fpga-dfl.h"
 #include "types_int.h"
 #include <opae/buffer.h>
+#include <opae/mem_bind.h>
 #include <opae/mmio.h>
 
 #define NLB_DSM_SIZE (2 * 1024 * 1024)
@@ -282,6 +284,180 @@ TEST_P(buffer_prepare, write_read) {
   EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_OK);
 }
 
+/**
+ * @test       slab
+ *
+ * @brief      When FPGA_BUF_SLAB is given, fpgaPrepareBuffer carves
+ *             small buffers from one shared region. Each buffer has
+ *             its own wsid, and its IO address is offset from the
+ *             other's by the distance between their virtual addresses.
+ *             FPGA_BUF_SLAB with FPGA_BUF_PREALLOCATED is rejected.
+ *
+ */
+TEST_P(buffer_prepare, slab) {
+  void *a = nullptr;
+  void *b = nullptr;
+  uint64_t wsid_a = 0;
+  uint64_t wsid_b = 0;
+  uint64_t iova_a = 0;
+  uint64_t iova_b = 0;
+  struct _fpga_handle *h = (struct _fpga_handle *)handle_;
+
+  ASSERT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(4), &a, &wsid_a,
+                                    FPGA_BUF_SLAB), FPGA_OK);
+  ASSERT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(8), &b, &wsid_b,
+                                    FPGA_BUF_SLAB), FPGA_OK);
+  EXPECT_NE(wsid_a, wsid_b);
+  EXPECT_EQ(h->slab.pinned, MiB(2));
+
+  ASSERT_EQ(xfpga_fpgaGetIOAddress(handle_, wsid_a, &iova_a), FPGA_OK);
+  ASSERT_EQ(xfpga_fpgaGetIOAddress(handle_, wsid_b, &iova_b), FPGA_OK);
+  EXPECT_EQ(iova_b - iova_a, (uint64_t)b - (uint64_t)a);
+
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid_a), FPGA_OK);
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid_b), FPGA_OK);
+
+  a = &wsid_a;
+  EXPECT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(4), &a, &wsid_a,
+                                    FPGA_BUF_SLAB | FPGA_BUF_PREALLOCATED),
+            FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test       prefault
+ *
+ * @brief      When FPGA_BUF_PREFAULT is given, fpgaPrepareBuffer
+ *             populates the pages of a multi-page buffer before the
+ *             DMA map, and fpgaGetBufferPrepareStats counts the buffer
+ *             as prefaulted. Buffers without the flag are counted
+ *             but not prefaulted.
+ *
+ */
+TEST_P(buffer_prepare, prefault) {
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+  fpga_buffer_prepare_stats stats;
+
+  EXPECT_EQ(xfpga_fpgaGetBufferPrepareStats(handle_, nullptr),
+            FPGA_INVALID_PARAM);
+
+  ASSERT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(4), &buf_addr, &wsid, 0),
+            FPGA_OK);
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_OK);
+
+  ASSERT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(4), &buf_addr, &wsid,
+                                    FPGA_BUF_PREFAULT), FPGA_OK);
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_OK);
+
+  ASSERT_EQ(xfpga_fpgaGetBufferPrepareStats(handle_, &stats), FPGA_OK);
+  EXPECT_EQ(stats.buffers, 2);
+  EXPECT_EQ(stats.bytes, KiB(8));
+  EXPECT_EQ(stats.prefaulted, 1);
+}
+
+/**
+ * @test       numa_node
+ *
+ * @brief      fpgaPrepareBufferEx rejects NUMA nodes that don't exist
+ *             with FPGA_INVALID_PARAM, without allocating.
+ *
+ */
+TEST_P(buffer_prepare, numa_node) {
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+
+  EXPECT_EQ(xfpga_fpgaPrepareBufferEx(handle_, KiB(4), &buf_addr, &wsid,
+                                      0, -2), FPGA_INVALID_PARAM);
+  EXPECT_EQ(xfpga_fpgaPrepareBufferEx(handle_, KiB(4), &buf_addr, &wsid,
+                                      0, mem_bind_num_nodes()),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(xfpga_fpgaPrepareBufferEx(handle_, KiB(4), &buf_addr, &wsid,
+                                      0, INT_MAX), FPGA_INVALID_PARAM);
+  EXPECT_EQ(buf_addr, nullptr);
+}
+
+/**
+ * @test       sg
+ *
+ * @brief      fpgaPrepareBufferSG pins an unaligned range of heap
+ *             memory. The segment lengths add up to the range length,
+ *             the first segment starts at the buffer's IO address, and
+ *             the buffer is released with fpgaReleaseBuffer.
+ *             Invalid lengths, segment counts and flags are rejected.
+ *
+ */
+TEST_P(buffer_prepare, sg) {
+  const uint64_t len = KiB(12);
+  uint8_t *heap = (uint8_t *)aligned_alloc(KiB(4), KiB(16));
+  ASSERT_NE(heap, nullptr);
+  void *buf = heap + 100;
+  fpga_sg_entry sg[4];
+  uint32_t num_sg = 4;
+  uint64_t wsid = 0;
+  uint64_t iova = 0;
+  uint64_t total = 0;
+  uint32_t i;
+
+  ASSERT_EQ(xfpga_fpgaPrepareBufferSG(handle_, buf, len, &wsid,
+                                      sg, &num_sg, 0), FPGA_OK);
+  ASSERT_GE(num_sg, 1u);
+  ASSERT_LE(num_sg, 4u);
+  for (i = 0 ; i < num_sg ; ++i)
+    total += sg[i].len;
+  EXPECT_EQ(total, len);
+
+  ASSERT_EQ(xfpga_fpgaGetIOAddress(handle_, wsid, &iova), FPGA_OK);
+  EXPECT_EQ(iova, sg[0].iova);
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_OK);
+
+  num_sg = 0;
+  EXPECT_EQ(xfpga_fpgaPrepareBufferSG(handle_, buf, len, &wsid,
+                                      sg, &num_sg, 0), FPGA_INVALID_PARAM);
+  num_sg = 4;
+  EXPECT_EQ(xfpga_fpgaPrepareBufferSG(handle_, buf, 0, &wsid,
+                                      sg, &num_sg, 0), FPGA_INVALID_PARAM);
+  EXPECT_EQ(xfpga_fpgaPrepareBufferSG(handle_, buf, len, &wsid,
+                                      sg, &num_sg, FPGA_BUF_PREALLOCATED),
+            FPGA_INVALID_PARAM);
+
+  free(heap);
+}
+
+/**
+ * @test       deferred
+ *
+ * @brief      On a handle opened with FPGA_OPEN_DEFERRED_RELEASE,
+ *             fpgaReleaseBuffer returns before the buffer is unmapped
+ *             and fpgaDrainBufferReleases waits for the release.
+ *             The wsid is invalid as soon as fpgaReleaseBuffer returns.
+ *
+ */
+TEST_P(buffer_prepare, deferred) {
+  void *buf_addr = nullptr;
+  uint64_t wsid = 0;
+
+  EXPECT_EQ(xfpga_fpgaDrainBufferReleases(nullptr), FPGA_INVALID_PARAM);
+  EXPECT_EQ(xfpga_fpgaDrainBufferReleases(handle_), FPGA_OK);
+
+  ASSERT_EQ(xfpga_fpgaClose(handle_), FPGA_OK);
+  handle_ = nullptr;
+  ASSERT_EQ(xfpga_fpgaOpen(tokens_[0], &handle_,
+                           FPGA_OPEN_DEFERRED_RELEASE), FPGA_OK);
+
+  for (int i = 0 ; i < 4 ; ++i) {
+    ASSERT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(4), &buf_addr,
+                                      &wsid, 0), FPGA_OK);
+    EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_OK);
+    EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_INVALID_PARAM);
+  }
+
+  EXPECT_EQ(xfpga_fpgaDrainBufferReleases(handle_), FPGA_OK);
+
+  ASSERT_EQ(xfpga_fpgaPrepareBuffer(handle_, KiB(4), &buf_addr,
+                                    &wsid, 0), FPGA_OK);
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(handle_, wsid), FPGA_OK);
+}
+
 namespace {
 std::vector<buffer_params> params{
     buffer_params{FPGA_INVALID_PARAM, 0, 0},
@@ -334,6 +510,93 @@ TEST_P(buffer_c_mock_p, port_dma_map) {
   EXPECT_EQ(res, FPGA_INVALID_PARAM) << "result is " << fpgaErrStr(res);
 }
 
+// DMA mappings made through the mock driver, iova -> length. The iova
+// is the user address, and overlapping mappings fail as in the driver.
+static std::map<uint64_t, uint64_t> sg_mapped;
+
+static int sg_dma_map(mock_object *, int, va_list argp) {
+  struct dfl_fpga_port_dma_map *m =
+    va_arg(argp, struct dfl_fpga_port_dma_map *);
+
+  for (auto &r : sg_mapped) {
+    if (m->user_addr < r.first + r.second &&
+        r.first < m->user_addr + m->length) {
+      errno = EEXIST;
+      return -1;
+    }
+  }
+  m->iova = m->user_addr;
+  sg_mapped[m->iova] = m->length;
+  return 0;
+}
+
+static int sg_dma_unmap(mock_object *, int, va_list argp) {
+  struct dfl_fpga_port_dma_unmap *u =
+    va_arg(argp, struct dfl_fpga_port_dma_unmap *);
+
+  if (!sg_mapped.erase(u->iova)) {
+    errno = EINVAL;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @test       sg_shared_page
+ *
+ * @brief      Two fpgaPrepareBufferSG buffers that start in the same
+ *             page share its mapping. The page stays mapped until both
+ *             are released, and a buffer asking for other access flags
+ *             on the shared page is rejected with FPGA_INVALID_PARAM.
+ *
+ */
+TEST_P(buffer_c_mock_p, sg_shared_page) {
+  uint8_t *heap = (uint8_t *)aligned_alloc(KiB(4), KiB(16));
+  ASSERT_NE(heap, nullptr);
+  uint8_t *page = heap;
+  fpga_sg_entry sg_a[4];
+  fpga_sg_entry sg_b[4];
+  uint32_t num_a = 4;
+  uint32_t num_b = 4;
+  uint64_t wsid_a = 0;
+  uint64_t wsid_b = 0;
+  uint64_t wsid_c = 0;
+
+  sg_mapped.clear();
+  system_->register_ioctl_handler(DFL_FPGA_PORT_DMA_MAP, sg_dma_map);
+  system_->register_ioctl_handler(DFL_FPGA_PORT_DMA_UNMAP, sg_dma_unmap);
+
+  ASSERT_EQ(xfpga_fpgaPrepareBufferSG(accel_, page + 100, 1000, &wsid_a,
+                                      sg_a, &num_a, 0), FPGA_OK);
+  ASSERT_EQ(num_a, 1u);
+  EXPECT_EQ(sg_a[0].iova, (uint64_t)(page + 100));
+  EXPECT_EQ(sg_a[0].len, 1000u);
+
+  // Starts in the page buffer a mapped, and runs into the next one.
+  ASSERT_EQ(xfpga_fpgaPrepareBufferSG(accel_, page + 2000, KiB(4), &wsid_b,
+                                      sg_b, &num_b, 0), FPGA_OK);
+  ASSERT_EQ(num_b, 2u);
+  EXPECT_EQ(sg_b[0].iova, (uint64_t)(page + 2000));
+  EXPECT_EQ(sg_b[0].len, KiB(4) - 2000);
+  EXPECT_EQ(sg_b[1].iova, (uint64_t)(page + KiB(4)));
+  EXPECT_EQ(sg_b[1].len, 2000u);
+  EXPECT_EQ(sg_mapped.size(), 2u);
+
+  num_b = 4;
+  EXPECT_EQ(xfpga_fpgaPrepareBufferSG(accel_, page + 500, 10, &wsid_c,
+                                      sg_b, &num_b, FPGA_BUF_READ_ONLY),
+            FPGA_INVALID_PARAM);
+
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(accel_, wsid_a), FPGA_OK);
+  EXPECT_EQ(sg_mapped.size(), 2u);
+  EXPECT_EQ(sg_mapped.count((uint64_t)page), 1u);
+
+  EXPECT_EQ(xfpga_fpgaReleaseBuffer(accel_, wsid_b), FPGA_OK);
+  EXPECT_TRUE(sg_mapped.empty());
+
+  free(heap);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(buffer_c_mock_p);
 INSTANTIATE_TEST_SUITE_P(buffer_c, buffer_c_mock_p,
                          ::testing::ValuesIn(test_platform::mock_platforms({
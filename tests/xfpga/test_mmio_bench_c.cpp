@@ -0,0 +1,235 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+extern "C" {
+#include <opae/utils.h>
+#include "types_int.h"
+#include "wsid_list_int.h"
+#include "xfpga.h"
+#include "mmio-wide.h"
+}
+
+#include <chrono>
+#include <cstdio>
+
+#include "gtest/gtest.h"
+
+/*
+ * Measures the per-call cost of xfpga_fpgaReadMMIO64() against a handle
+ * tracking an increasing number of MMIO regions and DMA buffers. The
+ * MMIO accessors resolve a mapped region through the handle's directly
+ * indexed mmio_regions[] table, so the cost should stay flat as the
+ * trackers grow. The cost of the wsid_find_by_index() walk that the
+ * accessors used previously is reported alongside for comparison.
+ */
+
+static const uint64_t BENCH_ITERATIONS = 1000000;
+static const uint32_t BENCH_TRACKED[] = { 0, 64, 4096, 16384 };
+
+class mmio_bench_handle {
+ public:
+  explicit mmio_bench_handle(uint32_t tracked) {
+    memset(&handle_, 0, sizeof(handle_));
+    memset(mmio_, 0, sizeof(mmio_));
+
+    handle_.magic = FPGA_HANDLE_MAGIC;
+    handle_.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+    handle_.fddev = -1;
+    handle_.fdfpgad = -1;
+
+    handle_.mmio_root = wsid_tracker_init(4);
+    handle_.wsid_table = wsid_table_init();
+
+    // Region 0 is the one accessed; the rest only populate the tracker.
+    for (uint32_t i = tracked ; i > 0 ; --i)
+      wsid_add(handle_.mmio_root, wsid_gen(), 0, 0, 0, 0, i, 0);
+    wsid_add(handle_.mmio_root, wsid_gen(),
+             (uint64_t)mmio_, 0, sizeof(mmio_),
+             (uint64_t)mmio_, 0, 0);
+    handle_.mmio_regions[0].base = mmio_;
+    handle_.mmio_regions[0].len = sizeof(mmio_);
+    handle_.mmio_wide = opae_mmio_wide_select();
+
+    for (uint32_t i = 0 ; i < tracked ; ++i) {
+      uint64_t wsid = 0;
+      wsid_table_add(handle_.wsid_table, 0, 0, 4096, 0, &wsid);
+    }
+  }
+
+  ~mmio_bench_handle() {
+    wsid_table_cleanup(handle_.wsid_table, nullptr);
+    wsid_tracker_cleanup(handle_.mmio_root, nullptr);
+  }
+
+  // Best of several runs, in ns per xfpga_fpgaReadMMIO64 call.
+  double read64_ns() {
+    double best = 0.0;
+    uint64_t value = 0;
+
+    for (int run = 0 ; run < 5 ; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      for (uint64_t i = 0 ; i < BENCH_ITERATIONS / 5 ; ++i)
+        xfpga_fpgaReadMMIO64(&handle_, 0, 0x100, &value);
+      auto end = std::chrono::steady_clock::now();
+      double ns = std::chrono::duration<double, std::nano>(end - start).count() /
+                  (BENCH_ITERATIONS / 5);
+      if (!run || ns < best)
+        best = ns;
+    }
+
+    return best;
+  }
+
+  double walk_ns() {
+    const uint64_t walks = 1000;
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0 ; i < walks ; ++i) {
+      struct wsid_map *wm = wsid_find_by_index(handle_.mmio_root, 0);
+      sum += wm->len;
+    }
+    auto end = std::chrono::steady_clock::now();
+    EXPECT_NE(0u, sum);
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           walks;
+  }
+
+  struct _fpga_handle handle_;
+  alignas(64) uint8_t mmio_[4096];
+};
+
+/**
+ * @test       read64
+ * @brief      Benchmark: xfpga_fpgaReadMMIO64
+ * @details    For handles tracking increasing numbers of additional<br>
+ *             MMIO regions and DMA buffers, report the average cost of<br>
+ *             xfpga_fpgaReadMMIO64 and of wsid_find_by_index, and check<br>
+ *             that the MMIO cost at the largest count stays within a<br>
+ *             generous factor of the cost at the smallest.<br>
+ */
+TEST(mmio_bench, read64) {
+  const size_t counts = sizeof(BENCH_TRACKED) / sizeof(BENCH_TRACKED[0]);
+  double mmio_ns[counts];
+
+  for (size_t c = 0 ; c < counts ; ++c) {
+    mmio_bench_handle h(BENCH_TRACKED[c]);
+    uint64_t *csr = (uint64_t *)(h.mmio_ + 0x100);
+    uint64_t value = 0;
+
+    *csr = 0xdecafbadfeedbeef;
+    ASSERT_EQ(FPGA_OK, xfpga_fpgaReadMMIO64(&h.handle_, 0, 0x100, &value));
+    EXPECT_EQ(0xdecafbadfeedbeef, value);
+
+    mmio_ns[c] = h.read64_ns();
+    printf("tracked %6u: xfpga_fpgaReadMMIO64 %8.1f ns/op, "
+           "wsid_find_by_index %10.1f ns/op\n",
+           BENCH_TRACKED[c], mmio_ns[c], h.walk_ns());
+  }
+
+  // A lookup that scaled with the trackers would cost 100x more here.
+  EXPECT_LT(mmio_ns[counts - 1], 4.0 * mmio_ns[0] + 50.0);
+}
+
+class mmio_bench_f : public ::testing::TestWithParam<uint32_t> {
+ protected:
+  mmio_bench_f() : h_(GetParam()), handle_(h_.handle_), mmio_(h_.mmio_) {}
+
+  mmio_bench_handle h_;
+  struct _fpga_handle &handle_;
+  uint8_t *mmio_;
+};
+
+/**
+ * @test       copy
+ * @brief      Benchmark: xfpga_fpgaCopyToMMIO, xfpga_fpgaCopyFromMMIO
+ * @details    Report the cost of moving a 4 KiB window to and from<br>
+ *             MMIO with the block copy calls, with one<br>
+ *             xfpga_fpgaWriteMMIO64 call per word, and with a<br>
+ *             per-word store loop through the mapped pointer.<br>
+ *             The window is ordinary memory here, so the numbers<br>
+ *             measure software overhead only.<br>
+ */
+TEST_P(mmio_bench_f, copy) {
+  const uint64_t copies = 10000;
+  const uint64_t words = sizeof(h_.mmio_) / sizeof(uint64_t);
+  uint64_t src[sizeof(h_.mmio_) / sizeof(uint64_t)];
+  uint64_t dst[sizeof(h_.mmio_) / sizeof(uint64_t)];
+  uint64_t i;
+  uint64_t j;
+
+  for (i = 0 ; i < words ; ++i)
+    src[i] = 0xdecafbadfeedbeef ^ i;
+
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaCopyToMMIO(&handle_, 0, 0, src, sizeof(src)));
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaCopyFromMMIO(&handle_, 0, 0, dst, sizeof(dst)));
+  EXPECT_EQ(0, memcmp(src, mmio_, sizeof(src)));
+  EXPECT_EQ(0, memcmp(src, dst, sizeof(dst)));
+
+  auto start = std::chrono::steady_clock::now();
+  for (i = 0 ; i < copies ; ++i)
+    xfpga_fpgaCopyToMMIO(&handle_, 0, 0, src, sizeof(src));
+  auto end = std::chrono::steady_clock::now();
+  double copy_to_ns = std::chrono::duration<double, std::nano>(end - start).count() /
+                      copies;
+
+  start = std::chrono::steady_clock::now();
+  for (i = 0 ; i < copies ; ++i)
+    xfpga_fpgaCopyFromMMIO(&handle_, 0, 0, dst, sizeof(dst));
+  end = std::chrono::steady_clock::now();
+  double copy_from_ns = std::chrono::duration<double, std::nano>(end - start).count() /
+                        copies;
+
+  start = std::chrono::steady_clock::now();
+  for (i = 0 ; i < copies ; ++i) {
+    for (j = 0 ; j < words ; ++j)
+      xfpga_fpgaWriteMMIO64(&handle_, 0, j * sizeof(uint64_t), src[j]);
+  }
+  end = std::chrono::steady_clock::now();
+  double api_ns = std::chrono::duration<double, std::nano>(end - start).count() /
+                  copies;
+
+  start = std::chrono::steady_clock::now();
+  for (i = 0 ; i < copies ; ++i) {
+    volatile uint64_t *dev_addr = (volatile uint64_t *)mmio_;
+    for (j = 0 ; j < words ; ++j)
+      *dev_addr++ = src[j];
+  }
+  end = std::chrono::steady_clock::now();
+  double loop_ns = std::chrono::duration<double, std::nano>(end - start).count() /
+                   copies;
+
+  printf("tracked %6u: 4 KiB CopyToMMIO %8.1f ns, CopyFromMMIO %8.1f ns, "
+         "WriteMMIO64 x%u %8.1f ns, store loop %8.1f ns\n",
+         GetParam(), copy_to_ns, copy_from_ns, (uint32_t)words,
+         api_ns, loop_ns);
+}
+
+INSTANTIATE_TEST_SUITE_P(mmio_bench, mmio_bench_f,
+                         ::testing::ValuesIn(BENCH_TRACKED));
@@ -40,9 +40,15 @@ KEEP_XFPGA_SYMBOLS
 #include "types_int.h"
 #include "sysfs_int.h"
 
+#include <sys/mman.h>
+#include <atomic>
+#include <thread>
+
 extern "C" {
+#include "wsid_list_int.h"
 int xfpga_plugin_initialize(void);
 int xfpga_plugin_finalize(void);
+void xfpga_mmio_quiesce(struct _fpga_handle *_handle);
 }
 
 using namespace opae::testing;
@@ -446,9 +452,215 @@ TEST_P (mmio_c_p, test_neg_read_write_512) {
 #endif
 }
 
+/**
+*  @test      mmio_c_p
+*  @brief     Test: test_pos_read_write_batch
+*  @details   When the parameters are valid and the drivers are loaded:
+*             xfpga_fpgaWriteMMIOBatch must write each value at its MMIO
+*             offset.  xfpga_fpgaReadMMIOBatch must read each value back.
+*
+*/
+TEST_P (mmio_c_p, test_pos_read_write_batch) {
+  const fpga_mmio_op wops[3] = {
+    { 0, sizeof(uint64_t), CSR_SCRATCHPAD0, 0xdecafbadfeedbeef },
+    { 0, sizeof(uint32_t), CSR_SCRATCHPAD0 + 8, 0xc0cac01a },
+    { 0, sizeof(uint32_t), CSR_SCRATCHPAD0 + 12, 0xdeadbeef }
+  };
+  fpga_mmio_op rops[3] = {
+    { 0, sizeof(uint64_t), CSR_SCRATCHPAD0, 0 },
+    { 0, sizeof(uint32_t), CSR_SCRATCHPAD0 + 8, 0 },
+    { 0, sizeof(uint64_t), CSR_SCRATCHPAD0 + 8, 0 }
+  };
+
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaWriteMMIOBatch(accel_, wops, 3));
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaReadMMIOBatch(accel_, rops, 3));
+
+  EXPECT_EQ(0xdecafbadfeedbeef, rops[0].value);
+  EXPECT_EQ(0xc0cac01a, rops[1].value);
+  EXPECT_EQ(0xdeadbeefc0cac01a, rops[2].value);
+
+#ifndef BUILD_ASE
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaUnmapMMIO(accel_, 0));
+#endif
+}
+
+/**
+*  @test      mmio_c_p
+*  @brief     Test: test_neg_read_write_batch
+*  @details   When an operation is misaligned, out of bounds, or has an
+*             invalid width, xfpga_fpgaReadMMIOBatch and
+*             xfpga_fpgaWriteMMIOBatch return FPGA_INVALID_PARAM.
+*
+*/
+TEST_P (mmio_c_p, test_neg_read_write_batch) {
+  fpga_mmio_op op = { 0, sizeof(uint64_t), CSR_SCRATCHPAD0 + 4, 0 };
+
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaWriteMMIOBatch(accel_, &op, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(accel_, &op, 1));
+
+  op.offset = MMIO_OUT_REGION_ADDRESS;
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaWriteMMIOBatch(accel_, &op, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(accel_, &op, 1));
+
+  // Accesses that start inside the region but end past it.
+  op.offset = 0x40000;
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaWriteMMIOBatch(accel_, &op, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(accel_, &op, 1));
+
+  op.offset = 0x40000 - sizeof(uint32_t);
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(accel_, &op, 1));
+  op.width = sizeof(uint32_t);
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaReadMMIOBatch(accel_, &op, 1));
+  op.width = sizeof(uint64_t);
+
+  op.offset = CSR_SCRATCHPAD0;
+  op.width = 2;
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaWriteMMIOBatch(accel_, &op, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(accel_, &op, 1));
+
+#ifndef BUILD_ASE
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaReadMMIOBatch(NULL, &op, 1));
+  EXPECT_EQ(FPGA_INVALID_PARAM, xfpga_fpgaWriteMMIOBatch(NULL, &op, 1));
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaUnmapMMIO(accel_, 0));
+#endif
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(mmio_c_p);
 INSTANTIATE_TEST_SUITE_P(mmio_c, mmio_c_p,
                          ::testing::ValuesIn(test_platform::platforms({
                                                                         "dfl-d5005",
                                                                         "dfl-n3000"
                                                                       })));
+
+class mmio_quiesce_f : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    memset(&handle_, 0, sizeof(handle_));
+    handle_.magic = FPGA_HANDLE_MAGIC;
+    handle_.lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+    handle_.fddev = -1;
+    handle_.fdfpgad = -1;
+    handle_.mmio_root = wsid_tracker_init(4);
+    ASSERT_NE(handle_.mmio_root, nullptr);
+
+    mmio_ = (uint8_t *)mmap(NULL, 4096, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(mmio_, MAP_FAILED);
+    ASSERT_TRUE(wsid_add(handle_.mmio_root, wsid_gen(),
+                         (uint64_t)mmio_, 0, 4096,
+                         (uint64_t)mmio_, 0, 0));
+    handle_.mmio_regions[0].len = 4096;
+    handle_.mmio_regions[0].base = mmio_;
+  }
+
+  virtual void TearDown() override {
+    if (handle_.mmio_regions[0].base)
+      munmap(mmio_, 4096);
+    wsid_tracker_cleanup(handle_.mmio_root, nullptr);
+  }
+
+  struct _fpga_handle handle_;
+  uint8_t *mmio_;
+};
+
+/**
+ * @test       drain
+ * @brief      Test: xfpga_mmio_quiesce
+ * @details    xfpga_mmio_quiesce waits for lock-free accesses<br>
+ *             in flight, withdraws the published regions, and<br>
+ *             makes later accesses fail with FPGA_INVALID_PARAM.<br>
+ */
+TEST_F(mmio_quiesce_f, drain) {
+  std::atomic<bool> done(false);
+  uint64_t value = 0;
+
+  // Simulate an access in flight.
+  __atomic_add_fetch(&handle_.mmio_regions[0].users, 1, __ATOMIC_SEQ_CST);
+
+  std::thread closer([&] {
+    xfpga_mmio_quiesce(&handle_);
+    done = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(done);
+
+  __atomic_sub_fetch(&handle_.mmio_regions[0].users, 1, __ATOMIC_SEQ_CST);
+  closer.join();
+  EXPECT_TRUE(done);
+
+  EXPECT_EQ(nullptr, handle_.mmio_regions[0].base);
+  EXPECT_EQ(FPGA_INVALID_PARAM,
+            xfpga_fpgaReadMMIO64(&handle_, 0, 0, &value));
+  EXPECT_EQ(0, handle_.mmio_regions[0].users);
+
+  munmap(mmio_, 4096);
+}
+
+/**
+ * @test       unmap_race
+ * @brief      Test: xfpga_fpgaReadMMIO64, xfpga_fpgaUnmapMMIO
+ * @details    Lock-free readers racing with xfpga_fpgaUnmapMMIO<br>
+ *             either complete against the live mapping or fail<br>
+ *             cleanly; none touches the region after it is unmapped.<br>
+ */
+TEST_F(mmio_quiesce_f, unmap_race) {
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> ok(0);
+  std::vector<std::thread> readers;
+
+  *(uint64_t *)mmio_ = 0xdecafbadfeedbeef;
+
+  for (int i = 0 ; i < 4 ; ++i) {
+    readers.emplace_back([&] {
+      uint64_t value = 0;
+      while (!stop) {
+        if (xfpga_fpgaReadMMIO64(&handle_, 0, 0, &value) == FPGA_OK) {
+          EXPECT_EQ(0xdecafbadfeedbeef, value);
+          ++ok;
+        }
+      }
+    });
+  }
+
+  while (ok < 1000)
+    std::this_thread::yield();
+
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaUnmapMMIO(&handle_, 0));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  stop = true;
+  for (auto &t : readers)
+    t.join();
+
+  EXPECT_EQ(nullptr, handle_.mmio_regions[0].base);
+  EXPECT_EQ(0, handle_.mmio_regions[0].users);
+}
+
+/**
+ * @test       unmap_other_region
+ * @brief      Test: xfpga_fpgaUnmapMMIO
+ * @details    xfpga_fpgaUnmapMMIO waits only for accesses to<br>
+ *             the region being unmapped. An access in flight<br>
+ *             to another region doesn't hold it up.<br>
+ */
+TEST_F(mmio_quiesce_f, unmap_other_region) {
+  std::atomic<bool> done(false);
+
+  // Simulate an access in flight to region 1.
+  __atomic_add_fetch(&handle_.mmio_regions[1].users, 1, __ATOMIC_SEQ_CST);
+
+  std::thread unmapper([&] {
+    EXPECT_EQ(FPGA_OK, xfpga_fpgaUnmapMMIO(&handle_, 0));
+    done = true;
+  });
+
+  for (int i = 0 ; i < 1000 && !done ; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_TRUE(done);
+
+  __atomic_sub_fetch(&handle_.mmio_regions[1].users, 1, __ATOMIC_SEQ_CST);
+  unmapper.join();
+
+  EXPECT_EQ(nullptr, handle_.mmio_regions[0].base);
+}
@@ -281,6 +281,34 @@ TEST_P(openclose_c_p, close_03) {
   accel_ = nullptr;
 }
 
+/**
+ * @test       open_lockless
+ *
+ * @brief      FPGA_OPEN_LOCKLESS_MMIO is a hint that xfpga accepts:
+ *             MMIO through xfpga handles is already lock-free.
+ *
+ */
+TEST_P(openclose_c_p, open_lockless) {
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaOpen(accel_token_, &accel_,
+                                    FPGA_OPEN_LOCKLESS_MMIO));
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaClose(accel_));
+  accel_ = nullptr;
+}
+
+/**
+ * @test       open_buffer_pool
+ *
+ * @brief      FPGA_OPEN_BUFFER_POOL is a hint that xfpga accepts and
+ *             ignores.
+ *
+ */
+TEST_P(openclose_c_p, open_buffer_pool) {
+  ASSERT_EQ(FPGA_OK, xfpga_fpgaOpen(accel_token_, &accel_,
+                                    FPGA_OPEN_BUFFER_POOL));
+  EXPECT_EQ(FPGA_OK, xfpga_fpgaClose(accel_));
+  accel_ = nullptr;
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(openclose_c_p);
 INSTANTIATE_TEST_SUITE_P(openclose_c, openclose_c_p, 
                          ::testing::ValuesIn(test_platform::platforms({
@@ -33,6 +33,7 @@ extern "C" {
 }
 
 #include <random>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -186,3 +187,75 @@ TEST_F(wsid_list_f, stress) {
   EXPECT_EQ(stress_count, 0);
   wsid_root_ = nullptr;
 }
+
+/**
+ * @test    wsid_table_add_find
+ * @brief   Test: wsid_table_add(), wsid_table_find(), wsid_table_phys()
+ * @details Each added workspace gets a unique, non-zero wsid<br>
+ *          that resolves to its own slot and IO address.
+ */
+TEST(wsid_table, add_find) {
+  struct wsid_table *table = wsid_table_init();
+  ASSERT_NE(table, nullptr);
+
+  std::vector<uint64_t> wsids;
+  uint64_t i;
+  for (i = 0; i < 3 * WSID_CHUNK_SLOTS; ++i) {
+    uint64_t wsid = 0;
+    ASSERT_TRUE(wsid_table_add(table, index_to_addr(i), index_to_phys(i),
+                               index_to_len(i), (int)i, &wsid));
+    EXPECT_NE(wsid, 0);
+    wsids.push_back(wsid);
+  }
+  EXPECT_EQ(table->n_chunks, 3);
+
+  for (i = 0; i < wsids.size(); ++i) {
+    wsid_slot *slot = wsid_table_find(table, wsids[i]);
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->addr, index_to_addr(i));
+    EXPECT_EQ(slot->len, index_to_len(i));
+    EXPECT_EQ(slot->flags, (int)i);
+
+    uint64_t phys = 0;
+    EXPECT_TRUE(wsid_table_phys(table, wsids[i], &phys));
+    EXPECT_EQ(phys, index_to_phys(i));
+  }
+
+  wsid_table_cleanup(table, nullptr);
+}
+
+/**
+ * @test    wsid_table_stale
+ * @brief   Test: wsid_table_del(), wsid_table_find(), wsid_table_phys()
+ * @details When a workspace is deleted, its wsid is no longer found,<br>
+ *          even after its slot is reused by a new workspace.<br>
+ *          Unknown and zero wsids are never found.
+ */
+TEST(wsid_table, stale) {
+  struct wsid_table *table = wsid_table_init();
+  ASSERT_NE(table, nullptr);
+
+  uint64_t phys = 0;
+  uint64_t old_wsid = 0;
+  uint64_t new_wsid = 0;
+
+  EXPECT_EQ(wsid_table_find(table, 0), nullptr);
+  EXPECT_FALSE(wsid_table_phys(table, 0x10000, &phys));
+
+  ASSERT_TRUE(wsid_table_add(table, 0x1000, 0x2000, 4096, 0, &old_wsid));
+  EXPECT_EQ(wsid_table_find(table, 0), nullptr);
+  EXPECT_TRUE(wsid_table_del(table, old_wsid));
+  EXPECT_FALSE(wsid_table_del(table, old_wsid));
+
+  ASSERT_TRUE(wsid_table_add(table, 0x3000, 0x4000, 4096, 0, &new_wsid));
+  // The slot is reused with a new generation.
+  EXPECT_EQ((uint32_t)new_wsid, (uint32_t)old_wsid);
+  EXPECT_NE(new_wsid, old_wsid);
+
+  EXPECT_EQ(wsid_table_find(table, old_wsid), nullptr);
+  EXPECT_FALSE(wsid_table_phys(table, old_wsid, &phys));
+  EXPECT_TRUE(wsid_table_phys(table, new_wsid, &phys));
+  EXPECT_EQ(phys, 0x4000);
+
+  wsid_table_cleanup(table, nullptr);
+}